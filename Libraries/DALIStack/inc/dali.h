@@ -21,14 +21,25 @@
 #ifndef DALI_H
 #define DALI_H
 
-extern volatile u8 dali_address;
-extern volatile u8 dali_data;
-extern volatile u8 dali_receive_status;
-extern volatile u8 dali_error;
-extern u8 dali_state;
+#include "dali_config.h"
+#include "DALIslave.h"
+#include "dali_col.h"
+
+/* frame mailbox and sender state of each DALI line */
+extern volatile u8 dali_address[DALI_LINES];
+extern volatile u8 dali_data[DALI_LINES];
+extern volatile u8 dali_receive_status[DALI_LINES];
+extern volatile u8 dali_error[DALI_LINES];
+extern volatile u8 dali_ext_bits[DALI_LINES];
+extern volatile u8 dali_ext_frame[DALI_LINES][DALI_FRAME_BYTES];
+extern u8 dali_state[DALI_LINES];
 
 //callback function type for light control
-typedef void TDLightControlCallback(u16 lighvalue);
+typedef void TDLightControlCallback(DALI_UNIT_PARAMS u16 lighvalue);
+
+//callback function type for frames of other sizes than 16 bits (DALI_FRAME_8/24/25),
+//frame: DALI_FRAME_BYTES bytes, first bit received = MSB of frame[0]
+typedef void TDFrameCallback(DALI_LINE_PARAMS u8 bits, u8 *frame);
 
 /*---CONSTANTS---*/
 /* Constants for dali_state*/
@@ -53,11 +64,21 @@ typedef void TDLightControlCallback(u16 lighvalue);
 
 /** public functions **/
 void DALI_Init(TDLightControlCallback LightControlFunction);
+u8 DALI_SetClock(u8 run_ckdivr, u8 idle_ckdivr);
 u8 DALI_TimerStatus(void);
 u8 DALI_CheckAndExecuteTimer(void);
 u8 DALI_CheckAndExecuteReceivedCommand(void);
 void DALI_halt(void);
-void DALI_Set_Lamp_Failure(u8 failure);
+u8 DALI_Bus_Idle(void);
+void DALI_Set_Lamp_Failure(DALI_UNIT_PARAMS u8 failure);
+u8 DALI_Read_Register(DALI_UNIT_PARAMS u8 idx);
+void DALI_Light_On_Done(void);
+void DALI_Set_Frame_Callback(TDFrameCallback FrameFunction);
+u8 DALI_Send_Forward_Frame(DALI_LINE_PARAMS u8 bits, u8 *frame, u8 priority);
+u8 DALI_Forward_Frame_Status(DALI_LINE_PARAM);
+#ifdef DALI_COLOUR
+void DALI_Set_Colour_Callback(TDCColourControlCallback ColourControlFunction);
+#endif
 
 void Send_DALI_Frame(u8);
 u8 Get_DALI_Random(void);
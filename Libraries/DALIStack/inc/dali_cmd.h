@@ -22,6 +22,9 @@
 #define DALI_CMD_H
 
 /** public data **/
+/* vendor special commands (reserved special command range) */
+#define DALIC_SELECT_BY_SERIAL  30  /* address 0xDD: select by serial number in bank 0 */
+
 /** public functions **/
 
 void  DALIC_Init(void);
@@ -29,6 +32,8 @@ u8 	  DALIC_isTalkingToMe(void);
 void  DALIC_ProcessCommand(void);
 void  DALIC_Process_System_Failure(void);
 void  DALIC_PowerOn(void);
+void  DALIC_Select_By_Serial(u8);
+u8    DALIC_Is_Repeated(void);
 
 #endif
 
@@ -0,0 +1,107 @@
+/**
+  ******************************************************************************
+  * @file    dali_col.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Colour control (IEC 62386-209, device type 8) - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_COL_H
+#define DALI_COL_H
+
+#include "stm8s.h"
+#include "dali_config.h"
+
+/*---CONSTANTS---*/
+/* colour types, values as the type bits of QUERY COLOUR STATUS */
+#define DALICOL_TYPE_NONE       0x00
+#define DALICOL_TYPE_TC         0x20
+#define DALICOL_TYPE_PRIMARY    0x40
+#define DALICOL_TYPE_RGBWAF     0x80
+
+/* QUERY COLOUR STATUS flags */
+#define DALICOL_STATUS_TC_OUT_OF_RANGE  0x02
+
+/* QUERY GEAR FEATURES/STATUS flags */
+#define DALICOL_FEATURE_AUTO_ACTIVATION 0x01
+
+#define DALICOL_MASK            0xFFFF  /* 16 bit value not changed */
+#define DALICOL_LEVEL_MAX       0xFFFE  /* full output of a primary */
+
+#if (DALICOL_PRIMARIES == 2)
+ #define DALICOL_TC_CAPABLE     1       /* output 0 warm white, output 1 cool white */
+#else
+ #define DALICOL_TC_CAPABLE     0
+#endif
+
+#if (DALICOL_PRIMARIES < 1) || (DALICOL_PRIMARIES > 6)
+ #error "DALICOL_PRIMARIES out of range (1..6)"
+#endif
+
+/*---TYPES---*/
+/* output of one primary of a unit, value is the arc power level (linear,
+   as passed to the light control callback) scaled by the colour share */
+typedef void TDCColourControlCallback(DALI_UNIT_PARAMS u8 primary, u16 value);
+
+/* colour state of one unit (part of TDALIContext).
+   Temporary values are loaded by the SET TEMPORARY commands, ACTIVATE (or
+   an arc power command with auto activation) makes them actual: the share
+   of each primary is looked up once (Tc mixing table or level scaling) and
+   a linear fade of the shares is set up, each ms tick then costs one
+   addition per primary and the output one multiplication per primary. */
+typedef struct
+{
+  u16 TempTc;                          /* mirek */
+  u16 TempLevel[DALICOL_PRIMARIES];    /* 0..DALICOL_LEVEL_MAX */
+  u8  TempControl;                     /* RGBWAF control */
+  u8  TempType;
+
+  u16 Tc;
+  u16 Level[DALICOL_PRIMARIES];
+  u8  Control;
+  u8  Type;
+  u8  Status;
+
+  u16 TcCoolest;                       /* Tc limits (mirek) */
+  u16 TcWarmest;
+  u8  Features;
+
+  u32 Share[DALICOL_PRIMARIES];        /* Q16.16 share of the arc level */
+  u32 Step[DALICOL_PRIMARIES];         /* added each tick (two's complement) */
+  u16 Goal[DALICOL_PRIMARIES];
+  u32 FadeTicks;                       /* ticks to the end of the colour fade */
+  u16 Light;                           /* last arc level (linear) */
+  u8  Dirty;                           /* shares changed, outputs not updated */
+} TDALIColour;
+
+/*---VARIABLES---*/
+extern TDCColourControlCallback *DALICol_Callback;
+extern CONST u16 DALICol_TcTable[DALICOL_TC_STEPS + 1];
+
+/*---FUNCTIONS---*/
+void DALICol_Init(void);
+void DALICol_Reset(void);
+void DALICol_Light(DALI_UNIT_PARAMS u16 light);
+void DALICol_Auto_Activate(u32 ticks);
+void DALICol_TimerCallback(void);
+void DALICol_Flush(void);
+
+/* extended command set of device type 8 (see DALIP_Extensions) */
+u8 DALICol_Ext_Cmd_Is_Answer_Required(u8 command);
+u8 DALICol_Ext_Cmd_Is_Answer_YesNo(u8 command);
+u8 DALICol_Extended_Command(u8 command);
+u8 DALICol_Extended_Version_Number(void);
+
+#endif
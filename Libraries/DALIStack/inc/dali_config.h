@@ -22,9 +22,25 @@
 #define DALI_CONFIG_H
 
 #include "stm8s.h"
+#include "DALIslave.h"
+
+/* --- Logical control gear units on one bus interface (see dali_ctx.h) --- */
+#ifndef DALI_INSTANCES
+ #define DALI_INSTANCES    1
+#endif
+#if (DALI_INSTANCES + DALI_LINES > 256)
+ #error "unit index is u8: at most 256 - DALI_LINES units"
+#endif
+
+/* light control callbacks and unit API get the unit index if there are more units */
+#if (DALI_INSTANCES > 1)
+ #define DALI_UNIT_PARAMS  u8 unit,
+#else
+ #define DALI_UNIT_PARAMS
+#endif
 
 //callback function type for light control
-typedef void TLightControlCallback(u16 lighvalue);
+typedef void TLightControlCallback(DALI_UNIT_PARAMS u16 lighvalue);
 
 /* defines if device is physically selected */
 extern volatile u8 Physically_Selected;
@@ -39,13 +55,47 @@ extern volatile u8 Physically_Selected;
 #define IN_DALI_PIN        0
 #define INVERT_IN_DALI     0
 
-/* pushbutton for device physical selection */
-#define DALI_BUTTON_PORT   GPIOB //PB4 = button to GND
-#define DALI_BUTTON_PIN    4
+/* IO pins of the second DALI line (DALI_LINES > 1 in DALIslave.h),
+   unit n is served on line n % DALI_LINES */
+#define OUT_DALI2_PORT     GPIOE //PE7 = TX
+#define OUT_DALI2_PIN      7
+#define INVERT_OUT_DALI2   0
+
+#define IN_DALI2_PORT      GPIOE //PE6 = RX
+#define IN_DALI2_PIN       6
+#define INVERT_IN_DALI2    0
+
+/* pushbutton for device physical selection, pull-up Vdd control for energy
+   saving in halt: off PB4/PB5 if these are I2C pins (DALI_I2C_SLAVE) */
+#ifdef DALI_I2C_SLAVE
+ #define DALI_BUTTON_PORT  GPIOC //PC4 = button to GND
+ #define DALI_BUTTON_PIN   4
+ #define DALI_PULLUP_PORT  GPIOC //PC5 = Vdd for pull-up for LED in optocoupler
+ #define DALI_PULLUP_PIN   5
+#else
+ #define DALI_BUTTON_PORT  GPIOB //PB4 = button to GND
+ #define DALI_BUTTON_PIN   4
+ #define DALI_PULLUP_PORT  GPIOB //PB5 = Vdd for pull-up for LED in optocoupler
+ #define DALI_PULLUP_PIN   5
+#endif
 
-/* pull-up Vdd control for energy saving in halt */
-#define DALI_PULLUP_PORT   GPIOB //PB5 = Vdd for pull-up for LED in optocoupler
-#define DALI_PULLUP_PIN    5
+/* analog input sampled at start-up as noise source for random address */
+#define DALI_RANDOM_ADC_CHANNEL  ADC1_CHANNEL_2 //PB2 = AIN2, unused
+#define DALI_RANDOM_ADC_SCHMITT  ADC1_SCHMITTTRIG_CHANNEL2
+
+/* --- Memory banks (see DALIM_Banks in dali_config.c) --- */
+/* Uncomment the line below to take firmware updates over the bus through
+   memory bank 3 into slot B of program memory (see dali_fwu.h: boot area,
+   UBC option byte and linker settings; needs RAM_EXECUTION in stm8s.h) */
+/* #define DALI_FW_UPDATE  (1) */
+#ifdef DALI_FW_UPDATE
+ #define DALIM_BANKS_CNT   4    // bank 2 = diagnostics (dali_diag.h), bank 3 = firmware update
+#else
+ #define DALIM_BANKS_CNT   3    // bank 2 = diagnostics (dali_diag.h)
+#endif
+#define DALIM_BANK0_SIZE   0x20
+#define DALIM_BANK1_SIZE   0x20
+#define DALIM_E2_SIZE      (DALIM_BANK0_SIZE + DALIM_BANK1_SIZE) // EEPROM backed banks
 
 
 
@@ -85,4 +135,16 @@ extern volatile u8 Physically_Selected;
         255        Control gear supports more than one device type
         */
 
+/*  ------------------------ colour control ------------------------ */
+/* Uncomment the line below to add colour control (IEC 62386-209, device
+   type 8) to each unit next to DEVICE_TYPE: QUERY DEVICE TYPE answers 255,
+   ENABLE DEVICE TYPE 6 or 8 selects the extended command set (see
+   DALIP_Extensions in dali_config.c). Each unit then drives
+   DALICOL_PRIMARIES outputs through the colour callback (see dali_col.h) */
+/* #define DALI_COLOUR  (1) */
+#define DALICOL_PRIMARIES   2      // outputs per unit (1..6), 2 = warm + cool white
+#define DALICOL_TC_COOLEST  153    // mirek of the cool white output (6500K)
+#define DALICOL_TC_WARMEST  370    // mirek of the warm white output (2700K)
+#define DALICOL_TC_STEPS    16     // intervals of DALICol_TcTable (dali_config.c)
+
 #endif
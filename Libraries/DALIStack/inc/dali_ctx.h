@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file    dali_ctx.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   State of logical control gear units - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_CTX_H
+#define DALI_CTX_H
+
+#include "stm8s.h"
+#include "dali_config.h"
+#include "dali_regs.h"
+#include "dali_col.h"
+
+/*---TYPES---*/
+/* All state of one logical control gear unit. The stack code works on the
+   active unit through DALI_CTX:
+   - DALI_INSTANCES == 1: DALI_CTX is the constant address of the only
+     context, fields are accessed directly like former globals (no overhead)
+   - DALI_INSTANCES > 1: DALI_CTX is the pointer selected by DALI_SELECT,
+     the stack selects each unit before it runs the unit code, a received
+     frame is passed to all units
+   Bus interface state (frame mailbox, IO driver) is not part of it. */
+typedef struct
+{
+  /* frame being processed (dali.c, dali_cmd.c) */
+  u8 address;
+  u8 data;
+
+  /* registers (dali_regs.c) */
+  u8 RAMRegs[DALIREG_RAM_END - DALIREG_RAM_START];
+  u8 short_addr;
+
+  /* command layer (dali_cmd.c) */
+  u8 dtr;
+  u8 dtr1;
+  u8 dtr2;
+  u8 write_enable_membanks;
+  u8 iBufferedCmdHi;
+  u8 iBufferedCmdLo;
+  u8 b_status_reg;
+  u8 ext_selected;              /* DALIP_Extensions index of ENABLE DEVICE TYPE X */
+
+  /* fading and light control (dali_pub.c) */
+  u32 iChangeEvery;
+  u32 iChangeCountdown;
+  u8 bIncrease;
+  u8 bOff_AfterFade;
+  u8 iMaxLevel;
+  u8 iMinLevel;
+  u8 FadeGoal;
+  u8 bEnable_DAPC;
+  u8 bDAPCTrack;                /* DAPC sequence: output follows the trajectory */
+  u8 DAPCInterval;              /* ms between the last two DAPC commands */
+  u8 DAPCRate;                  /* averaged DAPC command interval (ms), 0 = none yet */
+  u16 DAPCPos;                  /* trajectory position, arc level Q8.8 */
+  s16 DAPCStep;                 /* trajectory slope, Q8.8 per ms */
+#if (DEVICE_TYPE == 6)          /* LED type device */
+  u8 FastFade;
+  u8 CurveType;
+#endif
+  TLightControlCallback *LightControlCallback;
+#ifdef DALI_COLOUR
+  TDALIColour Colour;           /* colour control (dali_col.c) */
+#endif
+
+  /* timers (lite_timer_8bit.c), big timer and countdown run in the 1ms interrupt */
+  u8  RealTimeClock_BigTimer;
+  u8  bigtimermins;
+  u16 bigtimertics;
+  u16 RealTimeClock_TimerCountDown;
+  u8  UserTimerActive;
+  u8  DAPCTimerActive;
+  u16 PowerOnTimerActive;
+
+#if (DALI_INSTANCES > 1)
+  u8 unit;                      /* index in DALI_Contexts */
+#endif
+} TDALIContext;
+
+/*---VARIABLES---*/
+extern TDALIContext DALI_Contexts[DALI_INSTANCES];
+
+/*---MACROS---*/
+/* size of the register image of one unit in EEPROM */
+#define DALI_E2_REGS_SIZE  (DALIREG_EEPROM_END - DALIREG_EEPROM_START)
+#define DALI_E2_IMAGES_SIZE (DALI_INSTANCES * DALI_E2_REGS_SIZE)
+
+/* eeprom_variable (eeprom.c): signature (4 bytes), register image of each
+   unit, user area (DALIP_Read_E2). 125 bytes on the target, room for the
+   images of 4 units; host builds size it from DALI_INSTANCES (see
+   Utilities/HostShim), a simulator runs up to 255 units in one process.
+   Addresses in it behind the signature are u8 as long as they fit. */
+#ifndef DALI_E2_SIZE
+ #define DALI_E2_SIZE      125
+#endif
+#if (DALI_E2_SIZE > 256)
+typedef u16 TDALIE2Addr;
+#else
+typedef u8 TDALIE2Addr;
+#endif
+
+/* DALI_Active is a selector, not a context argument passed down the calls:
+   - all code using DALI_CTX runs in the main loop, one unit at a time: the
+     entry points select the unit first (DALI_Init,
+     DALI_CheckAndExecuteReceivedCommand, DALI_CheckAndExecuteTimer and
+     EEPROM_Process per unit, DALI_Set_Lamp_Failure and DALI_Read_Register
+     by their unit argument), nothing is interleaved
+   - interrupt code never uses DALI_CTX nor DALI_SELECT: the 1ms interrupt
+     (Lite_timer_Interrupt) walks DALI_Contexts with a local pointer, the
+     bus interrupts only fill the frame mailbox, so the selection of the
+     main loop cannot change under it
+   - one pointer in RAM instead of a pointer argument through every stack
+     function keeps the DALI_INSTANCES == 1 build unchanged
+   Many units in one process are DALI_INSTANCES contexts of one stack, as
+   the host simulators build it (Utilities/LineSim runs hundreds); a second
+   stack in the same process needs its own copy of the globals, renamed
+   like the controller of Utilities/HostShim/hostctl.c. */
+#if (DALI_INSTANCES > 1)
+extern TDALIContext *DALI_Active;
+ #define DALI_CTX          DALI_Active
+ #define DALI_SELECT(u)    (DALI_Active = &DALI_Contexts[u])
+ #define DALI_UNIT_ARGS    DALI_Active->unit,
+ #define DALI_E2_BASE      ((TDALIE2Addr)(DALI_Active->unit * DALI_E2_REGS_SIZE))
+#else
+ #define DALI_CTX          (&DALI_Contexts[0])
+ #define DALI_SELECT(u)
+ #define DALI_UNIT_ARGS
+ #define DALI_E2_BASE      0
+#endif
+
+#endif
@@ -0,0 +1,39 @@
+/* Dimming curves of DALIP_ConvertARC - generated by Utilities/ArcCurves
+   (arccurves -o Libraries/DALIStack/inc/dali_curves.h log linear gamma:2.2), do not edit */
+
+#ifndef DALI_CURVES_H
+#define DALI_CURVES_H
+
+#define DALIP_CURVES_CNT   3
+#define DALIP_CURVE_KNOTS  66  /* value at arc level 4k-2, k = 0..65 */
+
+#define DALIP_CURVES_TABLE \
+  /* 0: log */ \
+  { \
+       66,    67,    75,    84,    93,   104,   116,   130,   145,   161,   180, \
+      201,   224,   250,   279,   311,   347,   387,   431,   481,   536,   598, \
+      667,   744,   830,   926,  1033,  1152,  1285,  1433,  1599,  1783,  1989, \
+     2219,  2475,  2760,  3079,  3434,  3831,  4273,  4766,  5316,  5929,  6613, \
+     7377,  8228,  9177, 10236, 11418, 12735, 14205, 15844, 17673, 19712, 21987, \
+    24524, 27354, 30511, 34032, 37959, 42340, 47226, 52676, 58755, 65535, 65535 \
+  }, \
+  /* 1: linear */ \
+  { \
+    65025,   516,  1548,  2580,  3612,  4644,  5676,  6708,  7740,  8772,  9804, \
+    10836, 11869, 12901, 13933, 14965, 15997, 17029, 18061, 19093, 20125, 21157, \
+    22189, 23221, 24253, 25285, 26317, 27349, 28381, 29413, 30445, 31477, 32509, \
+    33542, 34574, 35606, 36638, 37670, 38702, 39734, 40766, 41798, 42830, 43862, \
+    44894, 45926, 46958, 47990, 49022, 50054, 51086, 52118, 53150, 54182, 55215, \
+    56247, 57279, 58311, 59343, 60375, 61407, 62439, 63471, 64503, 65535, 65535 \
+  }, \
+  /* 2: gamma:2.2 */ \
+  { \
+    65535,     2,    17,    53,   112,   194,   301,   435,   596,   785,  1003, \
+     1250,  1527,  1835,  2173,  2543,  2945,  3379,  3846,  4347,  4880,  5448, \
+     6050,  6686,  7357,  8064,  8806,  9583, 10397, 11247, 12133, 13057, 14017, \
+    15015, 16050, 17123, 18234, 19383, 20570, 21796, 23061, 24365, 25709, 27091, \
+    28513, 29975, 31477, 33019, 34602, 36225, 37888, 39592, 41338, 43124, 44952, \
+    46821, 48732, 50685, 52679, 54716, 56795, 58916, 61080, 63286, 65535, 65535 \
+  } \
+
+#endif
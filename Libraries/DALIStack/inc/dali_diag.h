@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+  * @file    dali_diag.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Diagnostic counters and diagnostic memory bank - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_DIAG_H
+#define DALI_DIAG_H
+
+/*---CONSTANTS---*/
+/* Diagnostic memory bank layout, counters are 32 bit, MSB first */
+#define DALID_VERSION            4
+#define DALID_LOC_VERSION        0x02  /* layout version */
+#define DALID_LOC_FRAMES         0x03  /* forward frames received without error */
+#define DALID_LOC_ACCEPTED       0x07  /* frames addressed to this device */
+#define DALID_LOC_ERR_START      0x0B  /* decoder: start bit too long */
+#define DALID_LOC_ERR_STOP       0x0F  /* decoder: edge or wrong level in stop bits */
+#define DALID_LOC_ERR_EDGE       0x13  /* decoder: missing edge in data bits */
+#define DALID_LOC_REPLIES        0x17  /* backward frames sent */
+#define DALID_LOC_REP_TIMEOUTS   0x1B  /* configuration command not repeated in time */
+#define DALID_LOC_IF_FAILURES    0x1F  /* interface failures */
+#define DALID_LOC_E2_WRITES      0x23  /* EEPROM bytes programmed */
+#define DALID_LOC_UPTIME         0x27  /* seconds since reset, halt not counted */
+#define DALID_LOC_ISR_MAX        0x2B  /* longest DALI timer interrupt (us), above the
+                                          tick period (104us): ticks were lost */
+#define DALID_LOC_BOOT_LIGHT     0x2F  /* DALI_Init to power on level at the outputs (us) */
+#define DALID_LOC_BOOT_FRAME     0x33  /* DALI_Init to first frame received (us) */
+#define DALID_LOC_TX_FRAMES      0x37  /* forward frames sent as bus master */
+#define DALID_LOC_COLLISIONS     0x3B  /* collisions while sending forward frames */
+#define DALID_LOC_TICK_JITTER    0x3F  /* spread of the timer interrupt entry during frames
+                                          (us), within DALI_LATENCY_BUDGET_US */
+#define DALID_BANK_SIZE          0x43
+
+/* boot latencies not measured (yet): 0xFFFFFFFF in the bank */
+#define DALID_BOOT_NONE          0xFFFF
+
+/*---TYPES---*/
+/* counters of the DALI stack (bus counters are in TDALIStats of the driver) */
+typedef struct
+{
+  u32 accepted;
+  u32 rep_timeouts;
+  u32 e2_writes;
+  u32 uptime;
+} TDALIDCounters;
+
+/* boot latencies in DALI timer ticks (1/TICKS_PER_SECOND s) from its start
+   at the beginning of DALI_Init, earlier startup (C runtime, clock, outputs
+   setup) is not counted */
+typedef struct
+{
+  u16 light;     /* set by DALI_Light_On_Done */
+  u16 frame;     /* set by the first DALI_Interrupt */
+} TDALIDBoot;
+
+/*---VARIABLES---*/
+extern TDALIDCounters DALID_Counters;
+extern u16 DALID_UptimeMs;
+extern TDALIDBoot DALID_Boot;
+extern u8 DALID_Bank[DALID_BANK_SIZE];
+
+/*---FUNCTIONS---*/
+void DALID_ReadHook(u8 addr);
+
+#endif
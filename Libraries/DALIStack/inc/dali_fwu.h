@@ -0,0 +1,192 @@
+/**
+  ******************************************************************************
+  * @file    dali_fwu.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   This file contains DALI firmware update definitions
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_FWU_H
+#define DALI_FWU_H
+
+#include "dali_config.h"
+#include "stm8s_flash.h"
+
+/* Firmware update over the bus (DALI_FW_UPDATE in dali_config.h).
+
+   Program memory (STM8S105, 32KB):
+     0x8000 DALIU_BOOT     boot area: boot vector table and the swap of
+                           dali_boot.c, write protected by the UBC option
+                           byte (OPT1 = DALIU_BOOT_SIZE / 512 = 0x02, NOPT1 =
+                           0xFD), never received nor swapped
+     0x8400 DALIU_SLOT_A   firmware, its own vector table first
+     0xC000 DALIU_SLOT_B   image received, previous image after INSTALL
+     0xFC00 DALIU_SCRATCH  one block, swap buffer
+   The boot vectors forward each interrupt to the same vector of slot A,
+   the reset vector enters DALIU_Boot. The firmware must be linked into the
+   boot area and slot A only:
+   - IAR: lnkstm8s105c6.icf with DALI_FW_UPDATE defined for the linker
+     (--config_def DALI_FW_UPDATE=1)
+   - Cosmic: vector file address 0x8400, +seg .const -b 0x8480 -m 0x3b80,
+     +seg .daliu -b 0x8000 -m 0x400 for the segments of dali_boot.c, .eeprom
+     up to DALIU_E2_ADDRESS (-m 0x3e0)
+   - Raisonance: CODESTART(0x8400) CODESIZE(0x3C00), dali_boot.c at 0x8000
+   The image transferred is slot A (the program memory from 0x8400); the
+   boot area of a new build is not, keep dali_boot.c and the record layout
+   of DALIU_E2 the same in all versions. DALIU_Verify rejects an image
+   which is not linked for slot A (DALIU_ERR_IMAGE).
+
+   INSTALL, ROLLBACK and DALIU_TRIALS resets of a new image before it is
+   confirmed write DALIU_SWAPPING to the update record and reset: the boot
+   swaps the slots before it starts the firmware, a block at a time through
+   the scratch block, with word programming run from the boot area (the
+   CPU stalls). Its progress is kept in the record, after a power failure
+   or reset the swap goes on from the last step, so the slots are never
+   left mixed. The swap takes up to 3 x DALIU_SLOT_BLOCKS x 32 x 6ms (about
+   70s), words which are the same in both slots are skipped. A new image
+   runs on trial with the independent watchdog armed (about 1s, refreshed
+   by DALIU_Process): a hanging image resets, and after DALIU_TRIALS resets
+   the previous image comes back.
+
+   Transfer: vendor memory bank DALIU_BANK, unlocked by 0x55 in location 2.
+   Data are written by WRITE MEMORY LOCATION - NO REPLY (one payload byte
+   per forward frame, no backward frame to wait for), the DTR auto
+   increment walks through a window of one flash block. Per block the
+   controller sends DTR = DALIU_LOC_BLOCK, ENABLE WRITE MEMORY (twice),
+   then block number, CRC-16 of the block data and FLASH_BLOCK_SIZE data
+   bytes: 7 frames of overhead per 128 bytes. The write of the last
+   window location hands the block to the programmer, which programs it in
+   the settling time before the next forward frame (about 6ms, the bus
+   keeps streaming). A block with a wrong number or CRC-16 is dropped: the
+   controller checks DALIU_LOC_NEXT now and then and goes back to it.
+   The next block expected is kept in EEPROM, START with the same image
+   size and CRC-32 resumes an interrupted transfer, after a reset too. The
+   CRC-32 of the whole image is checked on the programmed slot.
+   Utilities/FwuSim runs the transfer, the swap and the trial on this code. */
+#define DALIU_BANK          3
+#define DALIU_BANK_SIZE     (DALIU_LOC_DATA + FLASH_BLOCK_SIZE)
+
+/* memory bank locations, 16 and 32 bit values MSB first */
+#define DALIU_LOC_COMMAND   0x03  /* write: DALIU_CMD_xxx, read: state DALIU_xxx */
+#define DALIU_LOC_ERROR     0x04  /* last error DALIU_ERR_xxx (read only) */
+#define DALIU_LOC_BLOCK_SIZE 0x05 /* FLASH_BLOCK_SIZE (read only) */
+#define DALIU_LOC_NEXT      0x06  /* 2 bytes: next block expected (read only) */
+#define DALIU_LOC_BLOCKS    0x08  /* 2 bytes: image size in blocks (before START) */
+#define DALIU_LOC_CRC       0x0A  /* 4 bytes: CRC-32 of the image (before START) */
+#define DALIU_LOC_BLOCK     0x0E  /* window: 2 bytes block number, */
+#define DALIU_LOC_BLOCK_CRC 0x10  /* 2 bytes CRC-16 of the data, */
+#define DALIU_LOC_DATA      0x12  /* FLASH_BLOCK_SIZE data bytes */
+
+/* commands */
+#define DALIU_CMD_START     0x01  /* receive DALIU_LOC_BLOCKS blocks into slot B (or resume) */
+#define DALIU_CMD_INSTALL   0x02  /* DALIU_READY: swap slots and reset */
+#define DALIU_CMD_ABORT     0x03  /* forget the image being received */
+#define DALIU_CMD_ROLLBACK  0x04  /* DALIU_TRIAL or DALIU_CONFIRMED: swap slots back and reset */
+#define DALIU_CMD_CONFIRM   0x05  /* DALIU_TRIAL: keep the new image */
+
+/* states */
+#define DALIU_IDLE          0x00
+#define DALIU_RECEIVING     0x01
+#define DALIU_VERIFYING     0x02  /* all blocks programmed, CRC-32 being checked */
+#define DALIU_READY         0x03  /* verified image in slot B */
+#define DALIU_TRIAL         0x04  /* new image installed, previous one in slot B */
+#define DALIU_CONFIRMED     0x05  /* new image confirmed, previous one in slot B */
+#define DALIU_ROLLED_BACK   0x06  /* previous image restored, rejected one in slot B */
+#define DALIU_SWAPPING      0x07  /* record only: slots swapped by the boot */
+
+/* errors */
+#define DALIU_ERR_NONE      0x00
+#define DALIU_ERR_SIZE      0x01  /* image larger than a slot */
+#define DALIU_ERR_SEQUENCE  0x02  /* block number is not the next one */
+#define DALIU_ERR_BLOCK_CRC 0x03  /* CRC-16 of the block wrong */
+#define DALIU_ERR_IMAGE_CRC 0x04  /* CRC-32 of the image wrong, transfer restarts */
+#define DALIU_ERR_STATE     0x05  /* command not allowed now */
+#define DALIU_ERR_FLASH     0x06  /* block programming failed */
+#define DALIU_ERR_BUSY      0x07  /* previous block not programmed yet */
+#define DALIU_ERR_IMAGE     0x08  /* image not linked for slot A */
+
+/* program memory layout (first 64KB), FLASH_BLOCK_SIZE aligned: the boot
+   area is a whole number of UBC pages, smaller DALIU_SLOT_SIZE on parts
+   with less than 32KB of program memory */
+#define DALIU_BOOT          0x8000
+#ifndef DALIU_BOOT_SIZE
+ #define DALIU_BOOT_SIZE    0x0400
+#endif
+#ifndef DALIU_SLOT_SIZE
+ #define DALIU_SLOT_SIZE    0x3C00
+#endif
+#define DALIU_SLOT_A        (DALIU_BOOT + DALIU_BOOT_SIZE)
+#define DALIU_SLOT_B        (DALIU_SLOT_A + DALIU_SLOT_SIZE)
+#define DALIU_SCRATCH       (DALIU_SLOT_B + DALIU_SLOT_SIZE)
+#define DALIU_SLOT_BLOCKS   (DALIU_SLOT_SIZE / FLASH_BLOCK_SIZE)
+#define DALIU_VECTORS       32    /* interrupt vectors of 4 bytes: INT opcode, 24 bit address */
+
+/* update record: last 32 bytes of data EEPROM, at the same address in all
+   versions (the boot reads it), 16 bit values MSB first */
+#ifndef DALIU_E2_ADDRESS
+ #if defined (STM8S208) || defined (STM8S207) || defined (STM8AF52Ax)
+  #define DALIU_E2_ADDRESS  0x47E0
+ #elif defined (STM8S103) || defined (STM8S903)
+  #define DALIU_E2_ADDRESS  0x4260
+ #else
+  #define DALIU_E2_ADDRESS  0x43E0
+ #endif
+#endif
+#define DALIU_E2_PROGRESS   0   /* 2 words of 4 bytes: swap steps done, MSB first, then
+                                   both bytes complemented; step n goes to word n & 1 */
+#define DALIU_E2_TARGET     8   /* state after the swap */
+#define DALIU_E2_STATE      9   /* state, DALIU_SWAPPING until the boot swapped */
+#define DALIU_E2_TRIALS     10  /* resets of the image in DALIU_TRIAL */
+#define DALIU_E2_BLOCKS     11  /* image size in blocks */
+#define DALIU_E2_CRC        13  /* CRC-32 of the image */
+#define DALIU_E2_NEXT       17  /* next block to receive */
+#define DALIU_E2_SIZE       19
+
+/* byte of program memory or data EEPROM by address, store of a byte (host
+   builds of Utilities redirect both) */
+#ifndef DALIU_MEM
+ #define DALIU_MEM(addr)          (*(volatile PointerAttr u8 *)(addr))
+#endif
+#ifndef DALIU_WRITE
+ #define DALIU_WRITE(addr, val)   (DALIU_MEM(addr) = (val))
+#endif
+/* software reset: WWDG with T6 cleared resets at once */
+#ifndef DALIU_RESET
+ #define DALIU_RESET()            do { WWDG->CR = WWDG_CR_WDGA; while (1) ; } while (0)
+#endif
+
+/* block programming stalls the CPU, interrupts included (DALI_LATENCY_BUDGET_US
+   does not hold): it starts only while a line has been idle for at most
+   DALIU_PROGRAM_IDLE_MAX ticks after a frame, so the stall ends before the
+   shortest settling time of the next forward frame (13.5ms, 130 ticks) */
+#define DALIU_STALL_TICKS   58    /* standard block programming, 6ms */
+#define DALIU_PROGRAM_IDLE_MAX (130 - DALIU_STALL_TICKS - 16)
+
+#define DALIU_TRIALS        3     /* resets of a new image before it is rolled back */
+#define DALIU_CONFIRM_S     60    /* uptime after which a new image confirms itself */
+#define DALIU_VERIFY_CHUNK  16    /* bytes checked per ms */
+
+/*---VARIABLES---*/
+extern u8 DALIU_Bank[DALIU_BANK_SIZE];
+
+/*---FUNCTIONS---*/
+void DALIU_Init(void);
+u8 DALIU_Process(void);
+u8 DALIU_Watchdog(void);
+void DALIU_WriteHook(u8 addr, u8 data);
+void DALIU_BootSwap(void);
+void DALIU_Boot(void);
+
+#endif
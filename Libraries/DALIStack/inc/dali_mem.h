@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file    dali_mem.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   DALI memory banks - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_MEM_H
+#define DALI_MEM_H
+
+#include "dali_config.h"
+
+/*---CONSTANTS---*/
+/* backing of memory bank content */
+#define DALIM_FLASH       0   /* constant image in flash */
+#define DALIM_EEPROM      1   /* image in EEPROM, read from RAM cache */
+#define DALIM_RAM         2   /* live data in RAM */
+
+/* lock policy */
+#define DALIM_READ_ONLY   0   /* no location writable */
+#define DALIM_LOCK_BYTE   1   /* location 2 = lock byte, others writable if it is 0x55 */
+#define DALIM_WRITABLE    2   /* all locations from 2 writable */
+
+#define DALIM_UNLOCKED    0x55
+
+/*---TYPES---*/
+/* called before location is read (live data refresh) */
+typedef void TDALIMReadHook(u8 addr);
+/* called after location was written */
+typedef void TDALIMWriteHook(u8 addr, u8 data);
+
+/* memory bank descriptor: location 0 (last location) is given by size,
+   location 1 (checksum) is maintained by the memory bank module */
+typedef struct
+{
+  u8 size;                      /* number of locations */
+  u8 backing;                   /* DALIM_FLASH, DALIM_EEPROM or DALIM_RAM */
+  u8 lock;                      /* DALIM_READ_ONLY, DALIM_LOCK_BYTE or DALIM_WRITABLE */
+  u8 open_addr;                 /* location writable in spite of lock byte, 0 = none */
+  u8 e2_offset;                 /* DALIM_EEPROM: first byte in DALIM_E2 */
+  CONST u8 *image;              /* DALIM_FLASH: bank content */
+  u8 *ram;                      /* DALIM_RAM: bank content */
+  TDALIMReadHook *read_hook;    /* may be 0 */
+  TDALIMWriteHook *write_hook;  /* may be 0 */
+} TDALIMBank;
+
+/*---VARIABLES---*/
+extern CONST TDALIMBank DALIM_Banks[DALIM_BANKS_CNT];
+#ifdef _IAR_
+extern u8 DALIM_E2[DALIM_E2_SIZE];
+#else
+extern EEPROM u8 DALIM_E2[DALIM_E2_SIZE];
+#endif
+
+/*---FUNCTIONS---*/
+void DALIM_Init(void);
+u8 DALIM_LastLocation(u8 bank);
+u8 DALIM_Read(u8 bank, u8 addr);
+u8 DALIM_Peek(u8 bank, u8 addr);
+u8 DALIM_Write(u8 bank, u8 addr, u8 data);
+u8 DALIM_Process_Writes(void);
+
+#endif
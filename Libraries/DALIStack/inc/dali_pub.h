@@ -22,8 +22,11 @@
 #ifndef DALI_PUB_H
 #define DALI_PUB_H
 
+#include "stm8s.h"
+#include "dali_config.h"
+
 //callback function type for light control
-typedef void TDPLightControlCallback(u16 lighvalue);
+typedef void TDPLightControlCallback(DALI_UNIT_PARAMS u16 lighvalue);
 
 /* Public Functions */
 void DALIP_Init(TDPLightControlCallback LightControlFunction);
@@ -152,6 +155,29 @@ void DALIP_Try_DAPC_Sequence(void);
 u8 DALIP_What_Device_Type(void);
 u8 DALIP_Is_Physically_Selected(void);
 u8 DALIP_Is_Device_Type(u8);
+u8 DALIP_Select_Device_Type(u8);
+u32 DALIP_Fade_Ticks_Left(void);
+
+/* Extended command set of one device type. DALIP_Extensions (dali_config.c)
+   lists all types of the gear, ENABLE DEVICE TYPE X selects the set which
+   receives the following application extended commands. */
+typedef u8 TDPExtCmdFunction(u8 command);
+typedef u8 TDPExtVersionFunction(void);
+typedef struct
+{
+  u8 device_type;
+  TDPExtCmdFunction *answer_required;
+  TDPExtCmdFunction *answer_yesno;
+  TDPExtCmdFunction *command;
+  TDPExtVersionFunction *version;
+} TDPExtension;
+
+#ifdef DALI_COLOUR
+ #define DALIP_EXT_CNT  2       /* DEVICE_TYPE and colour control */
+#else
+ #define DALIP_EXT_CNT  1
+#endif
+extern CONST TDPExtension DALIP_Extensions[DALIP_EXT_CNT];
 
 /* Extended Commands */
 
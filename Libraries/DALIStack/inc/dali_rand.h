@@ -0,0 +1,44 @@
+/**
+  ******************************************************************************
+  * @file    dali_rand.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Entropy pool and random generator for DALI random address - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef DALI_RAND_H
+#define DALI_RAND_H
+
+/*---CONSTANTS---*/
+/* Unique ID (96 bits) location in the factory area, only the low density
+   parts have one - the STM8S105/207/208 and STM8AF devices do not */
+#if defined (STM8S103) || defined (STM8S903)
+ #define DALIRND_UID_ADDRESS   0x4865
+ #define DALIRND_UID_SIZE      12
+#endif
+
+/* GTIN and serial number in memory bank 0 (factory burn in), the identity of
+   the device on parts without unique ID */
+#define DALIRND_ID_FIRST       0x03
+#define DALIRND_ID_LAST        0x0E
+
+#define DALIRND_ADC_SAMPLES    32   /* ADC conversions, one noise bit taken from each */
+
+/*---FUNCTIONS---*/
+void DALIRnd_Init(void);
+void DALIRnd_Mix(u8 entropy);
+u8 DALIRnd_Next(void);
+
+#endif
@@ -102,6 +102,8 @@ u8 DALIR_ReadStatusBit(u8);
 
 void DALIR_ResetRegs(void);
 void DALIR_LoadRegsFromE2(void);
+void DALIR_CheckRegs(void);
+u8 DALIR_DefaultEEPROMReg(u8 idx);
 void DALIR_DeleteShort(void);
 void DALIR_Init(void);
 
@@ -19,15 +19,21 @@
   */
 
 #ifndef EEPROM2_H
-#define EEPORM2_H
+#define EEPROM2_H
+
+#include "dali_ctx.h"
 
 /*---FUNCTIONS---*/
 
 void EEPROM_Init (void);
+u8 EEPROM_Process(void);
+
+void E2_WriteMem(TDALIE2Addr, u8);
+void E2_WriteBurst(TDALIE2Addr, u8, u8*);
+u8 E2_ReadMem(TDALIE2Addr);
+u8 E2_IsValid(TDALIE2Addr);
 
-void E2_WriteMem(u8, u8);
-void E2_WriteBurst(u8, u8, u8*);
-u8 E2_ReadMem(u8);
+extern u8 E2_Repairing;
 
 
 /*---CONSTANTS---*/
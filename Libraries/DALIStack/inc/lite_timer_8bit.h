@@ -37,11 +37,6 @@ u8 Process_Lite_timer_IT(void); //SESE
 void Lite_timer_Interrupt(void);
 
 
-/*---Variables---*/
-
-extern u8  RealTimeClock_BigTimer;
-extern u16 RealTimeClock_TimerCountDown;
-
 #endif
 
 
@@ -27,27 +27,64 @@
 #include "dali_pub.h"
 #include "dali_regs.h"
 #include "eeprom.h"
+#include "dali_rand.h"
+#include "dali_mem.h"
+#include "dali_diag.h"
+#include "dali_fwu.h"
+#include "dali_ctx.h"
 
 
-volatile u8 dali_address;
-volatile u8 dali_data;
-volatile u8 dali_receive_status;
-volatile u8 dali_error;
+#if (DALI_INSTANCES < DALI_LINES)
+ #error "each DALI line needs a unit (DALI_INSTANCES >= DALI_LINES)"
+#endif
 
-u8 dali_state;
+volatile u8 dali_address[DALI_LINES];
+volatile u8 dali_data[DALI_LINES];
+volatile u8 dali_receive_status[DALI_LINES];
+volatile u8 dali_error[DALI_LINES];
+
+/* frames of other sizes (input devices, IEC 62386-103), for the application */
+volatile u8 dali_ext_bits[DALI_LINES];  /* 0: none waiting, else DALI_FRAME_8/24/25 */
+volatile u8 dali_ext_frame[DALI_LINES][DALI_FRAME_BYTES];
+static TDFrameCallback *DALI_FrameCallback;
+
+u8 dali_state[DALI_LINES];
+#if (DALI_LINES > 1)
+static u8 dali_line; // line of the frame being processed (answer goes to it)
+#endif
+
+TDALIContext DALI_Contexts[DALI_INSTANCES]; // state of logical control gear units
+#if (DALI_INSTANCES > 1)
+TDALIContext *DALI_Active = &DALI_Contexts[0];
+#endif
 
 
 /*-----------------------------------------------------------------------------
 ROUTINE NAME : DALI_Interrupt
 INPUT/OUTPUT : None
 DESCRIPTION  : DALI receiving callback
-COMMENTS     :
+COMMENTS     : Frames not for control gear are dropped here unless the
+               application takes them (DALI_Set_Frame_Callback)
 -----------------------------------------------------------------------------*/
-void DALI_Interrupt(u8 address,u8 dataByte)
+void DALI_Interrupt(DALI_LINE_PARAMS u8 bits, u8 *frame)
 {
-  dali_address = address; 		// read DALI forward address
-  dali_data = dataByte;		// read DALI forward data;
-  dali_receive_status = DALI_NEW_FRAME_RECEIVED;
+  u8 i;
+
+  if (DALID_Boot.frame == DALID_BOOT_NONE)
+    DALID_Boot.frame = BootTicks; // boot latency report
+  if (bits != DALI_FRAME_16)
+  {
+    if (DALI_FrameCallback && !dali_ext_bits[DALI_LINE_INDEX]) // else lost
+    {
+      for (i = 0; i < DALI_FRAME_BYTES; i++)
+        dali_ext_frame[DALI_LINE_INDEX][i] = frame[i];
+      dali_ext_bits[DALI_LINE_INDEX] = bits;
+    }
+    return;
+  }
+  dali_address[DALI_LINE_INDEX] = frame[0]; 		// read DALI forward address
+  dali_data[DALI_LINE_INDEX] = frame[1];		// read DALI forward data;
+  dali_receive_status[DALI_LINE_INDEX] = DALI_NEW_FRAME_RECEIVED;
 }
 
 /*-----------------------------------------------------------------------------
@@ -56,12 +93,12 @@ INPUT/OUTPUT : None
 DESCRIPTION  : DALI Error callback
 COMMENTS     :
 -----------------------------------------------------------------------------*/
-void DALI_Error(u8 code_val)
+void DALI_Error(DALI_LINE_PARAMS u8 code_val)
 {
   switch (code_val)
   {
-    case 1:  dali_error = DALI_INTERFACE_FAILURE_ERROR; break;
-    default: dali_error = DALI_NO_ERROR; break;
+    case 1:  dali_error[DALI_LINE_INDEX] = DALI_INTERFACE_FAILURE_ERROR; break;
+    default: dali_error[DALI_LINE_INDEX] = DALI_NO_ERROR; break;
   }
 }
 
@@ -73,6 +110,9 @@ COMMENTS     :
 -----------------------------------------------------------------------------*/
 void DALI_Init(TDLightControlCallback LightControlFunction)
 {
+  u8 unit;
+  u8 line;
+
   /* Pull-up Vdd pin for data output */
   DALI_PULLUP_PORT->ODR |= (1<<DALI_PULLUP_PIN); //high level
   DALI_PULLUP_PORT->DDR |= (1<<DALI_PULLUP_PIN); //output mode
@@ -86,18 +126,73 @@ void DALI_Init(TDLightControlCallback LightControlFunction)
   DALI_BUTTON_PORT->CR2 &= ~(1<<DALI_BUTTON_PIN); //interrupt disable on pin
 
   /* dali flags init */
-  dali_state = DALI_IDLE;
-  dali_receive_status = DALI_READY_TO_RECEIVE;
+  for (line = 0; line < DALI_LINES; line++)
+  {
+    dali_state[line] = DALI_IDLE;
+    dali_receive_status[line] = DALI_READY_TO_RECEIVE;
+  }
+  DALID_Boot.light = DALID_BOOT_NONE;
+  DALID_Boot.frame = DALID_BOOT_NONE;
+
+  /* Initialisation of DALI IO driver first: the bus is received while the
+     stack is set up, a frame waits for DALI_CheckAndExecuteReceivedCommand */
+#if (DALI_LINES > 1)
+  init_DALI(0, OUT_DALI_PORT, OUT_DALI_PIN, INVERT_OUT_DALI, IN_DALI_PORT, IN_DALI_PIN, INVERT_IN_DALI, DALI_Interrupt, DALI_Error, Lite_timer_Interrupt);
+  init_DALI(1, OUT_DALI2_PORT, OUT_DALI2_PIN, INVERT_OUT_DALI2, IN_DALI2_PORT, IN_DALI2_PIN, INVERT_IN_DALI2, DALI_Interrupt, DALI_Error, Lite_timer_Interrupt);
+#else
+  init_DALI(OUT_DALI_PORT, OUT_DALI_PIN, INVERT_OUT_DALI, IN_DALI_PORT, IN_DALI_PIN, INVERT_IN_DALI, DALI_Interrupt, DALI_Error, Lite_timer_Interrupt);
+#endif
 
   /* Initialisation of DALI stack modules*/
-  Timer_Lite_Init();
-  EEPROM_Init();
-  DALIR_Init();
-  DALIP_Init(LightControlFunction);
-  DALIC_Init();
+  DALIRnd_Init();
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+  {
+    DALI_SELECT(unit);
+#if (DALI_INSTANCES > 1)
+    DALI_CTX->unit = unit;
+#endif
+    Timer_Lite_Init();
+  }
+  EEPROM_Init(); // registers of all units, repair and range check at idle time (EEPROM_Process)
+  DALIM_Init();
+#ifdef DALI_FW_UPDATE
+  DALIU_Init(); // may swap the program memory slots back and reset (rollback)
+#endif
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+  {
+    DALI_SELECT(unit);
+    DALIR_Init();
+    DALIP_Init(LightControlFunction);
+    DALIC_Init();
+    /* instant on: power on level now, not at the end of the 600ms power on timer */
+    DALIC_PowerOn();
+    PowerOnTimerReset();
+  }
+}
 
-  /* Initialisation of DALI IO driver */
-  init_DALI(OUT_DALI_PORT, OUT_DALI_PIN, INVERT_OUT_DALI, IN_DALI_PORT, IN_DALI_PIN, INVERT_IN_DALI, DALI_Interrupt, DALI_Error, Lite_timer_Interrupt);
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Light_On_Done
+INPUT/OUTPUT : None
+DESCRIPTION  : Records the boot latency of the power on level (diagnostics bank)
+COMMENTS     : Called by the application once the level set by DALI_Init is
+               at the outputs
+-----------------------------------------------------------------------------*/
+void DALI_Light_On_Done(void)
+{
+  DALID_Boot.light = get_boot_ticks();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_SetClock
+INPUT/OUTPUT : CLK->CKDIVR values during frames and between frames / returns 1 if done
+DESCRIPTION  : Changes the clock, DALI bit timing is recomputed for both settings
+COMMENTS     : Only possible between frames, call again later if 0 is returned
+               The prescaller HSIDIV of run_ckdivr applies to both settings,
+               only CPUDIV is switched at the frame boundaries
+-----------------------------------------------------------------------------*/
+u8 DALI_SetClock(u8 run_ckdivr, u8 idle_ckdivr)
+{
+  return set_DALI_clock(run_ckdivr, idle_ckdivr);
 }
 
 /*-----------------------------------------------------------------------------
@@ -124,6 +219,11 @@ u8 DALI_CheckAndExecuteTimer(void)
   if(lite_timer_IT_state==1) //set every 1 ms by timer
   {
     TimerActive = Process_Lite_timer_IT(); //manage fade effects each 1ms (fade time and fade rate)
+    TimerActive |= DALIM_Process_Writes(); //deferred memory bank writes, keeps device awake until done
+    TimerActive |= EEPROM_Process();       //deferred EEPROM repair and register check after boot
+#ifdef DALI_FW_UPDATE
+    TimerActive |= DALIU_Process();        //firmware update: block programming, image check, slot swap
+#endif
   }
   return TimerActive;
 }
@@ -132,34 +232,95 @@ u8 DALI_CheckAndExecuteTimer(void)
 ROUTINE NAME : DALI_CheckAndExecuteReceivedCommand
 INPUT/OUTPUT : returns if some commands was active and executed
 DESCRIPTION  : checks if some received command is pending and if then execute it
-COMMENTS     :
+COMMENTS     : the frame is passed to each unit of its line, the first answer is sent
 -----------------------------------------------------------------------------*/
 u8 DALI_CheckAndExecuteReceivedCommand(void)
 {
-  //check received data
-  if(dali_receive_status == DALI_NEW_FRAME_RECEIVED)
+  u8 line;
+  u8 unit;
+  u8 done;
+  u8 executed = 0;
+  u8 failure = 0;
+
+  for (line = 0; line < DALI_LINES; line++)
   {
-    if (DALIC_isTalkingToMe())
+#if (DALI_LINES > 1)
+    dali_line = line;
+#endif
+    done = 0; // per line: a frame on one line does not delay the error check of the others
+    //frame of another size (input devices) to the application
+    if (dali_ext_bits[line])
     {
-      DALIC_ProcessCommand();
-      dali_receive_status = DALI_READY_TO_RECEIVE;
-      return 1;
+      DALI_FrameCallback(DALI_LINE_ARGS dali_ext_bits[line], (u8*)dali_ext_frame[line]);
+      dali_ext_bits[line] = 0;
+      done = 1;
     }
-    dali_receive_status = DALI_READY_TO_RECEIVE;
-  }
+    //check received data
+    if(dali_receive_status[line] == DALI_NEW_FRAME_RECEIVED)
+    {
+      DALIRnd_Mix(get_start_edge_phase(DALI_LINE_ARG)); //bus edge jitter to the random pool
+      dali_state[line] = DALI_IDLE;
+      for (unit = line; unit < DALI_INSTANCES; unit += DALI_LINES) // units of this line
+      {
+        DALI_SELECT(unit);
+        DALI_CTX->address = dali_address[line];
+        DALI_CTX->data = dali_data[line];
+        if (DALIC_isTalkingToMe())
+        {
+          DALID_Counters.accepted++;
+          DALIC_ProcessCommand();
+          done = 1;
+        }
+      }
+      dali_receive_status[line] = DALI_READY_TO_RECEIVE;
+    }
+    executed |= done;
+    if (done)
+      continue; // error of this line is checked at next call
 
-  //check error
-  if(dali_error == DALI_INTERFACE_FAILURE_ERROR)
-  {
-    //error management
-    DALIC_Process_System_Failure();
-    dali_error = DALI_NO_ERROR;
-    return 2;
+    //check error
+    if(dali_error[line] == DALI_INTERFACE_FAILURE_ERROR)
+    {
+      //error management
+      for (unit = line; unit < DALI_INSTANCES; unit += DALI_LINES)
+      {
+        DALI_SELECT(unit);
+        DALIC_Process_System_Failure();
+      }
+      dali_error[line] = DALI_NO_ERROR;
+      failure = 1;
+    }
   }
 
+  if (executed)
+    return 1;
+  if (failure)
+    return 2;
   return 0;
 }
 
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Bus_Idle
+INPUT/OUTPUT : none / returns 1 if no line is busy
+DESCRIPTION  : checks if DALI packet receiving/sending is not in progress and
+               no frame waits for the stack
+COMMENTS     : call with interrupts disabled to act on the result
+-----------------------------------------------------------------------------*/
+u8 DALI_Bus_Idle(void)
+{
+  u8 line;
+
+  for (line = 0; line < DALI_LINES; line++)
+  {
+    if ((dali_receive_status[line] == DALI_NEW_FRAME_RECEIVED) || dali_ext_bits[line]
+        || (get_flag(DALI_LINE_ARG) != NO_ACTION)    //if DALI frame receiving in progress
+        || (get_send_status(DALI_LINE_ARG) == DALI_TX_PENDING)        //or forward frame waiting for the bus
+        || (get_send_status(DALI_LINE_ARG) == DALI_TX_WAIT_ANSWER))   //or answer to it expected
+      return 0;
+  }
+  return 1;
+}
+
 /*-----------------------------------------------------------------------------
 ROUTINE NAME : DALI_halt
 INPUT/OUTPUT : none
@@ -169,9 +330,18 @@ COMMENTS     :
 void DALI_halt(void)
 {
   sim(); //disable interrupts (to not start receiving)
-  if ((dali_receive_status != DALI_NEW_FRAME_RECEIVED) && (get_flag() == NO_ACTION) )  //if DALI frame receiving in progress
+  if (DALI_Bus_Idle()) // all lines idle
   {
-    halt();
+#ifdef DALI_FW_UPDATE
+    if (DALIU_Watchdog()) // new image on trial: IWDG would reset in halt
+    {
+      wfi();
+    }
+    else
+#endif
+    {
+      halt();
+    }
   }
   rim(); //enable interrupts
 }
@@ -189,33 +359,32 @@ COMMENTS     :
 -----------------------------------------------------------------------------*/
 void Send_DALI_Frame(u8 data_val)
 {
-  send_data(data_val);
-  dali_state = DALI_SEND_START;
+#if (DALI_LINES > 1)
+  u8 line = dali_line;
+#endif
+
+#if (DALI_INSTANCES > 1)
+  if (dali_state[DALI_LINE_INDEX] == DALI_SEND_START) // one backward frame per forward frame
+    return;
+#endif
+  send_data(DALI_LINE_ARGS data_val);
+  dali_state[DALI_LINE_INDEX] = DALI_SEND_START;
 }
 
 /*-----------------------------------------------------------------------------
 ROUTINE NAME : Get_DALI_Random
 INPUT/OUTPUT : None
 DESCRIPTION  :
-COMMENTS     :
+COMMENTS     : main loop only (selects the unit)
  ************************************************
  * Returns random number	 *
+ * from the entropy pool (unique ID, ADC noise,  *
+ * bus edge jitter) through xorshift generator   *
  ************************************************
 -----------------------------------------------------------------------------*/
 u8 Get_DALI_Random(void)
 {
-  static u8 RandomCounter;
-  u8 TimerCount;
-
-  RandomCounter ++;
-  TimerCount = get_timer_count();
-  switch (RandomCounter & 0x03)
-  {
-    case 0:  return (TimerCount); break;
-    case 1:  return (~TimerCount); break;
-    case 2:  return ((TimerCount >> 1)^(TimerCount   )); break;
-    default: return ((TimerCount     )^(RandomCounter)); break;
-  }
+  return DALIRnd_Next();
 }
 
 /*-----------------------------------------------------------------------------
@@ -227,7 +396,71 @@ COMMENTS     :
  * Returns random number	 *
  ************************************************
 -----------------------------------------------------------------------------*/
-void DALI_Set_Lamp_Failure(u8 failure)
+void DALI_Set_Lamp_Failure(DALI_UNIT_PARAMS u8 failure)
 {
+  DALI_SELECT(unit);
   DALIP_SetLampFailureFlag(failure);
 }
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Read_Register
+INPUT/OUTPUT : register index (DALIREG_xxx) / returns its value
+DESCRIPTION  : Reads a DALI register of the unit (host interfaces)
+COMMENTS     : main loop only (selects the unit)
+-----------------------------------------------------------------------------*/
+u8 DALI_Read_Register(DALI_UNIT_PARAMS u8 idx)
+{
+  DALI_SELECT(unit);
+  return DALIR_ReadReg(idx);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Send_Forward_Frame
+INPUT/OUTPUT : frame size (DALI_FRAME_xx), frame bytes, priority 1..5 /
+               returns 0 if the previous frame of the line is still pending
+DESCRIPTION  : Sends a forward frame as a bus master (input device events,
+               IEC 62386-103), collisions are resolved by the driver
+COMMENTS     : Result in DALI_Forward_Frame_Status
+-----------------------------------------------------------------------------*/
+u8 DALI_Send_Forward_Frame(DALI_LINE_PARAMS u8 bits, u8 *frame, u8 priority)
+{
+  return send_forward(DALI_LINE_ARGS bits, frame, priority, 0);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Forward_Frame_Status
+INPUT/OUTPUT : returns DALI_TX_PENDING, DALI_TX_DONE or DALI_TX_FAILED
+DESCRIPTION  : State of the last forward frame of the line
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+u8 DALI_Forward_Frame_Status(DALI_LINE_PARAM)
+{
+  return get_send_status(DALI_LINE_ARG);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Set_Frame_Callback
+INPUT/OUTPUT : function taking 8/24/25 bit frames, 0: frames dropped
+DESCRIPTION  : Passes forward frames which are not for control gear (input
+               device commands and events, IEC 62386-103) to the application
+COMMENTS     : Called from DALI_CheckAndExecuteReceivedCommand, one frame
+               per line waits for it, later ones are lost meanwhile
+-----------------------------------------------------------------------------*/
+void DALI_Set_Frame_Callback(TDFrameCallback FrameFunction)
+{
+  DALI_FrameCallback = FrameFunction;
+}
+
+#ifdef DALI_COLOUR
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALI_Set_Colour_Callback
+INPUT/OUTPUT : output function of the primaries
+DESCRIPTION  : Units drive DALICOL_PRIMARIES outputs instead of the light
+               control callback
+COMMENTS     : Must be called before DALI_Init
+-----------------------------------------------------------------------------*/
+void DALI_Set_Colour_Callback(TDCColourControlCallback ColourControlFunction)
+{
+  DALICol_Callback = ColourControlFunction;
+}
+#endif /* DALI_COLOUR */
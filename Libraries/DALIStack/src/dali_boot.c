@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+  * @file    dali_boot.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   DALI firmware update: boot area (power fail safe slot swap)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "stm8s.h"
+#include "stm8s_flash.h"
+#include "dali_config.h"
+#include "dali_fwu.h"
+
+#ifdef DALI_FW_UPDATE
+
+/* Boot area (see dali_fwu.h): linked at DALIU_BOOT, write protected by UBC,
+   runs before the C startup of the firmware. The code here calls nothing
+   outside this file and uses no library or compiler helpers, only 8 and 16
+   bit arithmetic: slot A may hold anything while it is being swapped. */
+
+#if defined (_IAR_)
+ #define DALIU_BOOT_CODE(a)       a @ "daliu_boot"
+ #define DALIU_BOOT_VECTORS(a)    __root a @ "daliu_boot_vec"
+#else
+ #define DALIU_BOOT_CODE(a)       a
+ #define DALIU_BOOT_VECTORS(a)    a
+#endif
+
+#define DALIU_E2(offset)   (DALIU_E2_ADDRESS + (offset))
+#define DALIU_SWAP_STEPS   (3 * DALIU_SLOT_BLOCKS)  /* per block: A to scratch, B to A, scratch to B */
+
+#if defined (_IAR_) || defined (_COSMIC_) || defined (_RAISONANCE_)
+
+#if defined (_COSMIC_)
+ #pragma section const {daliu_vec}
+typedef void @far (*TDALIU_Handler)(void);
+typedef struct
+{
+  u8 opcode;                 /* 0x82: INT */
+  TDALIU_Handler handler;
+} TDALIU_Vector;
+ #define DALIU_VECTOR(h)   { 0x82, (TDALIU_Handler)(h) }
+#else /* _IAR_, _RAISONANCE_: 16 bit code addresses */
+typedef void (*TDALIU_Handler)(void);
+typedef struct
+{
+  u8 opcode;                 /* 0x82: INT */
+  u8 ext;                    /* address bits 23..16 */
+  TDALIU_Handler handler;
+} TDALIU_Vector;
+ #define DALIU_VECTOR(h)   { 0x82, 0x00, (TDALIU_Handler)(h) }
+#endif /* _COSMIC_ */
+
+/* boot vector table at DALIU_BOOT: reset enters the boot, the interrupts go
+   on to the vector table of slot A (INT there is executed as a jump) */
+#define DALIU_FORWARD(n)   DALIU_VECTOR(DALIU_SLOT_A + 4 * (n))
+DALIU_BOOT_VECTORS(const TDALIU_Vector DALIU_BootVectors[DALIU_VECTORS]) =
+{
+  DALIU_VECTOR(DALIU_Boot), DALIU_FORWARD(1),  DALIU_FORWARD(2),  DALIU_FORWARD(3),
+  DALIU_FORWARD(4),  DALIU_FORWARD(5),  DALIU_FORWARD(6),  DALIU_FORWARD(7),
+  DALIU_FORWARD(8),  DALIU_FORWARD(9),  DALIU_FORWARD(10), DALIU_FORWARD(11),
+  DALIU_FORWARD(12), DALIU_FORWARD(13), DALIU_FORWARD(14), DALIU_FORWARD(15),
+  DALIU_FORWARD(16), DALIU_FORWARD(17), DALIU_FORWARD(18), DALIU_FORWARD(19),
+  DALIU_FORWARD(20), DALIU_FORWARD(21), DALIU_FORWARD(22), DALIU_FORWARD(23),
+  DALIU_FORWARD(24), DALIU_FORWARD(25), DALIU_FORWARD(26), DALIU_FORWARD(27),
+  DALIU_FORWARD(28), DALIU_FORWARD(29), DALIU_FORWARD(30), DALIU_FORWARD(31)
+};
+
+#if defined (_COSMIC_)
+ #pragma section const {}
+#endif /* _COSMIC_ */
+
+#endif /* _IAR_ || _COSMIC_ || _RAISONANCE_ */
+
+#if defined (_COSMIC_)
+ #pragma section (daliu)
+#endif /* _COSMIC_ */
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_BootWait
+INPUT/OUTPUT : None
+DESCRIPTION  : Waits for the end of a program memory or data EEPROM write
+COMMENTS     : Reading IAPSR clears EOP
+-----------------------------------------------------------------------------*/
+static DALIU_BOOT_CODE(void DALIU_BootWait(void))
+{
+  while (!(FLASH->IAPSR & (FLASH_IAPSR_EOP | FLASH_IAPSR_WR_PG_DIS)))
+    ;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_BootE2
+INPUT/OUTPUT : offset in the update record, value
+DESCRIPTION  : Writes one byte of the update record if it differs
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+static DALIU_BOOT_CODE(void DALIU_BootE2(u8 offset, u8 val))
+{
+  if (DALIU_MEM(DALIU_E2(offset)) == val)
+    return;
+  DALIU_WRITE(DALIU_E2(offset), val);
+  DALIU_BootWait();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_BootProgress
+INPUT/OUTPUT : swap steps done
+DESCRIPTION  : Keeps the swap progress in the update record
+COMMENTS     : Alternates between the two words: a word torn by a reset
+               fails its complement and the other word still holds the
+               previous step, which is then done again
+-----------------------------------------------------------------------------*/
+static DALIU_BOOT_CODE(void DALIU_BootProgress(u16 step))
+{
+  u8 w;
+
+  w = (u8)(DALIU_E2_PROGRESS + ((step & 1) ? 4 : 0));
+  DALIU_BootE2(w, (u8)(step >> 8));
+  DALIU_BootE2((u8)(w + 1), (u8)step);
+  DALIU_BootE2((u8)(w + 2), (u8)~(u8)(step >> 8));
+  DALIU_BootE2((u8)(w + 3), (u8)~(u8)step);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_BootCopy
+INPUT/OUTPUT : destination and source block addresses
+DESCRIPTION  : Copies one block of program memory by word programming
+COMMENTS     : Runs from flash, the CPU stalls while a word is programmed.
+               Words which are already right are not programmed again, so
+               a copy interrupted by a reset is finished quickly.
+-----------------------------------------------------------------------------*/
+static DALIU_BOOT_CODE(void DALIU_BootCopy(u16 dst, u16 src))
+{
+  u8 i;
+  u8 j;
+
+  for (i = 0; i < FLASH_BLOCK_SIZE; i += 4)
+  {
+    for (j = 0; j < 4; j++)
+      if (DALIU_MEM(dst + i + j) != DALIU_MEM(src + i + j))
+        break;
+    if (j == 4)
+      continue;
+    FLASH->CR2 |= FLASH_CR2_WPRG;
+    FLASH->NCR2 &= (u8)(~FLASH_NCR2_NWPRG);
+    for (j = 0; j < 4; j++)
+      DALIU_WRITE(dst + i + j, DALIU_MEM(src + i + j));
+    DALIU_BootWait();
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_BootSwap
+INPUT/OUTPUT : None
+DESCRIPTION  : Exchanges slot A and slot B if the update record says
+               DALIU_SWAPPING, then writes the target state to the record
+COMMENTS     : Each step copies one block and is written to the record once
+               done: after a reset the swap goes on from the last step
+               recorded, the sources of that step are still untouched
+-----------------------------------------------------------------------------*/
+DALIU_BOOT_CODE(void DALIU_BootSwap(void))
+{
+  u16 step;
+  u16 val;
+  u16 block;
+  u8 phase;
+  u8 w;
+  u8 hi;
+  u8 lo;
+
+  if (DALIU_MEM(DALIU_E2(DALIU_E2_STATE)) != DALIU_SWAPPING)
+    return;
+
+  step = 0;
+  for (w = DALIU_E2_PROGRESS; w < DALIU_E2_PROGRESS + 8; w += 4)
+  {
+    hi = (u8)(DALIU_MEM(DALIU_E2(w)) ^ 0xFF);
+    lo = (u8)(DALIU_MEM(DALIU_E2(w + 1)) ^ 0xFF);
+    val = (u16)(((u16)DALIU_MEM(DALIU_E2(w)) << 8) | DALIU_MEM(DALIU_E2(w + 1)));
+    if ((DALIU_MEM(DALIU_E2(w + 2)) == hi) && (DALIU_MEM(DALIU_E2(w + 3)) == lo)
+        && (val > step))
+      step = val;
+  }
+  if (step > DALIU_SWAP_STEPS)
+    step = DALIU_SWAP_STEPS;
+  block = DALIU_SLOT_A;
+  for (val = step; val >= 3; val -= 3)
+    block += FLASH_BLOCK_SIZE;
+  phase = (u8)val;
+
+  FLASH->PUKR = FLASH_RASS_KEY1;
+  FLASH->PUKR = FLASH_RASS_KEY2;
+  FLASH->DUKR = FLASH_RASS_KEY2; // keys reversed on data EEPROM
+  FLASH->DUKR = FLASH_RASS_KEY1;
+  while (step < DALIU_SWAP_STEPS)
+  {
+    if (phase == 0)
+      DALIU_BootCopy(DALIU_SCRATCH, block);
+    else if (phase == 1)
+      DALIU_BootCopy(block, (u16)(block + DALIU_SLOT_SIZE));
+    else
+      DALIU_BootCopy((u16)(block + DALIU_SLOT_SIZE), DALIU_SCRATCH);
+    step++;
+    DALIU_BootProgress(step);
+    if (++phase == 3)
+    {
+      phase = 0;
+      block += FLASH_BLOCK_SIZE;
+    }
+  }
+  DALIU_BootE2(DALIU_E2_TRIALS, 0);
+  DALIU_BootE2(DALIU_E2_STATE, DALIU_MEM(DALIU_E2(DALIU_E2_TARGET)));
+  FLASH->IAPSR &= (u8)(~(FLASH_IAPSR_PUL | FLASH_IAPSR_DUL));
+}
+
+#if defined (_IAR_) || defined (_COSMIC_) || defined (_RAISONANCE_)
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Boot
+INPUT/OUTPUT : None
+DESCRIPTION  : Reset entry: pending slot swap, then the reset vector of slot A
+COMMENTS     : Stack pointer at its reset value, no C startup yet
+-----------------------------------------------------------------------------*/
+DALIU_BOOT_CODE(void DALIU_Boot(void))
+{
+  DALIU_BootSwap();
+  ((void (*)(void))(u16)(((u16)DALIU_MEM(DALIU_SLOT_A + 2) << 8) | DALIU_MEM(DALIU_SLOT_A + 3)))();
+}
+#endif /* _IAR_ || _COSMIC_ || _RAISONANCE_ */
+
+#if defined (_COSMIC_)
+ #pragma section ()
+#endif /* _COSMIC_ */
+
+#endif /* DALI_FW_UPDATE */
@@ -24,6 +24,9 @@
 #include "dali_cmd.h"
 #include "dali_pub.h"
 #include "lite_timer_8bit.h"
+#include "dali_mem.h"
+#include "dali_diag.h"
+#include "dali_ctx.h"
 
 #define DALI_REPETITION_WAIT 	120  /*Command repetition timeout (ms)*/
 
@@ -109,69 +112,10 @@ void DALIC_Physical_Selection(void);
 void DALIC_Initialize_Select(u8);
 void DALIC_Enable_Device_Type_X(u8);
 void DALIC_Write_Memory_Location(u8);
-u8 DALIC_Mem_Checksum(u8);
+void DALIC_Write_Memory_Location_No_Reply(u8);
 void DALIC_Adjust_Actual_Level(void);
 
 
-u8 dtr;
-static u8 dtr1;
-static u8 dtr2;
-static u8 write_enable_membanks;
-static u8 iBufferedCmdHi,iBufferedCmdLo;
-
-#define MEM_BANKS_CNT           2
-#define MEM_BANK_SIZE           0x20
-
-#ifdef _IAR_
-u8 membanks[MEM_BANKS_CNT][MEM_BANK_SIZE] @ "eeprom_zone"=
-#else
-EEPROM u8 membanks[MEM_BANKS_CNT][MEM_BANK_SIZE]=
-#endif
-{
-  // memory bank 0 - according specification
-  {
-    (MEM_BANK_SIZE-1)     , // 0x00 address of last accessible memory location factory burn in read-only
-    (u8)(0 - (MEM_BANKS_CNT-1) - 0 - 1 - 2 - 3 - 4 - 5 - 1 - 0 - 0 - 0 - 0 - 1 - 'S' - 'T' - 'M' - '8' - 'D' - 'A' - 'L' - 'I' - ' ' - 'l' - 'i' - 'b' - 'r' - 'a' - 'r' - 'y' - '.')
-                          , // 0x01 checksum of memory bank 0 factory burn in read-only
-    (MEM_BANKS_CNT-1)     , // 0x02 number of last accessible memory bank factory burn in read-only
-    0                     , // 0x03 GTIN byte 0 (MSB) factory burn in read-only
-    1                     , // 0x04 GTIN byte 1 factory burn in read-only
-    2                     , // 0x05 GTIN byte 2 factory burn in read-only
-    3                     , // 0x06 GTIN byte 3 factory burn in read-only
-    4                     , // 0x07 GTIN byte 4 factory burn in read-only
-    5                     , // 0x08 GTIN byte 5 factory burn in read-only
-    1                     , // 0x09 control gear firmware version (major) factory burn in read-only
-    0                     , // 0x0A control gear firmware version (minor) factory burn in read-only
-    0                     , // 0x0B serial number byte 1 (MSB) factory burn in read-only
-    0                     , // 0x0C serial number byte 2 factory burn in read-only
-    0                     , // 0x0D serial number byte 3 factory burn in read-only
-    1                     , // 0x0E serial number byte 4 factory burn in read-only
-    'S','T','M','8','D','A','L','I',' ','l','i','b','r','a','r','y','.' // 0x0F- ... additional control gear information
-  }
-  ,
-  // memory bank 1 - according specification
-  {
-    (MEM_BANK_SIZE-1)     , // 0x00 address of last accessible memory location factory burn in read-only
-    30                    , // 0x01 checksum of memory bank 1 read-only
-    0xFF                  , // 0x02 memory bank 1 lock byte (read-only if not 0x55) 0xFF read / write
-    0xFF                  , // 0x03 OEM GTIN byte 0 (MSB) 0xFF read / write (lockable)
-    0xFF                  , // 0x04 OEM GTIN byte 1 0xFF read / write (lockable)
-    0xFF                  , // 0x05 OEM GTIN byte 2 0xFF read / write (lockable)
-    0xFF                  , // 0x06 OEM GTIN byte 3 0xFF read / write (lockable)
-    0xFF                  , // 0x07 OEM GTIN byte 4 0xFF read / write (lockable)
-    0xFF                  , // 0x08 OEM GTIN byte 5 0xFF read / write (lockable)
-    0xFF                  , // 0x09 OEM serial number byte 1 (MSB) 0xFF read / write (lockable)
-    0xFF                  , // 0x0A OEM serial number byte 2 0xFF read / write (lockable)
-    0xFF                  , // 0x0B OEM serial number byte 3 0xFF read / write (lockable)
-    0xFF                  , // 0x0C OEM serial number byte 4 (LSB) 0xFF read / write (lockable)
-    0xFF                  , // 0x0D Subsystem (bit 4 to bit 7) Device number (bit 0 to bit 3) 0xFF read / write (lockable)
-    0xFF                  , // 0x0E Lamp type number (lockable) c 0xFF read / write (lockable)
-    0xFF                  , // 0x0F Lamp type number 0xFF read / write
-    0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF // 0x10- ... additional OEM information
-  }
-
-};
-
 #define b_is_special            0
 #define b_in_special_mode       1
 #define b_is_selected           2
@@ -180,11 +124,9 @@ EEPROM u8 membanks[MEM_BANKS_CNT][MEM_BANK_SIZE]=
 #define b_is_cmd_buffered       5
 #define b_is_cmd_inbetween	    6
 
-#define SetFlag(a) SetBit(b_status_reg,a)
-#define ClrFlag(a) ClrBit(b_status_reg,a)
-#define IsFlag(a)  ValBit(b_status_reg,a)
-
-static u8 b_status_reg;
+#define SetFlag(a) SetBit(DALI_CTX->b_status_reg,a)
+#define ClrFlag(a) ClrBit(DALI_CTX->b_status_reg,a)
+#define IsFlag(a)  ValBit(DALI_CTX->b_status_reg,a)
 
 typedef void (*const TFuncPointer) (u8);
 
@@ -473,14 +415,15 @@ TFuncPointer special_jt[]={
   (TFuncPointer) DALIC_SetDTR1,                        /* Command 273 */
   (TFuncPointer) DALIC_SetDTR2,                        /* Command 274 */
   (TFuncPointer) DALIC_Write_Memory_Location,          /* Command 275 */
+  (TFuncPointer) DALIC_Write_Memory_Location_No_Reply, /* Command 276 */
 };
 
 //-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-*-
 
 void DALIC_Init(void)
 {
-    b_status_reg = 0;
-    write_enable_membanks = 0;
+    DALI_CTX->b_status_reg = 0;
+    DALI_CTX->write_enable_membanks = 0;
 
     DALIR_WriteStatusBit(DALIREG_STATUS_POWER_FAILURE,1);		//ALAL to set the "power failure" bit after a power on (to solve error 6.1.5)
 
@@ -505,7 +448,7 @@ u8 DALIC_isTalkingToMe(void)
 
 	ClrFlag(b_is_special);
 
-	addr = dali_address;
+	addr = DALI_CTX->address;
 
 	if (((addr & 0xE1) == 0xA1) || ((addr & 0xE1) == 0xC1))
 	{ /* Special command */
@@ -627,17 +570,17 @@ u8 DALIC_Is_Repeated(void)
 {
 	if (!IsFlag(b_is_cmd_buffered))
     {
-		iBufferedCmdHi = dali_address;
-		iBufferedCmdLo = dali_data;
+		DALI_CTX->iBufferedCmdHi = DALI_CTX->address;
+		DALI_CTX->iBufferedCmdLo = DALI_CTX->data;
 		SetFlag(b_is_cmd_buffered);
 		RTC_LaunchTimer(DALI_REPETITION_WAIT);
 	}
     else
     {
 		ClrFlag(b_is_cmd_buffered);
-		if (RealTimeClock_TimerCountDown == 0)
+		if (DALI_CTX->RealTimeClock_TimerCountDown == 0)
             return 0; /* Timeout */
-		if ((iBufferedCmdHi == dali_address) && (iBufferedCmdLo == dali_data))
+		if ((DALI_CTX->iBufferedCmdHi == DALI_CTX->address) && (DALI_CTX->iBufferedCmdLo == DALI_CTX->data))
         {
 		    return 1;
 	    }
@@ -666,9 +609,9 @@ u8 DALIC_Is_Repetiton_Fault(void)
         return DCRF_OK;
 
 	state = 0;
-	if (RealTimeClock_TimerCountDown == 0)
+	if (DALI_CTX->RealTimeClock_TimerCountDown == 0)
         state += DCRF_TIMEOUT;
-	if ((iBufferedCmdHi == dali_address) && (iBufferedCmdLo == dali_data))
+	if ((DALI_CTX->iBufferedCmdHi == DALI_CTX->address) && (DALI_CTX->iBufferedCmdLo == DALI_CTX->data))
         state += DCRF_EQUAL;
 	switch (state)
     {
@@ -685,6 +628,7 @@ u8 DALIC_Is_Repetiton_Fault(void)
 			 | In Timeout case, clear the Buffer    |
 			 | execute this command                 |
 			 *--------------------------------------*/
+			DALID_Counters.rep_timeouts++;
 			ClrFlag(b_is_cmd_buffered);
 			ClrFlag(b_is_cmd_inbetween);
 			return DCRF_OK;
@@ -730,12 +674,12 @@ void DALIC_ProcessSpecialCommand(void)
 {
 	u8 cmd,data_val;
 
-	cmd = (dali_address-161)>>1;
-	data_val = dali_data;
+	cmd = (DALI_CTX->address-161)>>1;
+	data_val = DALI_CTX->data;
 	ClrFlag(b_is_selected);
-	if (cmd != (275 - 256)) //if not write command
-	  write_enable_membanks = 0;
-	if (cmd > (275 -256))
+	if ((cmd != (275 - 256)) && (cmd != (276 - 256))) //if not write command
+	  DALI_CTX->write_enable_membanks = 0;
+	if (cmd > (276 -256))
     {
 	    DALIP_Reserved_Special_Function(cmd,data_val);
 	    return;
@@ -747,12 +691,12 @@ void DALIC_ProcessNormalCommand(void)
 {
 	u8 cmd;
 
-	cmd = dali_data;
+	cmd = DALI_CTX->data;
 
   if (cmd < 0xE0)
     ClrFlag(b_is_selected);
-  write_enable_membanks = 0;
-	if(!(dali_address & 0x01))
+  DALI_CTX->write_enable_membanks = 0;
+	if(!(DALI_CTX->address & 0x01))
     { /* Direct arc */
 	    DALIR_WriteStatusBit(DALIREG_STATUS_POWER_FAILURE,0);
 	    DALIC_Direct_Arc(cmd);
@@ -842,14 +786,14 @@ void DALIC_Store_Act_Level_To_DTR(void)
 {
 	if (!DALIC_Is_Repeated())
         return;
-	dtr = DALIR_ReadReg(DALIREG_ACTUAL_DIM_LEVEL);
+	DALI_CTX->dtr = DALIR_ReadReg(DALIREG_ACTUAL_DIM_LEVEL);
 }
 
 void DALIC_Store_DTR_As_(u8 idx)
 {
 	if (!DALIC_Is_Repeated())
 	    return;
-	DALIR_WriteReg(idx,dtr);
+	DALIR_WriteReg(idx,DALI_CTX->dtr);
 }
 
 void DALIC_StoreMinMax_DTR_As_(u8 idx)
@@ -860,18 +804,18 @@ void DALIC_StoreMinMax_DTR_As_(u8 idx)
 	    return;
 
 	zw = DALIR_ReadReg(DALIREG_MIN_LEVEL);
-	if (dtr < zw)
+	if (DALI_CTX->dtr < zw)
 	{
 	 DALIR_WriteReg(idx,zw);
 	 return;
 	}
 	zw = DALIR_ReadReg(DALIREG_MAX_LEVEL);
-	if (dtr > zw)
+	if (DALI_CTX->dtr > zw)
 	{
 	    DALIR_WriteReg(idx,zw);
 	    return;
 	}
-	DALIR_WriteReg(idx,dtr);
+	DALIR_WriteReg(idx,DALI_CTX->dtr);
 }
 
 void DALIC_Remove_From_Scene(u8 idx)
@@ -972,18 +916,18 @@ void DALIC_Store_DTR_As_Short(void)
 
 	if (!DALIC_Is_Repeated())
         return;
-	if (dtr == 255)
+	if (DALI_CTX->dtr == 255)
 		{
 			DALIR_DeleteShort();
 			DALIR_WriteStatusBit(DALIREG_STATUS_MISSING_SHORT,1);
 			return;
 		}
-	if (dtr & 0x80)
+	if (DALI_CTX->dtr & 0x80)
         return;
-	if (!(dtr & 0x01))
+	if (!(DALI_CTX->dtr & 0x01))
         return;
 	DALIR_WriteStatusBit(DALIREG_STATUS_MISSING_SHORT,0);
-	DALIR_WriteReg(DALIREG_SHORT_ADDRESS,dtr);
+	DALIR_WriteReg(DALIREG_SHORT_ADDRESS,DALI_CTX->dtr);
 }
 
 void DALIC_Query_Status(void)
@@ -1034,17 +978,17 @@ void DALIC_Query_Reg_(u8 reg)
 
 void DALIC_Query_Content_DTR(void)
 {
-    Send_DALI_Frame(dtr);
+    Send_DALI_Frame(DALI_CTX->dtr);
 }
 
 void DALIC_Query_Content_DTR1(void)
 {
-    Send_DALI_Frame(dtr1);
+    Send_DALI_Frame(DALI_CTX->dtr1);
 }
 
 void DALIC_Query_Content_DTR2(void)
 {
-    Send_DALI_Frame(dtr2);
+    Send_DALI_Frame(DALI_CTX->dtr2);
 }
 
 void DALIC_Query_Device_Type(void)
@@ -1069,23 +1013,26 @@ void DALIC_Query_Fade_Time_Rate(void)
 
 void DALIC_Query_Application_Extended_Commands(u8 cmd)
 {
+  CONST TDPExtension *ext;
+
   if (!IsFlag(b_is_selected))
     return;
-	if (DALIP_Ext_Cmd_Is_Answer_Required(cmd))
+  ext = &DALIP_Extensions[DALI_CTX->ext_selected];
+	if (ext->answer_required(cmd))
     {
-	    if (DALIP_Ext_Cmd_Is_Answer_YesNo(cmd))
+	    if (ext->answer_yesno(cmd))
         {
-	        if (DALIP_Extended_Command(cmd))
+	        if (ext->command(cmd))
                 Send_DALI_Frame(0xFF);
 	    }
         else
         {
-	         Send_DALI_Frame(DALIP_Extended_Command(cmd));
+	         Send_DALI_Frame(ext->command(cmd));
 	    }
 	}
     else
     {
-	    DALIP_Extended_Command(cmd);
+	    ext->command(cmd);
 	}
 }
 
@@ -1093,7 +1040,7 @@ void DALIC_Query_Application_Extended_Version_Number(void)
 {
   if (!IsFlag(b_is_selected))
     return;
-  Send_DALI_Frame(DALIP_Extended_Version_Number());
+  Send_DALI_Frame(DALIP_Extensions[DALI_CTX->ext_selected].version());
 }
 
 u8 DALIC_Is_Selected(void)
@@ -1146,7 +1093,7 @@ void DALIC_Initialize(u8 addr)
 		    break;
 
 		default:	 /* initialize if own short address recognized */
-		    dali_address = addr;
+		    DALI_CTX->address = addr;
 		    if (DALIC_isTalkingToMe())
             {
 		        DALIC_LaunchInit();
@@ -1158,7 +1105,7 @@ void DALIC_Initialize(u8 addr)
 void DALIC_Terminate(void)
 {
     ClrFlag(b_in_special_mode);
-    RealTimeClock_BigTimer = 0;
+    DALI_CTX->RealTimeClock_BigTimer = 0;
 }
 
 void DALIC_Randomize(void)
@@ -1166,7 +1113,7 @@ void DALIC_Randomize(void)
 	if (!DALIC_Is_Repeated())
         return;
 
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 
 	DALIR_WriteReg(DALIREG_RANDOM_ADDRESS + 0,Get_DALI_Random()); // take value from AR_Timer
@@ -1178,7 +1125,7 @@ void DALIC_Compare(void)
 {
 	u8 search[3],rand[3],i;
 
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 	if (IsFlag(b_is_withdrawn))
         return;
@@ -1208,17 +1155,45 @@ void DALIC_Compare(void)
 
 void DALIC_Withdraw(void)
 {
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 
 	if (DALIC_Is_Selected())
         SetFlag(b_is_withdrawn);
 }
 
+/****************************************************************************
+ * Vendor extension: selects a device by the serial number in memory bank 0
+ * (0x0B..0x0E) = data byte (MSB), DTR2, DTR1, DTR (LSB).
+ * The matching device copies its random address to the search address and
+ * answers YES, all other devices move search address off their random
+ * address. Then PROGRAM SHORT ADDRESS reaches only the matching device,
+ * one device is addressed by 5 frames without the binary search.
+ ****************************************************************************/
+void DALIC_Select_By_Serial(u8 serial_msb)
+{
+	u8 i;
+
+	if (!DALI_CTX->RealTimeClock_BigTimer)
+		return;
+
+	if ((DALIM_Read(0, 0x0B) == serial_msb) && (DALIM_Read(0, 0x0C) == DALI_CTX->dtr2) &&
+	    (DALIM_Read(0, 0x0D) == DALI_CTX->dtr1) && (DALIM_Read(0, 0x0E) == DALI_CTX->dtr))
+	{
+		for (i=0;i<3;i++)
+			DALIR_WriteReg(DALIREG_SEARCH_ADDRESS + i, DALIR_ReadReg(DALIREG_RANDOM_ADDRESS + i));
+		Send_DALI_Frame(0xFF);
+	}
+	else
+	{
+		DALIR_WriteReg(DALIREG_SEARCH_ADDRESS + 2, DALIR_ReadReg(DALIREG_RANDOM_ADDRESS + 2) ^ 0x01);
+	}
+}
+
 void DALIC_Program_Short_Address(u8 addr)
 {
 
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 
 	if (addr == 0xFF)
@@ -1248,7 +1223,7 @@ void DALIC_Verify_Short_Address(u8 addr)
 void DALIC_Query_Short_Address(void)
 {
     u8 zw;
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 	if (DALIC_Is_Selected())
 		{
@@ -1259,49 +1234,49 @@ void DALIC_Query_Short_Address(void)
 
 void DALIC_Physical_Selection(void)
 {
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 	SetFlag(b_in_physical_selection);
 }
 
 void DALIC_Enable_Device_Type_X(u8 devtype)
 {
-    if (DALIP_What_Device_Type()==devtype)
+    if (DALIP_Select_Device_Type(devtype))
         SetFlag(b_is_selected);
 }
 
 void DALIC_SetDTR(u8 newdtr)
 {
-    dtr = newdtr;
+    DALI_CTX->dtr = newdtr;
 }
 
 void DALIC_SetDTR1(u8 newdtr)
 {
-    dtr1 = newdtr;
+    DALI_CTX->dtr1 = newdtr;
 }
 
 void DALIC_SetDTR2(u8 newdtr)
 {
-    dtr2 = newdtr;
+    DALI_CTX->dtr2 = newdtr;
 }
 
 void DALIC_SetSearchAddress0(u8 newsearch)
 {
-    if (!RealTimeClock_BigTimer)
+    if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
     DALIR_WriteReg(DALIREG_SEARCH_ADDRESS + 0, newsearch);
 }
 
 void DALIC_SetSearchAddress1(u8 newsearch)
 {
-    if (!RealTimeClock_BigTimer)
+    if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
     DALIR_WriteReg(DALIREG_SEARCH_ADDRESS + 1, newsearch);
 }
 
 void DALIC_SetSearchAddress2(u8 newsearch)
 {
-	if (!RealTimeClock_BigTimer)
+	if (!DALI_CTX->RealTimeClock_BigTimer)
         return;
 	DALIR_WriteReg(DALIREG_SEARCH_ADDRESS + 2, newsearch);
 }
@@ -1359,8 +1334,14 @@ void DALIC_Reset(void)
 	DALIP_DoneTimer();
 	zw = DALIP_GetArc();
 	DALIR_ResetRegs();
+#ifdef DALI_COLOUR
+  DALICol_Reset();
+#endif
   DALIC_Direct_Arc_NoFade(zw);
   DALIC_PowerOn();
+#ifdef DALI_COLOUR
+  DALICol_Flush();
+#endif
 }
 
 u8 DALIC_BoundPhys(u8 val)
@@ -1399,7 +1380,7 @@ void DALIC_Store_DTR_As_Max_Level(void)
 	if (!DALIC_Is_Repeated())
         return;
 
-	zw = DALIC_BoundPhys(dtr);
+	zw = DALIC_BoundPhys(DALI_CTX->dtr);
 	zw2 = DALIR_ReadReg(DALIREG_MIN_LEVEL);
 	if (zw<zw2)
         zw = zw2;
@@ -1413,7 +1394,7 @@ void DALIC_Store_DTR_As_Min_Level(void)
 
 	if (!DALIC_Is_Repeated())
         return;
-    zw = DALIC_BoundPhys(dtr);
+    zw = DALIC_BoundPhys(DALI_CTX->dtr);
 	zw2 = DALIR_ReadReg(DALIREG_MAX_LEVEL);
 	if (zw>zw2)
         zw = zw2;
@@ -1435,8 +1416,8 @@ void DALIC_Store_DTR_As_Fade_Time(void)
 {
   if (!DALIC_Is_Repeated())
 	    return;
-  if (dtr < 15)
-	  DALIR_WriteReg(DALIREG_FADE_TIME,dtr);
+  if (DALI_CTX->dtr < 15)
+	  DALIR_WriteReg(DALIREG_FADE_TIME,DALI_CTX->dtr);
 	else
 	  DALIR_WriteReg(DALIREG_FADE_TIME,15);
 }
@@ -1447,7 +1428,7 @@ void DALIC_Store_DTR_As_Fade_Rate(void)
 
 	if (!DALIC_Is_Repeated())
         return;
-	zw = dtr;
+	zw = DALI_CTX->dtr;
 	if (zw > 15)
         zw = 15;
 	if (zw == 0)
@@ -1530,52 +1511,48 @@ void DALIC_Query_Reg_Random_Address2(void)
 
 void DALIC_Enable_Write_Memory(void)
 {
-  write_enable_membanks = 1;
+  DALI_CTX->write_enable_membanks = 1;
 }
 
 void DALIC_Read_Memory_Location(void)
 {
   u8 mem_data;
 
-  if((dtr1 < MEM_BANKS_CNT) && (dtr <= membanks[dtr1][0]))
+  if((DALI_CTX->dtr1 < DALIM_BANKS_CNT) && (DALI_CTX->dtr <= DALIM_LastLocation(DALI_CTX->dtr1)))
   {
-    mem_data = membanks[dtr1][dtr];
-    dtr++;
-    if (dtr <= membanks[dtr1][0])
-      dtr2 = membanks[dtr1][dtr];
+    mem_data = DALIM_Read(DALI_CTX->dtr1, DALI_CTX->dtr);
+    DALI_CTX->dtr++;
+    if (DALI_CTX->dtr <= DALIM_LastLocation(DALI_CTX->dtr1))
+      DALI_CTX->dtr2 = DALIM_Peek(DALI_CTX->dtr1, DALI_CTX->dtr); // no read hook: not read by the master yet
     Send_DALI_Frame(mem_data);
   }
 }
 
-void DALIC_Write_Memory_Location(u8 mem_data)
+static u8 DALIC_Write_Memory(u8 mem_data)
 {
   if(
-     (write_enable_membanks)     && // check global write protection
-     (dtr1 <= membanks[0][2])    && // check dtr1 to membanks count
-     (dtr1 > 0)                  && // check dtr1 to membanks min (bank 0 is read only)
-     (dtr  <= membanks[dtr1][0]) && // check dtr to max address
-     (dtr  >= 2)                 && // check dtr to min address
-     ((dtr==2) || (membanks[dtr1][2] == 0x55) || ((dtr==0x0F)&&(dtr1==1)))
-                                    // check if memory bank is write protected (except protection byte - index "2" and index 0x0F in bank 1)
+     (DALI_CTX->write_enable_membanks) && // check global write protection
+     (DALI_CTX->dtr1 < DALIM_BANKS_CNT) && // check dtr1 to membanks count
+     (DALIM_Write(DALI_CTX->dtr1, DALI_CTX->dtr, mem_data))// range and lock policy of the bank, EEPROM is written later
     )
   {
-    membanks[dtr1][dtr] = mem_data;    //write to memory bank "dtr1" at address "dtr"
-    membanks[dtr1][1]   = DALIC_Mem_Checksum(dtr1);  //update memory bank checksum
-    if (dtr == membanks[dtr1][0])
-      write_enable_membanks = 0;
-    dtr++;
-    Send_DALI_Frame(mem_data);
+    if (DALI_CTX->dtr == DALIM_LastLocation(DALI_CTX->dtr1))
+      DALI_CTX->write_enable_membanks = 0;
+    DALI_CTX->dtr++;
+    return 1;
   }
+  return 0;
 }
 
-u8 DALIC_Mem_Checksum(u8 mem_number)
+void DALIC_Write_Memory_Location(u8 mem_data)
 {
-  u8 i;
-  u8 checksum;
+  if (DALIC_Write_Memory(mem_data))
+    Send_DALI_Frame(mem_data);
+}
 
-  checksum = 0;
-  for (i = 2; i <= membanks[mem_number][0]; i++)
-    checksum -= membanks[mem_number][i];
-  return checksum;
+// IEC 62386-102 ed.2: no backward frame, a stream of writes takes one frame per byte
+void DALIC_Write_Memory_Location_No_Reply(u8 mem_data)
+{
+  DALIC_Write_Memory(mem_data);
 }
 
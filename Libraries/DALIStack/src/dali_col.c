@@ -0,0 +1,535 @@
+/**
+  ******************************************************************************
+  * @file    dali_col.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Colour control (IEC 62386-209, device type 8)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Include files */
+#include "stm8s.h"
+#include "dali_col.h"
+#include "dali_pub.h"
+#include "dali_cmd.h"
+#include "dali_ctx.h"
+
+#ifdef DALI_COLOUR
+
+/*---CONSTANTS---*/
+/* QUERY COLOUR VALUE selectors (DTR) */
+#define DALICOL_VAL_TC              2
+#define DALICOL_VAL_PRIMARY         3    /* 3..8: primary N dimlevel */
+#define DALICOL_VAL_RGBWAF          9    /* 9..14: red .. freecolour dimlevel */
+#define DALICOL_VAL_CONTROL         15
+#define DALICOL_VAL_TYPE            16   /* temporary and report only */
+#define DALICOL_VAL_PRIMARIES       82
+#define DALICOL_VAL_TC_COOLEST      128
+#define DALICOL_VAL_TC_PHYS_COOLEST 129
+#define DALICOL_VAL_TC_WARMEST      130
+#define DALICOL_VAL_TC_PHYS_WARMEST 131
+#define DALICOL_VAL_TEMPORARY       192  /* + selector: temporary value */
+#define DALICOL_VAL_REPORT          224  /* + selector: actual value */
+
+#define DALICOL_RGBWAF_SCALE        258  /* 8 bit dimlevel to primary level (254 -> 0xFEFC) */
+#define DALICOL_TC_RANGE            (DALICOL_TC_WARMEST - DALICOL_TC_COOLEST)
+
+//definitions from dali_config.c
+extern const u32 DALIP_FadeTimeTable[];
+
+/* output of the primaries, one function for all units */
+TDCColourControlCallback *DALICol_Callback;
+
+
+#if DALICOL_TC_CAPABLE
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Tc_Share
+INPUT/OUTPUT : colour temperature (mirek, physical range) / share of cool output
+DESCRIPTION  : Interpolates the Tc mixing table
+COMMENTS     : Called at activation only, never per tick
+-----------------------------------------------------------------------------*/
+static u16 DALICol_Tc_Share(u16 tc)
+{
+  u32 pos;
+  u8 i;
+  u16 a;
+  u16 b;
+
+  pos = (u32)(tc - DALICOL_TC_COOLEST) * DALICOL_TC_STEPS;
+  i = (u8)(pos / DALICOL_TC_RANGE);
+  if (i >= DALICOL_TC_STEPS)
+    return DALICol_TcTable[DALICOL_TC_STEPS];
+  a = DALICol_TcTable[i];
+  b = DALICol_TcTable[i + 1];
+  return (u16)(a - ((u32)(a - b) * (pos % DALICOL_TC_RANGE)) / DALICOL_TC_RANGE);
+}
+#endif /* DALICOL_TC_CAPABLE */
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Goals
+INPUT/OUTPUT : None
+DESCRIPTION  : Share of each primary for the actual colour
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+static void DALICol_Goals(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+#if DALICOL_TC_CAPABLE
+  u16 share;
+
+  if (c->Type == DALICOL_TYPE_TC)
+  {
+    share = DALICol_Tc_Share(c->Tc);
+    c->Goal[0] = (u16)(0xFFFF - share);  /* warm */
+    c->Goal[1] = share;                  /* cool */
+    return;
+  }
+#endif
+  for (n = 0; n < DALICOL_PRIMARIES; n++)
+    c->Goal[n] = c->Level[n];
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Start_Fade
+INPUT/OUTPUT : fade duration (ms ticks, 0 = at once)
+DESCRIPTION  : Sets up the linear fade of the shares to the goals
+COMMENTS     : Steps are two's complement, the last tick loads the goals
+               exactly (no rounding drift)
+-----------------------------------------------------------------------------*/
+static void DALICol_Start_Fade(u32 ticks)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+  u32 goal;
+
+  for (n = 0; n < DALICOL_PRIMARIES; n++)
+  {
+    goal = (u32)c->Goal[n] << 16;
+    if (!ticks)
+      c->Share[n] = goal;
+    else if (goal >= c->Share[n])
+      c->Step[n] = (goal - c->Share[n]) / ticks;
+    else
+      c->Step[n] = 0 - ((c->Share[n] - goal) / ticks);
+  }
+  c->FadeTicks = ticks;
+  c->Dirty = 1;
+}
+
+static void DALICol_Clear_Temporary(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+
+  c->TempTc = DALICOL_MASK;
+  for (n = 0; n < DALICOL_PRIMARIES; n++)
+    c->TempLevel[n] = DALICOL_MASK;
+  c->TempControl = c->Control;
+  c->TempType = DALICOL_TYPE_NONE;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Activate
+INPUT/OUTPUT : fade duration (ms ticks, 0 = at once)
+DESCRIPTION  : Temporary colour becomes actual colour, fade to it starts
+COMMENTS     : Masked temporary values keep the actual ones. Outputs are
+               updated by the next DALICol_Flush or light level output.
+-----------------------------------------------------------------------------*/
+static void DALICol_Activate(u32 ticks)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+  u16 tc;
+
+  if (c->TempType == DALICOL_TYPE_NONE)
+    return;
+  if (c->TempType == DALICOL_TYPE_TC)
+  {
+    if (c->TempTc != DALICOL_MASK)
+    {
+      tc = c->TempTc;
+      c->Status &= (u8)~DALICOL_STATUS_TC_OUT_OF_RANGE;
+      if (tc < c->TcCoolest)
+      {
+        tc = c->TcCoolest;
+        c->Status |= DALICOL_STATUS_TC_OUT_OF_RANGE;
+      }
+      else if (tc > c->TcWarmest)
+      {
+        tc = c->TcWarmest;
+        c->Status |= DALICOL_STATUS_TC_OUT_OF_RANGE;
+      }
+      c->Tc = tc;
+    }
+  }
+  else
+  {
+    for (n = 0; n < DALICOL_PRIMARIES; n++)
+      if (c->TempLevel[n] != DALICOL_MASK)
+        c->Level[n] = c->TempLevel[n];
+    if (c->TempType == DALICOL_TYPE_RGBWAF)
+      c->Control = c->TempControl;
+  }
+  c->Type = c->TempType;
+  DALICol_Clear_Temporary();
+  DALICol_Goals();
+  DALICol_Start_Fade(ticks);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Init
+INPUT/OUTPUT : None
+DESCRIPTION  : Colour state of the selected unit after power up
+COMMENTS     : Called by DALIP_Init, takes the light output of the unit
+               over if the application has set a colour callback
+-----------------------------------------------------------------------------*/
+void DALICol_Init(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+
+  c->Features = 0;
+  c->Light = 0;
+  DALICol_Reset();
+  if (DALICol_Callback)
+    DALI_CTX->LightControlCallback = DALICol_Light;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Reset
+INPUT/OUTPUT : None
+DESCRIPTION  : Reset values: Tc limits physical, warmest Tc (Tc capable gear)
+               or all primaries full, no fade
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+void DALICol_Reset(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+
+  c->TcCoolest = DALICOL_TC_COOLEST;
+  c->TcWarmest = DALICOL_TC_WARMEST;
+  c->Tc = DALICOL_TC_WARMEST;
+  for (n = 0; n < DALICOL_PRIMARIES; n++)
+    c->Level[n] = (u16)(254 * DALICOL_RGBWAF_SCALE);
+  c->Control = 0;
+  c->Status = 0;
+#if DALICOL_TC_CAPABLE
+  c->Type = DALICOL_TYPE_TC;
+#else
+  c->Type = DALICOL_TYPE_RGBWAF;
+#endif
+  DALICol_Clear_Temporary();
+  DALICol_Goals();
+  DALICol_Start_Fade(0);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Light
+INPUT/OUTPUT : arc power level (linear, from DALIP_ConvertARC)
+DESCRIPTION  : Light control callback of a colour unit, outputs all primaries
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+void DALICol_Light(DALI_UNIT_PARAMS u16 light)
+{
+  DALI_CTX->Colour.Light = light;
+  DALI_CTX->Colour.Dirty = 1;
+  DALICol_Flush();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Flush
+INPUT/OUTPUT : None
+DESCRIPTION  : Outputs the primaries if the shares have changed
+COMMENTS     : Constant cost: one multiplication per primary
+-----------------------------------------------------------------------------*/
+void DALICol_Flush(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+
+  if (!c->Dirty)
+    return;
+  c->Dirty = 0;
+  if (!DALICol_Callback)
+    return;
+  for (n = 0; n < DALICOL_PRIMARIES; n++)
+    DALICol_Callback(DALI_UNIT_ARGS n, (u16)(((u32)c->Light * (u16)(c->Share[n] >> 16)) >> 16));
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Auto_Activate
+INPUT/OUTPUT : fade duration (ms ticks) of the arc power command
+DESCRIPTION  : Activates the temporary colour with an arc power command
+               if auto activation is enabled
+COMMENTS     : Called with the duration of the arc fade: colour fade starts
+               and ends on the same ticks as the arc fade
+-----------------------------------------------------------------------------*/
+void DALICol_Auto_Activate(u32 ticks)
+{
+  if (DALI_CTX->Colour.Features & DALICOL_FEATURE_AUTO_ACTIVATION)
+    DALICol_Activate(ticks);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_TimerCallback
+INPUT/OUTPUT : None
+DESCRIPTION  : One ms step of the colour fade
+COMMENTS     : Called by Process_Lite_timer_IT while FadeTicks != 0, before
+               the arc fade step of the same tick
+-----------------------------------------------------------------------------*/
+void DALICol_TimerCallback(void)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 n;
+
+  c->FadeTicks--;
+  if (c->FadeTicks)
+  {
+    for (n = 0; n < DALICOL_PRIMARIES; n++)
+      c->Share[n] += c->Step[n];
+  }
+  else
+  {
+    for (n = 0; n < DALICOL_PRIMARIES; n++)
+      c->Share[n] = (u32)c->Goal[n] << 16;
+  }
+  c->Dirty = 1;
+}
+
+#if DALICOL_TC_CAPABLE
+static void DALICol_Step_Tc(u8 warmer)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+
+  if (c->Type != DALICOL_TYPE_TC)
+    return;
+  if (warmer)
+  {
+    if (c->Tc >= c->TcWarmest)
+      return;
+    c->Tc++;
+  }
+  else
+  {
+    if (c->Tc <= c->TcCoolest)
+      return;
+    c->Tc--;
+  }
+  DALICol_Goals();
+  DALICol_Start_Fade(0);
+  DALICol_Flush();
+}
+
+static void DALICol_Store_Tc_Limit(u8 limit, u16 tc)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+
+  if (tc == DALICOL_MASK)
+    return;
+  if (tc < DALICOL_TC_COOLEST)
+    tc = DALICOL_TC_COOLEST;
+  if (tc > DALICOL_TC_WARMEST)
+    tc = DALICOL_TC_WARMEST;
+  if ((limit == 0) && (tc <= c->TcWarmest))
+    c->TcCoolest = tc;
+  if ((limit == 1) && (tc >= c->TcCoolest))
+    c->TcWarmest = tc;
+  /* physical limits (2, 3) are given by the outputs (dali_config.h) */
+}
+#endif /* DALICOL_TC_CAPABLE */
+
+static void DALICol_Set_Temporary_Dimlevels(u8 first, u8 d0, u8 d1, u8 d2)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 dim[3];
+  u8 i;
+
+  dim[0] = d0;
+  dim[1] = d1;
+  dim[2] = d2;
+  for (i = 0; i < 3; i++)
+  {
+    if ((u8)(first + i) < DALICOL_PRIMARIES)
+      c->TempLevel[first + i] = (dim[i] == 255) ? DALICOL_MASK : (u16)(dim[i] * DALICOL_RGBWAF_SCALE);
+  }
+  c->TempType = DALICOL_TYPE_RGBWAF;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALICol_Query_Value
+INPUT/OUTPUT : selector (DTR) / MSB of the value, LSB goes to DTR
+DESCRIPTION  : QUERY COLOUR VALUE
+COMMENTS     : 8 bit values (dimlevels, control, type) are answered as is,
+               unknown values answer MASK
+-----------------------------------------------------------------------------*/
+static u8 DALICol_Query_Value(u8 sel)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u8 temp = 0;
+  u16 val = DALICOL_MASK;
+  u16 *levels;
+
+  switch (sel)
+  {
+    case DALICOL_VAL_PRIMARIES:      return DALICOL_PRIMARIES;
+#if DALICOL_TC_CAPABLE
+    case DALICOL_VAL_TC_COOLEST:      val = c->TcCoolest;      break;
+    case DALICOL_VAL_TC_PHYS_COOLEST: val = DALICOL_TC_COOLEST; break;
+    case DALICOL_VAL_TC_WARMEST:      val = c->TcWarmest;      break;
+    case DALICOL_VAL_TC_PHYS_WARMEST: val = DALICOL_TC_WARMEST; break;
+#endif
+    default:
+      if (sel >= DALICOL_VAL_REPORT)
+        sel -= DALICOL_VAL_REPORT;
+      else if (sel >= DALICOL_VAL_TEMPORARY)
+      {
+        sel -= DALICOL_VAL_TEMPORARY;
+        temp = 1;
+      }
+      levels = temp ? c->TempLevel : c->Level;
+      if (sel == DALICOL_VAL_TYPE)
+        return temp ? c->TempType : c->Type;
+      if (sel == DALICOL_VAL_CONTROL)
+        return temp ? c->TempControl : c->Control;
+      if ((sel >= DALICOL_VAL_RGBWAF) && (sel < DALICOL_VAL_RGBWAF + DALICOL_PRIMARIES))
+      {
+        val = levels[sel - DALICOL_VAL_RGBWAF];
+        return (val == DALICOL_MASK) ? 255 : (u8)(val / DALICOL_RGBWAF_SCALE);
+      }
+      if ((sel >= DALICOL_VAL_PRIMARY) && (sel < DALICOL_VAL_PRIMARY + DALICOL_PRIMARIES))
+        val = levels[sel - DALICOL_VAL_PRIMARY];
+#if DALICOL_TC_CAPABLE
+      if (sel == DALICOL_VAL_TC)
+      {
+        if (temp)
+          val = c->TempTc;
+        else if (c->Type == DALICOL_TYPE_TC)
+          val = c->Tc;
+      }
+#endif
+      break;
+  }
+  DALI_CTX->dtr = (u8)val;
+  return (u8)(val >> 8);
+}
+
+/********************************************************************************
+ * Extended Commands of device type 8 (colour control), selected by            *
+ * ENABLE DEVICE TYPE 8. Temporary colour values are loaded from DTR, DTR1 and *
+ * DTR2, ACTIVATE makes them actual. xy coordinates, primary calibration and   *
+ * channel assignment are not supported (colour type features tell so).       *
+ *******************************************************************************/
+
+u8 DALICol_Ext_Cmd_Is_Answer_Required(u8 command)
+{
+  return (u8)((command >= 247) && (command <= 252));
+}
+
+u8 DALICol_Ext_Cmd_Is_Answer_YesNo(u8 command)
+{
+  return 0;
+}
+
+u8 DALICol_Extended_Command(u8 command)
+{
+  TDALIColour *c = &DALI_CTX->Colour;
+  u16 val;
+  u32 ticks;
+  u8 n;
+
+  val = ((u16)DALI_CTX->dtr1 << 8) | DALI_CTX->dtr;
+  switch (command)
+  {
+    case 226: /* Activate */
+      ticks = DALIP_Fade_Ticks_Left(); /* running arc fade: end together */
+      if (!ticks)
+        ticks = DALIP_FadeTimeTable[DALIP_GetFadeTime()];
+      DALICol_Activate(ticks);
+      DALICol_Flush();
+      return 0;
+#if DALICOL_TC_CAPABLE
+    case 231: /* Set temporary colour temperature Tc (DTR1:DTR mirek) */
+      c->TempTc = val;
+      c->TempType = DALICOL_TYPE_TC;
+      return 0;
+    case 232: /* Colour temperature Tc step cooler */
+      DALICol_Step_Tc(0);
+      return 0;
+    case 233: /* Colour temperature Tc step warmer */
+      DALICol_Step_Tc(1);
+      return 0;
+#endif
+    case 234: /* Set temporary primary N dimlevel (DTR1:DTR, N = DTR2) */
+      if (DALI_CTX->dtr2 < DALICOL_PRIMARIES)
+      {
+        c->TempLevel[DALI_CTX->dtr2] = val;
+        c->TempType = DALICOL_TYPE_PRIMARY;
+      }
+      return 0;
+    case 235: /* Set temporary RGB dimlevel (DTR, DTR1, DTR2) */
+      DALICol_Set_Temporary_Dimlevels(0, DALI_CTX->dtr, DALI_CTX->dtr1, DALI_CTX->dtr2);
+      return 0;
+    case 236: /* Set temporary WAF dimlevel (DTR, DTR1, DTR2) */
+      DALICol_Set_Temporary_Dimlevels(3, DALI_CTX->dtr, DALI_CTX->dtr1, DALI_CTX->dtr2);
+      return 0;
+    case 237: /* Set temporary RGBWAF control (DTR) */
+      c->TempControl = DALI_CTX->dtr;
+      c->TempType = DALICOL_TYPE_RGBWAF;
+      return 0;
+    case 238: /* Copy report to temporary */
+      c->TempTc = c->Tc;
+      for (n = 0; n < DALICOL_PRIMARIES; n++)
+        c->TempLevel[n] = c->Level[n];
+      c->TempControl = c->Control;
+      c->TempType = c->Type;
+      return 0;
+#if DALICOL_TC_CAPABLE
+    case 242: /* Store colour temperature Tc limit (DTR1:DTR, limit = DTR2), send twice */
+      if (DALIC_Is_Repeated())
+        DALICol_Store_Tc_Limit(DALI_CTX->dtr2, val);
+      return 0;
+#endif
+    case 243: /* Store gear features/status (DTR), send twice */
+      if (DALIC_Is_Repeated())
+        c->Features = (u8)(DALI_CTX->dtr & DALICOL_FEATURE_AUTO_ACTIVATION);
+      return 0;
+    case 247: /* Query gear features/status */
+      return c->Features;
+    case 248: /* Query colour status */
+      return (u8)(c->Status | c->Type);
+    case 249: /* Query colour type features */
+      return (u8)((DALICOL_TC_CAPABLE << 1) | (DALICOL_PRIMARIES << 2) | (DALICOL_PRIMARIES << 5));
+    case 250: /* Query colour value (selector = DTR) */
+      return DALICol_Query_Value(DALI_CTX->dtr);
+    case 251: /* Query RGBWAF control */
+      return c->Control;
+    case 252: /* Query assigned colour (channel = DTR) */
+      if (DALI_CTX->dtr >= DALICOL_PRIMARIES)
+        return 0;
+#if DALICOL_TC_CAPABLE
+      return 4; /* white */
+#else
+      return (u8)(DALI_CTX->dtr + 1); /* red, green, blue, white, amber, freecolour */
+#endif
+  }
+  return 0;
+}
+
+u8 DALICol_Extended_Version_Number(void)
+{
+  return 2;
+}
+
+#endif /* DALI_COLOUR */
@@ -20,6 +20,12 @@
 
 #include "stm8s.h"
 #include "dali_config.h"
+#include "dali_mem.h"
+#include "dali_diag.h"
+#include "dali_fwu.h"
+#include "dali_pub.h"
+#include "dali_col.h"
+#include "dali_curves.h"
 
 
 /*  ------------------------ Default DALI registers ------------------------ */
@@ -53,54 +59,14 @@ const u8 DaliRegDefaults[] =
 
 
 #ifdef USE_ARC_TABLE
-/**********************************************
- * Fill in the Numbers (see Spec)             *
- * then uncomment                             *
- **********************************************/
-
-/*
-//linear table for maximum set to 65535
-const u16 DALIP_ArcTable[]={
-      0,  258,  516,  774, 1032, 1290, 1548, 1806, 2064, 2322, 2580, 2838, 3096, 3354, 3612, 3870,
-   4128, 4386, 4644, 4902, 5160, 5418, 5676, 5934, 6192, 6450, 6708, 6966, 7224, 7482, 7740, 7998,
-   8256, 8514, 8772, 9030, 9288, 9546, 9804,10062,10320,10578,10836,11095,11353,11611,11869,12127,
-  12385,12643,12901,13159,13417,13675,13933,14191,14449,14707,14965,15223,15481,15739,15997,16255,
-  16513,16771,17029,17287,17545,17803,18061,18319,18577,18835,19093,19351,19609,19867,20125,20383,
-  20641,20899,21157,21415,21673,21931,22189,22447,22705,22963,23221,23479,23737,23995,24253,24511,
-  24769,25027,25285,25543,25801,26059,26317,26575,26833,27091,27349,27607,27865,28123,28381,28639,
-  28897,29155,29413,29671,29929,30187,30445,30703,30961,31219,31477,31735,31993,32251,32509,32768,
-  33026,33284,33542,33800,34058,34316,34574,34832,35090,35348,35606,35864,36122,36380,36638,36896,
-  37154,37412,37670,37928,38186,38444,38702,38960,39218,39476,39734,39992,40250,40508,40766,41024,
-  41282,41540,41798,42056,42314,42572,42830,43088,43346,43604,43862,44120,44378,44636,44894,45152,
-  45410,45668,45926,46184,46442,46700,46958,47216,47474,47732,47990,48248,48506,48764,49022,49280,
-  49538,49796,50054,50312,50570,50828,51086,51344,51602,51860,52118,52376,52634,52892,53150,53408,
-  53666,53924,54182,54440,54699,54957,55215,55473,55731,55989,56247,56505,56763,57021,57279,57537,
-  57795,58053,58311,58569,58827,59085,59343,59601,59859,60117,60375,60633,60891,61149,61407,61665,
-  61923,62181,62439,62697,62955,63213,63471,63729,63987,64245,64503,64761,65019,65277,65535,65535
-};
-*/
-
-//logarithmic table for maximum set to 65535
-const u16 DALIP_ArcTable[]={
-      0,   66,   67,   69,   71,   73,   75,   77,   79,   82,   84,   86,   88,   91,   93,   96,
-     99,  101,  104,  107,  110,  113,  116,  119,  123,  126,  130,  133,  137,  141,  145,  149,
-    153,  157,  161,  166,  170,  175,  180,  185,  190,  195,  201,  206,  212,  218,  224,  230,
-    236,  243,  250,  257,  264,  271,  279,  286,  294,  302,  311,  319,  328,  337,  347,  356,
-    366,  376,  387,  397,  408,  420,  431,  443,  455,  468,  481,  494,  508,  522,  536,  551,
-    567,  582,  598,  615,  632,  649,  667,  686,  705,  724,  744,  765,  786,  808,  830,  853,
-    877,  901,  926,  952,  978, 1005, 1033, 1062, 1091, 1121, 1152, 1184, 1217, 1251, 1285, 1321,
-   1357, 1395, 1433, 1473, 1514, 1556, 1599, 1643, 1689, 1735, 1783, 1833, 1884, 1936, 1989, 2044,
-   2101, 2159, 2219, 2280, 2343, 2408, 2475, 2543, 2614, 2686, 2760, 2837, 2915, 2996, 3079, 3164,
-   3252, 3342, 3434, 3529, 3627, 3727, 3831, 3937, 4046, 4158, 4273, 4391, 4513, 4637, 4766, 4898,
-   5033, 5173, 5316, 5463, 5614, 5769, 5929, 6093, 6262, 6435, 6613, 6796, 6985, 7178, 7377, 7581,
-   7791, 8006, 8228, 8456, 8690, 8930, 9177, 9431, 9692, 9961,10236,10520,10811,11110,11418,11734,
-  12059,12392,12735,13088,13450,13822,14205,14598,15002,15418,15844,16283,16734,17197,17673,18162,
-  18665,19181,19712,20258,20819,21395,21987,22596,23221,23864,24524,25203,25901,26618,27354,28112,
-  28890,29689,30511,31356,32224,33115,34032,34974,35942,36937,37959,39010,40090,41200,42340,43512,
-  44716,45954,47226,48533,49877,51257,52676,54134,55632,57172,58755,60381,62052,63770,65535,65535
+/*  ------------------------ Dimming curves ------------------------ */
+/* knots of the curves selectable by DT6 SELECT DIMMING CURVE, generated
+   into dali_curves.h by Utilities/ArcCurves from their parameters
+   (logarithmic, linear, gamma, LED bin calibration) */
+CONST u16 DALIP_Curves[DALIP_CURVES_CNT][DALIP_CURVE_KNOTS] =
+{
+  DALIP_CURVES_TABLE
 };
-
-
 #endif
 
 /*  ------------------------ Fade time table ------------------------ */
@@ -142,3 +108,89 @@ const u16 DALIP_FadeRateTable[]={       //ALALremark ms/step
   252,
   357
 };
+
+/*  ------------------------ Memory banks ------------------------ */
+/* EEPROM image of memory banks 0 and 1, bank 2 is live RAM (diagnostics) */
+#ifdef _IAR_
+u8 DALIM_E2[DALIM_E2_SIZE] @ "eeprom_zone"=
+#else
+EEPROM u8 DALIM_E2[DALIM_E2_SIZE]=
+#endif
+{
+  // memory bank 0 - according specification (DALIM_E2 offset 0)
+  (DALIM_BANK0_SIZE-1)  , // 0x00 address of last accessible memory location factory burn in read-only
+  (u8)(0 - (DALIM_BANKS_CNT-1) - 0 - 1 - 2 - 3 - 4 - 5 - 1 - 0 - 0 - 0 - 0 - 1 - 'S' - 'T' - 'M' - '8' - 'D' - 'A' - 'L' - 'I' - ' ' - 'l' - 'i' - 'b' - 'r' - 'a' - 'r' - 'y' - '.')
+                        , // 0x01 checksum of memory bank 0 factory burn in read-only
+  (DALIM_BANKS_CNT-1)   , // 0x02 number of last accessible memory bank factory burn in read-only
+  0                     , // 0x03 GTIN byte 0 (MSB) factory burn in read-only
+  1                     , // 0x04 GTIN byte 1 factory burn in read-only
+  2                     , // 0x05 GTIN byte 2 factory burn in read-only
+  3                     , // 0x06 GTIN byte 3 factory burn in read-only
+  4                     , // 0x07 GTIN byte 4 factory burn in read-only
+  5                     , // 0x08 GTIN byte 5 factory burn in read-only
+  1                     , // 0x09 control gear firmware version (major) factory burn in read-only
+  0                     , // 0x0A control gear firmware version (minor) factory burn in read-only
+  0                     , // 0x0B serial number byte 1 (MSB) factory burn in read-only
+  0                     , // 0x0C serial number byte 2 factory burn in read-only
+  0                     , // 0x0D serial number byte 3 factory burn in read-only
+  1                     , // 0x0E serial number byte 4 factory burn in read-only
+  'S','T','M','8','D','A','L','I',' ','l','i','b','r','a','r','y','.', // 0x0F- ... additional control gear information
+
+  // memory bank 1 - according specification (DALIM_E2 offset DALIM_BANK0_SIZE)
+  (DALIM_BANK1_SIZE-1)  , // 0x00 address of last accessible memory location factory burn in read-only
+  30                    , // 0x01 checksum of memory bank 1 read-only
+  0xFF                  , // 0x02 memory bank 1 lock byte (read-only if not 0x55) 0xFF read / write
+  0xFF                  , // 0x03 OEM GTIN byte 0 (MSB) 0xFF read / write (lockable)
+  0xFF                  , // 0x04 OEM GTIN byte 1 0xFF read / write (lockable)
+  0xFF                  , // 0x05 OEM GTIN byte 2 0xFF read / write (lockable)
+  0xFF                  , // 0x06 OEM GTIN byte 3 0xFF read / write (lockable)
+  0xFF                  , // 0x07 OEM GTIN byte 4 0xFF read / write (lockable)
+  0xFF                  , // 0x08 OEM GTIN byte 5 0xFF read / write (lockable)
+  0xFF                  , // 0x09 OEM serial number byte 1 (MSB) 0xFF read / write (lockable)
+  0xFF                  , // 0x0A OEM serial number byte 2 0xFF read / write (lockable)
+  0xFF                  , // 0x0B OEM serial number byte 3 0xFF read / write (lockable)
+  0xFF                  , // 0x0C OEM serial number byte 4 (LSB) 0xFF read / write (lockable)
+  0xFF                  , // 0x0D Subsystem (bit 4 to bit 7) Device number (bit 0 to bit 3) 0xFF read / write (lockable)
+  0xFF                  , // 0x0E Lamp type number (lockable) c 0xFF read / write (lockable)
+  0xFF                  , // 0x0F Lamp type number 0xFF read / write
+  0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF // 0x10- ... additional OEM information
+};
+
+/* memory bank descriptors, index = bank number */
+CONST TDALIMBank DALIM_Banks[DALIM_BANKS_CNT] =
+{
+  /* size             backing       lock             open  e2_offset         image ram read write hook */
+  { DALIM_BANK0_SIZE, DALIM_EEPROM, DALIM_READ_ONLY, 0,    0,                0,    0,  0,   0 },
+  { DALIM_BANK1_SIZE, DALIM_EEPROM, DALIM_LOCK_BYTE, 0x0F, DALIM_BANK0_SIZE, 0,    0,  0,   0 },
+  { DALID_BANK_SIZE,  DALIM_RAM,    DALIM_READ_ONLY, 0,    0,                0,    DALID_Bank, DALID_ReadHook, 0 },
+#ifdef DALI_FW_UPDATE
+  { DALIU_BANK_SIZE,  DALIM_RAM,    DALIM_LOCK_BYTE, 0,    0,                0,    DALIU_Bank, 0,   DALIU_WriteHook },
+#endif
+};
+
+/*  ------------------------ Device types ------------------------ */
+/* extended command sets, index = ENABLE DEVICE TYPE X selection, more
+   than one entry makes QUERY DEVICE TYPE answer 255 */
+CONST TDPExtension DALIP_Extensions[DALIP_EXT_CNT] =
+{
+  /* type        answer required                   answer yes/no                  command                  version */
+  { DEVICE_TYPE, DALIP_Ext_Cmd_Is_Answer_Required, DALIP_Ext_Cmd_Is_Answer_YesNo, DALIP_Extended_Command, DALIP_Extended_Version_Number },
+#ifdef DALI_COLOUR
+  { 8,           DALICol_Ext_Cmd_Is_Answer_Required, DALICol_Ext_Cmd_Is_Answer_YesNo, DALICol_Extended_Command, DALICol_Extended_Version_Number },
+#endif
+};
+
+#ifdef DALI_COLOUR
+/*  ------------------------ Colour temperature mixing ------------------------ */
+/* share of the cool white output (65535 = all cool) giving the colour
+   temperature DALICOL_TC_COOLEST + i * (DALICOL_TC_WARMEST - DALICOL_TC_COOLEST)
+   / DALICOL_TC_STEPS mirek, the warm output gets the rest. Computed for
+   Planckian 6500K and 2700K sources of equal flux (mix on the straight line
+   between them in CIE xy, McCamy CCT), replace with measured values */
+CONST u16 DALICol_TcTable[DALICOL_TC_STEPS + 1] =
+{
+  65535, 60333, 55407, 50708, 46203, 41864, 37665, 33586,
+  29610, 25720, 21901, 18140, 14425, 10744,  7086,  3439,
+      0
+};
+#endif /* DALI_COLOUR */
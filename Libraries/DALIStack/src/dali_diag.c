@@ -0,0 +1,124 @@
+/**
+  ******************************************************************************
+  * @file    dali_diag.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Diagnostic counters and diagnostic memory bank
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "stm8s.h"
+#include "dali_diag.h"
+#include "DALIslave.h"
+
+/* file global variable */
+TDALIDCounters DALID_Counters;
+u16 DALID_UptimeMs;
+TDALIDBoot DALID_Boot;
+u8 DALID_Bank[DALID_BANK_SIZE];   /* snapshot read by master (live RAM memory bank) */
+
+static TDALIStats stats_copy;
+static TDALIDCounters counters_copy;
+static TDALIDBoot boot_copy;
+
+#if (TICKS_PER_SECOND % 64)
+ #error "boot latency conversion needs TICKS_PER_SECOND multiple of 64"
+#endif
+
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALID_Copy
+INPUT/OUTPUT : destination, source, size (multiple of 4)
+DESCRIPTION  : Copies counters updated by interrupts
+COMMENTS     : Interrupts are disabled for one 32 bit counter at a time, as
+               the I2C and CAN statistics do: the tick is delayed by a few
+               cycles only
+-----------------------------------------------------------------------------*/
+static void DALID_Copy(u8 *dst, volatile u8 *src, u8 size)
+{
+  u8 i;
+
+  for (i = 0; i < size; i += 4)
+  {
+    sim(); // counters are written by the DALI interrupts
+    dst[i] = src[i];
+    dst[i + 1] = src[i + 1];
+    dst[i + 2] = src[i + 2];
+    dst[i + 3] = src[i + 3];
+    rim();
+  }
+}
+
+static void DALID_Put(u8 loc, u32 val)
+{
+  DALID_Bank[loc + 0] = (u8)(val >> 24);
+  DALID_Bank[loc + 1] = (u8)(val >> 16);
+  DALID_Bank[loc + 2] = (u8)(val >> 8);
+  DALID_Bank[loc + 3] = (u8)(val);
+}
+
+/* boot latency in us, 1000000 = 15625 * 64 keeps 0xFFFF ticks within 32 bit */
+static u32 DALID_Boot_us(u16 ticks)
+{
+  if (ticks == DALID_BOOT_NONE)
+    return 0xFFFFFFFFUL;
+  return ((u32)ticks * 15625UL) / (TICKS_PER_SECOND / 64);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALID_Snapshot
+INPUT/OUTPUT : None
+DESCRIPTION  : Copies all counters into the diagnostic memory bank
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+static void DALID_Snapshot(void)
+{
+  DALID_Copy((u8*)&stats_copy, (volatile u8*)&DALIStats, sizeof(TDALIStats));
+  DALID_Copy((u8*)&counters_copy, (volatile u8*)&DALID_Counters, sizeof(TDALIDCounters));
+  DALID_Copy((u8*)&boot_copy, (volatile u8*)&DALID_Boot, sizeof(TDALIDBoot));
+
+  DALID_Bank[DALID_LOC_VERSION] = DALID_VERSION;
+  DALID_Put(DALID_LOC_FRAMES,       stats_copy.frames);
+  DALID_Put(DALID_LOC_ACCEPTED,     counters_copy.accepted);
+  DALID_Put(DALID_LOC_ERR_START,    stats_copy.err_start);
+  DALID_Put(DALID_LOC_ERR_STOP,     stats_copy.err_stop);
+  DALID_Put(DALID_LOC_ERR_EDGE,     stats_copy.err_edge);
+  DALID_Put(DALID_LOC_REPLIES,      stats_copy.replies);
+  DALID_Put(DALID_LOC_REP_TIMEOUTS, counters_copy.rep_timeouts);
+  DALID_Put(DALID_LOC_IF_FAILURES,  stats_copy.if_failures);
+  DALID_Put(DALID_LOC_E2_WRITES,    counters_copy.e2_writes);
+  DALID_Put(DALID_LOC_UPTIME,       counters_copy.uptime);
+  DALID_Put(DALID_LOC_ISR_MAX,      get_tick_duration_us());
+  DALID_Put(DALID_LOC_BOOT_LIGHT,   DALID_Boot_us(boot_copy.light));
+  DALID_Put(DALID_LOC_BOOT_FRAME,   DALID_Boot_us(boot_copy.frame));
+  DALID_Put(DALID_LOC_TX_FRAMES,    stats_copy.tx_frames);
+  DALID_Put(DALID_LOC_COLLISIONS,   stats_copy.collisions);
+  DALID_Put(DALID_LOC_TICK_JITTER,  get_tick_jitter_us());
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALID_ReadHook
+INPUT/OUTPUT : location to be read
+DESCRIPTION  : Read hook of the diagnostic memory bank
+COMMENTS     : Snapshot is taken at the start of a bank read (checksum or
+               first counter location), so one read sequence is consistent
+-----------------------------------------------------------------------------*/
+void DALID_ReadHook(u8 addr)
+{
+  static u8 last_addr;
+
+  if ((addr == 1) || ((addr == 2) && (last_addr != 1)))
+    DALID_Snapshot();
+  last_addr = addr;
+}
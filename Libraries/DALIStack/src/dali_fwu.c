@@ -0,0 +1,527 @@
+/**
+  ******************************************************************************
+  * @file    dali_fwu.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   DALI firmware update (memory bank streaming, flash block programming)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "stm8s.h"
+#include "stm8s_flash.h"
+#include "stm8s_iwdg.h"
+#include "dali.h"
+#include "dali_mem.h"
+#include "dali_diag.h"
+#include "dali_fwu.h"
+
+#ifdef DALI_FW_UPDATE
+
+#ifndef RAM_EXECUTION
+ #error "firmware update programs flash blocks from RAM: define RAM_EXECUTION in stm8s.h"
+#endif
+#if ((DALIU_SLOT_B + DALIU_SLOT_SIZE) > 0xFF80)
+ #error "firmware update slots and scratch block exceed the first 64KB of program memory"
+#endif
+
+/* file global variable */
+u8 DALIU_Bank[DALIU_BANK_SIZE];         /* memory bank, data window is the swap buffer too */
+static u8 DALIU_Block[FLASH_BLOCK_SIZE]; /* block waiting for programming */
+static u8 DALIU_Pending;                 /* DALIU_Block to be programmed at DALIU_Next */
+static u8 DALIU_State;
+static u8 DALIU_Target;                  /* DALIU_SWAPPING: state after the swap */
+static u8 DALIU_Error;
+static u8 DALIU_Trials;
+static u16 DALIU_Blocks;
+static u32 DALIU_Crc;
+static u16 DALIU_Next;
+static u16 DALIU_WinNext;                /* next data location of the window, 0 = dropped */
+static u8 DALIU_WinLast;                 /* data written there last */
+static u16 DALIU_WinCrc;
+static u16 DALIU_VerifyPos;
+static u32 DALIU_VerifyCrc;
+static u8 DALIU_Cache[DALIU_E2_SIZE];    /* RAM copy of the update record */
+static u32 DALIU_Dirty;                  /* bit per byte: cache not yet in EEPROM */
+static u8 DALIU_Iwdg;                    /* independent watchdog armed (DALIU_TRIAL) */
+
+
+static u16 DALIU_Crc16(u16 crc, u8 data)
+{
+  u8 i;
+
+  crc ^= (u16)data << 8;
+  for (i = 0; i < 8; i++)
+    crc = (crc & 0x8000) ? (u16)((crc << 1) ^ 0x1021) : (u16)(crc << 1);
+  return crc;
+}
+
+static u32 DALIU_Crc32(u32 crc, u8 data)
+{
+  u8 i;
+
+  crc ^= data;
+  for (i = 0; i < 8; i++)
+    crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320UL) : (crc >> 1);
+  return crc;
+}
+
+static u16 DALIU_Get16(u8 *p)
+{
+  return (u16)(((u16)p[0] << 8) | p[1]);
+}
+
+static void DALIU_Put16(u8 *p, u16 val)
+{
+  p[0] = (u8)(val >> 8);
+  p[1] = (u8)val;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Save
+INPUT/OUTPUT : None
+DESCRIPTION  : Copies the update state to the EEPROM record cache
+COMMENTS     : Changed bytes are written by DALIU_Process, one per call
+-----------------------------------------------------------------------------*/
+static void DALIU_Save(void)
+{
+  u8 rec[DALIU_E2_SIZE];
+  u8 i;
+
+  for (i = 0; i < DALIU_E2_SIZE; i++)
+    rec[i] = DALIU_Cache[i];
+  if (DALIU_State == DALIU_SWAPPING)
+  { // swap from the first step: word 0 holds step 0, word 1 is not valid
+    for (i = 0; i < 8; i++)
+      rec[DALIU_E2_PROGRESS + i] = ((i == 2) || (i == 3)) ? 0xFF : 0x00;
+  }
+  rec[DALIU_E2_TARGET] = DALIU_Target;
+  rec[DALIU_E2_STATE] = DALIU_State;
+  rec[DALIU_E2_TRIALS] = DALIU_Trials;
+  DALIU_Put16(&rec[DALIU_E2_BLOCKS], DALIU_Blocks);
+  DALIU_Put16(&rec[DALIU_E2_CRC], (u16)(DALIU_Crc >> 16));
+  DALIU_Put16(&rec[DALIU_E2_CRC + 2], (u16)DALIU_Crc);
+  DALIU_Put16(&rec[DALIU_E2_NEXT], DALIU_Next);
+  for (i = 0; i < DALIU_E2_SIZE; i++)
+  {
+    if (DALIU_Cache[i] != rec[i])
+    {
+      DALIU_Cache[i] = rec[i];
+      DALIU_Dirty |= (u32)1 << i;
+    }
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Write_Step
+INPUT/OUTPUT : returns !=0 while some write is pending
+DESCRIPTION  : Background writer of the EEPROM record, one byte per call
+COMMENTS     : Never waits for programming (see DALIM_Process_Writes). Lowest
+               offset first: the swap progress before the state.
+-----------------------------------------------------------------------------*/
+static u8 DALIU_Write_Step(void)
+{
+  u8 i;
+
+  if (!DALIU_Dirty)
+    return 0;
+  if (!(FLASH->IAPSR & FLASH_IAPSR_HVOFF)) // EEPROM programming in progress
+    return 1;
+  for (i = 0; i < DALIU_E2_SIZE; i++)
+  {
+    if (DALIU_Dirty & ((u32)1 << i))
+    {
+      DALIU_Dirty &= ~((u32)1 << i);
+      DALIU_WRITE(DALIU_E2_ADDRESS + i, DALIU_Cache[i]);
+      DALID_Counters.e2_writes++;
+      break;
+    }
+  }
+  return 1;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Publish
+INPUT/OUTPUT : None
+DESCRIPTION  : Writes the read only locations of the memory bank
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+static void DALIU_Publish(void)
+{
+  DALIU_Bank[DALIU_LOC_COMMAND] = DALIU_State;
+  DALIU_Bank[DALIU_LOC_ERROR] = DALIU_Error;
+  DALIU_Bank[DALIU_LOC_BLOCK_SIZE] = FLASH_BLOCK_SIZE;
+  DALIU_Put16(&DALIU_Bank[DALIU_LOC_NEXT], DALIU_Next);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Swap
+INPUT/OUTPUT : state of the update record after the swap
+DESCRIPTION  : Writes DALIU_SWAPPING to the update record and resets, the boot
+               then swaps slot A and slot B (dali_boot.c)
+COMMENTS     : Does not return
+-----------------------------------------------------------------------------*/
+static void DALIU_Swap(u8 target)
+{
+  DALIU_State = DALIU_SWAPPING;
+  DALIU_Target = target;
+  DALIU_Save();
+  while (DALIU_Write_Step())
+    ;
+  DALIU_RESET();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Init
+INPUT/OUTPUT : None
+DESCRIPTION  : Restores the update state after a reset, counts the resets of
+               an image on trial, arms the independent watchdog for it and
+               swaps the slots back after DALIU_TRIALS
+COMMENTS     : EEPROM must be initialised (unlocked) before. Once armed the
+               watchdog runs until the next reset, CONFIRM does not stop it.
+-----------------------------------------------------------------------------*/
+void DALIU_Init(void)
+{
+  u8 i;
+
+  for (i = 0; i < DALIU_E2_SIZE; i++)
+    DALIU_Cache[i] = DALIU_MEM(DALIU_E2_ADDRESS + i);
+  DALIU_Dirty = 0;
+  DALIU_Iwdg = 0;
+  DALIU_State = DALIU_Cache[DALIU_E2_STATE];
+  DALIU_Target = DALIU_Cache[DALIU_E2_TARGET];
+  DALIU_Trials = DALIU_Cache[DALIU_E2_TRIALS];
+  DALIU_Blocks = DALIU_Get16(&DALIU_Cache[DALIU_E2_BLOCKS]);
+  DALIU_Crc = ((u32)DALIU_Get16(&DALIU_Cache[DALIU_E2_CRC]) << 16) | DALIU_Get16(&DALIU_Cache[DALIU_E2_CRC + 2]);
+  DALIU_Next = DALIU_Get16(&DALIU_Cache[DALIU_E2_NEXT]);
+  DALIU_Error = DALIU_ERR_NONE;
+  DALIU_Pending = 0;
+  DALIU_WinNext = 0;
+
+  if ((DALIU_State >= DALIU_SWAPPING) || (DALIU_Blocks > DALIU_SLOT_BLOCKS) || (DALIU_Next > DALIU_Blocks))
+  { // blank or foreign record, or swap left by a firmware without the boot
+    DALIU_State = DALIU_IDLE;
+    DALIU_Blocks = 0;
+    DALIU_Next = 0;
+  }
+  if ((DALIU_State == DALIU_RECEIVING) && (DALIU_Next == DALIU_Blocks))
+    DALIU_State = DALIU_VERIFYING;
+  if (DALIU_State == DALIU_VERIFYING)
+  { // check again from the start
+    DALIU_VerifyPos = 0;
+    DALIU_VerifyCrc = 0xFFFFFFFFUL;
+  }
+  if (DALIU_State == DALIU_TRIAL)
+  {
+    if (DALIU_Trials >= DALIU_TRIALS)
+      DALIU_Swap(DALIU_ROLLED_BACK); // does not return
+    DALIU_Trials++;
+  }
+  DALIU_Save();
+  if (DALIU_State == DALIU_TRIAL)
+  { // counted before the new image can hang, then a hang resets (about 1s)
+    while (DALIU_Write_Step())
+      ;
+    IWDG->KR = IWDG_KEY_ENABLE;
+    IWDG->KR = (u8)IWDG_WriteAccess_Enable;
+    IWDG->PR = (u8)IWDG_Prescaler_256;
+    IWDG->RLR = 0xFF;
+    IWDG->KR = IWDG_KEY_REFRESH;
+    DALIU_Iwdg = 1;
+  }
+
+  for (i = 0; i < DALIU_BANK_SIZE; i++)
+    DALIU_Bank[i] = 0;
+  DALIU_Put16(&DALIU_Bank[DALIU_LOC_BLOCKS], DALIU_Blocks);
+  DALIU_Put16(&DALIU_Bank[DALIU_LOC_CRC], (u16)(DALIU_Crc >> 16));
+  DALIU_Put16(&DALIU_Bank[DALIU_LOC_CRC + 2], (u16)DALIU_Crc);
+  DALIU_Publish();
+}
+
+static void DALIU_Command(u8 cmd)
+{
+  u16 blocks;
+  u32 crc;
+
+  DALIU_Error = DALIU_ERR_NONE;
+  switch (cmd)
+  {
+    case DALIU_CMD_START:
+      blocks = DALIU_Get16(&DALIU_Bank[DALIU_LOC_BLOCKS]);
+      crc = ((u32)DALIU_Get16(&DALIU_Bank[DALIU_LOC_CRC]) << 16) | DALIU_Get16(&DALIU_Bank[DALIU_LOC_CRC + 2]);
+      if ((DALIU_State == DALIU_TRIAL) || (DALIU_State == DALIU_SWAPPING))
+        DALIU_Error = DALIU_ERR_STATE; // slot B holds the image for rollback
+      else if ((blocks == 0) || (blocks > DALIU_SLOT_BLOCKS))
+        DALIU_Error = DALIU_ERR_SIZE;
+      else if ((DALIU_State != DALIU_RECEIVING) || (blocks != DALIU_Blocks) || (crc != DALIU_Crc))
+      { // another image: from the first block, else resume at DALIU_Next
+        DALIU_State = DALIU_RECEIVING;
+        DALIU_Blocks = blocks;
+        DALIU_Crc = crc;
+        DALIU_Next = 0;
+        DALIU_Pending = 0;
+        DALIU_WinNext = 0;
+      }
+      break;
+    case DALIU_CMD_INSTALL:
+      if (DALIU_State == DALIU_SWAPPING)
+        break; // same command from another unit
+      if (DALIU_State != DALIU_READY)
+        DALIU_Error = DALIU_ERR_STATE;
+      else
+      { // reset by DALIU_Process once written and the bus is idle
+        DALIU_State = DALIU_SWAPPING;
+        DALIU_Target = DALIU_TRIAL;
+      }
+      break;
+    case DALIU_CMD_ABORT:
+      if ((DALIU_State == DALIU_RECEIVING) || (DALIU_State == DALIU_VERIFYING) || (DALIU_State == DALIU_READY))
+      {
+        DALIU_State = DALIU_IDLE;
+        DALIU_Next = 0;
+        DALIU_Pending = 0;
+      }
+      else if (DALIU_State != DALIU_IDLE)
+        DALIU_Error = DALIU_ERR_STATE;
+      break;
+    case DALIU_CMD_ROLLBACK:
+      if (DALIU_State == DALIU_SWAPPING)
+        break;
+      if ((DALIU_State != DALIU_TRIAL) && (DALIU_State != DALIU_CONFIRMED))
+        DALIU_Error = DALIU_ERR_STATE;
+      else
+      {
+        DALIU_State = DALIU_SWAPPING;
+        DALIU_Target = DALIU_ROLLED_BACK;
+      }
+      break;
+    case DALIU_CMD_CONFIRM:
+      if (DALIU_State == DALIU_TRIAL)
+        DALIU_State = DALIU_CONFIRMED;
+      else if (DALIU_State != DALIU_CONFIRMED)
+        DALIU_Error = DALIU_ERR_STATE;
+      break;
+    default:
+      DALIU_Error = DALIU_ERR_STATE;
+      return;
+  }
+  DALIU_Save();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Window_Done
+INPUT/OUTPUT : None
+DESCRIPTION  : Checks the block in the window and hands it to DALIU_Process
+COMMENTS     : Last data location written, window not dropped
+-----------------------------------------------------------------------------*/
+static void DALIU_Window_Done(void)
+{
+  u8 i;
+
+  if (DALIU_State != DALIU_RECEIVING)
+    DALIU_Error = DALIU_ERR_STATE;
+  else if (DALIU_Pending)
+    DALIU_Error = DALIU_ERR_BUSY;
+  else if (DALIU_Get16(&DALIU_Bank[DALIU_LOC_BLOCK]) != DALIU_Next)
+    DALIU_Error = DALIU_ERR_SEQUENCE;
+  else if (DALIU_Get16(&DALIU_Bank[DALIU_LOC_BLOCK_CRC]) != DALIU_WinCrc)
+    DALIU_Error = DALIU_ERR_BLOCK_CRC;
+  else
+  {
+    for (i = 0; i < FLASH_BLOCK_SIZE; i++)
+      DALIU_Block[i] = DALIU_Bank[DALIU_LOC_DATA + i];
+    DALIU_Pending = 1;
+    DALIU_Error = DALIU_ERR_NONE;
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_WriteHook
+INPUT/OUTPUT : location, data
+DESCRIPTION  : Memory bank write: command, window header or data
+COMMENTS     : Called once per unit addressed by the frame: repeated writes
+               of the same data location are ignored
+-----------------------------------------------------------------------------*/
+void DALIU_WriteHook(u8 addr, u8 data)
+{
+  if (addr >= DALIU_LOC_DATA)
+  { // data must come in order, the CRC-16 is computed on the fly
+    if (addr == DALIU_WinNext)
+    {
+      DALIU_WinCrc = DALIU_Crc16(DALIU_WinCrc, data);
+      DALIU_WinLast = data;
+      if (++DALIU_WinNext == DALIU_BANK_SIZE)
+        DALIU_Window_Done();
+    }
+    else if (!(DALIU_WinNext && (addr + 1 == DALIU_WinNext) && (data == DALIU_WinLast)))
+      DALIU_WinNext = 0;
+  }
+  else if (addr >= DALIU_LOC_BLOCK)
+  { // header: the data start over
+    DALIU_WinNext = DALIU_LOC_DATA;
+    DALIU_WinCrc = 0xFFFF;
+  }
+  else if (addr == DALIU_LOC_COMMAND)
+    DALIU_Command(data);
+  DALIU_Publish(); // read only locations, command location reads as state
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Program
+INPUT/OUTPUT : None
+DESCRIPTION  : Programs the pending block into slot B when the bus is idle
+COMMENTS     : Called the ms after the frame which completed the block: the
+               flash stall (about 6ms, interrupt vectors are fetched from
+               flash too) falls into the settling time before the next frame.
+               Later than DALIU_PROGRAM_IDLE_MAX after it the block waits for
+               the next frame. A frame starting on another line of a dual
+               line device during the stall is lost.
+-----------------------------------------------------------------------------*/
+static void DALIU_Program(void)
+{
+  u8 i;
+  u8 ok;
+  u8 line;
+  u8 settling;
+  u16 dst;
+
+  if (!(FLASH->IAPSR & FLASH_IAPSR_HVOFF)) // EEPROM programming in progress
+    return;
+  sim();
+  settling = 0;
+  for (line = 0; line < DALI_LINES; line++)
+    if (get_idle_ticks(DALI_LINE_ARG) <= DALIU_PROGRAM_IDLE_MAX)
+      settling = 1;
+  if (!settling || !DALI_Bus_Idle())
+  {
+    rim();
+    return;
+  }
+  FLASH_Unlock(FLASH_MEMTYPE_PROG);
+  FLASH_ProgramBlock((u16)((DALIU_SLOT_B - DALIU_BOOT) / FLASH_BLOCK_SIZE + DALIU_Next), FLASH_MEMTYPE_PROG, FLASH_PROGRAMMODE_STANDARD, DALIU_Block);
+  FLASH_WaitForLastOperation(FLASH_MEMTYPE_PROG);
+  FLASH_Lock(FLASH_MEMTYPE_PROG);
+  rim();
+
+  dst = (u16)(DALIU_SLOT_B + DALIU_Next * FLASH_BLOCK_SIZE);
+  ok = 1;
+  for (i = 0; i < FLASH_BLOCK_SIZE; i++)
+    if (DALIU_MEM(dst + i) != DALIU_Block[i])
+      ok = 0;
+  DALIU_Pending = 0;
+  if (!ok)
+    DALIU_Error = DALIU_ERR_FLASH; // controller sends the block again
+  else if (++DALIU_Next == DALIU_Blocks)
+  {
+    DALIU_State = DALIU_VERIFYING;
+    DALIU_VerifyPos = 0;
+    DALIU_VerifyCrc = 0xFFFFFFFFUL;
+  }
+  DALIU_Save();
+  DALIU_Publish();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Verify
+INPUT/OUTPUT : None
+DESCRIPTION  : Computes the CRC-32 of slot B, DALIU_VERIFY_CHUNK bytes per call,
+               then checks that the image is linked for slot A: its vector
+               table first, the reset vector in slot A
+COMMENTS     : A wrong image is dropped, START then receives it again
+-----------------------------------------------------------------------------*/
+static void DALIU_Verify(void)
+{
+  u8 i;
+  u16 size;
+  u16 entry;
+
+  size = (u16)(DALIU_Blocks * FLASH_BLOCK_SIZE);
+  for (i = 0; (i < DALIU_VERIFY_CHUNK) && (DALIU_VerifyPos < size); i++, DALIU_VerifyPos++)
+    DALIU_VerifyCrc = DALIU_Crc32(DALIU_VerifyCrc, DALIU_MEM(DALIU_SLOT_B + DALIU_VerifyPos));
+  if (DALIU_VerifyPos < size)
+    return;
+  entry = (u16)(((u16)DALIU_MEM(DALIU_SLOT_B + 2) << 8) | DALIU_MEM(DALIU_SLOT_B + 3));
+  if ((u32)(DALIU_VerifyCrc ^ 0xFFFFFFFFUL) != DALIU_Crc)
+    DALIU_Error = DALIU_ERR_IMAGE_CRC;
+  else if ((DALIU_MEM(DALIU_SLOT_B) != 0x82) || (DALIU_MEM(DALIU_SLOT_B + 1) != 0)
+           || (entry < DALIU_SLOT_A + DALIU_VECTORS * 4) || (entry >= DALIU_SLOT_B))
+    DALIU_Error = DALIU_ERR_IMAGE;
+  if (DALIU_Error == DALIU_ERR_NONE)
+    DALIU_State = DALIU_READY;
+  else
+  {
+    DALIU_State = DALIU_IDLE;
+    DALIU_Next = 0;
+  }
+  DALIU_Save();
+  DALIU_Publish();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Process
+INPUT/OUTPUT : returns !=0 while some work is pending
+DESCRIPTION  : Background task of the update: block programming, image
+               check, confirmation, reset into the slot swap, EEPROM record
+               writes and the independent watchdog
+COMMENTS     : Called each ms
+-----------------------------------------------------------------------------*/
+u8 DALIU_Process(void)
+{
+  u32 uptime;
+
+  if (DALIU_Iwdg)
+    IWDG->KR = IWDG_KEY_REFRESH;
+  if (DALIU_Pending)
+  {
+    DALIU_Program();
+    return 1;
+  }
+  switch (DALIU_State)
+  {
+    case DALIU_VERIFYING:
+      DALIU_Verify();
+      return 1;
+    case DALIU_TRIAL:
+      sim();
+      uptime = DALID_Counters.uptime;
+      rim();
+      if (uptime >= DALIU_CONFIRM_S)
+      { // new image runs: keep it
+        DALIU_State = DALIU_CONFIRMED;
+        DALIU_Save();
+        DALIU_Publish();
+      }
+      break;
+    case DALIU_SWAPPING:
+      if (DALIU_Dirty || !(FLASH->IAPSR & FLASH_IAPSR_HVOFF))
+        break;
+      if (DALI_Bus_Idle()) // answer of the command sent
+        DALIU_RESET(); // the boot swaps the slots
+      return 1;
+  }
+  return DALIU_Write_Step();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIU_Watchdog
+INPUT/OUTPUT : returns !=0 while the independent watchdog runs
+DESCRIPTION  : The watchdog keeps counting in halt mode: DALI_halt waits for
+               interrupts instead
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+u8 DALIU_Watchdog(void)
+{
+  return DALIU_Iwdg;
+}
+
+#endif /* DALI_FW_UPDATE */
@@ -0,0 +1,208 @@
+/**
+  ******************************************************************************
+  * @file    dali_mem.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   DALI memory banks
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "stm8s.h"
+#include "dali_mem.h"
+#include "dali_diag.h"
+
+/* Writes of EEPROM banks are deferred: WRITE MEMORY LOCATION updates the
+   cache and the checksum (location 1) at once, the reply is armed before
+   any EEPROM access, DALIM_Process_Writes() programs one byte per ms from
+   the main loop and keeps the device awake until all are programmed. One
+   dirty bit per cached byte is the write queue: a location written again
+   before it is programmed costs nothing more, it never fills up (no wait
+   in the command handler at line speed), and reads and the lock byte
+   check see the pending data in the cache. */
+
+/* file global variable */
+static u8 DALIM_Cache[DALIM_E2_SIZE];            /* RAM copy of DALIM_E2 */
+static u8 DALIM_Dirty[(DALIM_E2_SIZE + 7) / 8];  /* bit per byte: cache not yet in EEPROM */
+static u8 DALIM_DirtyCnt;
+
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_Init
+INPUT/OUTPUT : None
+DESCRIPTION  : Loads EEPROM banks to RAM cache
+COMMENTS     : EEPROM must be initialised (unlocked) before
+-----------------------------------------------------------------------------*/
+void DALIM_Init(void)
+{
+  u8 i;
+
+  for (i = 0; i < DALIM_E2_SIZE; i++)
+    DALIM_Cache[i] = DALIM_E2[i];
+  for (i = 0; i < sizeof(DALIM_Dirty); i++)
+    DALIM_Dirty[i] = 0;
+  DALIM_DirtyCnt = 0;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_LastLocation
+INPUT/OUTPUT : bank number (must exist) / address of last accessible location
+DESCRIPTION  : Content of location 0 of the bank
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+u8 DALIM_LastLocation(u8 bank)
+{
+  return DALIM_Banks[bank].size - 1;
+}
+
+static u8 DALIM_Get(CONST TDALIMBank *b, u8 addr)
+{
+  switch (b->backing)
+  {
+    case DALIM_FLASH:  return b->image[addr];
+    case DALIM_EEPROM: return DALIM_Cache[b->e2_offset + addr];
+    default:           return b->ram[addr];
+  }
+}
+
+static void DALIM_SetDirty(u8 pos)
+{
+  u8 mask;
+
+  mask = (u8)(1 << (pos & 0x07));
+  if (!(DALIM_Dirty[pos >> 3] & mask))
+  {
+    DALIM_Dirty[pos >> 3] |= mask;
+    DALIM_DirtyCnt++;
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_Read
+INPUT/OUTPUT : bank number (must exist), location / content
+DESCRIPTION  : Reads memory bank location
+COMMENTS     : No EEPROM access - fast enough to stream a bank at frame rate
+               The read hook of the bank is called first
+-----------------------------------------------------------------------------*/
+u8 DALIM_Read(u8 bank, u8 addr)
+{
+  CONST TDALIMBank *b;
+
+  b = &DALIM_Banks[bank];
+  if (addr && b->read_hook)
+    b->read_hook(addr);
+  return DALIM_Peek(bank, addr);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_Peek
+INPUT/OUTPUT : bank number (must exist), location / content
+DESCRIPTION  : Reads memory bank location without calling the read hook
+COMMENTS     : For the prefetch of the next location into DTR2: the hook
+               sees the locations the master reads, not the prefetches
+-----------------------------------------------------------------------------*/
+u8 DALIM_Peek(u8 bank, u8 addr)
+{
+  CONST TDALIMBank *b;
+  u8 i;
+  u8 checksum;
+
+  b = &DALIM_Banks[bank];
+  if (addr == 0)
+    return b->size - 1;
+  if ((addr == 1) && (b->backing == DALIM_RAM))
+  { // live data: checksum computed on request
+    checksum = 0;
+    for (i = 2; i < b->size; i++)
+      checksum -= b->ram[i];
+    return checksum;
+  }
+  return DALIM_Get(b, addr);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_Write
+INPUT/OUTPUT : bank number (must exist), location, data / 1 if written
+DESCRIPTION  : Writes memory bank location according lock policy of the bank
+COMMENTS     : EEPROM banks: cache and checksum (0 - sum of locations 2..last)
+               are updated at once, EEPROM later by DALIM_Process_Writes()
+-----------------------------------------------------------------------------*/
+u8 DALIM_Write(u8 bank, u8 addr, u8 data)
+{
+  CONST TDALIMBank *b;
+  u8 pos;
+
+  b = &DALIM_Banks[bank];
+  if ((addr < 2) || (addr >= b->size))
+    return 0;
+  switch (b->lock)
+  {
+    case DALIM_READ_ONLY:
+      return 0;
+    case DALIM_LOCK_BYTE:
+      if ((addr != 2) && (addr != b->open_addr) && (DALIM_Get(b, 2) != DALIM_UNLOCKED))
+        return 0;
+      break;
+  }
+  switch (b->backing)
+  {
+    case DALIM_EEPROM:
+      pos = b->e2_offset + addr;
+      DALIM_Cache[b->e2_offset + 1] += DALIM_Cache[pos] - data; // add old, remove new
+      DALIM_Cache[pos] = data;
+      DALIM_SetDirty(pos);
+      DALIM_SetDirty(b->e2_offset + 1);
+      break;
+    case DALIM_RAM:
+      b->ram[addr] = data;
+      break;
+    default:
+      return 0;
+  }
+  if (b->write_hook)
+    b->write_hook(addr, data);
+  return 1;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIM_Process_Writes
+INPUT/OUTPUT : returns !=0 while some write is pending
+DESCRIPTION  : Background EEPROM writer, one byte per call
+COMMENTS     : Never waits for programming: returns at once while EEPROM is busy
+-----------------------------------------------------------------------------*/
+u8 DALIM_Process_Writes(void)
+{
+  u8 i;
+  u8 mask;
+
+  if (!DALIM_DirtyCnt)
+    return 0;
+  if (!(FLASH->IAPSR & FLASH_IAPSR_HVOFF)) // EEPROM programming in progress
+    return 1;
+  for (i = 0; i < DALIM_E2_SIZE; i++)
+  {
+    mask = (u8)(1 << (i & 0x07));
+    if (DALIM_Dirty[i >> 3] & mask)
+    {
+      DALIM_Dirty[i >> 3] &= (u8)~mask;
+      DALIM_DirtyCnt--;
+      if (DALIM_E2[i] != DALIM_Cache[i])
+      {
+        DALIM_E2[i] = DALIM_Cache[i];
+        DALID_Counters.e2_writes++;
+      }
+      break;
+    }
+  }
+  return 1;
+}
@@ -25,30 +25,25 @@
 #include "lite_timer_8bit.h"
 #include "eeprom.h"
 #include "dali_config.h"
+#include "dali_cmd.h"
+#include "dali_ctx.h"
+#include "dali_curves.h"
 
-u32 DALIP_iChangeEvery;
-u32 DALIP_iChangeCountdown;
-u8 DALIP_bIncrease;
-u8 DALIP_bOff_AfterFade;
-u8 DALIP_iMaxLevel,DALIP_iMinLevel;
 u8 DALIP_DTR;
-u8 DALIP_FadeGoal;
 volatile u8 Physically_Selected;
-u8 DALIP_bEnable_DAPC;
-
-#if (DEVICE_TYPE == 6)          /* LED type device */
-u8 DALIP_FastFade = 0;
-u8 DALIP_CurveType = 0;
-#endif
-
-extern u8 dtr;
 
 //definitions from dali_config.c
 extern const u32 DALIP_FadeTimeTable[];
 extern const u16 DALIP_FadeRateTable[];
 
 #ifdef USE_ARC_TABLE
-  extern const u16 DALIP_ArcTable[];
+  extern CONST u16 DALIP_Curves[DALIP_CURVES_CNT][DALIP_CURVE_KNOTS];
+#endif
+
+#if (DEVICE_TYPE == 6)          /* LED type device: curve selected by command 227 */
+ #define DALIP_CURVE  DALI_CTX->CurveType
+#else
+ #define DALIP_CURVE  0
 #endif
 
 /**************************************************************************
@@ -60,9 +55,9 @@ extern const u16 DALIP_FadeRateTable[];
  **************************************************************************/
 const u8 ROMRegs[2]={DALI_VERSION_NUMBER_ROM,PHYSICAL_MIN_LEVEL_ROM}; // ALAL old /* {Version Number, Phys. Min Level} */
 
-void DALIP_HW_LIGHT_Set(u16 newval);
-//callback function type for light control
-TLightControlCallback *LightControlCallback = DALIP_HW_LIGHT_Set;
+void DALIP_HW_LIGHT_Set(DALI_UNIT_PARAMS u16 newval);
+static void DALIP_DAPC_Track(u8 val);
+static void DALIP_DAPC_Tick(void);
 
 
 /*-----------------------------------------------------------------------------
@@ -75,12 +70,15 @@ COMMENTS     :
 -----------------------------------------------------------------------------*/
 void DALIP_Init(TDPLightControlCallback LightControlFunction)
 {
-  DALIP_bEnable_DAPC = 0;
+  DALI_CTX->bEnable_DAPC = 0;
   //callback function init
   if (LightControlFunction)
-    LightControlCallback = LightControlFunction;
+    DALI_CTX->LightControlCallback = LightControlFunction;
   else
-    LightControlCallback = DALIP_HW_LIGHT_Set;
+    DALI_CTX->LightControlCallback = DALIP_HW_LIGHT_Set;
+#ifdef DALI_COLOUR
+  DALICol_Init();
+#endif
 }
 
 /*-----------------------------------------------------------------------------
@@ -91,8 +89,11 @@ DESCRIPTION  : Set new light value - HW dependent
 
 COMMENTS     :
 -----------------------------------------------------------------------------*/
-void DALIP_HW_LIGHT_Set(u16 newval)
+void DALIP_HW_LIGHT_Set(DALI_UNIT_PARAMS u16 newval)
 {
+#if (DALI_INSTANCES > 1)
+  (void)unit; /* callback signature, no light of any unit */
+#endif
   return;
 }
 
@@ -104,21 +105,34 @@ void DALIP_LaunchTimer(u8 p)
 
 void DALIP_DoneTimer(void){
   RTC_DoneUserTimer();
+  DALI_CTX->bDAPCTrack = 0;
 }
 
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIP_ConvertARC
+INPUT/OUTPUT : arc power level / light value (0..65535)
+DESCRIPTION  : Dimming curve of the unit, knots of dali_curves.h interpolated
+COMMENTS     : Knot k is the value at level 4k-2, so the 3 levels between two
+               knots need shifts only (same cost for all levels and curves)
+-----------------------------------------------------------------------------*/
 u16 DALIP_ConvertARC(u16 index)
 {
 #ifdef USE_ARC_TABLE
+  CONST u16 *knot;
+  u16 diff;
+  u16 val;
 
-#if (DEVICE_TYPE == 6)
-  if(DALIP_CurveType)
-    return (index << 8);
-  else
-    return DALIP_ArcTable[index];
-#else
-  return DALIP_ArcTable[index];
-#endif
-
+  if (!index)
+    return 0;
+  index += 2;
+  knot = &DALIP_Curves[DALIP_CURVE][index >> 2];
+  val = knot[0];
+  diff = knot[1] - knot[0];
+  if (index & 2)
+    val += diff >> 1;
+  if (index & 1)
+    val += diff >> 2;
+  return val;
 #else
   return (index << 8);
 #endif
@@ -143,17 +157,22 @@ void DALIP_TimerCallback(void)
 {
     u8 zw;
 
-    if (DALIP_iChangeCountdown)
+    if (DALI_CTX->bDAPCTrack)
+    {
+        DALIP_DAPC_Tick();
+        return;
+    }
+    if (DALI_CTX->iChangeCountdown)
     {
-        DALIP_iChangeCountdown--;
+        DALI_CTX->iChangeCountdown--;
     }
     else
     {
-        DALIP_iChangeCountdown = DALIP_iChangeEvery;
+        DALI_CTX->iChangeCountdown = DALI_CTX->iChangeEvery;
         zw = DALIP_GetArc();
-        if (DALIP_bIncrease)
+        if (DALI_CTX->bIncrease)
         {
-            if (zw < DALIP_iMaxLevel)
+            if (zw < DALI_CTX->iMaxLevel)
             {
                 zw++;
                 DALIP_SetArc(zw);
@@ -166,7 +185,7 @@ void DALIP_TimerCallback(void)
         }
         else
         {
-            if (zw > DALIP_iMinLevel)
+            if (zw > DALI_CTX->iMinLevel)
             {
                 zw--;
                 DALIP_SetArc(zw);
@@ -175,9 +194,9 @@ void DALIP_TimerCallback(void)
             {
                 DALIP_DoneTimer();
                 DALIP_SetFadeReadyFlag(0); /* fade is ready */
-                if (DALIP_bOff_AfterFade)
+                if (DALI_CTX->bOff_AfterFade)
                 {
-                  DALIP_bOff_AfterFade = 0;
+                  DALI_CTX->bOff_AfterFade = 0;
                   DALIR_WriteStatusBit(DALIREG_STATUS_POWER_FAILURE,0);
 	                DALIR_WriteStatusBit(DALIREG_STATUS_LAMP_ARC_POWER_ON,0);
 	                DALIP_Off();
@@ -185,8 +204,8 @@ void DALIP_TimerCallback(void)
                 }
             }
         }
-        LightControlCallback(DALIP_ConvertARC(zw));
-        if (zw == DALIP_FadeGoal)
+        DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
+        if (zw == DALI_CTX->FadeGoal)
         {
             DALIP_DoneTimer();
             DALIP_SetFadeReadyFlag(0); /* fade is ready */
@@ -296,24 +315,22 @@ u8 DALIP_GetPhysMinLevel(void)
  * EPROM Access Functions                 *
  *******************************************/
 
+/* user area: behind the signature and the register images of all units */
 u8 DALIP_EEPROM_Size(void)
 {
-    u16 zwms;
-    zwms = E2_PHYSICAL_SIZE;
-    zwms -= DALIREG_EEPROM_END-DALIREG_EEPROM_START+4;
-    return (u8) zwms;
+    return (u8)(DALI_E2_SIZE - 4 - DALI_E2_IMAGES_SIZE);
 }
 
 u8 DALIP_Read_E2(u8 addr)
 {
     if (addr >= DALIP_EEPROM_Size()) return 0;
-    return E2_ReadMem(addr+DALIREG_EEPROM_END-DALIREG_EEPROM_START);
+    return E2_ReadMem((TDALIE2Addr)(DALI_E2_IMAGES_SIZE + addr));
 }
 
 void DALIP_Write_E2(u8 addr, u8 data_val)
 {
     if (addr >= DALIP_EEPROM_Size()) return;
-    E2_WriteMem(addr+DALIREG_EEPROM_END-DALIREG_EEPROM_START,data_val);
+    E2_WriteMem((TDALIE2Addr)(DALI_E2_IMAGES_SIZE + addr),data_val);
 }
 
 void DALIP_Write_E2_Buffer(u8 addr, u8 number, u8*buf)
@@ -324,7 +341,7 @@ void DALIP_Write_E2_Buffer(u8 addr, u8 number, u8*buf)
     if (addr >= zw) return;
     zw -= addr;
     if (number > zw) return;
-    E2_WriteBurst(addr,number,buf);
+    E2_WriteBurst((TDALIE2Addr)(DALI_E2_IMAGES_SIZE + addr),number,buf);
 }
 
 
@@ -339,7 +356,12 @@ void DALIP_Reserved_Function(u8 cmd)
 
 void DALIP_Reserved_Special_Function(u8 cmd, u8 data_val)
 {
-
+  switch (cmd)
+  {
+    case DALIC_SELECT_BY_SERIAL:
+      DALIC_Select_By_Serial(data_val);
+      break;
+  }
 }
 
 /*********************************************************************
@@ -366,59 +388,78 @@ void DALIP_Direct_Arc(u8 val)
     u8 iActFT;
     u32 FadeTime;
 
+    if (DALI_CTX->bEnable_DAPC && val)
+    {
+        DALIP_DAPC_Track(val);
+        return;
+    }
     iActVal = DALIP_GetArc();
-    if (iActVal == val) return;
     iActFT = DALIP_GetFadeTime();
+    if (iActVal == val)
+    {
+#ifdef DALI_COLOUR
+        DALICol_Auto_Activate(DALIP_FadeTimeTable[iActFT]);
+        DALICol_Flush();
+#endif
+        return;
+    }
 
     DALIP_DoneTimer();
     if ((iActFT == 0)
 #if (DEVICE_TYPE == 6)          /* LED type device */
-        &&(DALIP_FastFade == 0)
+        &&(DALI_CTX->FastFade == 0)
 #endif
-        &&(!DALIP_bEnable_DAPC))
+        &&(!DALI_CTX->bEnable_DAPC))
     {
         DALIP_SetArc(val);
-        LightControlCallback(DALIP_ConvertARC(val));
+#ifdef DALI_COLOUR
+        DALICol_Auto_Activate(0);
+#endif
+        DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(val));
     }
     else
     {
-        if(DALIP_bEnable_DAPC)
-          FadeTime = 200;
+        if(DALI_CTX->bEnable_DAPC)
+          FadeTime = 200;       /* end of sequence: fade to off */
         else
         {
           FadeTime = DALIP_FadeTimeTable[iActFT];
 #if (DEVICE_TYPE == 6)          /* LED type device */
           if(FadeTime ==0) /* apply fast fade time */
-            FadeTime = DALIP_FastFade * 25;
+            FadeTime = DALI_CTX->FastFade * 25;
 #endif
         }
-        DALIP_bOff_AfterFade = 0;
+        DALI_CTX->bOff_AfterFade = 0;
         if (iActVal > val)
         {
-            DALIP_iMinLevel = DALIP_GetMinLevel();
-            DALIP_bIncrease = 0;
+            DALI_CTX->iMinLevel = DALIP_GetMinLevel();
+            DALI_CTX->bIncrease = 0;
             if(val)
             {
-              DALIP_iChangeEvery = (FadeTime/((long)(iActVal - val)))-1;
+              DALI_CTX->iChangeEvery = (FadeTime/((long)(iActVal - val)))-1;
             }
             else
             {
-              DALIP_iChangeEvery = (FadeTime/((long)(iActVal - DALIP_iMinLevel)))-1;
-              DALIP_bOff_AfterFade = 1;
+              DALI_CTX->iChangeEvery = (FadeTime/((long)(iActVal - DALI_CTX->iMinLevel)))-1;
+              DALI_CTX->bOff_AfterFade = 1;
             }
         }
         else
         {
-            DALIP_iMaxLevel = DALIP_GetMaxLevel();
-            DALIP_bIncrease = 1;
-            DALIP_iChangeEvery = (FadeTime/((long)(val - iActVal)))-1;
+            DALI_CTX->iMaxLevel = DALIP_GetMaxLevel();
+            DALI_CTX->bIncrease = 1;
+            DALI_CTX->iChangeEvery = (FadeTime/((long)(val - iActVal)))-1;
         }
-        if (DALIP_iChangeEvery == (u32)0xFFFFFFFF)
-          DALIP_iChangeEvery = 0;
-        DALIP_iChangeCountdown = DALIP_iChangeEvery;
+        if (DALI_CTX->iChangeEvery == (u32)0xFFFFFFFF)
+          DALI_CTX->iChangeEvery = 0;
+        DALI_CTX->iChangeCountdown = DALI_CTX->iChangeEvery;
         DALIP_SetFadeReadyFlag(1);                       /* Fade running from now */
-        DALIP_FadeGoal = val;
+        DALI_CTX->FadeGoal = val;
         DALIP_LaunchTimer(0xFF);
+#ifdef DALI_COLOUR
+        /* colour fade ends on the tick of the last arc step */
+        DALICol_Auto_Activate(DALIP_Fade_Ticks_Left());
+#endif
     }
 }
 
@@ -427,14 +468,14 @@ void DALIP_Direct_Arc_NoFade(u8 val)
     if (DALIP_GetArc() == val) return;
     DALIP_DoneTimer();
     DALIP_SetArc(val);
-    LightControlCallback(DALIP_ConvertARC(val));
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(val));
 }
 
 void DALIP_Off(void)
 {
     DALIP_DoneTimer();
     DALIP_SetArc(0);
-    LightControlCallback(0);
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS 0);
 }
 
 void DALIP_Up(void)
@@ -450,16 +491,16 @@ void DALIP_Up(void)
             zw = DALIP_GetArc();
             zw++;
             DALIP_SetArc(zw);
-            LightControlCallback(DALIP_ConvertARC(zw));
+            DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
         }
         else
         {
-            DALIP_iMaxLevel = DALIP_GetMaxLevel();
-            DALIP_bIncrease = 1;
-            DALIP_iChangeEvery = DALIP_FadeRateTable[zw]-1;
-            DALIP_iChangeCountdown = DALIP_iChangeEvery;
+            DALI_CTX->iMaxLevel = DALIP_GetMaxLevel();
+            DALI_CTX->bIncrease = 1;
+            DALI_CTX->iChangeEvery = DALIP_FadeRateTable[zw]-1;
+            DALI_CTX->iChangeCountdown = DALI_CTX->iChangeEvery;
             DALIP_SetFadeReadyFlag(1);      /* Fade running from now */
-            DALIP_FadeGoal = 255;
+            DALI_CTX->FadeGoal = 255;
             DALIP_LaunchTimer(200);
         }
     }
@@ -482,16 +523,16 @@ void DALIP_Down(void)
             zw = DALIP_GetArc();
             zw--;
             DALIP_SetArc(zw);
-            LightControlCallback(DALIP_ConvertARC(zw));
+            DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
         }
         else
         {
-            DALIP_bIncrease = 0;
-            DALIP_iMinLevel = DALIP_GetMinLevel();
-            DALIP_iChangeEvery = DALIP_FadeRateTable[zw]-1;
-            DALIP_iChangeCountdown = DALIP_iChangeEvery;
+            DALI_CTX->bIncrease = 0;
+            DALI_CTX->iMinLevel = DALIP_GetMinLevel();
+            DALI_CTX->iChangeEvery = DALIP_FadeRateTable[zw]-1;
+            DALI_CTX->iChangeCountdown = DALI_CTX->iChangeEvery;
             DALIP_SetFadeReadyFlag(1);      /* Fade running from now */
-            DALIP_FadeGoal = 255;
+            DALI_CTX->FadeGoal = 255;
             DALIP_LaunchTimer(200);
         }
     }
@@ -503,20 +544,120 @@ void DALIP_Down(void)
 
 void DALIP_Enable_DAPC_Sequence(void)
 {
-  DALIP_bEnable_DAPC = 1;
+  DALI_CTX->bEnable_DAPC = 1;
+  DALI_CTX->DAPCRate = 0;
   RTC_LaunchDAPCTimer();
 }
 
 void DALIP_Stop_DAPC_Sequence(void)
 {
   RTC_DoneDAPCTimer();
-  DALIP_bEnable_DAPC = 0;
+  DALI_CTX->bEnable_DAPC = 0;
 }
 
 void DALIP_Try_DAPC_Sequence(void)
 {
-  if(DALIP_bEnable_DAPC)
+  if(DALI_CTX->bEnable_DAPC)
+  {
+    /* the sequence timer runs 200ms from the previous command */
+    DALI_CTX->DAPCInterval = (u8)(200 - DALI_CTX->DAPCTimerActive);
     RTC_LaunchDAPCTimer();
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIP_DAPC_Track
+INPUT/OUTPUT : new arc power level of the DAPC sequence (not 0)
+DESCRIPTION  : Retargets the output trajectory of a DAPC sequence
+COMMENTS     : The command interval is averaged over the sequence and the
+               slope is set so that the output reaches the level when the
+               next command is expected: a slider stream gives a continuous
+               ramp instead of a staircase. The trajectory stops at the
+               level (no overshoot), so when the sequence ends the output
+               converges to the last level received.
+-----------------------------------------------------------------------------*/
+static void DALIP_DAPC_Track(u8 val)
+{
+    u8 tracking;
+    u8 interval;
+    u16 goal;
+    s32 diff;
+
+    tracking = DALI_CTX->bDAPCTrack;
+    DALIP_DoneTimer();
+    if (!tracking)
+        DALI_CTX->DAPCPos = (u16)DALIP_GetArc() << 8;
+
+    interval = DALI_CTX->DAPCInterval;
+    if (interval == 0)
+        interval = 1;
+    if (interval > 200)
+        interval = 200;
+    if (DALI_CTX->DAPCRate)
+        DALI_CTX->DAPCRate = (u8)(((u16)DALI_CTX->DAPCRate + interval + 1) >> 1);
+    else
+        DALI_CTX->DAPCRate = interval;
+
+    goal = (u16)val << 8;
+    if (goal == DALI_CTX->DAPCPos)
+    {
+        DALIP_SetArc(val);
+        DALIP_SetFadeReadyFlag(0);
+        return;
+    }
+    diff = (s32)goal - (s32)DALI_CTX->DAPCPos;
+    DALI_CTX->DAPCStep = (s16)(diff / DALI_CTX->DAPCRate);
+    if (DALI_CTX->DAPCStep == 0)
+        DALI_CTX->DAPCStep = (diff > 0) ? 1 : -1;
+    DALI_CTX->FadeGoal = val;
+    DALI_CTX->bOff_AfterFade = 0;
+    DALIP_SetFadeReadyFlag(1);                       /* Fade running from now */
+    DALIP_LaunchTimer(0xFF);
+    DALI_CTX->bDAPCTrack = 1;
+#ifdef DALI_COLOUR
+    DALICol_Auto_Activate(DALIP_Fade_Ticks_Left());
+#endif
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIP_DAPC_Tick
+INPUT/OUTPUT : None
+DESCRIPTION  : One ms step of the DAPC trajectory
+COMMENTS     : Light value is interpolated between the curve values of the
+               two neighbour arc levels, the output moves at each tick (PWM
+               update granularity) instead of each arc level step
+-----------------------------------------------------------------------------*/
+static void DALIP_DAPC_Tick(void)
+{
+    u16 goal;
+    u16 pos;
+    u16 lo;
+    u16 hi;
+    u8 level;
+
+    goal = (u16)DALI_CTX->FadeGoal << 8;
+    pos = (u16)(DALI_CTX->DAPCPos + DALI_CTX->DAPCStep);
+    if (((DALI_CTX->DAPCStep > 0) && ((pos >= goal) || (pos < DALI_CTX->DAPCPos)))
+        || ((DALI_CTX->DAPCStep < 0) && ((pos <= goal) || (pos > DALI_CTX->DAPCPos))))
+        pos = goal;
+    DALI_CTX->DAPCPos = pos;
+
+    level = (u8)(pos >> 8);
+    if (level != DALIP_GetArc())
+        DALIP_SetArc(level);
+    lo = DALIP_ConvertARC(level);
+    if ((u8)pos)
+    {
+        hi = DALIP_ConvertARC(level + 1);
+        lo += (u16)(((u32)(hi - lo) * (u8)pos) >> 8);
+    }
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS lo);
+
+    if (pos == goal)
+    {
+        DALIP_DoneTimer();
+        DALIP_SetFadeReadyFlag(0); /* fade is ready */
+    }
 }
 
 void DALIP_Step_Up(void)
@@ -530,7 +671,7 @@ void DALIP_Step_Up(void)
     else
       zw = DALIR_ReadReg(DALIREG_MIN_LEVEL);
     DALIP_SetArc(zw);
-    LightControlCallback(DALIP_ConvertARC(zw));
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
 }
 
 void DALIP_Step_Down(void)
@@ -541,7 +682,7 @@ void DALIP_Step_Down(void)
     zw = DALIP_GetArc();
     zw--;
     DALIP_SetArc(zw);
-    LightControlCallback(DALIP_ConvertARC(zw));
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
 }
 
 void DALIP_Recall_Max_Level(void)
@@ -551,7 +692,7 @@ void DALIP_Recall_Max_Level(void)
     DALIP_DoneTimer();
     zw = DALIR_ReadReg(DALIREG_MAX_LEVEL);
     DALIP_SetArc(zw);
-    LightControlCallback(DALIP_ConvertARC(zw));
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
 }
 
 void DALIP_Recall_Min_Level(void)
@@ -561,7 +702,7 @@ void DALIP_Recall_Min_Level(void)
     DALIP_DoneTimer();
     zw = DALIR_ReadReg(DALIREG_MIN_LEVEL);
     DALIP_SetArc(zw);
-    LightControlCallback(DALIP_ConvertARC(zw));
+    DALI_CTX->LightControlCallback(DALI_UNIT_ARGS DALIP_ConvertARC(zw));
 }
 
 void DALIP_Step_Down_And_Off(void)
@@ -588,7 +729,57 @@ u8 DALIP_Is_Physically_Selected(void)
 /* return the device type (see spec.) */
 u8 DALIP_What_Device_Type(void)
 {
+#if (DALIP_EXT_CNT > 1)
+    return 255;                      // more than one device type
+#else
     return DEVICE_TYPE;              // globally defined
+#endif
+}
+
+/* selects the extended command set of the device type, 0 = not supported */
+u8 DALIP_Select_Device_Type(u8 device_type)
+{
+    u8 i;
+
+    for (i = 0; i < DALIP_EXT_CNT; i++)
+    {
+        if (DALIP_Extensions[i].device_type == device_type)
+        {
+            DALI_CTX->ext_selected = i;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ms ticks to the last step of the running fade (0 = no fade running) */
+u32 DALIP_Fade_Ticks_Left(void)
+{
+    u8 arc;
+    u8 goal;
+    u8 steps;
+    u16 pos;
+    u16 step;
+
+    if ((!DALI_CTX->UserTimerActive) || (!DALIR_ReadStatusBit(DALIREG_STATUS_FADE_READY)))
+        return 0;
+    if (DALI_CTX->bDAPCTrack)
+    {
+        pos = (u16)DALI_CTX->FadeGoal << 8;
+        pos = (pos > DALI_CTX->DAPCPos) ? (u16)(pos - DALI_CTX->DAPCPos) : (u16)(DALI_CTX->DAPCPos - pos);
+        step = (DALI_CTX->DAPCStep < 0) ? (u16)(-DALI_CTX->DAPCStep) : (u16)DALI_CTX->DAPCStep;
+        return ((u32)pos + step - 1) / step;
+    }
+    if (DALI_CTX->FadeGoal == 255)   /* up / down: runs until the timer expires */
+        return DALI_CTX->UserTimerActive;
+    arc = DALIP_GetArc();
+    goal = DALI_CTX->bOff_AfterFade ? DALI_CTX->iMinLevel : DALI_CTX->FadeGoal;
+    steps = (arc > goal) ? (u8)(arc - goal) : (u8)(goal - arc);
+    if (DALI_CTX->bOff_AfterFade)
+        steps++;                     /* off one step period after min level */
+    if (!steps)
+        return 0;
+    return DALI_CTX->iChangeCountdown + 1 + (u32)(steps - 1) * (DALI_CTX->iChangeEvery + 1);
 }
 
 #if (DEVICE_TYPE == 6)          /* LED type device */
@@ -651,37 +842,32 @@ u8 DALIP_Extended_Command(u8 command)
     case 240: /* Query Features */
       return 0;
     case 227: /* Select dimming curve */
-      if (dtr == 1)
-      {
-        DALIP_CurveType = 1;
-        /* select linear curve */
-      }
-      else if(dtr == 0)
+      if (DALI_CTX->dtr < DALIP_CURVES_CNT)
       {
-        DALIP_CurveType = 0;
-        /* select logaritmic curve */
+        DALI_CTX->CurveType = DALI_CTX->dtr;
+        /* 0 = logarithmic, 1 = linear, others see dali_curves.h */
       }
       return 0;
     case 228: /* Store DTR as fast fade time */
-      if (dtr > 27)
+      if (DALI_CTX->dtr > 27)
       {
-        DALIP_FastFade = 27;
+        DALI_CTX->FastFade = 27;
         return 0;
       }
-      DALIP_FastFade = dtr;
+      DALI_CTX->FastFade = DALI_CTX->dtr;
       return 0;
     case 237: /* Query gear type */
       return 9; /* 0x09 = LED supply integrated, DC supply possible */
     case 238: /* Query dimming curve */
-      return DALIP_CurveType;
+      return DALI_CTX->CurveType;
     case 239: /* Query possible operation modes */
       return 1; /* 0x01 = PWM regulation is possible */
     case 241: /* Query failure status */
       return 0; /* 0 = no error */
     case 252: /* Query operation mode */
-      return (1 + (DALIP_CurveType << 4)); /* 1 = PWM operation, and lin/log curve */
+      return (1 + (DALI_CTX->CurveType ? 0x10 : 0)); /* 1 = PWM operation, and non-log curve */
     case 253: /* Query fast fade time */
-      return DALIP_FastFade;
+      return DALI_CTX->FastFade;
     case 254: /* Query min fast fade time */
       return 1;
   }
@@ -0,0 +1,110 @@
+/**
+  ******************************************************************************
+  * @file    dali_rand.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Entropy pool and random generator for DALI random address
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "stm8s.h"
+#include "dali_rand.h"
+#include "dali_config.h"
+#include "dali_mem.h"
+
+/* file global variable */
+u32 RandomPool;   /* xorshift32 state, never zero */
+
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIRnd_Step
+INPUT/OUTPUT : None
+DESCRIPTION  : One xorshift32 step (13, 17, 5) on the pool
+COMMENTS     : Period 2^32-1, zero state is not allowed
+-----------------------------------------------------------------------------*/
+static void DALIRnd_Step(void)
+{
+  if (RandomPool == 0)
+    RandomPool = 0x2545F491UL;
+  RandomPool ^= RandomPool << 13;
+  RandomPool ^= RandomPool >> 17;
+  RandomPool ^= RandomPool << 5;
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIRnd_Mix
+INPUT/OUTPUT : entropy byte
+DESCRIPTION  : Stirs one byte into the pool
+COMMENTS     :
+-----------------------------------------------------------------------------*/
+void DALIRnd_Mix(u8 entropy)
+{
+  RandomPool ^= entropy;
+  DALIRnd_Step();
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIRnd_Next
+INPUT/OUTPUT : returns random byte
+DESCRIPTION  : Mixes in the TIM4 phase at the call and returns next random byte
+COMMENTS     : Upper byte of the state has the best statistical properties
+-----------------------------------------------------------------------------*/
+u8 DALIRnd_Next(void)
+{
+  DALIRnd_Mix(TIM4->CNTR);
+  return (u8)(RandomPool >> 24);
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : DALIRnd_Init
+INPUT/OUTPUT : None
+DESCRIPTION  : Seeds the pool from unique ID, bank 0 identity and ADC noise
+COMMENTS     : Unique ID (if the part has one) and GTIN + serial number
+               separate devices powered up together, LSB of ADC conversions
+               separates power-ups of one device and devices with the same
+               identity (serial number not burnt in)
+-----------------------------------------------------------------------------*/
+void DALIRnd_Init(void)
+{
+  u8 i;
+  u8 noise;
+
+#ifdef DALIRND_UID_ADDRESS
+  /* device unique ID */
+  for (i = 0; i < DALIRND_UID_SIZE; i++)
+    DALIRnd_Mix(*((NEAR u8*)(DALIRND_UID_ADDRESS + i)));
+#endif /* DALIRND_UID_ADDRESS */
+
+  /* identification number of memory bank 0 */
+  for (i = DALIRND_ID_FIRST; i <= DALIRND_ID_LAST; i++)
+    DALIRnd_Mix(DALIM_E2[i]);
+
+#if defined(STM8S105) || defined(STM8S103) || defined(STM8S903) || defined (STM8AF626x)
+  /* ADC noise: one LSB from each conversion, fADC = fMASTER / 4 (4MHz at
+     16MHz, inside the 6MHz limit of the converter) */
+  ADC1_Init(ADC1_CONVERSIONMODE_SINGLE, DALI_RANDOM_ADC_CHANNEL, ADC1_PRESSEL_FCPU_D4,
+            ADC1_EXTTRIG_TIM, DISABLE, ADC1_ALIGN_RIGHT, DALI_RANDOM_ADC_SCHMITT, DISABLE);
+  noise = 0;
+  for (i = 0; i < DALIRND_ADC_SAMPLES; i++)
+  {
+    ADC1_StartConversion();
+    while (ADC1_GetFlagStatus(ADC1_FLAG_EOC) == RESET);
+    noise = (u8)((noise << 1) | (ADC1_GetConversionValue() & 0x01));
+    ADC1_ClearFlag(ADC1_FLAG_EOC);
+    if ((i & 0x07) == 0x07)
+      DALIRnd_Mix(noise);
+  }
+  ADC1_DeInit(); /* ADC off, channel back to digital */
+#endif /* ADC1 devices */
+}
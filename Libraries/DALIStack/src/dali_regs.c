@@ -24,9 +24,8 @@
 #include "dali_regs.h"
 #include "eeprom.h"
 #include "dali_config.h"
+#include "dali_ctx.h"
 
-uint8_t RAMRegs[DALIREG_RAM_END - DALIREG_RAM_START];
-uint8_t short_addr;
 uint8_t randbuf[2];
 
 extern const uint8_t ROMRegs[2]; /* Declared in DALI_PUB.C */
@@ -37,34 +36,37 @@ extern const uint8_t DaliRegDefaults[];
 #define DALIR_IsROMReg(a)  ((a>=DALIREG_ROM_START) && (a<DALIREG_ROM_END))
 #define DALIR_IsValid(a) (a < DALI_NUMBER_REGS)
 
-#if (DEVICE_TYPE == 6)          /* LED type device */
-extern u8 DALIP_FastFade;
-extern u8 DALIP_CurveType;
-#endif
-
 void DALIR_Init(void)
 {
   uint8_t i;
-  for (i = 0; i<5; i++) RAMRegs[i]=0;
+  for (i = 0; i<5; i++) DALI_CTX->RAMRegs[i]=0;
 }
 
 void DALIR_WriteEEPROMReg(uint8_t idx, uint8_t val)
 {
 
-  if (idx == DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START) short_addr = val;
-  E2_WriteMem(idx,val);
+  if (idx == DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START) DALI_CTX->short_addr = val;
+  E2_WriteMem(DALI_E2_BASE + idx,val);
 }
 
 uint8_t DALIR_ReadEEPROMReg(uint8_t idx)
 {
-  if (idx == DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START) return short_addr;
-  return E2_ReadMem(idx);
+  if (idx == DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START) return DALI_CTX->short_addr;
+  if (!E2_IsValid(DALI_E2_BASE + idx)) return DALIR_DefaultEEPROMReg(idx); /* image not rewritten yet */
+  return E2_ReadMem(DALI_E2_BASE + idx);
+}
+
+/* Reset value of an EEPROM register (index from DALIREG_EEPROM_START) */
+uint8_t DALIR_DefaultEEPROMReg(uint8_t idx)
+{
+  if (idx == DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START) return 0xFF;
+  return DaliRegDefaults[DALIREG_EEPROM_START + idx];
 }
 
 uint8_t DALIR_ReadReg(uint8_t idx)
 {
   if (!DALIR_IsValid(idx)) return 0;
-  if (DALIR_IsRAMReg(idx)) { return RAMRegs[idx - DALIREG_RAM_START];}
+  if (DALIR_IsRAMReg(idx)) { return DALI_CTX->RAMRegs[idx - DALIREG_RAM_START];}
   if (DALIR_IsROMReg(idx)) { return ROMRegs[idx - DALIREG_ROM_START];}
   return DALIR_ReadEEPROMReg(idx - DALIREG_EEPROM_START);
 }
@@ -76,7 +78,7 @@ void DALIR_WriteReg(uint8_t idx, uint8_t newval)
     if (DALIR_IsROMReg(idx)) return;
     if (DALIR_IsRAMReg(idx))
     {
-        RAMRegs[idx - DALIREG_RAM_START] = newval;
+        DALI_CTX->RAMRegs[idx - DALIREG_RAM_START] = newval;
     }
     else
     {
@@ -114,25 +116,25 @@ void DALIR_WriteStatusBit(uint8_t bit_nbr,uint8_t val)
 {
     if (val == 0)
     {
-        ClrBit(RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
+        ClrBit(DALI_CTX->RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
     }
     else
     {
-        SetBit(RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
+        SetBit(DALI_CTX->RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
     }
 }
 
 uint8_t DALIR_ReadStatusBit(uint8_t bit_nbr)
 {
-    return ValBit(RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
+    return ValBit(DALI_CTX->RAMRegs[DALIREG_STATUS_INFORMATION - DALIREG_RAM_START],bit_nbr);
 }
 
 void DALIR_ResetRegs(void)
 {
     uint8_t i;
 
-    E2_WriteBurst(0,(u8)(DALIREG_EEPROM_END-DALIREG_EEPROM_START),(u8*)(&(DaliRegDefaults[DALIREG_EEPROM_START])));
-    E2_WriteMem(DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START,short_addr);
+    E2_WriteBurst(DALI_E2_BASE,(u8)(DALIREG_EEPROM_END-DALIREG_EEPROM_START),(u8*)(&(DaliRegDefaults[DALIREG_EEPROM_START])));
+    E2_WriteMem(DALI_E2_BASE + DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START,DALI_CTX->short_addr);
     for (i=0; i<DALI_NUMBER_REGS; i++)
     {
         switch (i)
@@ -157,20 +159,49 @@ void DALIR_ResetRegs(void)
     DALIR_WriteReg(DALIREG_STATUS_INFORMATION, i);
     DALIR_WriteStatusBit(DALIREG_STATUS_RESET_STATE,1); /*Set reset State*/
   #if (DEVICE_TYPE == 6)          /* LED type device */
-    DALIP_FastFade = 0;
-    DALIP_CurveType = 0;
+    DALI_CTX->FastFade = 0;
+    DALI_CTX->CurveType = 0;
   #endif
 }
 
 void DALIR_LoadRegsFromE2(void)
 {
-    short_addr = E2_ReadMem(DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START);
+    if (E2_Repairing)
+        DALI_CTX->short_addr = 0xFF;
+    else
+        DALI_CTX->short_addr = E2_ReadMem(DALI_E2_BASE + DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START);
+}
+
+/* Range check of the register image (called at idle time after boot): values
+   no command can store, left by a reset during programming, get their reset
+   value */
+void DALIR_CheckRegs(void)
+{
+    uint8_t min;
+    uint8_t max;
+    uint8_t zw;
+
+    min = DALIR_ReadReg(DALIREG_MIN_LEVEL);
+    max = DALIR_ReadReg(DALIREG_MAX_LEVEL);
+    if ((min < DALIR_ReadReg(DALIREG_PHYS_MIN_LEVEL)) || (max > 254) || (min > max))
+    {
+        DALIR_WriteEEPROMReg(DALIREG_MIN_LEVEL - DALIREG_EEPROM_START, DALIR_ReadReg(DALIREG_PHYS_MIN_LEVEL));
+        DALIR_WriteEEPROMReg(DALIREG_MAX_LEVEL - DALIREG_EEPROM_START, DaliRegDefaults[DALIREG_MAX_LEVEL]);
+    }
+    zw = DALIR_ReadReg(DALIREG_FADE_RATE);
+    if ((zw == 0) || (zw > 15))
+        DALIR_WriteEEPROMReg(DALIREG_FADE_RATE - DALIREG_EEPROM_START, DaliRegDefaults[DALIREG_FADE_RATE]);
+    if (DALIR_ReadReg(DALIREG_FADE_TIME) > 15)
+        DALIR_WriteEEPROMReg(DALIREG_FADE_TIME - DALIREG_EEPROM_START, DaliRegDefaults[DALIREG_FADE_TIME]);
+    zw = DALI_CTX->short_addr;
+    if ((zw != 0xFF) && (zw & 0x80))
+        DALIR_DeleteShort();
 }
 
 void DALIR_DeleteShort(void)
 {
-    short_addr = 0xFF;
-    E2_WriteMem(DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START,0xFF);
+    DALI_CTX->short_addr = 0xFF;
+    E2_WriteMem(DALI_E2_BASE + DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START,0xFF);
     DALIR_WriteStatusBit(DALIREG_STATUS_MISSING_SHORT,1);
 }
 
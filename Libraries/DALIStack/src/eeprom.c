@@ -21,82 +21,175 @@
 #include "stm8s.h"
 #include "eeprom.h"
 #include "dali_regs.h"
+#include "dali_diag.h"
+#include "dali_ctx.h"
 
 #ifdef _COSMIC_
 #include <iostm8s.h>
 #endif
 
 #ifdef _IAR_
-__no_init EEPROM u8 eeprom_variable[125];
+__no_init EEPROM u8 eeprom_variable[DALI_E2_SIZE];
 #else
-EEPROM u8 eeprom_variable[125];
+EEPROM u8 eeprom_variable[DALI_E2_SIZE];
+#endif
+
+#if (4 + DALI_E2_IMAGES_SIZE) > DALI_E2_SIZE
+ #error "eeprom_variable too small for register images of DALI_INSTANCES units"
 #endif
 
 
 #define EEP_Wait_Finished() //while (!(FLASH->IAPSR & FLASH_IAPSR_HVOFF))
 
-void E2_ResetEEPROM(void);
+//"TG8" + layout (units count - 1): allows to check later that the EEPROM content is valid
+static CONST u8 E2_Signature[4] = { 'T', 'G', 8, DALI_INSTANCES - 1 };
+
+// Boot does not program the EEPROM: an invalid content is repaired by
+// EEPROM_Process() at idle time, one byte per call, register images first,
+// signature last (a reset during the repair starts it again and loses the
+// register writes done meanwhile). Image bytes not repaired yet read as
+// their reset values; a register write during the repair programs its byte
+// at once and marks it, the repair skips it.
+u8 E2_Repairing;          // !=0 until images and signature are rewritten
+static TDALIE2Addr E2_RepairPos; // next byte: images, then signature
+static u8 E2_Written[(DALI_E2_IMAGES_SIZE + 7) / 8]; // image bytes written during the repair
+static u8 E2_CheckUnit;   // next unit whose register image is range checked
+
 void E2_WriteSR(u8);
 u8 E2_DetectMemSize(void);
 u8 E2_ReadSR(void);
+static void E2_RepairStep(void);
+static void E2_RepairMark(TDALIE2Addr addr);
 
 
 void EEPROM_Init(void)
 {
+  u8 unit;
+  TDALIE2Addr i;
+
   //unlock EEPROM
   FLASH->DUKR = 0xAE;
   FLASH->DUKR = 0x56;
   EEP_Wait_Finished();
-  if ((eeprom_variable[0]=='T') && (eeprom_variable[1]=='G') && (eeprom_variable[2]==8) && (eeprom_variable[3]==0x00))
-  { //test on EEPROM content validity see E2_ResetEEPROM()
-    DALIR_LoadRegsFromE2();  // short_addr = E2_ReadMem(DALIREG_SHORT_ADDRESS - DALIREG_EEPROM_START);
+  //test on EEPROM content validity, nothing is written here (see EEPROM_Process)
+  E2_Repairing = (eeprom_variable[0]!=E2_Signature[0]) || (eeprom_variable[1]!=E2_Signature[1])
+              || (eeprom_variable[2]!=E2_Signature[2]) || (eeprom_variable[3]!=E2_Signature[3]);
+  E2_RepairPos = 0;
+  for (i = 0; i < sizeof(E2_Written); i++)
+    E2_Written[i] = 0;
+  // images just repaired hold reset values, no range check needed
+  E2_CheckUnit = E2_Repairing ? DALI_INSTANCES : 0;
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+  { //register image of each unit
+    DALI_SELECT(unit);
+    DALIR_LoadRegsFromE2();  // short_addr, 0xFF while repairing
+  }
+}
+
+/*-----------------------------------------------------------------------------
+ROUTINE NAME : EEPROM_Process
+INPUT/OUTPUT : returns !=0 while the repair or the range check is pending
+DESCRIPTION  : Background EEPROM repair and register range check, one step per call
+COMMENTS     : Never waits for programming: returns at once while EEPROM is busy
+-----------------------------------------------------------------------------*/
+u8 EEPROM_Process(void)
+{
+  if (!E2_Repairing && (E2_CheckUnit >= DALI_INSTANCES))
+    return 0;
+  if (!(FLASH->IAPSR & FLASH_IAPSR_HVOFF)) // EEPROM programming in progress
+    return 1;
+  if (E2_Repairing)
+  {
+    E2_RepairStep();
   }
   else
   {
-    DALIR_DeleteShort();
-    DALIR_ResetRegs();
-    E2_ResetEEPROM();
+    DALI_SELECT(E2_CheckUnit);
+    DALIR_CheckRegs();
+    E2_CheckUnit++;
   }
-  EEP_Wait_Finished();
+  return 1;
 }
 
-void E2_ResetEEPROM(void)
+// Programs the next byte of the repair
+static void E2_RepairStep(void)
 {
-  EEP_Wait_Finished();
-  eeprom_variable[0] = 'T';   //"TG80" is written  in the EEPROM
-  EEP_Wait_Finished();
-  eeprom_variable[1] = 'G';   //This allows to check later that the EEPROM content is valid.
-  EEP_Wait_Finished();
-  eeprom_variable[2] = 8;
-  EEP_Wait_Finished();
-  eeprom_variable[3] = 0x00;
-  EEP_Wait_Finished();
+  TDALIE2Addr addr;
+  u8 val;
+
+  if (E2_RepairPos < DALI_E2_IMAGES_SIZE)
+  {
+    if (E2_Written[E2_RepairPos >> 3] & (1 << (E2_RepairPos & 0x07)))
+    { // written by a register write meanwhile
+      E2_RepairPos++;
+      return;
+    }
+    addr = (TDALIE2Addr)(E2_RepairPos + 4);
+    val = DALIR_DefaultEEPROMReg((u8)(E2_RepairPos % DALI_E2_REGS_SIZE));
+  }
+  else
+  {
+    addr = (TDALIE2Addr)(E2_RepairPos - DALI_E2_IMAGES_SIZE);
+    val = E2_Signature[addr];
+  }
+  if (eeprom_variable[addr] != val)
+  {
+    eeprom_variable[addr] = val;
+    DALID_Counters.e2_writes++;
+  }
+  if (++E2_RepairPos >= DALI_E2_IMAGES_SIZE + 4)
+    E2_Repairing = 0;
 }
 
-void E2_WriteMem(u8 addr, u8 val)
+// Returns 0 for an image byte (E2_WriteMem address) the repair has still to
+// program: it holds no valid value yet
+u8 E2_IsValid(TDALIE2Addr addr)
 {
+  if (!E2_Repairing || (addr >= DALI_E2_IMAGES_SIZE) || (addr < E2_RepairPos))
+    return 1;
+  return (u8)(E2_Written[addr >> 3] & (1 << (addr & 0x07)));
+}
+
+// Keeps the repair off an image byte written by a register write
+static void E2_RepairMark(TDALIE2Addr addr)
+{
+  if (E2_Repairing && (addr < DALI_E2_IMAGES_SIZE))
+    E2_Written[addr >> 3] |= (u8)(1 << (addr & 0x07));
+}
+
+void E2_WriteMem(TDALIE2Addr addr, u8 val)
+{
+  E2_RepairMark(addr);
   EEP_Wait_Finished();
   if (eeprom_variable[addr+4] !=val)
+  {
     eeprom_variable[addr+4] = val;
+    DALID_Counters.e2_writes++;
+  }
   EEP_Wait_Finished();
 }
 
-void E2_WriteBurst(u8 addr, u8 times, u8 *buf)
+void E2_WriteBurst(TDALIE2Addr addr, u8 times, u8 *buf)
 {
-  u8 address,i;
+  TDALIE2Addr address;
+  u8 i;
   EEP_Wait_Finished();
   address = addr + 4;
   i = 0;
   while (times--)
   {
+    E2_RepairMark((TDALIE2Addr)(addr + i));
     if (eeprom_variable[address+i] != buf[i])
+    {
       eeprom_variable[address+i] = buf[i];
+      DALID_Counters.e2_writes++;
+    }
     i++;
     EEP_Wait_Finished();
   }
 }
 
-u8 E2_ReadMem(u8 addr)
+u8 E2_ReadMem(TDALIE2Addr addr)
 {
   EEP_Wait_Finished();
   return eeprom_variable[addr+4];
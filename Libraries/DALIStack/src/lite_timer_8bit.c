@@ -22,121 +22,148 @@
 #include "lite_timer_8bit.h"
 #include "dali_pub.h"
 #include "dali_cmd.h"
+#include "dali_diag.h"
+#include "dali_ctx.h"
 
 /* file global variable */
 volatile u8 lite_timer_IT_state;
 
 u16 timercounter;
-u8  bigtimermins;
-u16 bigtimertics;
-u8  RealTimeClock_BigTimer;
-u16 RealTimeClock_TimerCountDown;
-u8  UserTimerActive;
-u8  DAPCTimerActive;
-u16 PowerOnTimerActive;
 u16 BusFailureTimer;
 
 
 /* Configure the Timer Lite */
 void Timer_Lite_Init(void)
 {
-  PowerOnTimerActive = 600; //600 ms timeout after power up
-  UserTimerActive = 0;
-  DAPCTimerActive = 0;
+  DALI_CTX->PowerOnTimerActive = 600; //600 ms timeout after power up
+  DALI_CTX->UserTimerActive = 0;
+  DALI_CTX->DAPCTimerActive = 0;
 }
 
 void PowerOnTimerReset(void)
 {
-  PowerOnTimerActive = 0;
+  DALI_CTX->PowerOnTimerActive = 0;
 }
 
 void RTC_LaunchBigTimer(u8 mins)
 {
-  bigtimertics = 60000; /* 60000*1ms=1mn*/
-  bigtimermins = mins-1; /* Timer is launched for (mins-1)*1mn (basically 15mn, see DALI specifications)*/
-  RealTimeClock_BigTimer = 1;
+  DALI_CTX->bigtimertics = 60000; /* 60000*1ms=1mn*/
+  DALI_CTX->bigtimermins = mins-1; /* Timer is launched for (mins-1)*1mn (basically 15mn, see DALI specifications)*/
+  DALI_CTX->RealTimeClock_BigTimer = 1;
 }
 
 void RTC_LaunchTimer(u16 timer_value)
 {
-  RealTimeClock_TimerCountDown=timer_value;
+  DALI_CTX->RealTimeClock_TimerCountDown=timer_value;
 }
 
 void RTC_LaunchUserTimer(u8 TimerCount)
 {
-  UserTimerActive=TimerCount;
+  DALI_CTX->UserTimerActive=TimerCount;
 }
 
 void RTC_DoneUserTimer(void)
 {
-  UserTimerActive=0;
+  DALI_CTX->UserTimerActive=0;
 }
 
 void RTC_LaunchDAPCTimer(void)
 {
-  DAPCTimerActive=200;
+  DALI_CTX->DAPCTimerActive=200;
 }
 
 void RTC_DoneDAPCTimer(void)
 {
-  DAPCTimerActive=0;
+  DALI_CTX->DAPCTimerActive=0;
 }
 
 u8 Process_Lite_timer_IT(void)
 {
-  if (UserTimerActive)
-  {
-    if (UserTimerActive!=0xFF) UserTimerActive--;
-    DALIP_TimerCallback();
-    if (UserTimerActive==0)
-      DALIP_SetFadeReadyFlag(0); /* fade is ready */
-  }
-  if (PowerOnTimerActive)
+  u8 unit;
+  u8 active = 0;
+
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
   {
-    PowerOnTimerActive--;
-    if (!PowerOnTimerActive)
+    DALI_SELECT(unit);
+#ifdef DALI_COLOUR
+    /* colour shares first: an arc step of this tick outputs them too */
+    if (DALI_CTX->Colour.FadeTicks)
+      DALICol_TimerCallback();
+#endif
+    if (DALI_CTX->UserTimerActive)
     {
-      DALIC_PowerOn();
+      if (DALI_CTX->UserTimerActive!=0xFF) DALI_CTX->UserTimerActive--;
+      DALIP_TimerCallback();
+      if (DALI_CTX->UserTimerActive==0)
+        DALIP_SetFadeReadyFlag(0); /* fade is ready */
+    }
+    if (DALI_CTX->PowerOnTimerActive)
+    {
+      DALI_CTX->PowerOnTimerActive--;
+      if (!DALI_CTX->PowerOnTimerActive)
+      {
+        DALIC_PowerOn();
+      }
     }
-  }
 
-  if (DAPCTimerActive)
-  {
-    DAPCTimerActive--;
-    if (!DAPCTimerActive)
+    if (DALI_CTX->DAPCTimerActive)
     {
-      DALIP_Stop_DAPC_Sequence();
+      DALI_CTX->DAPCTimerActive--;
+      if (!DALI_CTX->DAPCTimerActive)
+      {
+        DALIP_Stop_DAPC_Sequence();
+      }
     }
+#ifdef DALI_COLOUR
+    DALICol_Flush();
+    if (DALI_CTX->Colour.FadeTicks)
+      active = 1;
+#endif
+    if (DALI_CTX->UserTimerActive || DALI_CTX->PowerOnTimerActive || DALI_CTX->DAPCTimerActive)
+      active = 1;
   }
 
   lite_timer_IT_state=0;
-  return (UserTimerActive + PowerOnTimerActive + DAPCTimerActive);
+  return active;
 }
 
 
 /*  for calling every 1ms - callback function */
 void Lite_timer_Interrupt(void)
 {
-    if (bigtimertics)
+  u8 unit;
+  TDALIContext *ctx;
+
+  /* all units, DALI_CTX may be just changed by the main loop */
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+  {
+    ctx = &DALI_Contexts[unit];
+    if (ctx->bigtimertics)
     {
-      bigtimertics--;
+      ctx->bigtimertics--;
     }
     else
     {
-      if (bigtimermins)
+      if (ctx->bigtimermins)
       {
-        bigtimermins--;
-        bigtimertics = 60000;  /* 60000*1ms=1mn*/
+        ctx->bigtimermins--;
+        ctx->bigtimertics = 60000;  /* 60000*1ms=1mn*/
       }
       else
       {
-        RealTimeClock_BigTimer = 0;
+        ctx->RealTimeClock_BigTimer = 0;
       }
     }
-    if (RealTimeClock_TimerCountDown)
+    if (ctx->RealTimeClock_TimerCountDown)
     {
-      RealTimeClock_TimerCountDown--;
+      ctx->RealTimeClock_TimerCountDown--;
     }
-    lite_timer_IT_state=1;
+  }
+  if (++DALID_UptimeMs >= 1000) /* diagnostics: uptime in seconds */
+  {
+    DALID_UptimeMs = 0;
+    DALID_Counters.uptime++;
+  }
+  lite_timer_IT_state=1;
 }
 
@@ -0,0 +1,90 @@
+/**
+  ******************************************************************************
+  * @file    dalican.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali to CAN bridge (building backbone) - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALICAN_H
+#define __DALICAN_H
+
+#include "DALIslave.h"
+#include "DALItrace.h"
+#include "DALIevents.h"
+
+/* CAN bridge (DALI_CAN_BRIDGE, parts with beCAN: STM8S208, STM8AF52Ax, add
+   stm8s_can.c of the peripheral library to the project): each node pushes the
+   events of its DALI lines to the backbone as they happen, one controller
+   collects dozens of lines without polling them.
+
+   Node -> controller, standard id CANB_ID_EVENT + CANB_NODE: event records
+   packed back to back, as many whole records as fit into the 8 data bytes.
+   A partly filled frame is sent CANB_FLUSH_MS after its first record.
+   Records are the bus records of the trace (DALItrace.h) without timestamp,
+   type (line 1: + TRACE_LINE1) then payload:
+     TRACE_FRAME_RX   address, data           frame received
+     TRACE_FRAME_RXL  bits, 4 frame bytes     8, 24 or 25 bit frame received
+     TRACE_FRAME_TX   answer                  backward frame sent by the node
+     TRACE_ERROR      TRACE_ERR_xxx           frame decoding failed
+     TRACE_IF_FAIL    -                       interface failure
+     TRACE_LOST       count                   records dropped before this one
+     CANB_REC_SENT    status, answer          outcome of CANB_CMD_SEND (DALI_TX_xxx)
+     CANB_REC_STAT    index, u32 (MSB first)  counter of DALIStats (CANB_CMD_STATS),
+                                              index CANB_STAT_DROPPED: commands dropped
+   Controller -> node, standard id CANB_ID_COMMAND + CANB_NODE, or
+   CANB_ID_COMMAND alone for all nodes (only these two ids pass the hardware
+   filter, other traffic of the backbone never interrupts the node):
+     CANB_CMD_SEND    line << 4 | CANB_SEND_xxx, bits (DALI_FRAME_16/24/25), 4 frame bytes
+     CANB_CMD_STATS   -
+   Commands are executed in order, a frame to send waits for the previous one.
+
+   Events are queued by the DALI interrupts (DALIevents.h, add dalievents.c
+   to the project) and packed in the main loop, the
+   receive FIFO is drained by the CAN receive interrupt: both CAN interrupts
+   run at DALI_APP_PRIORITY, the DALI interrupts nest into them. */
+#ifndef CANB_NODE
+ #define CANB_NODE          (1)     // 1..0x7F
+#endif
+#ifndef CANB_BITRATE
+ #define CANB_BITRATE       (125000)
+#endif
+#define CANB_TQ_PER_BIT     (16)    // sync + BS1 11 + BS2 4: sample point 75%
+#define CANB_FLUSH_MS       (10)
+
+#define CANB_ID_COMMAND     (0x200)
+#define CANB_ID_EVENT       (0x400)
+
+#define CANB_CMD_SEND       (0x01)
+#define CANB_CMD_STATS      (0x02)
+#define CANB_SEND_PRIORITY  (0x07)  // 1..5, 0: 2
+#define CANB_SEND_QUERY     (0x08)  // backward frame expected
+
+#define CANB_REC_SENT       (0xE0)  // line 1: + TRACE_LINE1
+#define CANB_REC_STAT       (0xE1)
+#define CANB_STAT_DROPPED   (sizeof(TDALIStats) / sizeof(u32))
+
+#define CANB_COMMANDS       (4)     // power of 2
+
+#if defined (DALI_CAN_BRIDGE) && !defined (STM8S208) && !defined (STM8AF52Ax)
+ #error "CAN bridge needs a part with beCAN"
+#endif
+
+void init_DALI_can(void);
+u8 can_bridge_process(void);
+void can_bridge_timer(void);
+void can_rx_interrupt(void);
+
+#endif /* __DALICAN_H */
@@ -0,0 +1,60 @@
+/**
+  ******************************************************************************
+  * @file    dalievents.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali bus event queue for host interfaces - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALIEVENTS_H
+#define __DALIEVENTS_H
+
+#include "DALIslave.h"
+#include "DALItrace.h"
+
+/* Bus events of the DALI interrupts queued for the host interface of the
+   device (CAN bridge, DALIcan.h, or I2C slave, DALIi2c.h): the bus records
+   of the trace (DALItrace.h) without timestamp, type then payload:
+     TRACE_FRAME_RX   address, data           frame received
+     TRACE_FRAME_RXL  bits, 4 frame bytes     8, 24 or 25 bit frame received
+     TRACE_FRAME_TX   answer                  backward frame sent by the device
+     TRACE_ERROR      TRACE_ERR_xxx           frame decoding failed
+     TRACE_IF_FAIL    -                       interface failure
+     TRACE_LOST       count                   records dropped before this one
+   Start bit and timestamp records are not queued. The queue is written at
+   DALI interrupt level only and read by one consumer, records which do not
+   fit are dropped and reported by TRACE_LOST. */
+#if defined (DALI_CAN_BRIDGE) || defined (DALI_I2C_SLAVE)
+ #define DALI_EVENTS
+#endif
+#if defined (DALI_CAN_BRIDGE) && defined (DALI_I2C_SLAVE)
+ #error "bus event queue has one consumer: CAN bridge or I2C slave"
+#endif
+#if defined (DALI_EVENTS) && defined (DALI_TRACE)
+ #error "host interfaces and UART trace share the bus event hooks"
+#endif
+
+#define EVENT_BUFFER_SIZE (64)  // power of 2
+#define EVENT_NONE        (0xFF) // event_len: record type not queued
+
+void init_DALI_events(void);
+void event_put(u8 type, u8 d0, u8 d1);
+void event_put_frame(u8 type, u8 bits, u8 *frame);
+u8 event_len(u8 type);
+u8 event_count(void);
+u8 event_peek(u8 offset);
+void event_drop(u8 count);
+
+#endif /* __DALIEVENTS_H */
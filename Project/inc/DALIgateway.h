@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+  * @file    daligateway.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   UART to Dali gateway (application controller) - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALIGATEWAY_H
+#define __DALIGATEWAY_H
+
+#include "DALIslave.h"
+#include "DALItrace.h"
+
+/* Gateway mode (DALI_GATEWAY): a host sends forward frames over UART, the
+   device sends them on line GW_LINE as a bus master (multi-master transmitter
+   of the driver) and returns the outcome of each one, the backward frame of a
+   query included. The control gear units of the device keep working, but do
+   not see the frames sent by the gateway.
+
+   Request (host -> gateway), GW_REQUEST_SIZE bytes, 8N1 at GW_BAUDRATE:
+     byte 0     GW_REQUEST
+     byte 1     request id, returned in the response
+     byte 2     flags: priority 1..5 in GW_FLAG_PRIORITY (0: GW_PRIORITY_DEFAULT),
+                GW_FLAG_QUERY, GW_FLAG_TWICE, GW_FLAG_TRANSACTION
+     byte 3     frame size, DALI_FRAME_16/24/25
+     byte 4..7  frame, first bit = MSB of byte 4
+     byte 8     checksum: 0 - sum of bytes 0..7
+   Response (gateway -> host), GW_RESPONSE_SIZE bytes:
+     byte 0     GW_RSP_xxx
+     byte 1     request id
+     byte 2     backward frame (GW_RSP_ANSWER), 0 otherwise
+
+   Requests are executed in the order received, each one gets one response.
+   The host may send up to GW_QUEUE_DEPTH requests ahead of their responses:
+   the next frame is then handed to the transmitter as soon as the previous
+   one is resolved (sent, answered or backward frame window closed), the
+   driver starts it right at the end of its settling time and the line runs
+   at the rate the bus timing allows, whatever the host latency. Bytes which
+   do not fit into the queue are dropped and reported by GW_RSP_OVERRUN
+   (queue flushed).
+
+   Framing: GW_REQUEST may also appear inside a request, a request is taken
+   only if its checksum matches - otherwise the gateway searches the next
+   GW_REQUEST from the byte after the one it tried. A request left incomplete
+   for GW_IDLE_MS (bytes lost on the line, host restarted) is dropped, so the
+   next one is not mixed with it. Neither gets a response: the host sends the
+   request again when its response does not come. */
+#define GW_REQUEST          (0xA5)
+#define GW_REQUEST_SIZE     (9)
+#define GW_RESPONSE_SIZE    (3)
+
+#define GW_FLAG_PRIORITY    (0x07)
+#define GW_FLAG_QUERY       (0x08) // backward frame expected (GW_RSP_ANSWER or GW_RSP_NO_ANSWER)
+#define GW_FLAG_TWICE       (0x10) // send twice (configuration commands): second frame at
+                                   // priority 1, one response after it
+#define GW_FLAG_TRANSACTION (0x20) // next request belongs to the same transaction (DTR then
+                                   // command...): it is sent at priority 1
+#define GW_PRIORITY_DEFAULT (2)
+
+#define GW_RESPONSE         (0xB0)
+#define GW_RSP_DONE         (GW_RESPONSE | DALI_TX_DONE)
+#define GW_RSP_FAILED       (GW_RESPONSE | DALI_TX_FAILED)         // DALI_TX_ATTEMPTS collisions
+#define GW_RSP_ANSWER       (GW_RESPONSE | DALI_TX_ANSWER)
+#define GW_RSP_NO_ANSWER    (GW_RESPONSE | DALI_TX_NO_ANSWER)
+#define GW_RSP_INVALID      (GW_RESPONSE | DALI_TX_ANSWER_INVALID) // several answers collided
+                                                                   // ("yes" of a yes/no query)
+#define GW_RSP_BAD          (0xB8) // bad request (frame size), not sent
+#define GW_RSP_OVERRUN      (0xB9) // queue overflow, id 0: requests lost, queue flushed
+
+#define GW_QUEUE_SIZE       (128)  // bytes, power of 2
+#define GW_QUEUE_DEPTH      (GW_QUEUE_SIZE / GW_REQUEST_SIZE) // requests
+#define GW_IDLE_MS          (5)    // line idle time dropping an incomplete request
+#define GW_RESPONSE_BUFFER  (32)   // power of 2
+#ifndef GW_BAUDRATE
+ #define GW_BAUDRATE        (115200)
+#endif
+#ifndef GW_LINE
+ #define GW_LINE            (0)
+#endif
+
+#if defined (DALI_GATEWAY) && defined (DALI_TRACE)
+ #error "gateway and bus trace use the same UART"
+#endif
+
+/* UART of the gateway: the one of the bus trace (see DALItrace.h) */
+#define GW_UART             TRACE_UART
+#define GW_CR2_TIEN         TRACE_CR2_TIEN
+#define GW_CR2_TEN          TRACE_CR2_TEN
+#define GW_CR2_RIEN         TRACE_CR2_RIEN
+#define GW_CR2_REN          TRACE_CR2_REN
+
+void init_DALI_gateway(void);
+u8 gateway_process(void);
+void gateway_timer(void);
+void gateway_tx_interrupt(void);
+void gateway_rx_interrupt(void);
+
+#endif /* __DALIGATEWAY_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    dalii2c.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali co-processor register interface (I2C slave) - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALII2C_H
+#define __DALII2C_H
+
+#include "DALIslave.h"
+#include "DALIevents.h"
+#include "dali_config.h"
+#include "dali_regs.h"
+#include "DALIpwm.h"
+
+/* Co-processor mode (DALI_I2C_SLAVE, add stm8s_i2c.c of the peripheral
+   library and dalievents.c to the project): a host MCU reads the state of
+   the device as a register file over I2C (SCL = PB4, SDA = PB5, slave
+   address I2CS_ADDRESS, up to 400kHz) and is told of bus events by the
+   I2CS_IRQ pin instead of polling.
+
+   Write: register pointer, further bytes are ignored (registers are read
+   only). Read: register at the pointer, then the following ones (auto
+   increment) in one burst, up to the end of the map. The pointer stops at
+   I2CS_REG_EVENTS: each byte read there is taken from the event queue
+   (DALIevents.h, whole records), 0xFF once it is empty. A burst from
+   I2CS_REG_STATUS thus returns status, byte count, then the events.
+     0x00  I2CS_REG_ID        I2CS_ID
+     0x01  I2CS_REG_VERSION   I2CS_VERSION
+     0x02  I2CS_REG_STATUS    I2CS_STATUS_xxx
+     0x03  I2CS_REG_COUNT     bytes in the event queue
+     0x04  I2CS_REG_EVENTS    event queue
+     0x05  I2CS_REG_UNITS     DALI units (DALI_INSTANCES)
+     0x06  I2CS_REG_LINES     DALI lines (DALI_LINES)
+     0x08  I2CS_REG_LEVEL     u16 per PWM channel (MSB first), 0 if unused
+     0x10  I2CS_REG_STATS     u32 per counter of DALIStats (MSB first)
+     0x40  I2CS_REG_UNIT(n)   DALI registers of unit n (DALIREG_xxx order)
+   Registers from I2CS_REG_UNITS on are a snapshot refreshed by the main
+   loop at most each I2CS_REFRESH_MS, one read transfer always returns the
+   values of one snapshot.
+
+   I2CS_IRQ pin (open drain, active low) is asserted while the event queue
+   is not empty. The I2C interrupt runs at DALI_APP_PRIORITY, the DALI
+   interrupts nest into it; with the fast mode clock a burst of the whole
+   queue takes less than 2ms. The physical selection button and the pull-up
+   control move off PB4/PB5 (see dali_config.h). */
+#ifndef I2CS_ADDRESS
+ #define I2CS_ADDRESS       (0x2D)  // 7 bits
+#endif
+#define I2CS_REFRESH_MS     (20)
+
+#define I2CS_IRQ_PORT       GPIOC   // PC3
+#define I2CS_IRQ_PIN        3
+
+#define I2CS_ID             (0xDA)
+#define I2CS_VERSION        (1)
+#define I2CS_STATUS_EVENTS  (0x01)  // event queue not empty (I2CS_IRQ asserted)
+#define I2CS_STATUS_READY   (0x02)  // snapshot valid
+
+#define I2CS_REG_ID         (0x00)
+#define I2CS_REG_VERSION    (0x01)
+#define I2CS_REG_STATUS     (0x02)
+#define I2CS_REG_COUNT      (0x03)
+#define I2CS_REG_EVENTS     (0x04)
+#define I2CS_REG_UNITS      (0x05)
+#define I2CS_REG_LINES      (0x06)
+#define I2CS_REG_LEVEL      (0x08)
+#define I2CS_REG_STATS      (0x10)
+#define I2CS_REG_UNIT(n)    (0x40 + (n) * 0x28)
+#define I2CS_REG_END        I2CS_REG_UNIT(DALI_INSTANCES)
+
+#if defined (DALI_I2C_SLAVE) && (I2CS_REG_END > 0x100)
+ #error "I2C register map holds 4 units"
+#endif
+
+void init_DALI_i2c(void);
+u8 i2c_slave_process(void);
+void i2c_slave_timer(void);
+void i2c_slave_interrupt(void);
+
+#endif /* __DALII2C_H */
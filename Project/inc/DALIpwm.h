@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+  * @file    dalipwm.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   PWM light outputs of the DALI control gear units - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALIPWM_H
+#define __DALIPWM_H
+
+#include "stm8s.h"
+#include "dali_config.h"
+
+/* One PWM output per DALI unit (DALI_INSTANCES in dali_config.h), channel
+   n is driven by unit n. With colour control (DALI_COLOUR) each unit drives
+   DALICOL_PRIMARIES channels, primary p of unit n is channel
+   n*DALICOL_PRIMARIES+p. Period is 0x10000 timer clocks (ARR reset value,
+   244Hz at 16MHz), duty cycle is the light level of the unit.
+   Timers are configured once by init_PWM(), set_PWM() only records the
+   pending level, update_PWM() commits pending levels through the compare
+   preload registers (or to the dither modulator, see PWM_DITHER), the
+   timers apply them at the next update event.
+   Channel map on STM8S discovery board:
+     0: TIM3_CH2 PD0 (board LED, active low)
+     1: TIM2_CH1 PD4
+     2: TIM1_CH1 PC1
+     3: TIM2_CH2 PD3 (shares the TIM2 counter with channel 1) */
+#ifndef PWM_CHANNELS_MAX
+ #define PWM_CHANNELS_MAX  (4)
+#endif
+
+#ifdef DALI_COLOUR
+ #define PWM_UNIT_CHANNELS  (DALICOL_PRIMARIES)
+#else
+ #define PWM_UNIT_CHANNELS  (1)
+#endif
+#define PWM_CHANNELS  (DALI_INSTANCES * PWM_UNIT_CHANNELS)
+
+#if (PWM_CHANNELS > PWM_CHANNELS_MAX)
+ #error "DALI units need more PWM channels than the board has"
+#endif
+
+/* Uncomment the line below for the high frequency output mode: period of
+   2^PWM_DITHER_BITS timer clocks (3.9kHz at 16MHz with 12 bits, no flicker
+   on camera) and a first-order sigma-delta modulator in the timer update
+   interrupts, which spreads the low 16-PWM_DITHER_BITS bits of the level
+   over successive periods: the average duty cycle keeps the full 16-bit
+   resolution down to the lowest arc levels (dither pattern repeats each
+   2^(16-PWM_DITHER_BITS) periods, 244Hz with 12 bits, 1 count amplitude).
+   Costs one update interrupt per timer and period at DALI_APP_PRIORITY. */
+/* #define PWM_DITHER  (1) */
+#define PWM_DITHER_BITS  (12)  // timer resolution of the dithered mode (10..15)
+
+#ifdef PWM_DITHER
+ #define PWM_PERIOD  (1UL << PWM_DITHER_BITS)
+#else
+ #define PWM_PERIOD  (0x10000UL)
+#endif
+
+/* Uncomment the line below to spread the pulses of the timers over the
+   period (counter n starts at n*PWM_PERIOD/PWM_CHANNELS), so the channels
+   do not switch on together and the supply ripple is lower */
+/* #define PWM_PHASE_STAGGER  (1) */
+
+void init_PWM(void);
+void set_PWM(u8 channel, u16 level);
+u16 get_PWM(u8 channel);
+void update_PWM(void);
+u8 PWM_lit(void);
+u8 PWM_running(u8 channel);
+u8 PWM_unit_running(u8 unit);
+#ifdef PWM_DITHER
+void dither_PWM(u8 timer);
+#endif
+
+#endif /* __DALIPWM_H */
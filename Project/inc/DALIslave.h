@@ -18,40 +18,255 @@
   ******************************************************************************
   */
 
+#ifndef __DALISLAVE_H
+#define __DALISLAVE_H
+
 #include "stm8s.h"
 
+/* Number of DALI lines (PHYs) served by the driver, each line has its own
+   pins, decoder/encoder state, failure supervision and frame mailbox, all
+   lines are sampled by the common TIM4 tick. Driver functions of a line get
+   the line index first if there are more lines. Utilities/LineSim runs two
+   lines with traffic on both at once. */
+#ifndef DALI_LINES
+ #define DALI_LINES  (1)
+#endif
+
+/* Uncomment the line below to stream bus events (frames, decoding errors,
+   backward frames) with tick timestamps to UART, see DALItrace.h */
+/* #define DALI_TRACE  (1) */
+
+/* Uncomment the line below to send forward frames requested by a host over
+   UART as a bus master (application controller), see DALIgateway.h */
+/* #define DALI_GATEWAY  (1) */
+
+/* Uncomment the line below to push bus events to a CAN backbone and take
+   commands from it (STM8S208), see DALIcan.h */
+/* #define DALI_CAN_BRIDGE  (1) */
+
+/* Uncomment the line below to serve a host MCU as a co-processor: registers,
+   counters and bus events read over I2C, see DALIi2c.h */
+/* #define DALI_I2C_SLAVE  (1) */
+
 #define NO_ACTION 0
 #define SENDING_DATA 1
 #define RECEIVING_DATA 2
 #define ERR 3
+#define SENDING_FORWARD 4  // multi-master transmitter: forward frame
+#define SENDING_BREAK 5    // multi-master transmitter: collision break
+
+// Frame sizes accepted by the decoder (data bits, IEC 62386-101)
+#define DALI_FRAME_8      (8)     // backward frame (answer of control gear to a query)
+#define DALI_FRAME_16     (16)    // control gear (IEC 62386-102): address, data
+#define DALI_FRAME_24     (24)    // input devices and event messages (IEC 62386-103)
+#define DALI_FRAME_25     (25)    // reserved size, passed on undecoded
+#define DALI_FRAME_BYTES  (4)     // frame buffer, first bit received = MSB of byte 0
+
+// Multi-master transmitter (forward frames of input devices, IEC 62386-101/103):
+// a frame is started after the bus has been idle for the settling time of its
+// priority, drawn at random in the priority window, and read back at the middle
+// of each half bit. On a difference the bus is held low for the collision break
+// (all transmitters stop) and the frame is tried again after a new settling time.
+#define DALI_TX_IDLE        (0)   // tx status: nothing queued
+#define DALI_TX_PENDING     (1)   // waiting for the bus or being sent
+#define DALI_TX_DONE        (2)   // sent without collision
+#define DALI_TX_FAILED      (3)   // DALI_TX_ATTEMPTS collisions, given up
+#define DALI_TX_WAIT_ANSWER (4)   // sent, backward frame window open (query)
+#define DALI_TX_ANSWER      (5)   // backward frame received, see get_send_answer
+#define DALI_TX_NO_ANSWER   (6)   // no backward frame in the window
+#define DALI_TX_ANSWER_INVALID (7) // decoding error in the window (answers collided)
+#define DALI_TX_PRIORITIES  (5)   // event priorities 1 (highest) .. 5
+#define DALI_TX_ATTEMPTS    (10)
+#define DALI_TX_BREAK_TICKS (13)  // collision break 1.2..1.4ms
+// Backward frame window: its start bit comes 5.5..10.5ms after the last data bit
+// of the query, idle ticks are counted from the end of the stop bits (+16 ticks)
+#define DALI_TX_ANSWER_TICKS (87)
+
+#define TICKS_PER_SECOND  (9600)  // 8 x 1200 DALI baudrate
+#define MS_PER_SECOND     (1000)
+#define TIM4_MAX_PERIOD   (256)   // 8-bit auto-reload
+#define TIM4_MAX_PRESCALLER (0x07) // divide by 128
+
+/* Interrupt priority plan (ITC software priority, level 3 is the highest):
+   - TIM4 update (bit tick): DALI_IRQ_PRIORITY
+   - EXTI of the DALI input ports: DALI_EXTI_PRIORITY, the same level with
+     one line. With DALI_LINES > 1 the start edge of one line comes while
+     the other lines receive or send: pending together, the EXTI vectors
+     would be served before TIM4, so the EXTI goes one level below the tick,
+     the tick preempts it. It only samples the phase and marks the start
+     (start_pending), the tick starts receiving: DALI interrupts never nest
+     into each other's state. Utilities/LineSim reports the tick jitter
+     with both lines busy.
+   - all other interrupt sources: DALI_APP_PRIORITY, so the DALI interrupts
+     nest into any application interrupt routine
+   Application must not raise other sources to DALI_IRQ_PRIORITY. */
+#define DALI_IRQ_PRIORITY  ITC_PRIORITYLEVEL_3
+#if (DALI_LINES > 1)
+ #define DALI_EXTI_PRIORITY ITC_PRIORITYLEVEL_2
+#else
+ #define DALI_EXTI_PRIORITY DALI_IRQ_PRIORITY
+#endif
+#define DALI_APP_PRIORITY  ITC_PRIORITYLEVEL_1
 
-#define CPU_CLK           (16000000)  //16MHz
-#define TIM4_PRESCALLER   (0x03) // divide by 8
-#define TIM4_DIVIDER      (CPU_CLK/(1<<TIM4_PRESCALLER)/9600) //8 x 1200 DALI baudrate
-#define TICKS_PER_ONE_MS  (9600/1000)
+/* Worst-case latency budget of the bit tick interrupt, checked at build time.
+   Receiver samples 8 times per bit and accepts edges 7..9 ticks apart, the
+   sampling instant may move by 1/4 of the tick period (104us) at most.
+   During a frame the tick can be delayed only by the instruction in progress,
+   by the interrupt context save and by code running with interrupts disabled
+   (sim..rim) - the DALI EXTI is disabled while a frame is received or sent,
+   the EXTI of the other lines (DALI_LINES > 1) is below the tick and has no
+   section with interrupts disabled: no term for it.
+   Sections do not nest, the longest one counts. Sections of the stack which
+   may run during a frame (cycles at most, counted from the code, calls
+   included):
+     send_data           timebase switch, state change, trace record  150
+     set_DALI_clock      idle check, timebases copied (computed before) 110
+     update_PWM          PWM_DITHER: levels handed to the modulators   60
+     send_forward        settling time draw                            60
+     DALID_Copy, I2C/CAN statistics: one 32 bit counter at a time      30
+   Not counted: DALIU_Program (firmware update) stalls the CPU for a whole
+   block programming, it starts only in the settling time after a forward
+   frame (see DALIU_PROGRAM_IDLE_MAX in dali_fwu.h), and DALI_halt, which
+   halts with all lines idle. The application declares its longest section
+   in APP_MAX_ATOMIC_CYCLES (not its interrupt routines: they run at
+   DALI_APP_PRIORITY, the DALI interrupts nest into them).
+   The constants bound the code as written; the real maximum is measured at
+   run time: get_tick_jitter_us (diagnostic bank: DALID_LOC_TICK_JITTER),
+   the spread of the tick entry over the frames seen, must stay below
+   DALI_LATENCY_BUDGET_US. */
+#define DALI_LATENCY_BUDGET_US  (26)
+#define DALI_MIN_FCPU_HZ        (8000000) // lowest fCPU of the run clock (see set_DALI_clock)
+#define DALI_IRQ_ENTRY_CYCLES   (9)       // context save to the stack
+#define DALI_MAX_INSTR_CYCLES   (17)      // longest instruction (DIVW)
+#define DALI_STACK_ATOMIC_CYCLES (150)    // longest section of the stack (list above)
+#ifndef APP_MAX_ATOMIC_CYCLES
+ #define APP_MAX_ATOMIC_CYCLES  (50)      // longest application code with interrupts disabled
+#endif
+#define DALI_ATOMIC_CYCLES      ((APP_MAX_ATOMIC_CYCLES > DALI_STACK_ATOMIC_CYCLES) ? \
+                                 APP_MAX_ATOMIC_CYCLES : DALI_STACK_ATOMIC_CYCLES)
+#define DALI_LATENCY_WORST_US   (((DALI_IRQ_ENTRY_CYCLES + DALI_MAX_INSTR_CYCLES + DALI_ATOMIC_CYCLES) \
+                                  * 1000000UL + DALI_MIN_FCPU_HZ - 1) / DALI_MIN_FCPU_HZ)
 
-#define US_PER_TICK       (1000000/(CPU_CLK/(1<<TIM4_PRESCALLER)/TIM4_DIVIDER))
-#define US_PER_MS         (1000000/1000)
+// TIM4 timebase for one tick: period = (period_int + period_frac/65536) timer counts
+// The fractional part is carried by a phase accumulator, one count at a time.
+typedef struct
+{
+  u8  ckdivr;      // CLK->CKDIVR value this timebase was computed for
+  u8  prescaller;  // TIM4->PSCR
+  u8  period_int;  // integer part of the tick period (timer counts)
+  u16 period_frac; // fractional part of the tick period (1/65536 timer counts)
+} TTimebase;
 
+#if (DALI_LINES > 1)
+ #define DALI_LINE_PARAMS  u8 line,
+ #define DALI_LINE_PARAM   u8 line
+ #define DALI_LINE_ARGS    line,
+ #define DALI_LINE_ARG     line
+ #define DALI_LINE_INDEX   line
+#else
+ #define DALI_LINE_PARAMS
+ #define DALI_LINE_PARAM   void
+ #define DALI_LINE_ARGS
+ #define DALI_LINE_ARG
+ #define DALI_LINE_INDEX   0
+#endif
+
+// Bus statistics counted by the driver at interrupt level (events only, not per tick)
+// (sum of all lines)
+typedef struct
+{
+  u32 frames;        // frames received without error (forward, others' backward)
+  u32 err_start;     // start bit too long
+  u32 err_stop;      // edge or wrong level in stop bits
+  u32 err_edge;      // missing edge in data bits
+  u32 replies;       // backward frames sent
+  u32 if_failures;   // interface failures (bus low for 500ms)
+  u32 tx_frames;     // forward frames sent (multi-master transmitter)
+  u32 collisions;    // collisions detected while sending forward frames
+} TDALIStats;
+
+extern TDALIStats DALIStats;
+extern volatile u16 BootTicks;
 
 //callback function type
-typedef void TDataReceivedCallback(u8 address,u8 dataByte);
+// frame: DALI_FRAME_BYTES bytes, valid during the call only, unused bits are 0
+typedef void TDataReceivedCallback(DALI_LINE_PARAMS u8 bits, u8 *frame);
 typedef void TRTC_1ms_Callback(void);
-typedef void TErrorCallback(u8 code);
+typedef void TErrorCallback(DALI_LINE_PARAMS u8 code);
+
+// State of one DALI line
+typedef struct
+{
+  GPIO_TypeDef *out_port;     // communication port and pin
+  u8 out_pin;
+  u8 out_invert;
+  GPIO_TypeDef *in_port;
+  u8 in_pin;
+  u8 in_invert;
+
+  u8 answer;                  // data to send to controller device
+  u8 frame[DALI_FRAME_BYTES]; // forward frame being received (address, data...)
+  u8 frame_bits;              // data bits of the received frame (DALI_FRAME_xx)
+
+  u8 flag;                    // status flag
+  u8 bit_count;               // nr of rec/send bits
+  u16 tick_count;             // nr of ticks of the timer
+  u16 InterfaceFailureCounter; // nr of ticks when interface voltage is low
+  bool former_val;            // bit value in previous tick of timer
+  u8 StartEdgePhase;          // TIM4 counter at the start bit edge, asynchronous to the tick
+#if (DALI_LINES > 1)
+  u8 start_pending;           // start edge taken by the EXTI, receiving starts at the next tick
+#endif
+
+  u8 idle_ticks;              // ticks the bus has been idle (saturated)
+  u8 tx_frame[DALI_FRAME_BYTES]; // forward frame of the multi-master transmitter
+  u8 tx_bits;
+  u8 tx_priority;             // 0..DALI_TX_PRIORITIES-1
+  u8 tx_wait;                 // idle ticks before the next attempt
+  u8 tx_attempts;
+  u8 tx_status;               // DALI_TX_xxx
+  u8 tx_query;                // backward frame expected after the frame
+  u8 tx_answer;               // backward frame received (DALI_TX_ANSWER)
+
+  TDataReceivedCallback *DataReceivedCallback;
+  TErrorCallback *ErrorCallback;
+} TDALILine;
+
+extern TDALILine DALILines[DALI_LINES];
 
 // Receiving procedures
-void receive_data(void);
-void receive_tick(void);
+void receive_edge(GPIO_TypeDef *port);
+void receive_data(DALI_LINE_PARAM);
+void receive_tick(DALI_LINE_PARAM);
+u8 inject_frame(DALI_LINE_PARAMS u8 bits, u8 *frame);
 
 // Common procedures
-void init_DALI(GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef* port_in, u8 pin_in, u8 invert_in,
+void init_DALI(DALI_LINE_PARAMS GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef* port_in, u8 pin_in, u8 invert_in,
                TDataReceivedCallback DataReceivedFunction, TErrorCallback ErrorFunction, TRTC_1ms_Callback RTC_1ms_Function);
-u8 get_flag(void);
+u8 get_flag(DALI_LINE_PARAM);
+u8 get_idle_ticks(DALI_LINE_PARAM);
+void line_tick(DALI_LINE_PARAM);
+void lines_tick(void);
 
 // Sending procedures
-void send_data(u8 byteToSend);
-void send_tick(void);
-void check_interface_failure(void);
+void send_data(DALI_LINE_PARAMS u8 byteToSend);
+void send_tick(DALI_LINE_PARAM);
+u8 send_forward(DALI_LINE_PARAMS u8 bits, u8 *frame, u8 priority, u8 query);
+u8 get_send_status(DALI_LINE_PARAM);
+u8 get_send_answer(DALI_LINE_PARAM);
+void check_interface_failure(DALI_LINE_PARAM);
 
 // Timer procedures
 u8 get_timer_count(void);
+u8 get_start_edge_phase(DALI_LINE_PARAM);
+void timebase_tick(void);
+u8 set_DALI_clock(u8 run_ckdivr, u8 idle_ckdivr);
+u32 get_fmaster(void);
+void tick_latency_sample(void);
+u16 get_tick_jitter_us(void);
+void tick_duration_sample(void);
+u16 get_tick_duration_us(void);
+void reset_tick_jitter(void);
+u16 get_boot_ticks(void);
+
+#endif /* __DALISLAVE_H */
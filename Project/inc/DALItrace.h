@@ -0,0 +1,129 @@
+/**
+  ******************************************************************************
+  * @file    dalitrace.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali bus trace streamer over UART - header
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __DALITRACE_H
+#define __DALITRACE_H
+
+#include "DALIslave.h"
+
+/* Trace stream format (8N1, TRACE_BAUDRATE), one record after another:
+     byte 0     record type (TRACE_xxx below)
+     byte 1..2  timestamp, tick counter (1/TICKS_PER_SECOND s), MSB first
+     byte 3..   payload, length given by the record type
+   The timestamp wraps each 65536 ticks (6.8s), a TRACE_WRAP record is sent
+   at every wrap so the host can rebuild absolute time.
+   Records are queued by the DALI interrupts and sent by the UART transmit
+   interrupt, records which do not fit into the buffer are dropped and
+   reported by TRACE_LOST as soon as there is space again.
+   Utilities/TraceDecode reads the stream from a serial port into a readable
+   log and a replay file. */
+#define TRACE_FRAME_RX  (0xD0) // forward frame received, payload: address, data
+#define TRACE_FRAME_TX  (0xD1) // backward frame start bit sent, payload: answer
+#define TRACE_START     (0xD2) // start bit edge, receiving started, no payload
+#define TRACE_ERROR     (0xD3) // frame decoding failed, payload: TRACE_ERR_xxx
+#define TRACE_IF_FAIL   (0xD4) // interface failure (bus low 500ms), no payload
+#define TRACE_WRAP      (0xD5) // timestamp wrapped, no payload
+#define TRACE_LOST      (0xD6) // records dropped before this one, payload: count (saturated)
+#define TRACE_FRAME_RXL (0xD7) // frame of 24 or 25 bits received (IEC 62386-103 input devices,
+                               // reserved size) or backward frame of another device (8 bits), payload: bit count, DALI_FRAME_BYTES
+                               // frame bytes (first bit = MSB of the first byte, unused bits 0)
+#define TRACE_STATE     (0xDD) // driver state of a line changed, payload: line, new state
+                               // (NO_ACTION, SENDING_DATA, RECEIVING_DATA, ERR, SENDING_FORWARD,
+                               // SENDING_BREAK of DALIslave.h)
+
+/* With DALI_LINES > 1 the bus records of line 1 have type + TRACE_LINE1
+   (0xD8..0xDC, 0xDF), TRACE_WRAP and TRACE_LOST are common to all lines,
+   TRACE_STATE gives the line in its payload. */
+#define TRACE_LINE1     (0x08)
+#if (defined (DALI_TRACE) || defined (DALI_CAN_BRIDGE) || defined (DALI_I2C_SLAVE)) && (DALI_LINES > 2)
+ #error "trace records distinguish two lines only"
+#endif
+#if (DALI_LINES > 1)
+ #define TRACE_ON_LINE(type, l) ((u8)((type) | ((l) << 3)))
+#else
+ #define TRACE_ON_LINE(type, l) (type)
+#endif
+
+/* Replay (DALI_TRACE_REPLAY, needs DALI_TRACE): a captured trace streamed
+   back unchanged into the UART receiver is replayed in the recorded timing.
+   Each TRACE_FRAME_RX or TRACE_FRAME_RXL record is handed to the stack as a received frame
+   after the recorded delay from the previous one (TRACE_WRAP records keep
+   long gaps exact) on the line it was recorded on, so traffic of both lines
+   of a dual line device is replayed interleaved as captured. Other record
+   types are skipped. Injected frames appear
+   again in the trace output, so the host keeps at most TRACE_REPLAY_DEPTH
+   frames ahead of them and diffs the output with the reference capture.
+   Offline replay of a capture (host build of the stack, virtual time,
+   registers, light output and answers diffed with a reference run):
+   Utilities/TraceReplay. */
+/* #define DALI_TRACE_REPLAY  (1) */
+#define TRACE_REPLAY_DEPTH (8) // power of 2
+
+#define TRACE_ERR_START (1)    // start bit too long
+#define TRACE_ERR_STOP  (2)    // edge or wrong level in stop bits
+#define TRACE_ERR_EDGE  (3)    // missing edge in data bits
+
+#ifndef TRACE_BAUDRATE
+ #define TRACE_BAUDRATE  (115200)
+#endif
+#define TRACE_BUFFER_SIZE (64) // power of 2
+
+/* UART used for trace: UART2 on STM8S105 (TX = PD5, RX = PD6),
+   UART1 on the other devices (same pins) */
+#if defined (STM8S105) || defined (STM8AF626x)
+ #define TRACE_UART     UART2
+ #define TRACE_CR2_TIEN UART2_CR2_TIEN
+ #define TRACE_CR2_TEN  UART2_CR2_TEN
+ #define TRACE_CR2_RIEN UART2_CR2_RIEN
+ #define TRACE_CR2_REN  UART2_CR2_REN
+#else
+ #define TRACE_UART     UART1
+ #define TRACE_CR2_TIEN UART1_CR2_TIEN
+ #define TRACE_CR2_TEN  UART1_CR2_TEN
+ #define TRACE_CR2_RIEN UART1_CR2_RIEN
+ #define TRACE_CR2_REN  UART1_CR2_REN
+#endif
+
+/* State changes go to the trace only (not to the CAN or I2C event queues) */
+#ifdef DALI_TRACE
+ #define DALI_TRACE_STATE(line, state)      trace_put(TRACE_STATE, (line), (state))
+#else
+ #define DALI_TRACE_STATE(line, state)
+#endif
+
+#ifdef DALI_TRACE
+ #define DALI_TRACE_EVENT(type, d0, d1)     trace_put((type), (d0), (d1))
+ #define DALI_TRACE_FRAME(type, bits, frame) trace_put_frame((type), (bits), (frame))
+#elif defined (DALI_CAN_BRIDGE) || defined (DALI_I2C_SLAVE)
+ #define DALI_TRACE_EVENT(type, d0, d1)     event_put((type), (d0), (d1)) // see DALIevents.h
+ #define DALI_TRACE_FRAME(type, bits, frame) event_put_frame((type), (bits), (frame))
+#else
+ #define DALI_TRACE_EVENT(type, d0, d1)
+ #define DALI_TRACE_FRAME(type, bits, frame)
+#endif
+
+void init_DALI_trace(void);
+void trace_put(u8 type, u8 d0, u8 d1);
+void trace_put_frame(u8 type, u8 bits, u8 *frame);
+void trace_tick(void);
+void trace_tx_interrupt(void);
+void trace_rx_interrupt(void);
+
+#endif /* __DALITRACE_H */
@@ -0,0 +1,254 @@
+/**
+  ******************************************************************************
+  * @file    dalican.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali to CAN bridge (building backbone)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALIcan.h"
+
+#ifdef DALI_CAN_BRIDGE
+
+#define CANB_COMMAND_MASK (CANB_COMMANDS - 1)
+#define CANB_STATS        (sizeof(TDALIStats) / sizeof(u32))
+#define CANB_NO_STAT      (0xFF)
+
+// 16 bit filter register of a standard id: STID[10:3], STID[2:0] RTR IDE EXID[17:15]
+#define CANB_FILTER_HI(id) ((u8)((id) >> 3))
+#define CANB_FILTER_LO(id) ((u8)(((id) & 0x07) << 5))
+
+// Commands: head written by the CAN receive interrupt, tail by can_bridge_process
+typedef struct
+{
+  u8 dlc;
+  u8 data[8];
+} TCanbCommand;
+
+TCanbCommand CanbCommands[CANB_COMMANDS];
+volatile u8 CanbCommandHead;
+volatile u8 CanbCommandTail;
+volatile u32 CanbDropped;  // commands dropped, queue full
+
+// Frame being packed
+u8 CanbFrame[8];
+u8 CanbFrameLen;
+u8 CanbFrameAge;        // ms since its first record
+
+u8 CanbSending;         // line of the CANB_CMD_SEND in progress + 1, 0: none
+u8 CanbStat;            // next counter to report, CANB_NO_STAT: none
+
+static u8 canb_len(u8 type);
+static u8 canb_pack(u8 type, u8 *payload);
+static u8 canb_flush(void);
+static u8 canb_command(void);
+
+// Setup CAN cell (normal mode, CANB_BITRATE) and the filter of the node
+// commands, fMASTER must not change afterwards
+void init_DALI_can(void)
+{
+  init_DALI_events();
+  CanbCommandHead = 0;
+  CanbCommandTail = 0;
+  CanbDropped = 0;
+  CanbFrameLen = 0;
+  CanbFrameAge = 0;
+  CanbSending = 0;
+  CanbStat = CANB_NO_STAT;
+
+  CAN_DeInit();
+  // automatic bus-off recovery, frames sent in the order they were queued
+  CAN_Init((CAN_MasterCtrl_TypeDef)(CAN_MasterCtrl_AutoBusOffManagement | CAN_MasterCtrl_TxFifoPriority),
+           CAN_Mode_Normal, CAN_SynJumpWidth_1TimeQuantum, CAN_BitSeg1_11TimeQuantum, CAN_BitSeg2_4TimeQuantum,
+           (u8)(get_fmaster() / ((u32)CANB_BITRATE * CANB_TQ_PER_BIT)));
+  // filter 0, list of 4 standard ids: the node, all nodes (twice each)
+  CAN_FilterInit(CAN_FilterNumber_0, ENABLE, CAN_FilterMode_IdList, CAN_FilterScale_16Bit,
+                 CANB_FILTER_HI(CANB_ID_COMMAND + CANB_NODE), CANB_FILTER_LO(CANB_ID_COMMAND + CANB_NODE),
+                 CANB_FILTER_HI(CANB_ID_COMMAND), CANB_FILTER_LO(CANB_ID_COMMAND),
+                 CANB_FILTER_HI(CANB_ID_COMMAND + CANB_NODE), CANB_FILTER_LO(CANB_ID_COMMAND + CANB_NODE),
+                 CANB_FILTER_HI(CANB_ID_COMMAND), CANB_FILTER_LO(CANB_ID_COMMAND));
+  CAN_ITConfig(CAN_IT_FMP, ENABLE);
+}
+
+// Returns payload length of the record type, EVENT_NONE: not sent on the backbone
+static u8 canb_len(u8 type)
+{
+  if (type == CANB_REC_STAT)
+    return 5;
+  if ((u8)(type & ~TRACE_LINE1) == CANB_REC_SENT)
+    return 2;
+  return event_len(type);
+}
+
+// Sends the packed frame, returns 0 if no transmit mailbox is free
+static u8 canb_flush(void)
+{
+  if (!CanbFrameLen)
+    return 1;
+  if (CAN_Transmit(CANB_ID_EVENT + CANB_NODE, CAN_Id_Standard, CAN_RTR_Data, CanbFrameLen, CanbFrame)
+      == CAN_TxStatus_NoMailBox)
+    return 0;
+  CanbFrameLen = 0;
+  CanbFrameAge = 0;
+  return 1;
+}
+
+// Adds one record to the frame, sends the frame first if the record does
+// not fit - returns 0 if that frame could not be sent (try again later)
+static u8 canb_pack(u8 type, u8 *payload)
+{
+  u8 len;
+
+  len = canb_len(type);
+  if ((u8)(CanbFrameLen + 1 + len) > 8)
+    if (!canb_flush())
+      return 0;
+  CanbFrame[CanbFrameLen++] = type;
+  while (len--)
+    CanbFrame[CanbFrameLen++] = *payload++;
+  return 1;
+}
+
+// Executes the next command, returns 0 if it has to wait
+static u8 canb_command(void)
+{
+  TCanbCommand *cmd;
+  u8 priority;
+
+  cmd = &CanbCommands[CanbCommandTail & CANB_COMMAND_MASK];
+  if ((cmd->dlc >= 1) && (cmd->data[0] == CANB_CMD_STATS))
+  {
+    if (CanbStat != CANB_NO_STAT)
+      return 0; // previous report still running
+    CanbStat = 0;
+    return 1;
+  }
+  if ((cmd->dlc < 7) || (cmd->data[0] != CANB_CMD_SEND) || ((cmd->data[1] >> 4) >= DALI_LINES)
+      || ((cmd->data[2] != DALI_FRAME_16) && (cmd->data[2] != DALI_FRAME_24) && (cmd->data[2] != DALI_FRAME_25)))
+    return 1; // unknown or bad command: ignored
+  if (CanbSending)
+    return 0;
+  priority = (u8)(cmd->data[1] & CANB_SEND_PRIORITY);
+  if (!priority)
+    priority = 2;
+#if (DALI_LINES > 1)
+  if (!send_forward((u8)(cmd->data[1] >> 4), cmd->data[2], &cmd->data[3], priority,
+                    (u8)(cmd->data[1] & CANB_SEND_QUERY)))
+#else
+  if (!send_forward(cmd->data[2], &cmd->data[3], priority, (u8)(cmd->data[1] & CANB_SEND_QUERY)))
+#endif
+    return 0; // line busy with a frame of the application
+  CanbSending = (u8)((cmd->data[1] >> 4) + 1);
+  return 1;
+}
+
+// Bridge main loop task: packs queued events, reports command outcomes and
+// counters, starts the next command - returns 0 when idle
+u8 can_bridge_process(void)
+{
+  u8 record[1 + 1 + DALI_FRAME_BYTES];
+  u8 type;
+  u8 len;
+  u8 i;
+  u32 value;
+
+  // bus events, in the order of the DALI interrupts
+  while (event_count())
+  {
+    type = event_peek(0);
+    len = event_len(type);
+    for (i = 0; i < len; i++)
+      record[i] = event_peek((u8)(i + 1));
+    if (!canb_pack(type, record))
+      return 1;
+    event_drop((u8)(len + 1));
+  }
+
+  if (CanbSending)
+  {
+    record[0] = get_send_status(
+#if (DALI_LINES > 1)
+                                (u8)(CanbSending - 1)
+#endif
+                                );
+    if ((record[0] != DALI_TX_PENDING) && (record[0] != DALI_TX_WAIT_ANSWER))
+    {
+      record[1] = (u8)((record[0] == DALI_TX_ANSWER) ? get_send_answer(
+#if (DALI_LINES > 1)
+                                                                      (u8)(CanbSending - 1)
+#endif
+                                                                      ) : 0);
+      if (!canb_pack(TRACE_ON_LINE(CANB_REC_SENT, CanbSending - 1), record))
+        return 1;
+      CanbSending = 0;
+    }
+  }
+
+  while (CanbStat != CANB_NO_STAT)
+  {
+    sim(); // counters are written by the DALI interrupts
+    value = (CanbStat < CANB_STATS) ? ((u32 *)&DALIStats)[CanbStat] : CanbDropped;
+    rim();
+    record[0] = CanbStat;
+    record[1] = (u8)(value >> 24);
+    record[2] = (u8)(value >> 16);
+    record[3] = (u8)(value >> 8);
+    record[4] = (u8)value;
+    if (!canb_pack(CANB_REC_STAT, record))
+      return 1;
+    CanbStat = (u8)((CanbStat < CANB_STAT_DROPPED) ? (CanbStat + 1) : CANB_NO_STAT);
+  }
+
+  while ((CanbCommandTail != CanbCommandHead) && canb_command())
+    CanbCommandTail++;
+
+  return (u8)(CanbFrameLen || CanbSending || (CanbCommandTail != CanbCommandHead));
+}
+
+// Sends a partly filled frame CANB_FLUSH_MS after its first record, call each ms
+void can_bridge_timer(void)
+{
+  if (!CanbFrameLen)
+    return;
+  if (CanbFrameAge < CANB_FLUSH_MS)
+    CanbFrameAge++;
+  else
+    canb_flush();
+}
+
+// Drains the receive FIFO into the command queue, called from CAN RX interrupt
+// (only commands of the node pass the filter)
+void can_rx_interrupt(void)
+{
+  TCanbCommand *cmd;
+  u8 i;
+
+  while (CAN_MessagePending() != CAN_NbrPendingMessage_0)
+  {
+    CAN_Receive(); // releases the FIFO output mailbox
+    if ((u8)(CanbCommandHead - CanbCommandTail) >= CANB_COMMANDS)
+    {
+      CanbDropped++;
+      continue;
+    }
+    cmd = &CanbCommands[CanbCommandHead & CANB_COMMAND_MASK];
+    cmd->dlc = CAN_GetReceivedDLC();
+    for (i = 0; i < 8; i++)
+      cmd->data[i] = CAN_GetReceivedData(i);
+    CanbCommandHead++;
+  }
+}
+
+#endif /* DALI_CAN_BRIDGE */
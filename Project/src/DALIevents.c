@@ -0,0 +1,118 @@
+/**
+  ******************************************************************************
+  * @file    dalievents.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali bus event queue for host interfaces
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALIevents.h"
+
+#ifdef DALI_EVENTS
+
+#define EVENT_BUFFER_MASK (EVENT_BUFFER_SIZE - 1)
+
+// Ring buffer, indexes run freely and are masked on access:
+// head is written only at DALI interrupt level, tail only by the consumer
+u8 EventBuffer[EVENT_BUFFER_SIZE];
+volatile u8 EventHead;
+volatile u8 EventTail;
+u8 EventLost;   // records dropped since the last TRACE_LOST record
+
+void init_DALI_events(void)
+{
+  EventHead = 0;
+  EventTail = 0;
+  EventLost = 0;
+}
+
+// Returns payload length of the record type, EVENT_NONE if it is not queued
+u8 event_len(u8 type)
+{
+  type &= (u8)~TRACE_LINE1;
+  if (type == TRACE_FRAME_RXL)
+    return 1 + DALI_FRAME_BYTES;
+  if (type == TRACE_FRAME_RX)
+    return 2;
+  if ((type == TRACE_FRAME_TX) || (type == TRACE_ERROR) || (type == TRACE_LOST))
+    return 1;
+  if (type == TRACE_IF_FAIL)
+    return 0;
+  return EVENT_NONE; // start bit edges, timestamp wraps
+}
+
+// Queues one record (payload: bits, then frame bytes), called from DALI
+// interrupts only (never blocks)
+void event_put_frame(u8 type, u8 bits, u8 *frame)
+{
+  u8 head;
+  u8 len;
+  u8 i;
+
+  len = event_len(type);
+  if (len == EVENT_NONE)
+    return;
+  head = EventHead;
+  if (EventLost)
+  {
+    if ((u8)(EVENT_BUFFER_SIZE - (u8)(head - EventTail)) < 2)
+    {
+      if (EventLost < 0xFF)
+        EventLost++;
+      return;
+    }
+    EventBuffer[head++ & EVENT_BUFFER_MASK] = TRACE_LOST;
+    EventBuffer[head++ & EVENT_BUFFER_MASK] = EventLost;
+    EventLost = 0;
+  }
+  if ((u8)(EVENT_BUFFER_SIZE - (u8)(head - EventTail)) < (u8)(len + 1))
+  {
+    EventHead = head;
+    EventLost = 1;
+    return;
+  }
+  EventBuffer[head++ & EVENT_BUFFER_MASK] = type;
+  if (len)
+    EventBuffer[head++ & EVENT_BUFFER_MASK] = bits;
+  for (i = 1; i < len; i++)
+    EventBuffer[head++ & EVENT_BUFFER_MASK] = frame[i - 1];
+  EventHead = head;
+}
+
+// Queues a record of up to 2 payload bytes
+void event_put(u8 type, u8 d0, u8 d1)
+{
+  event_put_frame(type, d0, &d1);
+}
+
+// Returns the number of bytes queued (whole records)
+u8 event_count(void)
+{
+  return (u8)(EventHead - EventTail);
+}
+
+// Returns a queued byte, offset from the oldest one
+u8 event_peek(u8 offset)
+{
+  return EventBuffer[(u8)(EventTail + offset) & EVENT_BUFFER_MASK];
+}
+
+// Removes bytes read by the consumer
+void event_drop(u8 count)
+{
+  EventTail = (u8)(EventTail + count);
+}
+
+#endif /* DALI_EVENTS */
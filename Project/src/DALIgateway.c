@@ -0,0 +1,249 @@
+/**
+  ******************************************************************************
+  * @file    daligateway.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   UART to Dali gateway (application controller)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALIgateway.h"
+
+#ifdef DALI_GATEWAY
+
+#define GW_QUEUE_MASK   (GW_QUEUE_SIZE - 1)
+#define GW_RESPONSE_MASK (GW_RESPONSE_BUFFER - 1)
+
+#if (DALI_LINES > 1)
+ #define GW_LINE_ARGS   GW_LINE,
+ #define GW_LINE_ARG    GW_LINE
+#else
+ #define GW_LINE_ARGS
+ #define GW_LINE_ARG
+#endif
+
+// Request states
+#define GW_IDLE         (0)
+#define GW_FIRST        (1)  // frame sent (first one of a send twice request)
+#define GW_SECOND       (2)  // second frame of a send twice request
+
+// Request queue, bytes as received, indexes run freely and are masked on access:
+// head is written only by the UART receive interrupt, tail only by gateway_process
+u8 GwQueue[GW_QUEUE_SIZE];
+volatile u8 GwQueueHead;
+volatile u8 GwQueueTail;
+volatile u8 GwOverrun;  // bytes dropped since the last GW_RSP_OVERRUN
+volatile u8 GwIdleMs;   // ms since the last received byte (up to GW_IDLE_MS)
+
+// Response buffer: head written by gateway_process, tail by the UART transmit interrupt
+u8 GwResponse[GW_RESPONSE_BUFFER];
+volatile u8 GwResponseHead;
+volatile u8 GwResponseTail;
+
+u8 GwRequest[GW_REQUEST_SIZE]; // request being executed
+u8 GwState;
+u8 GwTransaction;              // previous request opened a transaction
+
+static u8 gw_response_space(void);
+static void gw_respond(u8 status, u8 id, u8 answer);
+static u8 gw_start(void);
+
+// Setup UART for the gateway (8N1, both directions), fMASTER must not change afterwards
+// (set_DALI_clock may change CPU divider only)
+void init_DALI_gateway(void)
+{
+  u16 div;
+
+  div = (u16)((get_fmaster() + GW_BAUDRATE / 2) / GW_BAUDRATE);
+
+  GwQueueHead = 0;
+  GwQueueTail = 0;
+  GwOverrun = 0;
+  GwIdleMs = GW_IDLE_MS;
+  GwResponseHead = 0;
+  GwResponseTail = 0;
+  GwState = GW_IDLE;
+  GwTransaction = 0;
+
+  GW_UART->CR1 = 0;    // 8 data bits, no parity
+  GW_UART->CR3 = 0;    // 1 stop bit
+  GW_UART->BRR2 = (u8)(((div >> 8) & 0xF0) | (div & 0x0F)); // BRR2 must be written first
+  GW_UART->BRR1 = (u8)(div >> 4);
+  GW_UART->CR2 = GW_CR2_TEN | GW_CR2_REN | GW_CR2_RIEN; // TX interrupt enabled by gw_respond
+}
+
+// Returns free bytes of the response buffer
+static u8 gw_response_space(void)
+{
+  return (u8)(GW_RESPONSE_BUFFER - (u8)(GwResponseHead - GwResponseTail));
+}
+
+// Queues one response, the caller checked the space
+static void gw_respond(u8 status, u8 id, u8 answer)
+{
+  u8 head;
+
+  head = GwResponseHead;
+  GwResponse[head++ & GW_RESPONSE_MASK] = status;
+  GwResponse[head++ & GW_RESPONSE_MASK] = id;
+  GwResponse[head++ & GW_RESPONSE_MASK] = answer;
+  GwResponseHead = head;
+
+  GW_UART->CR2 |= GW_CR2_TIEN; // start or keep draining
+}
+
+// Hands the next queued request to the transmitter, returns 0 if there is none
+static u8 gw_start(void)
+{
+  u8 head;
+  u8 tail;
+  u8 priority;
+  u8 idle;
+  u8 sum;
+  u8 i;
+
+  for (;;)
+  {
+    idle = GwIdleMs; // read before the head: a byte received later is kept
+    head = GwQueueHead;
+    tail = GwQueueTail;
+    // resynchronise on the request byte (garbage, lost bytes)
+    while ((tail != head) && (GwQueue[tail & GW_QUEUE_MASK] != GW_REQUEST))
+      tail++;
+    if ((u8)(head - tail) < GW_REQUEST_SIZE)
+    {
+      if (idle >= GW_IDLE_MS)
+        tail = head; // incomplete and the host stopped sending: dropped
+      GwQueueTail = tail;
+      return 0;
+    }
+
+    sum = 0;
+    for (i = 0; i < GW_REQUEST_SIZE; i++)
+    {
+      GwRequest[i] = GwQueue[(u8)(tail + i) & GW_QUEUE_MASK];
+      sum += GwRequest[i];
+    }
+    if (sum)
+    { // GW_REQUEST inside a request or bytes lost: try from the next byte
+      GwQueueTail = (u8)(tail + 1);
+      continue;
+    }
+    GwQueueTail = tail;
+
+    if ((GwRequest[3] != DALI_FRAME_16) && (GwRequest[3] != DALI_FRAME_24) && (GwRequest[3] != DALI_FRAME_25))
+    {
+      if (gw_response_space() < GW_RESPONSE_SIZE)
+        return 1; // host does not read: keep the request
+      GwQueueTail = (u8)(tail + GW_REQUEST_SIZE);
+      gw_respond(GW_RSP_BAD, GwRequest[1], 0);
+      continue;
+    }
+
+    priority = (u8)(GwRequest[2] & GW_FLAG_PRIORITY);
+    if (!priority)
+      priority = GW_PRIORITY_DEFAULT;
+    if (GwTransaction)
+      priority = 1;
+    // the answer of a send twice request follows its second frame
+    if (!send_forward(GW_LINE_ARGS GwRequest[3], &GwRequest[4], priority,
+                      (u8)((GwRequest[2] & (GW_FLAG_QUERY | GW_FLAG_TWICE)) == GW_FLAG_QUERY)))
+      return 1; // line still busy with a frame of the application
+    GwQueueTail = (u8)(tail + GW_REQUEST_SIZE);
+    GwTransaction = (u8)(GwRequest[2] & GW_FLAG_TRANSACTION);
+    GwState = GW_FIRST;
+    return 1;
+  }
+}
+
+// Gateway main loop task: collects the outcome of the frame in progress and
+// starts the next request at once. Must be called at least each ms while the
+// gateway is busy (the next frame has to be loaded before the end of the
+// backward frame window plus the settling time, >= 4ms), returns 0 when idle
+u8 gateway_process(void)
+{
+  u8 status;
+
+  if (GwOverrun)
+  {
+    if (gw_response_space() < GW_RESPONSE_SIZE)
+      return 1;
+    sim(); // GwQueueHead is written by the receive interrupt
+    GwQueueTail = GwQueueHead;
+    GwOverrun = 0;
+    rim();
+    gw_respond(GW_RSP_OVERRUN, 0, 0);
+  }
+
+  if (GwState != GW_IDLE)
+  {
+    status = get_send_status(GW_LINE_ARG);
+    if ((status == DALI_TX_PENDING) || (status == DALI_TX_WAIT_ANSWER))
+      return 1;
+    if ((GwState == GW_FIRST) && (GwRequest[2] & GW_FLAG_TWICE) && (status == DALI_TX_DONE))
+    { // second frame of the same command, within 100ms
+      send_forward(GW_LINE_ARGS GwRequest[3], &GwRequest[4], 1, (u8)(GwRequest[2] & GW_FLAG_QUERY));
+      GwState = GW_SECOND;
+      return 1;
+    }
+    if (gw_response_space() < GW_RESPONSE_SIZE)
+      return 1; // host does not read: next request waits
+    gw_respond((u8)(GW_RESPONSE | status), GwRequest[1],
+               (u8)((status == DALI_TX_ANSWER) ? get_send_answer(GW_LINE_ARG) : 0));
+    GwState = GW_IDLE;
+  }
+
+  return gw_start();
+}
+
+// Line idle time of the request framing, called each ms
+void gateway_timer(void)
+{
+  sim(); // GwIdleMs is cleared by the receive interrupt
+  if (GwIdleMs < GW_IDLE_MS)
+    GwIdleMs++;
+  rim();
+}
+
+// Sends next response byte, called from UART TX interrupt (transmit data register empty)
+void gateway_tx_interrupt(void)
+{
+  if (GwResponseTail != GwResponseHead)
+  {
+    GW_UART->DR = GwResponse[GwResponseTail & GW_RESPONSE_MASK];
+    GwResponseTail++;
+    return;
+  }
+  GW_UART->CR2 &= ~GW_CR2_TIEN;
+}
+
+// Queues received request bytes, called from UART RX interrupt
+void gateway_rx_interrupt(void)
+{
+  u8 data;
+
+  data = GW_UART->SR; // SR then DR read clears RXNE and overrun
+  data = GW_UART->DR;
+
+  if (GwOverrun || ((u8)(GwQueueHead - GwQueueTail) >= GW_QUEUE_SIZE))
+  {
+    GwOverrun = 1; // dropped up to the flush by gateway_process
+    return;
+  }
+  GwQueue[GwQueueHead & GW_QUEUE_MASK] = data;
+  GwQueueHead++;
+  GwIdleMs = 0;
+}
+
+#endif /* DALI_GATEWAY */
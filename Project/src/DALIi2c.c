@@ -0,0 +1,276 @@
+/**
+  ******************************************************************************
+  * @file    dalii2c.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali co-processor register interface (I2C slave)
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALIi2c.h"
+#include "dali.h"
+
+#ifdef DALI_I2C_SLAVE
+
+#define I2CS_SNAPSHOT     (I2CS_REG_END - I2CS_REG_UNITS) // snapshot registers
+#define I2CS_STATS        (sizeof(TDALIStats) / sizeof(u32))
+#define I2CS_CLOCK_HZ     (400000)  // fast mode: fMASTER of 4MHz at least
+
+// Kind of the byte last loaded into the data register
+#define I2CS_LOAD_REG     (0)  // register, pointer incremented
+#define I2CS_LOAD_EVENT   (1)  // event queue byte
+#define I2CS_LOAD_FILL    (2)  // 0xFF after the queue or the map
+
+// Snapshot of the registers from I2CS_REG_UNITS on, double buffered:
+// i2c_slave_process writes the back one then makes it the front one, a read
+// transfer reads the front one of its start (I2cLocked) up to its end
+u8 I2cImage[2][I2CS_SNAPSHOT];
+volatile u8 I2cFront;
+volatile u8 I2cLocked;
+volatile u8 I2cActive;  // transfer addressed to the device, up to its end
+u8 I2cReady;            // snapshot written once
+
+// Transfer state, written by the I2C interrupt only
+u8 I2cPointer;          // register pointer
+u8 I2cFirst;            // write transfer: next byte is the pointer
+u8 I2cReading;          // read transfer in progress
+u8 I2cLoaded;           // kind of the byte in the data register (I2CS_LOAD_xxx)
+u8 I2cTaken;            // event queue bytes loaded by the read transfer
+
+u8 I2cRefreshAge;       // ms since the last snapshot
+
+static u8 i2cs_register(u8 reg);
+static void i2cs_load(void);
+static void i2cs_read_end(void);
+static void i2cs_snapshot(u8 *image);
+
+// Setup I2C slave (7 bit address I2CS_ADDRESS) and I2CS_IRQ pin, fMASTER must
+// not change afterwards (set_DALI_clock may change CPU divider only)
+void init_DALI_i2c(void)
+{
+  init_DALI_events();
+  I2cFront = 0;
+  I2cLocked = 0;
+  I2cActive = 0;
+  I2cReady = 0;
+  I2cPointer = I2CS_REG_ID;
+  I2cFirst = 0;
+  I2cReading = 0;
+  I2cRefreshAge = I2CS_REFRESH_MS; // first snapshot at once
+
+  I2CS_IRQ_PORT->ODR |= (1<<I2CS_IRQ_PIN);  //released
+  I2CS_IRQ_PORT->CR1 &= ~(1<<I2CS_IRQ_PIN); //open drain
+  I2CS_IRQ_PORT->CR2 &= ~(1<<I2CS_IRQ_PIN); //slow slope
+  I2CS_IRQ_PORT->DDR |= (1<<I2CS_IRQ_PIN);  //output mode
+
+  I2C_DeInit();
+  I2C_Init(I2CS_CLOCK_HZ, (u16)(I2CS_ADDRESS << 1), I2C_DUTYCYCLE_2, I2C_ACK_CURR, I2C_ADDMODE_7BIT,
+           (u8)(get_fmaster() / 1000000UL));
+  I2C->ITR = (u8)(I2C_ITR_ITBUFEN | I2C_ITR_ITEVTEN | I2C_ITR_ITERREN);
+}
+
+// Returns a register, the snapshot ones from the image locked by the transfer
+static u8 i2cs_register(u8 reg)
+{
+  switch (reg)
+  {
+    case I2CS_REG_ID:
+      return I2CS_ID;
+    case I2CS_REG_VERSION:
+      return I2CS_VERSION;
+    case I2CS_REG_STATUS:
+      return (u8)((event_count() ? I2CS_STATUS_EVENTS : 0) | (I2cReady ? I2CS_STATUS_READY : 0));
+    case I2CS_REG_COUNT:
+      return event_count();
+    default:
+      return I2cImage[I2cLocked][reg - I2CS_REG_UNITS];
+  }
+}
+
+// Loads the next byte of the read transfer into the data register
+static void i2cs_load(void)
+{
+  u8 data;
+
+  if (I2cPointer == I2CS_REG_EVENTS)
+  {
+    // whole queue bytes first, then fill: the queue may grow during the burst
+    if ((I2cLoaded != I2CS_LOAD_FILL) && (I2cTaken < event_count()))
+    {
+      data = event_peek(I2cTaken++);
+      I2cLoaded = I2CS_LOAD_EVENT;
+    }
+    else
+    {
+      data = 0xFF;
+      I2cLoaded = I2CS_LOAD_FILL;
+    }
+  }
+  else if (I2cPointer < I2CS_REG_END)
+  {
+    data = i2cs_register(I2cPointer++);
+    I2cLoaded = I2CS_LOAD_REG;
+  }
+  else
+  {
+    data = 0xFF;
+    I2cLoaded = I2CS_LOAD_FILL;
+  }
+  I2C->DR = data;
+}
+
+// End of a read transfer: the master did not take the byte loaded last
+// (loaded while the previous one was shifted out), the pointer and the
+// event queue continue from it
+static void i2cs_read_end(void)
+{
+  if (I2cLoaded == I2CS_LOAD_REG)
+    I2cPointer--;
+  else if (I2cLoaded == I2CS_LOAD_EVENT)
+    I2cTaken--;
+  event_drop(I2cTaken);
+  I2cReading = 0;
+}
+
+// Slave transfer events, called from I2C interrupt
+void i2c_slave_interrupt(void)
+{
+  u8 sr1;
+  u8 sr2;
+  u8 data;
+
+  sr2 = I2C->SR2;
+  if (sr2 & (I2C_SR2_AF | I2C_SR2_BERR | I2C_SR2_ARLO | I2C_SR2_OVR))
+  {
+    I2C->SR2 = 0;
+    // acknowledge failure: master ends the read with a NACK; the cell
+    // releases the bus at once and no STOPF follows, the transfer is over
+    if (I2cReading)
+    {
+      i2cs_read_end();
+      I2cActive = 0;
+    }
+    if (sr2 & I2C_SR2_BERR)
+      I2cActive = 0; // misplaced start or stop: transfer aborted
+  }
+
+  sr1 = I2C->SR1;
+  if (sr1 & I2C_SR1_ADDR)
+  {
+    I2cActive = 1;
+    if (I2C->SR3 & I2C_SR3_TRA) // SR1 then SR3 read: ADDR cleared
+    {
+      if (I2cReading)
+        i2cs_read_end(); // repeated start without NACK
+      I2cLocked = I2cFront;
+      I2cReading = 1;
+      I2cTaken = 0;
+      I2cLoaded = I2CS_LOAD_REG;
+      i2cs_load(); // overwrites a byte left from the previous read
+    }
+    else
+      I2cFirst = 1;
+    return;
+  }
+  if (sr1 & I2C_SR1_RXNE)
+  {
+    data = I2C->DR;
+    if (I2cFirst)
+    {
+      I2cPointer = data;
+      I2cFirst = 0;
+    }
+    // further bytes ignored: registers are read only
+  }
+  if ((sr1 & I2C_SR1_TXE) && I2cReading)
+    i2cs_load();
+  if (sr1 & I2C_SR1_STOPF)
+  {
+    I2C->CR2 |= I2C_CR2_ACK; // SR1 read then CR2 write: STOPF cleared
+    if (I2cReading)
+      i2cs_read_end();
+    I2cActive = 0;
+  }
+}
+
+// Writes a complete snapshot
+static void i2cs_snapshot(u8 *image)
+{
+  u8 i;
+  u8 unit;
+  u16 level;
+  u32 value;
+
+  image[I2CS_REG_UNITS - I2CS_REG_UNITS] = DALI_INSTANCES;
+  image[I2CS_REG_LINES - I2CS_REG_UNITS] = DALI_LINES;
+  for (i = 0; i < PWM_CHANNELS_MAX; i++)
+  {
+    level = (u16)((i < PWM_CHANNELS) ? get_PWM(i) : 0);
+    image[I2CS_REG_LEVEL - I2CS_REG_UNITS + 2 * i] = (u8)(level >> 8);
+    image[I2CS_REG_LEVEL - I2CS_REG_UNITS + 2 * i + 1] = (u8)level;
+  }
+  for (i = 0; i < I2CS_STATS; i++)
+  {
+    sim(); // counters are written by the DALI interrupts
+    value = ((u32 *)&DALIStats)[i];
+    rim();
+    image[I2CS_REG_STATS - I2CS_REG_UNITS + 4 * i] = (u8)(value >> 24);
+    image[I2CS_REG_STATS - I2CS_REG_UNITS + 4 * i + 1] = (u8)(value >> 16);
+    image[I2CS_REG_STATS - I2CS_REG_UNITS + 4 * i + 2] = (u8)(value >> 8);
+    image[I2CS_REG_STATS - I2CS_REG_UNITS + 4 * i + 3] = (u8)value;
+  }
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+    for (i = 0; i < DALI_NUMBER_REGS; i++)
+      image[I2CS_REG_UNIT(unit) - I2CS_REG_UNITS + i] = DALI_Read_Register(
+#if (DALI_INSTANCES > 1)
+                                                                           unit,
+#endif
+                                                                           i);
+}
+
+// Co-processor main loop task: drives I2CS_IRQ, refreshes the snapshot each
+// I2CS_REFRESH_MS - returns 0 when no transfer is running
+u8 i2c_slave_process(void)
+{
+  u8 back;
+
+  if (event_count())
+    I2CS_IRQ_PORT->ODR &= ~(1<<I2CS_IRQ_PIN);
+  else
+    I2CS_IRQ_PORT->ODR |= (1<<I2CS_IRQ_PIN);
+
+  if (I2cRefreshAge >= I2CS_REFRESH_MS)
+  {
+    // a transfer started after this test locks the front image, never the back one
+    back = (u8)(I2cFront ^ 1);
+    if (!(I2cActive && (I2cLocked == back)))
+    {
+      i2cs_snapshot(I2cImage[back]);
+      I2cFront = back;
+      I2cReady = 1;
+      I2cRefreshAge = 0;
+    }
+  }
+
+  return I2cActive;
+}
+
+// Ages the snapshot, call each ms
+void i2c_slave_timer(void)
+{
+  if (I2cRefreshAge < I2CS_REFRESH_MS)
+    I2cRefreshAge++;
+}
+
+#endif /* DALI_I2C_SLAVE */
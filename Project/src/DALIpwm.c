@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+  * @file    dalipwm.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   PWM light outputs of the DALI control gear units
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALIpwm.h"
+
+// Register bits with the same coding on TIM1, TIM2 and TIM3
+#define PWM_MODE1  (0x60)  // CCMR: OCxM = 110
+#define PWM_OCPE   (0x08)  // CCMR: compare value preload, loaded at update event
+#define PWM_CEN    (0x01)  // CR1: counter enable
+#define PWM_UDIS   (0x02)  // CR1: update event disabled (preload is not loaded)
+#define PWM_ARPE   (0x80)  // CR1: auto-reload preload
+#define PWM_UIE    (0x01)  // IER: update interrupt enable
+#define PWM_UIF    (0x01)  // SR1: update interrupt flag
+
+#define PWM_FRAC_MASK  ((u8)((1 << (16 - PWM_DITHER_BITS)) - 1)) // level bits below timer resolution
+
+// Output channel: registers of its timer and compare unit, registers are
+// accessed bytewise so one table serves TIM1, TIM2 and TIM3
+typedef struct
+{
+  u8 timer;              // timer number (1..3) for dither_PWM
+  volatile u8 *cr1;      // timer control register 1 (CEN = bit 0)
+  volatile u8 *ier;      // interrupt enable register
+  volatile u8 *sr1;      // status register 1
+  volatile u8 *arrh;     // auto-reload = period - 1, high byte first
+  volatile u8 *arrl;
+  volatile u8 *cntrh;    // counter, high byte first
+  volatile u8 *cntrl;
+  volatile u8 *ccmr;     // compare mode register of the channel
+  volatile u8 *ccer;     // compare enable register of the channel
+  u8 ccer_bits;          // output enable and polarity bits in ccer
+  volatile u8 *ccrh;     // compare value = duty cycle, high byte first
+  volatile u8 *ccrl;
+  GPIO_TypeDef *port;
+  u8 pin;
+} TPWMChannel;
+
+static const TPWMChannel PWMChannels[PWM_CHANNELS_MAX] =
+{
+  {3, &TIM3->CR1, &TIM3->IER, &TIM3->SR1, &TIM3->ARRH, &TIM3->ARRL, &TIM3->CNTRH, &TIM3->CNTRL, &TIM3->CCMR2, &TIM3->CCER1,
+   TIM3_CCER1_CC2E | TIM3_CCER1_CC2P, &TIM3->CCR2H, &TIM3->CCR2L, GPIOD, 0},
+  {2, &TIM2->CR1, &TIM2->IER, &TIM2->SR1, &TIM2->ARRH, &TIM2->ARRL, &TIM2->CNTRH, &TIM2->CNTRL, &TIM2->CCMR1, &TIM2->CCER1,
+   TIM2_CCER1_CC1E, &TIM2->CCR1H, &TIM2->CCR1L, GPIOD, 4},
+  {1, &TIM1->CR1, &TIM1->IER, &TIM1->SR1, &TIM1->ARRH, &TIM1->ARRL, &TIM1->CNTRH, &TIM1->CNTRL, &TIM1->CCMR1, &TIM1->CCER1,
+   TIM1_CCER1_CC1E, &TIM1->CCR1H, &TIM1->CCR1L, GPIOC, 1},
+  {2, &TIM2->CR1, &TIM2->IER, &TIM2->SR1, &TIM2->ARRH, &TIM2->ARRL, &TIM2->CNTRH, &TIM2->CNTRL, &TIM2->CCMR2, &TIM2->CCER1,
+   TIM2_CCER1_CC2E, &TIM2->CCR2H, &TIM2->CCR2L, GPIOD, 3}
+};
+
+u16 PWMLevel[PWM_CHANNELS];    // light level set by the units
+u8 PWMChanged;                 // bit n: level of channel n not yet written
+#ifdef PWM_DITHER
+u16 PWMActive[PWM_CHANNELS];   // committed levels, read by the update interrupts
+u8 PWMError[PWM_CHANNELS];     // sigma-delta accumulators (fraction carried to next period)
+#endif /* PWM_DITHER */
+
+// Configures the outputs of all units, timers run from then on (light off)
+void init_PWM(void)
+{
+  u8 ch;
+  const TPWMChannel *pwm;
+#ifdef PWM_PHASE_STAGGER
+  u16 start;
+#endif
+
+  TIM1->BKR |= TIM1_BKR_MOE;  // TIM1 outputs need main output enable
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+  {
+    pwm = &PWMChannels[ch];
+    pwm->port->DDR |= 1<<pwm->pin; // output mode
+    pwm->port->CR1 |= 1<<pwm->pin; // push-pull
+    *pwm->ccrh = 0;                // light off
+    *pwm->ccrl = 0;
+    *pwm->ccmr = PWM_MODE1 | PWM_OCPE;
+    *pwm->ccer |= pwm->ccer_bits;
+    *pwm->arrh = (u8)((PWM_PERIOD - 1) >> 8);
+    *pwm->arrl = (u8)(PWM_PERIOD - 1);
+#ifdef PWM_DITHER
+    PWMActive[ch] = 0;
+    PWMError[ch] = 0;
+    *pwm->ier |= PWM_UIE;          // modulator runs at each update event
+#endif /* PWM_DITHER */
+#ifdef PWM_PHASE_STAGGER
+    if (!(*pwm->cr1 & PWM_CEN))    // first channel of this timer sets its phase
+    {
+      start = (u16)(((u32)ch * PWM_PERIOD) / PWM_CHANNELS);
+      *pwm->cntrh = (u8)(start >> 8);
+      *pwm->cntrl = (u8)start;
+    }
+#endif /* PWM_PHASE_STAGGER */
+    *pwm->cr1 |= PWM_ARPE | PWM_CEN;           // enable PWM counter
+    PWMLevel[ch] = 0;
+  }
+  PWMChanged = 0;
+}
+
+// Stores new light level of one channel, written to the timer by update_PWM
+void set_PWM(u8 channel, u16 level)
+{
+  PWMLevel[channel] = level;
+  PWMChanged |= (u8)(1 << channel);
+}
+
+// Returns the level last set on the channel (committed or pending)
+u16 get_PWM(u8 channel)
+{
+  return PWMLevel[channel];
+}
+
+// Commits all changed levels, called after the DALI stack has run all units.
+// Levels go to the compare preload registers with the update event disabled,
+// the timers load them together at their next update event: a command
+// addressed to several units (broadcast) changes their outputs in the same
+// PWM period, a running period is never cut (no glitch from a half written
+// compare value). Minimal path: only compare registers are written.
+void update_PWM(void)
+{
+  u8 ch;
+
+  if (!PWMChanged)
+    return;
+#ifdef PWM_DITHER
+  // levels are written by the modulators, hand all changes to them at once
+  sim();
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+    PWMActive[ch] = PWMLevel[ch];
+  rim();
+#else
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+    *PWMChannels[ch].cr1 |= PWM_UDIS;
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+  {
+    if (PWMChanged & (u8)(1 << ch))
+    {
+      *PWMChannels[ch].ccrh = (u8)(PWMLevel[ch] >> 8); // high byte first
+      *PWMChannels[ch].ccrl = (u8)PWMLevel[ch];
+    }
+  }
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+    *PWMChannels[ch].cr1 &= (u8)~PWM_UDIS;
+#endif /* PWM_DITHER */
+  PWMChanged = 0;
+}
+
+// Returns 1 if some channel is on (PWM needs the timers running, no halt)
+u8 PWM_lit(void)
+{
+  u8 ch;
+
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+    if (PWMLevel[ch])
+      return 1;
+  return 0;
+}
+
+// Returns 1 if the timer of the channel runs (0 = hardware error)
+u8 PWM_running(u8 channel)
+{
+  return (u8)(*PWMChannels[channel].cr1 & PWM_CEN);
+}
+
+// Returns 1 if the timers of all channels of the unit run
+u8 PWM_unit_running(u8 unit)
+{
+  u8 ch;
+
+  for (ch = (u8)(unit * PWM_UNIT_CHANNELS); ch < (u8)((unit + 1) * PWM_UNIT_CHANNELS); ch++)
+    if (!PWM_running(ch))
+      return 0;
+  return 1;
+}
+
+#ifdef PWM_DITHER
+// Sigma-delta modulator of the channels of one timer, called from its update
+// interrupt: compare value of the next period is the level scaled to the
+// timer resolution, plus one count each time the accumulated fraction
+// overflows. Compare preload loads it at the next update event.
+void dither_PWM(u8 timer)
+{
+  u8 ch;
+  u8 acc;
+  u16 duty;
+  const TPWMChannel *pwm;
+
+  for (ch = 0; ch < PWM_CHANNELS; ch++)
+  {
+    pwm = &PWMChannels[ch];
+    if (pwm->timer != timer)
+      continue;
+    *pwm->sr1 &= (u8)~PWM_UIF;
+    duty = PWMActive[ch] >> (16 - PWM_DITHER_BITS);
+    acc = (u8)(PWMError[ch] + ((u8)PWMActive[ch] & PWM_FRAC_MASK));
+    if (acc > PWM_FRAC_MASK)
+    {
+      acc -= PWM_FRAC_MASK + 1;
+      duty++;               // full level gives PWM_PERIOD = always on
+    }
+    PWMError[ch] = acc;
+    *pwm->ccrh = (u8)(duty >> 8);
+    *pwm->ccrl = (u8)duty;
+  }
+}
+#endif /* PWM_DITHER */
@@ -19,75 +19,142 @@
   */
 
 #include "DALIslave.h"
+#include "DALItrace.h"
+#include "DALIevents.h"
 #include "stm8s_it.h"
 
-// Communication ports and pins
-GPIO_TypeDef* DALIOUT_port = GPIOD; //default
-u8 DALIOUT_pin = 1<<5; // default pin D5
-u8 DALIOUT_invert = 0;
-
-GPIO_TypeDef* DALIIN_port = GPIOD; //default
-u8 DALIIN_pin = 1<<6; // default pin D6
-u8 DALIIN_invert = 0;
+#if DALI_LATENCY_WORST_US > DALI_LATENCY_BUDGET_US
+ #error "DALI tick latency budget exceeded: raise DALI_MIN_FCPU_HZ or shorten atomic sections"
+#endif
 
 //callback function
-void DataReceived(u8 address, u8 dataByte);
-TDataReceivedCallback *DataReceivedCallback = DataReceived;
-
 void RTC1msFnc(void);
 TRTC_1ms_Callback * RTC_1ms_Callback = RTC1msFnc;
 
-void ErrorFnc(u8 code);
-TErrorCallback *ErrorCallback = ErrorFnc;
+// Lines: communication ports and pins, decoder and encoder state, callbacks (set by init_DALI)
+TDALILine DALILines[DALI_LINES];
+
+// Line being processed: DALI_LINE_SELECT (last declaration of functions having
+// the line parameter) points ln to it, with one line DALI_LN is the constant
+// address of DALILines[0] (direct addressing, as the former globals)
+#if (DALI_LINES > 1)
+ #define DALI_LINE_SELECT  TDALILine *ln = &DALILines[line]
+ #define DALI_LN           ln
+#else
+ #define DALI_LINE_SELECT
+ #define DALI_LN           (&DALILines[0])
+#endif
+
+// State change of the line, in the bus trace
+#define DALI_SET_FLAG(f)  { DALI_LN->flag = (f); DALI_TRACE_STATE(DALI_LINE_INDEX, (f)); }
+
+// Timebase variables
+TTimebase TimebaseRun;              // clock and TIM4 setting while a frame is received or sent
+TTimebase TimebaseIdle;             // clock and TIM4 setting between frames
+TTimebase *Timebase = &TimebaseRun; // active setting
+u16 PhaseAccumulator;               // sum of fractional tick periods
+
+// Tick entry latency in TIM4 counts after the update event, sampled during frames
+u8 TickLatencyMin = 0xFF;
+u8 TickLatencyMax = 0;
 
-// Data variables
-u8 answer;    // data to send to controller device
-u8 address;   // address byte from controller device
-u8 dataByte;  // data byte from controller device
+// Longest TIM4 interrupt (from update event to the end of handler) in TIM4 counts
+u8 TickDurationMaxRun;
+u8 TickDurationMaxIdle;
 
-// Processing variables
-u8 flag;        // status flag
-u8 bit_count;   // nr of rec/send bits
-u16 tick_count; // nr of ticks of the timer
-u16 InterfaceFailureCounter; //nr of ticks when interface voltage is low
+TDALIStats DALIStats;
 
-bool bit_value;   // value of actual bit
-bool actual_val;  // bit value in this tick of timer
-bool former_val;  // bit value in previous tick of timer
+// TIM4 ticks since the timer start (first init_DALI), saturated at 0xFFFF (6.8s):
+// time base of the boot latency report
+volatile u16 BootTicks;
+
+static void timebase_select(TTimebase *tb);
+static void timebase_load(void);
+static void timebase_idle(void);
+static bool get_DALIIN(DALI_LINE_PARAM);
+static void receive_done(DALI_LINE_PARAM);
+static void transmit_idle(DALI_LINE_PARAM);
+static void transmit_tick(DALI_LINE_PARAM);
+static void transmit_end(DALI_LINE_PARAM);
+static void transmit_backoff(DALI_LINE_PARAM);
+
+#define RX_STOP  (0xFF) // bit_count while the stop bits are received
+
+#if (DALI_LINES > 1)
+static u8 lines_idle(void);
+#else
+ #define lines_idle() (DALILines[0].flag == NO_ACTION)
+#endif
 
 
 /***********************************************************/
 /*************** R E C E I V E * P R O C E D U R E S *******/
 /***********************************************************/
 
-// edge of start bit detected
-void receive_data() {
+// external interrupt of port: start bit edge on the line(s) connected to it
+void receive_edge(GPIO_TypeDef *port)
+{
+#if (DALI_LINES > 1)
+  u8 line;
+
+  // below the tick (DALI_EXTI_PRIORITY), the tick may preempt at any point:
+  // no shared register or state written here, the tick starts receiving
+  for (line = 0; line < DALI_LINES; line++)
+  {
+    // lines may share the port interrupt: take the idle line(s) (EXTI enabled) with pin low
+    if ((DALILines[line].in_port == port) && (port->CR2 & DALILines[line].in_pin)
+        && !(port->IDR & DALILines[line].in_pin) && !DALILines[line].start_pending)
+    {
+      DALILines[line].StartEdgePhase = TIM4->CNTR;
+      DALILines[line].start_pending = 1;
+    }
+  }
+#else
+  if (DALILines[0].in_port == port)
+    receive_data();
+#endif
+}
+
+// edge of start bit detected (with DALI_LINES > 1: at the tick after it)
+void receive_data(DALI_LINE_PARAM) {
+  DALI_LINE_SELECT;
 
   // null variables
-  address = 0;
-  dataByte = 0;
-  bit_count = 0;
-  tick_count = 0;
-  former_val = TRUE;
+  DALI_LN->frame[0] = 0;
+  DALI_LN->frame[1] = 0;
+  DALI_LN->frame[2] = 0;
+  DALI_LN->frame[3] = 0;
+  DALI_LN->bit_count = 0;
+  DALI_LN->tick_count = 0;
+  DALI_LN->former_val = TRUE;
+
+#if (DALI_LINES == 1)
+  DALI_LN->StartEdgePhase = TIM4->CNTR;
+#endif
+  DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_START, DALI_LINE_INDEX), 0, 0);
 
   // setup flag
-  flag = RECEIVING_DATA;
+  DALI_SET_FLAG(RECEIVING_DATA);
   // disable external interrupt on DALI in port
-  DALIIN_port->CR2 &= ~DALIIN_pin;
+  DALI_LN->in_port->CR2 &= ~DALI_LN->in_pin;
+  // full speed for decoding
+  timebase_select(&TimebaseRun);
 }
 
 // gets state of the DALIIN pin
-bool get_DALIIN(void) {
-  if (DALIIN_invert)
+static bool get_DALIIN(DALI_LINE_PARAM) {
+  DALI_LINE_SELECT;
+
+  if (DALI_LN->in_invert)
   {
-    if(DALIIN_port->IDR & DALIIN_pin)
+    if(DALI_LN->in_port->IDR & DALI_LN->in_pin)
       return FALSE;
     else
       return TRUE;
   }
   else
   {
-    if(DALIIN_port->IDR & DALIIN_pin)
+    if(DALI_LN->in_port->IDR & DALI_LN->in_pin)
       return TRUE;
     else
       return FALSE;
@@ -95,129 +162,399 @@ bool get_DALIIN(void) {
 }
 
 // Routine for receiving data for slave device
-void receive_tick() {
+// bit_count: 0 start bit, n = data bit n being received (1..DALI_FRAME_25),
+// RX_STOP stop bits. Frame length is not known in advance: no mid-bit edge
+// 10 ticks after the last one ends the data bits, the frame is accepted if
+// its length is a DALI_FRAME_xx size and the line stays high for the stop
+// bits (18 ticks after the last mid-bit edge, as for 16 bit frames before).
+void receive_tick(DALI_LINE_PARAM) {
+  bool actual_val;  // bit value in this tick of timer
+  u8 n;
+  DALI_LINE_SELECT;
 
   // Because of the structure of current amplifier, input has
   // to be negated
-  actual_val = get_DALIIN();
-  tick_count++;
+  actual_val = get_DALIIN(DALI_LINE_ARG);
+  DALI_LN->tick_count++;
 
   // edge detected
-  if(actual_val != former_val)
+  if(actual_val != DALI_LN->former_val)
   {
-    switch(bit_count) {
+    switch(DALI_LN->bit_count) {
       case 0:
-        if (tick_count > 2)
+        if (DALI_LN->tick_count > 2)
         {
-          tick_count = 0;
-          bit_count  = 1; // start bit
+          DALI_LN->tick_count = 0;
+          DALI_LN->bit_count  = 1; // start bit
         }
       break;
-      case 17:      // 1st stop bit
-        if(tick_count > 6) // stop bit error, no edge should exist
-          flag = ERR;
-      break;
-      case 18:      // 2nd stop bit
-        flag = ERR; // stop bit error, no edge should exist
+      case RX_STOP: // stop bits, no edge should exist
+        DALI_SET_FLAG(ERR);
+        DALIStats.err_stop++;
+        DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_ERROR, DALI_LINE_INDEX), TRACE_ERR_STOP, 0);
       break;
-      default:      // other bits
-        if(tick_count > 6)
+      default:      // data bits, edges up to 6 ticks are bit boundaries
+        if(DALI_LN->tick_count > 6)
         {
-          if(bit_count < 9) // store bit in address byte
-          {
-            address |= (actual_val << (8-bit_count));
-          }else             // store bit in data byte
+          n = (u8)(DALI_LN->bit_count - 1);
+          if (n >= DALI_FRAME_25) // longer than any frame: stop bit expected
           {
-            dataByte |= (actual_val << (16-bit_count));
+            DALI_SET_FLAG(ERR);
+            DALIStats.err_stop++;
+            DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_ERROR, DALI_LINE_INDEX), TRACE_ERR_STOP, 0);
+            break;
           }
-          bit_count++;
-          tick_count = 0;
+          if (actual_val)
+            DALI_LN->frame[n >> 3] |= (u8)(0x80 >> (n & 0x07));
+          DALI_LN->bit_count++;
+          DALI_LN->tick_count = 0;
         }
       break;
     }
   }else // voltage level stable
   {
-    switch(bit_count)
+    switch(DALI_LN->bit_count)
     {
       case 0:
-        if(tick_count==8)  // too long start bit
-            flag = ERR;
-      break;
-      case 17:
-        // First stop bit
-        if (tick_count==8)
+        if(DALI_LN->tick_count==8)  // too long start bit
         {
-          if (actual_val==0) // wrong level of stop bit
-          {
-            flag = ERR;
-          }
-          else
-          {
-            bit_count++;
-            tick_count = 0;
-          }
+            DALI_SET_FLAG(ERR);
+            DALIStats.err_start++;
+            DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_ERROR, DALI_LINE_INDEX), TRACE_ERR_START, 0);
         }
       break;
-      case 18:
-        // Second stop bit
-        if (tick_count==10)
+      case RX_STOP:
+        // end of second stop bit
+        if (DALI_LN->tick_count==18)
         {
-          flag = NO_ACTION;
-          DALIIN_port->CR2 |= DALIIN_pin;//enable EXTI
+          DALI_SET_FLAG(NO_ACTION);
+          DALI_LN->in_port->CR2 |= DALI_LN->in_pin;//enable EXTI
           //TIM4->CR1 &= ~TIM4_CR1_CEN;
-          DataReceivedCallback(address,dataByte);
+          timebase_idle();
+          receive_done(DALI_LINE_ARG);
         }
       break;
-      default: // normal bits
-        if(tick_count==10)
-        { // too long delay before edge
-            flag = ERR;
+      default: // data bits
+        if(DALI_LN->tick_count==10)
+        { // no edge: end of the data bits or too long delay before edge
+          n = (u8)(DALI_LN->bit_count - 1);
+          if ((n != DALI_FRAME_16) && (n != DALI_FRAME_24) && (n != DALI_FRAME_25) && (n != DALI_FRAME_8))
+          {
+            DALI_SET_FLAG(ERR);
+            DALIStats.err_edge++;
+            DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_ERROR, DALI_LINE_INDEX), TRACE_ERR_EDGE, 0);
+          }
+          else if (actual_val==0) // wrong level of stop bit
+          {
+            DALI_SET_FLAG(ERR);
+            DALIStats.err_stop++;
+            DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_ERROR, DALI_LINE_INDEX), TRACE_ERR_STOP, 0);
+          }
+          else
+          {
+            DALI_LN->frame_bits = n;
+            DALI_LN->bit_count = RX_STOP; // tick_count goes on from the last mid-bit edge
+          }
         }
       break;
     }
   }
-  former_val = actual_val;
+  DALI_LN->former_val = actual_val;
 
-  if(flag==ERR)
+  if(DALI_LN->flag==ERR)
   {
-    flag = NO_ACTION;
-    DALIIN_port->CR2 |= DALIIN_pin;//enable EXTI
+    if (DALI_LN->tx_status == DALI_TX_WAIT_ANSWER)
+      DALI_LN->tx_status = DALI_TX_ANSWER_INVALID;
+    DALI_SET_FLAG(NO_ACTION);
+    DALI_LN->in_port->CR2 |= DALI_LN->in_pin;//enable EXTI
     //TIM4->CR1 &= ~TIM4_CR1_CEN;
+    timebase_idle();
   }
   return;
 }
 
+// Counts, traces and hands the received frame to the stack
+static void receive_done(DALI_LINE_PARAM)
+{
+  DALI_LINE_SELECT;
+
+  DALIStats.frames++;
+  DALI_LN->idle_ticks = 2; // frame end is detected 2 ticks before the end of its stop bits
+  if (DALI_LN->tx_status == DALI_TX_WAIT_ANSWER)
+  { // first frame after an own query
+    if (DALI_LN->frame_bits == DALI_FRAME_8)
+    {
+      DALI_LN->tx_answer = DALI_LN->frame[0];
+      DALI_LN->tx_status = DALI_TX_ANSWER;
+    }
+    else
+      DALI_LN->tx_status = DALI_TX_ANSWER_INVALID;
+  }
+#if defined (DALI_TRACE) || defined (DALI_EVENTS)
+  if (DALI_LN->frame_bits == DALI_FRAME_16)
+    DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_FRAME_RX, DALI_LINE_INDEX), DALI_LN->frame[0], DALI_LN->frame[1]);
+  else
+    DALI_TRACE_FRAME(TRACE_ON_LINE(TRACE_FRAME_RXL, DALI_LINE_INDEX), DALI_LN->frame_bits, DALI_LN->frame);
+#endif /* DALI_TRACE || DALI_EVENTS */
+  DALI_LN->DataReceivedCallback(DALI_LINE_ARGS DALI_LN->frame_bits, DALI_LN->frame);
+}
+
+// Hands a frame to the stack as if it was received from the bus (trace replay)
+// returns 0 if a frame is being received or sent - try again later
+u8 inject_frame(DALI_LINE_PARAMS u8 bits, u8 *frame)
+{
+  u8 i;
+  DALI_LINE_SELECT;
+
+  if (DALI_LN->flag != NO_ACTION)
+    return 0;
+  for (i = 0; i < DALI_FRAME_BYTES; i++)
+    DALI_LN->frame[i] = frame[i];
+  DALI_LN->frame_bits = bits;
+  receive_done(DALI_LINE_ARG);
+  return 1;
+}
+
+/***********************************************************/
+/*************** T I M E B A S E * P R O C E D U R E S *****/
+/***********************************************************/
+
+// Returns fMASTER for the clock divider ckdivr (CPU prescaller CPUDIV has no effect on it)
+static u32 fmaster_calc(u8 ckdivr)
+{
+  if (CLK->CMSR == CLK_SOURCE_HSI)
+    return HSI_VALUE >> ((ckdivr & CLK_CKDIVR_HSIDIV) >> 3);
+  else if (CLK->CMSR == CLK_SOURCE_LSI)
+    return LSI_VALUE;
+  else
+    return HSE_VALUE;
+}
+
+// Returns current fMASTER frequency (peripheral clock) in Hz
+u32 get_fmaster(void)
+{
+  return fmaster_calc(CLK->CKDIVR);
+}
+
+// Computes TIM4 setting giving TICKS_PER_SECOND for the master clock selected by ckdivr
+static void timebase_calc(TTimebase *tb, u8 ckdivr)
+{
+  u32 fmaster;
+  u32 ftim;
+  u8 psc;
+
+  // TIM4 runs from fMASTER
+  fmaster = fmaster_calc(ckdivr);
+
+  // smallest prescaller which keeps the period in 8 bits = best resolution
+  psc = 0;
+  while ((psc < TIM4_MAX_PRESCALLER) && ((fmaster >> psc) >= (u32)TICKS_PER_SECOND * TIM4_MAX_PERIOD))
+    psc++;
+  ftim = fmaster >> psc;
+
+  tb->ckdivr = ckdivr;
+  tb->prescaller = psc;
+  tb->period_int = (u8)(ftim / TICKS_PER_SECOND);
+  tb->period_frac = (u16)(((ftim % TICKS_PER_SECOND) << 16) / TICKS_PER_SECOND);
+}
+
+// Loads active timebase into clock controller and TIM4
+static void timebase_load(void)
+{
+  CLK->CKDIVR = Timebase->ckdivr;
+  TIM4->PSCR  = Timebase->prescaller;
+  TIM4->ARR   = Timebase->period_int - 1;
+  TIM4->EGR   = TIM4_EGR_UG; // load prescaller now (URS is set: no interrupt)
+  PhaseAccumulator = 0;
+}
+
+// Switches between run and idle clock: both have the same HSIDIV (set_DALI_clock),
+// only the CPU divider changes - fMASTER, TIM4 and the other peripherals keep their timing
+static void timebase_select(TTimebase *tb)
+{
+  if (tb == Timebase)
+    return;
+  Timebase = tb;
+  CLK->CKDIVR = tb->ckdivr;
+}
+
+// Returns to the idle clock when no line needs the run clock any more
+// (flag of the calling line is already NO_ACTION)
+static void timebase_idle(void)
+{
+  if (lines_idle())
+    timebase_select(&TimebaseIdle);
+}
+
+#if (DALI_LINES > 1)
+// Returns 1 if no frame is received or sent on any line (nor about to start)
+static u8 lines_idle(void)
+{
+  u8 line;
+
+  for (line = 0; line < DALI_LINES; line++)
+    if ((DALILines[line].flag != NO_ACTION) || DALILines[line].start_pending)
+      return 0;
+  return 1;
+}
+#endif /* DALI_LINES > 1 */
+
+// Called at each TIM4 update: next period is one count longer when fractions overflow
+void timebase_tick(void)
+{
+  u16 acc;
+
+  acc = PhaseAccumulator + Timebase->period_frac;
+  if (acc < PhaseAccumulator)
+    TIM4->ARR = Timebase->period_int;
+  else
+    TIM4->ARR = Timebase->period_int - 1;
+  PhaseAccumulator = acc;
+  if (BootTicks != 0xFFFF)
+    BootTicks++;
+}
+
+// Records tick entry latency, must be called first in the TIM4 interrupt
+// (call overhead is constant, jitter = max - min is not affected by it)
+void tick_latency_sample(void)
+{
+  u8 cnt;
+
+  if (lines_idle())
+    return;
+  cnt = TIM4->CNTR;
+  if (cnt > TickLatencyMax)
+    TickLatencyMax = cnt;
+  if (cnt < TickLatencyMin)
+    TickLatencyMin = cnt;
+}
+
+// Records TIM4 interrupt duration, must be called last in the TIM4 interrupt
+// An interrupt longer than the tick period would read the counter after it
+// wrapped (too short a duration): the update flag set again tells it, the
+// duration is recorded as 0xFF counts, more than any period (tick lost)
+void tick_duration_sample(void)
+{
+  u8 cnt;
+
+  cnt = TIM4->CNTR;
+  if (TIM4->SR1 & TIM4_SR1_UIF)
+    cnt = 0xFF;
+  if (Timebase == &TimebaseRun)
+  {
+    if (cnt > TickDurationMaxRun)
+      TickDurationMaxRun = cnt;
+  }
+  else if (cnt > TickDurationMaxIdle)
+    TickDurationMaxIdle = cnt;
+}
+
+// Returns longest TIM4 interrupt in microseconds (measured from the update event)
+u16 get_tick_duration_us(void)
+{
+  u16 run;
+  u16 idle;
+
+  run  = (u16)(((u32)TickDurationMaxRun  * 1000000UL) / ((u32)TICKS_PER_SECOND * TimebaseRun.period_int));
+  idle = (u16)(((u32)TickDurationMaxIdle * 1000000UL) / ((u32)TICKS_PER_SECOND * TimebaseIdle.period_int));
+  return (run > idle) ? run : idle;
+}
+
+// Returns TIM4 ticks since the timer start (saturated), not from interrupts
+u16 get_boot_ticks(void)
+{
+  u16 ticks;
+
+  sim();
+  ticks = BootTicks;
+  rim();
+  return ticks;
+}
+
+// Returns maximum tick entry jitter observed during frames in microseconds
+// one TIM4 count = 1s / (TICKS_PER_SECOND * run period)
+u16 get_tick_jitter_us(void)
+{
+  u8 jitter;
+
+  if (TickLatencyMin > TickLatencyMax) // no sample yet
+    return 0;
+  jitter = TickLatencyMax - TickLatencyMin;
+  return (u16)(((u32)jitter * 1000000UL) / ((u32)TICKS_PER_SECOND * TimebaseRun.period_int));
+}
+
+// Restarts jitter measurement
+void reset_tick_jitter(void)
+{
+  sim();
+  TickLatencyMin = 0xFF;
+  TickLatencyMax = 0;
+  rim();
+}
+
+// Sets clock divider (CLK->CKDIVR value) used during frames and between frames
+// returns 0 if a frame is in progress - nothing changed, try again later
+// fCPU of run_ckdivr must not be lower than DALI_MIN_FCPU_HZ (latency budget)
+// HSIDIV (fMASTER) is taken from run_ckdivr for both: between frames only the
+// CPU divider of idle_ckdivr is used, PWM, UART and TIM4 are not retimed
+u8 set_DALI_clock(u8 run_ckdivr, u8 idle_ckdivr)
+{
+  TTimebase run;
+  TTimebase idle;
+
+  // 32 bit divisions with interrupts enabled, only the copy is atomic
+  idle_ckdivr = (u8)((idle_ckdivr & CLK_CKDIVR_CPUDIV) | (run_ckdivr & CLK_CKDIVR_HSIDIV));
+  timebase_calc(&run, run_ckdivr);
+  timebase_calc(&idle, idle_ckdivr);
+  sim();
+  if (!lines_idle())
+  {
+    rim();
+    return 0;
+  }
+  TimebaseRun = run;
+  TimebaseIdle = idle;
+  Timebase = &TimebaseIdle;
+  timebase_load();
+  rim();
+  return 1;
+}
+
 /***********************************************************/
 /*************** C O M M O N * P R O C E D U R E S *********/
 /***********************************************************/
 
-// Setup DALIOUT port and pin
-void init_DALI(GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef* port_in, u8 pin_in, u8 invert_in,
+// Setup DALIOUT and DALIIN port and pin of a line, the first call starts the common TIM4 tick
+void init_DALI(DALI_LINE_PARAMS GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef* port_in, u8 pin_in, u8 invert_in,
                TDataReceivedCallback DataReceivedFunction, TErrorCallback ErrorFunction, TRTC_1ms_Callback RTC_1ms_Function)
 {
-  DALIOUT_port = port_out;
-  DALIOUT_pin = 1 << pin_out;
-  DALIOUT_invert = invert_out;
+  ITC_Irq_TypeDef exti_irq = ITC_IRQ_PORTD;
+  u8 irq;
+  DALI_LINE_SELECT;
 
-  DALIIN_port = port_in;
-  DALIIN_pin = 1 << pin_in;
-  DALIIN_invert = invert_in;
+  DALI_LN->out_port = port_out;
+  DALI_LN->out_pin = 1 << pin_out;
+  DALI_LN->out_invert = invert_out;
 
-  DataReceivedCallback = DataReceivedFunction;
+  DALI_LN->in_port = port_in;
+  DALI_LN->in_pin = 1 << pin_in;
+  DALI_LN->in_invert = invert_in;
+
+  DALI_LN->DataReceivedCallback = DataReceivedFunction;
   RTC_1ms_Callback = RTC_1ms_Function;
-  ErrorCallback = ErrorFunction;
+  DALI_LN->ErrorCallback = ErrorFunction;
 
   /* Pin for data output */
-  DALIOUT_port->ODR |= DALIOUT_pin; //high level
-  DALIOUT_port->DDR |= DALIOUT_pin; //output mode
-  DALIOUT_port->CR1 |= DALIOUT_pin; //push-pull
-  DALIOUT_port->CR2 |= DALIOUT_pin; //slow slope
+  port_out->ODR |= DALI_LN->out_pin; //high level
+  port_out->DDR |= DALI_LN->out_pin; //output mode
+  port_out->CR1 |= DALI_LN->out_pin; //push-pull
+  port_out->CR2 |= DALI_LN->out_pin; //slow slope
 
   /* Pin for data input */
-  DALIIN_port->DDR &= ~DALIIN_pin; //input mode
-  DALIIN_port->ODR &= ~DALIIN_pin; //low level
-  DALIIN_port->CR1 |= DALIIN_pin; //pull-up
-  DALIIN_port->CR2 |= DALIIN_pin; //interrupt enable on pin
+  port_in->DDR &= ~DALI_LN->in_pin; //input mode
+  port_in->ODR &= ~DALI_LN->in_pin; //low level
+  port_in->CR1 |= DALI_LN->in_pin; //pull-up
+  port_in->CR2 |= DALI_LN->in_pin; //interrupt enable on pin
 
   // External interrupts are allowed just for ports A-E,
   // application will not work properly for other ports.
@@ -226,72 +563,128 @@ void init_DALI(GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef*
   {
     EXTI->CR1 &= ~EXTI_CR1_PAIS;
     EXTI->CR1 |= 0x02;
+    exti_irq = ITC_IRQ_PORTA;
   }
   else if(port_in == GPIOB)
   {
     EXTI->CR1 &= ~EXTI_CR1_PBIS;
     EXTI->CR1 |= 0x02 << 2;
+    exti_irq = ITC_IRQ_PORTB;
   }
   else if(port_in == GPIOC)
   {
     EXTI->CR1 &= ~EXTI_CR1_PCIS;
     EXTI->CR1 |= 0x02 << 4;
+    exti_irq = ITC_IRQ_PORTC;
   }
   else if(port_in == GPIOD)
   {
     EXTI->CR1 &= ~EXTI_CR1_PDIS;
     EXTI->CR1 |= 0x02 << 6;
+    exti_irq = ITC_IRQ_PORTD;
   }
   else if(port_in == GPIOE)
   {
     EXTI->CR2 &= ~EXTI_CR2_PEIS;
     EXTI->CR2 |= 0x02;
+    exti_irq = ITC_IRQ_PORTE;
   }
 
   //set status flaf
-  flag = NO_ACTION;
+  DALI_LN->flag = NO_ACTION;
+#if (DALI_LINES > 1)
+  DALI_LN->start_pending = 0;
+#endif
 
   //reset 500ms interface failure counter
-  InterfaceFailureCounter = 0;
+  DALI_LN->InterfaceFailureCounter = 0;
 
-  /* Configure the Fcpu to DIV1 , 16MHz*/
-  CLK->CKDIVR = 0x00;
+  disableInterrupts(); // priority can be changed only with interrupts disabled
+  if (!(TIM4->CR1 & TIM4_CR1_CEN)) // first line
+  {
+    /* Interrupt priorities - DALI tick and start edge above all other sources */
+    for (irq = ITC_IRQ_AWU; irq <= ITC_IRQ_EEPROM_EEC; irq++)
+      ITC_SetSoftwarePriority((ITC_Irq_TypeDef)irq, DALI_APP_PRIORITY);
+    ITC_SetSoftwarePriority(ITC_IRQ_TIM4_OVF, DALI_IRQ_PRIORITY);
 
-  /* Time base configuration */
-  oneMScounter = 0;
-  TIM4->PSCR = TIM4_PRESCALLER;
-  TIM4->ARR  = TIM4_DIVIDER;
-  /* Enable TIM4 Interrupt sources */
-  TIM4->IER |= 0x01; //TIM4_IT_UPDATE
+    /* Time base configuration - computed from the current clock setting */
+    oneMScounter = 0;
+    TIM4->CR1 |= TIM4_CR1_URS; // only counter overflow generates interrupt
+    timebase_calc(&TimebaseRun, CLK->CKDIVR);
+    timebase_calc(&TimebaseIdle, CLK->CKDIVR);
+    Timebase = &TimebaseIdle;
+    timebase_load();
+    /* Enable TIM4 Interrupt sources */
+    TIM4->IER |= 0x01; //TIM4_IT_UPDATE
 
-  // enable timer
-  TIM4->CR1 |= TIM4_CR1_CEN;
+    // enable timer
+    TIM4->CR1 |= TIM4_CR1_CEN;
+  }
+  ITC_SetSoftwarePriority(exti_irq, DALI_EXTI_PRIORITY);
 
   enableInterrupts();
 
   return;
 }
 
-void DataReceived(u8 address, u8 dataByte)
+void RTC1msFnc(void)
 {
-  // Data has been received from master device
-  // Received data were stored in bytes address (1st byte)
-  // and dataByte (2nd byte)
+  //here is called routines every 1ms
 }
 
-void RTC1msFnc(void)
+u8 get_flag(DALI_LINE_PARAM)
 {
-  //here is called routines every 1ms
+  return DALILines[DALI_LINE_INDEX].flag;
 }
 
-void ErrorFnc(u8 code_val)
+// Returns ticks the line has been idle since its last frame (saturated at 0xFF)
+u8 get_idle_ticks(DALI_LINE_PARAM)
 {
-  //here is error management
+  return DALILines[DALI_LINE_INDEX].idle_ticks;
 }
 
-u8 get_flag(void)
+// Bit tick of one line: only the active part runs - decoder, encoder or
+// idle bus supervision (entry of the host simulators, each line one device)
+void line_tick(DALI_LINE_PARAM)
 {
-  return flag;
+  DALI_LINE_SELECT;
+
+#if (DALI_LINES > 1)
+  if (DALI_LN->start_pending)
+  { // start edge since the last tick: first tick of the frame, unless an
+    // answer was started meanwhile (send_data wins, as with one line)
+    if (DALI_LN->flag == NO_ACTION)
+      receive_data(DALI_LINE_ARG);
+    DALI_LN->start_pending = 0;
+  }
+#endif
+  if (DALI_LN->flag == RECEIVING_DATA)
+    receive_tick(DALI_LINE_ARG);
+  else if (DALI_LN->flag == SENDING_DATA)
+    send_tick(DALI_LINE_ARG);
+  else if (DALI_LN->flag != NO_ACTION)
+    transmit_tick(DALI_LINE_ARG);
+
+  if (DALI_LN->flag == NO_ACTION)
+  {
+    check_interface_failure(DALI_LINE_ARG); //check idle voltage on bus
+    transmit_idle(DALI_LINE_ARG);           //settling time of a pending forward frame
+  }
+  else
+    DALI_LN->idle_ticks = 0;
+}
+
+// Bit tick of all lines, called at each TIM4 update
+void lines_tick(void)
+{
+#if (DALI_LINES > 1)
+  u8 line;
+
+  for (line = 0; line < DALI_LINES; line++)
+    line_tick(line);
+#else
+  line_tick();
+#endif
 }
 
 //returns timer counter
@@ -300,41 +693,51 @@ u8 get_timer_count(void)
   return (TIM4->CNTR);
 }
 
+//returns timer counter sampled at the start bit edge of the last frame
+u8 get_start_edge_phase(DALI_LINE_PARAM)
+{
+  return DALILines[DALI_LINE_INDEX].StartEdgePhase;
+}
+
 /*************** S E N D * P R O C E D U R E S *************/
 /***********************************************************/
 
 // Set value to the DALIOUT pin
-void set_DALIOUT(bool pin_value)
+static void set_DALIOUT(DALI_LINE_PARAMS bool pin_value)
 {
-  if (DALIOUT_invert)
+  DALI_LINE_SELECT;
+
+  if (DALI_LN->out_invert)
   {
     if(pin_value)
-      DALIOUT_port->ODR &= ~DALIOUT_pin;
+      DALI_LN->out_port->ODR &= ~DALI_LN->out_pin;
     else
-      DALIOUT_port->ODR |= DALIOUT_pin;
+      DALI_LN->out_port->ODR |= DALI_LN->out_pin;
   }
   else
   {
     if(pin_value)
-      DALIOUT_port->ODR |= DALIOUT_pin;
+      DALI_LN->out_port->ODR |= DALI_LN->out_pin;
     else
-      DALIOUT_port->ODR &= ~DALIOUT_pin;
+      DALI_LN->out_port->ODR &= ~DALI_LN->out_pin;
   }
 }
 
 // gets state of the DALIOUT pin
-bool get_DALIOUT(void)
+static bool get_DALIOUT(DALI_LINE_PARAM)
 {
-  if (DALIOUT_invert)
+  DALI_LINE_SELECT;
+
+  if (DALI_LN->out_invert)
   {
-    if(DALIOUT_port->IDR & DALIOUT_pin)
+    if(DALI_LN->out_port->IDR & DALI_LN->out_pin)
       return FALSE;
     else
       return TRUE;
   }
   else
   {
-    if(DALIOUT_port->IDR & DALIOUT_pin)
+    if(DALI_LN->out_port->IDR & DALI_LN->out_pin)
       return TRUE;
     else
       return FALSE;
@@ -342,103 +745,283 @@ bool get_DALIOUT(void)
 }
 
 // Send answer to the controller device
-void send_data(u8 byteToSend)
+void send_data(DALI_LINE_PARAMS u8 byteToSend)
 {
-  answer = byteToSend;
-  bit_count = 0;
-  tick_count = 0;
+  DALI_LINE_SELECT;
+
+  DALI_LN->answer = byteToSend;
+  DALI_LN->bit_count = 0;
+  // settling time from the end of the query: idle_ticks is 3 at the earliest
+  // (receive_done sets 2, transmit_idle counts the tick of the frame end
+  // too), an answer the main loop gives late (EEPROM write) still starts in time
+  DALI_LN->tick_count = (DALI_LN->idle_ticks > 3) ? (u16)(DALI_LN->idle_ticks - 3) : 0;
+  if (DALI_LN->tick_count > 32)
+    DALI_LN->tick_count = 32;
 
   // disable external interrupt - no incoming data now
-  DALIIN_port->CR2 &= ~DALIIN_pin;
+  DALI_LN->in_port->CR2 &= ~DALI_LN->in_pin;
 
-  flag = SENDING_DATA;
+#if (DALI_LINES > 1) || defined (DALI_TRACE)
+  sim(); // other lines may switch the clock, trace records are queued at interrupt level
+  timebase_select(&TimebaseRun);
+  DALI_SET_FLAG(SENDING_DATA);
+  rim();
+#else
+  timebase_select(&TimebaseRun);
+  DALI_SET_FLAG(SENDING_DATA);
+#endif
   //TIM4->CR1 |= TIM4_CR1_CEN;
 }
 
 
+// Queues a forward frame (DALI_FRAME_xx bits) for the multi-master transmitter,
+// priority 1..DALI_TX_PRIORITIES, query: the backward frame window is supervised
+// after the frame - returns 0 if a frame is still pending on the line
+u8 send_forward(DALI_LINE_PARAMS u8 bits, u8 *frame, u8 priority, u8 query)
+{
+  u8 i;
+  DALI_LINE_SELECT;
+
+  if ((DALI_LN->tx_status == DALI_TX_PENDING) || (DALI_LN->tx_status == DALI_TX_WAIT_ANSWER))
+    return 0;
+  if ((priority < 1) || (priority > DALI_TX_PRIORITIES))
+    priority = DALI_TX_PRIORITIES;
+  for (i = 0; i < DALI_FRAME_BYTES; i++)
+    DALI_LN->tx_frame[i] = frame[i];
+  DALI_LN->tx_bits = bits;
+  DALI_LN->tx_priority = (u8)(priority - 1);
+  DALI_LN->tx_attempts = 0;
+  DALI_LN->tx_query = query;
+  sim(); // TxRandom is shared with the interrupt
+  transmit_backoff(DALI_LINE_ARG);
+  DALI_LN->tx_status = DALI_TX_PENDING;
+  rim();
+  return 1;
+}
+
+// Returns state of the last forward frame queued on the line (DALI_TX_xxx)
+u8 get_send_status(DALI_LINE_PARAM)
+{
+  return DALILines[DALI_LINE_INDEX].tx_status;
+}
+
+// Returns the backward frame answering the last query (status DALI_TX_ANSWER)
+u8 get_send_answer(DALI_LINE_PARAM)
+{
+  return DALILines[DALI_LINE_INDEX].tx_answer;
+}
+
 // DALI protocol physical layer for slave device
-void send_tick(void)
+void send_tick(DALI_LINE_PARAM)
 {
+  bool bit_value;   // value of actual bit
+  DALI_LINE_SELECT;
+
   //access to the routine just every 4 ticks = every half bit
-  if((tick_count & 0x03)==0)
+  if((DALI_LN->tick_count & 0x03)==0)
   {
-    if(tick_count < 104)
+    if(DALI_LN->tick_count < 104)
     {
       // settling time between forward and backward frame
-      if(tick_count < 32)
+      if(DALI_LN->tick_count < 32)
       {
-        tick_count++;
+        DALI_LN->tick_count++;
         return;
       }
 
       // start of the start bit
       // 32 ticks = 8*Te time = delay between forward and backward message frame (1*Te time must be added as half of stop bit)
-      if(tick_count == 32)
+      if(DALI_LN->tick_count == 32)
       {
-        set_DALIOUT(FALSE);
-        tick_count++;
+        set_DALIOUT(DALI_LINE_ARGS FALSE);
+        DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_FRAME_TX, DALI_LINE_INDEX), DALI_LN->answer, 0);
+        DALI_LN->tick_count++;
         return;
       }
 
       // edge of the start bit
-      if(tick_count == 36)
+      if(DALI_LN->tick_count == 36)
       {
-        set_DALIOUT(TRUE);
-        tick_count++;
+        set_DALIOUT(DALI_LINE_ARGS TRUE);
+        DALI_LN->tick_count++;
         return;
       }
 
       // bit value (edge) selection
-      bit_value = (bool)( (answer >> (7-bit_count)) & 0x01);
+      bit_value = (bool)( (DALI_LN->answer >> (7-DALI_LN->bit_count)) & 0x01);
 
       // Every half bit -> Manchester coding
-      if( !( (tick_count-32) & 0x0007) )
+      if( !( (DALI_LN->tick_count-32) & 0x0007) )
       { // div by 8
-        if(get_DALIOUT() == bit_value ) // former value of bit = new value of bit
-          set_DALIOUT((bool)(1-bit_value));
+        if(get_DALIOUT(DALI_LINE_ARG) == bit_value ) // former value of bit = new value of bit
+          set_DALIOUT(DALI_LINE_ARGS (bool)(1-bit_value));
       }
 
       // Generate edge for actual bit
-      if( !( (tick_count - 36) & 0x0007) )
+      if( !( (DALI_LN->tick_count - 36) & 0x0007) )
       {
-        set_DALIOUT(bit_value);
-        bit_count++;
+        set_DALIOUT(DALI_LINE_ARGS bit_value);
+        DALI_LN->bit_count++;
       }
     }else
     { // end of data byte, start of stop bits
-      if(tick_count == 104)
+      if(DALI_LN->tick_count == 104)
       {
-        set_DALIOUT(TRUE); // start of stop bit
+        set_DALIOUT(DALI_LINE_ARGS TRUE); // start of stop bit
       }
 
       // end of stop bits, no settling time
-      if(tick_count == 120)
+      if(DALI_LN->tick_count == 120)
       {
-        flag = NO_ACTION;
+        DALI_SET_FLAG(NO_ACTION);
         //TIM4->CR1 &= ~TIM4_CR1_CEN;
-        DALIIN_port->CR2 |= DALIIN_pin;//enable EXTI
+        DALI_LN->in_port->CR2 |= DALI_LN->in_pin;//enable EXTI
+        timebase_idle();
+        DALIStats.replies++;
       }
     }
   }
-  tick_count++;
+  DALI_LN->tick_count++;
 
   return;
 }
 
+// Settling time windows between forward frames by priority (IEC 62386-101),
+// in ticks: 13.5..14.7ms, 14.9..16.2ms, 16.3..17.7ms, 17.9..19.3ms, 19.5..21.2ms
+static CONST u8 TxWindowStart[DALI_TX_PRIORITIES] = { 130, 144, 157, 172, 188 };
+static CONST u8 TxWindowSpan[DALI_TX_PRIORITIES]  = {  12,  12,  13,  14,  16 };
+static u8 TxRandom = 1; // xorshift state, stirred with the asynchronous TIM4 counter
+
+// Draws the settling time of the next attempt in the window of the priority
+static void transmit_backoff(DALI_LINE_PARAM)
+{
+  u8 r;
+  DALI_LINE_SELECT;
+
+  r = (u8)(TxRandom ^ TIM4->CNTR);
+  r ^= (u8)(r << 3);
+  r ^= (u8)(r >> 5);
+  r ^= (u8)(r << 4);
+  if (!r)
+    r = 1;
+  TxRandom = r;
+  DALI_LN->tx_wait = (u8)(TxWindowStart[DALI_LN->tx_priority] + r % TxWindowSpan[DALI_LN->tx_priority]);
+}
+
+// Bus idle tick: closes the backward frame window of a query and starts the
+// pending forward frame once the bus has been idle for its settling time
+static void transmit_idle(DALI_LINE_PARAM)
+{
+  DALI_LINE_SELECT;
+
+  if (!get_DALIIN(DALI_LINE_ARG))
+  {
+    DALI_LN->idle_ticks = 0;
+    return;
+  }
+  if (DALI_LN->idle_ticks != 0xFF)
+    DALI_LN->idle_ticks++;
+  if ((DALI_LN->tx_status == DALI_TX_WAIT_ANSWER) && (DALI_LN->idle_ticks >= DALI_TX_ANSWER_TICKS))
+    DALI_LN->tx_status = DALI_TX_NO_ANSWER;
+  if ((DALI_LN->tx_status != DALI_TX_PENDING) || (DALI_LN->idle_ticks < DALI_LN->tx_wait))
+    return;
+
+  DALI_LN->in_port->CR2 &= ~DALI_LN->in_pin; // own frame is not received
+  DALI_LN->tick_count = 0;
+  DALI_SET_FLAG(SENDING_FORWARD);
+  timebase_select(&TimebaseRun);
+}
+
+// Forward frame encoder with read back, one half bit = 4 ticks:
+// level set at tick 0, bus compared at tick 2 of each half bit
+static void transmit_tick(DALI_LINE_PARAM)
+{
+  u8 half;
+  u8 n;
+  bool level;
+  DALI_LINE_SELECT;
+
+  if (DALI_LN->flag == SENDING_BREAK)
+  {
+    if (++DALI_LN->tick_count >= DALI_TX_BREAK_TICKS)
+    {
+      set_DALIOUT(DALI_LINE_ARGS TRUE);
+      if (++DALI_LN->tx_attempts >= DALI_TX_ATTEMPTS)
+        DALI_LN->tx_status = DALI_TX_FAILED;
+      else
+        transmit_backoff(DALI_LINE_ARG);
+      transmit_end(DALI_LINE_ARG);
+    }
+    return;
+  }
+
+  half = (u8)(DALI_LN->tick_count >> 2);
+  switch (DALI_LN->tick_count & 0x03)
+  {
+    case 0: // start of half bit
+      if (half < 2) // start bit: low, high
+        level = (bool)half;
+      else if (half < (u8)(2 + 2 * DALI_LN->tx_bits))
+      { // data bit n: inverted value, value
+        n = (u8)((half - 2) >> 1);
+        level = (bool)((DALI_LN->tx_frame[n >> 3] >> (7 - (n & 0x07))) & 0x01);
+        if (!(half & 0x01))
+          level = (bool)!level;
+      }
+      else if (half < (u8)(2 + 2 * DALI_LN->tx_bits + 4))
+        level = TRUE; // stop bits
+      else
+      {
+        DALI_LN->tx_status = DALI_LN->tx_query ? DALI_TX_WAIT_ANSWER : DALI_TX_DONE;
+        DALIStats.tx_frames++;
+        transmit_end(DALI_LINE_ARG);
+        return;
+      }
+      set_DALIOUT(DALI_LINE_ARGS level);
+    break;
+    case 2: // middle of half bit: bus must show the level sent
+      if (get_DALIIN(DALI_LINE_ARG) != get_DALIOUT(DALI_LINE_ARG))
+      { // other transmitter: break, all of them stop
+        DALIStats.collisions++;
+        set_DALIOUT(DALI_LINE_ARGS FALSE);
+        DALI_SET_FLAG(SENDING_BREAK);
+        DALI_LN->tick_count = 0;
+        return;
+      }
+    break;
+  }
+  DALI_LN->tick_count++;
+}
+
+// Back to bus supervision after a forward frame or a collision break
+static void transmit_end(DALI_LINE_PARAM)
+{
+  DALI_LINE_SELECT;
+
+  DALI_SET_FLAG(NO_ACTION);
+  DALI_LN->idle_ticks = 0;
+  DALI_LN->in_port->CR2 |= DALI_LN->in_pin;//enable EXTI
+  timebase_idle();
+}
+
 /* checking if DALI bus is in the error state for long time */
-void check_interface_failure(void)
+void check_interface_failure(DALI_LINE_PARAM)
 {
-  if (get_DALIIN())
+  DALI_LINE_SELECT;
+
+  if (get_DALIIN(DALI_LINE_ARG))
   {
-    InterfaceFailureCounter = 0;
+    DALI_LN->InterfaceFailureCounter = 0;
     return;
   }
 
-  InterfaceFailureCounter++;
-  if (InterfaceFailureCounter > ((1000l * 500)/US_PER_TICK) )  //check 500ms timeout
+  DALI_LN->InterfaceFailureCounter++;
+  if (DALI_LN->InterfaceFailureCounter > (TICKS_PER_SECOND / 2) )  //check 500ms timeout
   {
-    ErrorCallback(1);
-    InterfaceFailureCounter = 0;
+    DALI_LN->ErrorCallback(DALI_LINE_ARGS 1);
+    DALI_LN->InterfaceFailureCounter = 0;
+    DALIStats.if_failures++;
+    DALI_TRACE_EVENT(TRACE_ON_LINE(TRACE_IF_FAIL, DALI_LINE_INDEX), 0, 0);
   }
 }
 
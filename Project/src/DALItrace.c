@@ -0,0 +1,277 @@
+/**
+  ******************************************************************************
+  * @file    dalitrace.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Dali bus trace streamer over UART
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#include "DALItrace.h"
+
+#ifdef DALI_TRACE
+
+#define TRACE_BUFFER_MASK (TRACE_BUFFER_SIZE - 1)
+
+// Ring buffer, indexes run freely and are masked on access:
+// head is written only at DALI interrupt level, tail only by the UART interrupt
+u8 TraceBuffer[TRACE_BUFFER_SIZE];
+volatile u8 TraceHead;
+volatile u8 TraceTail;
+
+u16 TraceTicks; // timestamp of records
+u8 TraceLost;   // records dropped since the last TRACE_LOST record
+
+#ifdef DALI_TRACE_REPLAY
+#define TRACE_REPLAY_MASK (TRACE_REPLAY_DEPTH - 1)
+
+// Frame waiting for replay
+typedef struct
+{
+  u32 delay;   // ticks after the previous replayed frame
+  u8  bits;
+  u8  frame[DALI_FRAME_BYTES];
+#if (DALI_LINES > 1)
+  u8  line;
+#endif
+} TReplayFrame;
+
+// Replay queue: head written by the UART receive interrupt, tail by the TIM4 interrupt
+TReplayFrame ReplayQueue[TRACE_REPLAY_DEPTH];
+volatile u8 ReplayHead;
+volatile u8 ReplayTail;
+u32 ReplayElapsed;  // ticks since the last replayed frame
+
+// Record parser state (UART receive interrupt)
+u8 ReplayRecord[3 + 1 + DALI_FRAME_BYTES];
+u8 ReplayIndex;
+u8 ReplayStarted;
+u16 ReplayWraps;    // TRACE_WRAP records received = upper half of the recorded time
+u32 ReplayLast;     // recorded time of the previous frame
+#endif /* DALI_TRACE_REPLAY */
+
+static u8 trace_push(u8 type, u8 len, u8 *payload);
+static void trace_record(u8 type, u8 *payload);
+static u8 trace_len(u8 type);
+
+// Setup UART transmitter for trace output (8N1), fMASTER must not change afterwards
+// (set_DALI_clock may change CPU divider only)
+void init_DALI_trace(void)
+{
+  u16 div;
+
+  div = (u16)((get_fmaster() + TRACE_BAUDRATE / 2) / TRACE_BAUDRATE);
+
+  TraceHead = 0;
+  TraceTail = 0;
+  TraceTicks = 0;
+  TraceLost = 0;
+
+  TRACE_UART->CR1 = 0;    // 8 data bits, no parity
+  TRACE_UART->CR3 = 0;    // 1 stop bit
+  TRACE_UART->BRR2 = (u8)(((div >> 8) & 0xF0) | (div & 0x0F)); // BRR2 must be written first
+  TRACE_UART->BRR1 = (u8)(div >> 4);
+#ifdef DALI_TRACE_REPLAY
+  ReplayHead = 0;
+  ReplayTail = 0;
+  ReplayElapsed = 0;
+  ReplayIndex = 0;
+  ReplayStarted = 0;
+  ReplayWraps = 0;
+  TRACE_UART->CR2 = TRACE_CR2_TEN | TRACE_CR2_REN | TRACE_CR2_RIEN;
+#else
+  TRACE_UART->CR2 = TRACE_CR2_TEN; // transmitter only, TX interrupt enabled by trace_push
+#endif /* DALI_TRACE_REPLAY */
+}
+
+// Returns payload length of the record type
+static u8 trace_len(u8 type)
+{
+  if (type == TRACE_STATE)
+    return 2;
+  type &= (u8)~TRACE_LINE1;
+  if (type == TRACE_FRAME_RXL)
+    return 1 + DALI_FRAME_BYTES;
+  if (type == TRACE_FRAME_RX)
+    return 2;
+  if ((type == TRACE_FRAME_TX) || (type == TRACE_ERROR) || (type == TRACE_LOST))
+    return 1;
+  return 0;
+}
+
+// Stores one record if it fits, returns 0 if the buffer is full
+static u8 trace_push(u8 type, u8 len, u8 *payload)
+{
+  u8 head;
+
+  head = TraceHead;
+  if ((u8)(TRACE_BUFFER_SIZE - (u8)(head - TraceTail)) < (u8)(len + 3))
+    return 0;
+
+  TraceBuffer[head++ & TRACE_BUFFER_MASK] = type;
+  TraceBuffer[head++ & TRACE_BUFFER_MASK] = (u8)(TraceTicks >> 8);
+  TraceBuffer[head++ & TRACE_BUFFER_MASK] = (u8)TraceTicks;
+  while (len--)
+    TraceBuffer[head++ & TRACE_BUFFER_MASK] = *payload++;
+  TraceHead = head;
+
+  TRACE_UART->CR2 |= TRACE_CR2_TIEN; // start or keep draining
+  return 1;
+}
+
+// Queues one record after the pending TRACE_LOST one, if any
+static void trace_record(u8 type, u8 *payload)
+{
+  if (TraceLost)
+  {
+    if (!trace_push(TRACE_LOST, 1, &TraceLost))
+    {
+      if (TraceLost < 0xFF)
+        TraceLost++;
+      return;
+    }
+    TraceLost = 0;
+  }
+
+  if (!trace_push(type, trace_len(type), payload))
+    TraceLost = 1;
+}
+
+// Queues one record, called from DALI interrupts only (never blocks)
+void trace_put(u8 type, u8 d0, u8 d1)
+{
+  u8 payload[2];
+
+  payload[0] = d0;
+  payload[1] = d1;
+  trace_record(type, payload);
+}
+
+// Queues a TRACE_FRAME_RXL record (frame of DALI_FRAME_BYTES bytes)
+void trace_put_frame(u8 type, u8 bits, u8 *frame)
+{
+  u8 payload[1 + DALI_FRAME_BYTES];
+  u8 i;
+
+  payload[0] = bits;
+  for (i = 0; i < DALI_FRAME_BYTES; i++)
+    payload[1 + i] = frame[i];
+  trace_record(type, payload);
+}
+
+// Timestamp counter, called at each TIM4 tick
+void trace_tick(void)
+{
+  TraceTicks++;
+  if (TraceTicks == 0)
+    trace_put(TRACE_WRAP, 0, 0);
+
+#ifdef DALI_TRACE_REPLAY
+  ReplayElapsed++;
+  if (ReplayTail == ReplayHead)
+    return;
+  if (ReplayElapsed < ReplayQueue[ReplayTail & TRACE_REPLAY_MASK].delay)
+    return;
+  // bus busy (frame or answer in progress): try again next tick
+  if (inject_frame(
+#if (DALI_LINES > 1)
+                   ReplayQueue[ReplayTail & TRACE_REPLAY_MASK].line,
+#endif
+                   ReplayQueue[ReplayTail & TRACE_REPLAY_MASK].bits,
+                   ReplayQueue[ReplayTail & TRACE_REPLAY_MASK].frame))
+  {
+    ReplayTail++;
+    ReplayElapsed = 0;
+  }
+#endif /* DALI_TRACE_REPLAY */
+}
+
+// Sends next byte, called from UART TX interrupt (transmit data register empty)
+void trace_tx_interrupt(void)
+{
+  if (TraceTail != TraceHead)
+  {
+    TRACE_UART->DR = TraceBuffer[TraceTail & TRACE_BUFFER_MASK];
+    TraceTail++;
+    return;
+  }
+  // buffer empty: stop interrupt, re-enable it if a DALI interrupt
+  // has pushed a record meanwhile (its TIEN setting may be overwritten)
+  TRACE_UART->CR2 &= ~TRACE_CR2_TIEN;
+  if (TraceTail != TraceHead)
+    TRACE_UART->CR2 |= TRACE_CR2_TIEN;
+}
+
+#ifdef DALI_TRACE_REPLAY
+// Collects replayed trace records, called from UART RX interrupt
+void trace_rx_interrupt(void)
+{
+  u8 data;
+  u8 type;
+  u8 i;
+  u32 time;
+  TReplayFrame *frame;
+
+  data = TRACE_UART->SR; // SR then DR read clears RXNE and overrun
+  data = TRACE_UART->DR;
+
+  if ((ReplayIndex == 0) && ((data & 0xF0) != (TRACE_FRAME_RX & 0xF0)))
+    return; // not a record type: resynchronise on next byte
+  ReplayRecord[ReplayIndex++] = data;
+  if (ReplayIndex < (u8)(3 + trace_len(ReplayRecord[0])))
+    return;
+  ReplayIndex = 0;
+
+  if (ReplayRecord[0] == TRACE_WRAP)
+  {
+    ReplayWraps++;
+    return;
+  }
+#if (DALI_LINES > 1)
+  type = (u8)(ReplayRecord[0] & (u8)~TRACE_LINE1);
+#else
+  type = ReplayRecord[0]; // frames of other lines are skipped
+#endif
+  if ((type != TRACE_FRAME_RX) && (type != TRACE_FRAME_RXL))
+    return;
+  if ((u8)(ReplayHead - ReplayTail) >= TRACE_REPLAY_DEPTH)
+    return; // host is too far ahead, frame lost
+
+  time = ((u32)ReplayWraps << 16) | ((u16)ReplayRecord[1] << 8) | ReplayRecord[2];
+  frame = &ReplayQueue[ReplayHead & TRACE_REPLAY_MASK];
+  frame->delay = ReplayStarted ? (time - ReplayLast) : 0;
+  if (type == TRACE_FRAME_RX)
+  {
+    frame->bits = DALI_FRAME_16;
+    frame->frame[0] = ReplayRecord[3];
+    frame->frame[1] = ReplayRecord[4];
+    for (i = 2; i < DALI_FRAME_BYTES; i++)
+      frame->frame[i] = 0;
+  }
+  else
+  {
+    frame->bits = ReplayRecord[3];
+    for (i = 0; i < DALI_FRAME_BYTES; i++)
+      frame->frame[i] = ReplayRecord[4 + i];
+  }
+#if (DALI_LINES > 1)
+  frame->line = (u8)((ReplayRecord[0] & TRACE_LINE1) ? 1 : 0);
+#endif
+  ReplayLast = time;
+  ReplayStarted = 1;
+  ReplayHead++;
+}
+#endif /* DALI_TRACE_REPLAY */
+
+#endif /* DALI_TRACE */
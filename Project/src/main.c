@@ -28,6 +28,12 @@
 #include "dali_pub.h"
 #include "dali_regs.h"
 #include "eeprom.h"
+#include "DALIslave.h"
+#include "DALItrace.h"
+#include "DALIgateway.h"
+#include "DALIcan.h"
+#include "DALIi2c.h"
+#include "DALIpwm.h"
 
 
 /* ------------------------- Code header section ------------------------- */
@@ -68,35 +74,37 @@ CONST uint8_t version[3][20]={
 /* -----------------------End of code header section ----------------------*/
 
 
+#if defined (_COSMIC_) && defined (DALI_FW_UPDATE)
+int _fctcpy(char name); /* Cosmic library: copies moveable code segment to RAM */
+#endif /* _COSMIC_ && DALI_FW_UPDATE */
+
 /* global variables */
 #define LOW_POWER_TIMEOUT      2000  // 2 seconds to go to sleep/halt
-volatile u8 LEDlight;                // current light level
 u16 HALTtimer;                       // timeout counter for low power mode
 
 /* control of light level callback function - must be type TLightControlCallback - see dali.h */
-/* PWM for LED light control on STM8S discovery board */
-void PWM_LED(u16 lightlevel)
+/* PWM for LED light control on STM8S discovery board, one PWM channel per unit (see DALIpwm.h) */
+void PWM_LED(DALI_UNIT_PARAMS u16 lightlevel)
 {
-  /* PD0 pin - TIM3_CH2 */
-  #define LED_PORT GPIOD
-  #define LED_PIN  0
-
-  // PWM uses timer 3 on Discovery board
-  LED_PORT->DDR |= 1<<LED_PIN; // output mode
-  LED_PORT->CR1 |= 1<<LED_PIN; // push-pull
-
-  TIM3->PSCR  = 0;             // prescaller to 1
-  TIM3->CCMR2 = 0x60;          // PWM mode1
-  TIM3->CCER1 = 0x30;          // enable OC2 output pin (TIM3_CH2), polarity active low (LED from Vdd)
-  TIM3->ARRH  = 0xFF;          // PWM period to 0xFFFF cycles  - #ifdef USE_ARC_TABLE is enabled in "dali_config.h"
-  TIM3->ARRL  = 0xFF;
-  TIM3->CCR2H = lightlevel >>   8;          // duty cycle is light level - #ifdef USE_ARC_TABLE is enabled in "dali_config.h"
-  TIM3->CCR2L = lightlevel & 0xFF;
-  TIM3->CR1  |= TIM3_CR1_CEN;  // enable PWM counter
-
-  LEDlight = lightlevel;       // store current light level to global variable (for entering into halt if zero)
+#if (DALI_INSTANCES > 1)
+  set_PWM(unit, lightlevel);     // duty cycle is light level - #ifdef USE_ARC_TABLE is enabled in "dali_config.h"
+#else
+  set_PWM(0, lightlevel);
+#endif
 }
 
+#ifdef DALI_COLOUR
+/* output of one primary of a colour unit - must be type TDCColourControlCallback - see dali_col.h */
+void PWM_Colour(DALI_UNIT_PARAMS u8 primary, u16 lightlevel)
+{
+#if (DALI_INSTANCES > 1)
+  set_PWM((u8)(unit * DALICOL_PRIMARIES + primary), lightlevel);
+#else
+  set_PWM(primary, lightlevel);
+#endif
+}
+#endif /* DALI_COLOUR */
+
 
 /* main program loop */
 void main(void)
@@ -104,16 +112,50 @@ void main(void)
   /* Dummy access to avoid removal by compiler optimisation */
   __IO u8 t;
   u8 s = 0;
+#if (DALI_INSTANCES > 1)
+  u8 unit;
+#endif
   s=version[s][s];
   t=s;
 
+  /* Configure the Fcpu to DIV1 , 16MHz*/
+  CLK->CKDIVR = 0x00;
+
+#if defined (_COSMIC_) && defined (DALI_FW_UPDATE)
+  /* flash block programming executes from RAM (FLASH_CODE segment) */
+  _fctcpy('F');
+#endif /* _COSMIC_ && DALI_FW_UPDATE */
+
+  /* Light outputs (before DALI_Init: it sets the power on level) */
+  init_PWM();
+
   /* Initialisation of DALI */
-  DALI_Init(PWM_LED);
+#ifdef DALI_COLOUR
+  DALI_Set_Colour_Callback(PWM_Colour); // units drive one channel per primary
+#endif /* DALI_COLOUR */
+  DALI_Init(PWM_LED);   // power on level is set at once
+  update_PWM();
+  DALI_Light_On_Done(); // boot latency report (diagnostics memory bank)
+#ifdef DALI_TRACE
+  /* Bus trace output on UART (after DALI_Init: interrupt priorities are set) */
+  init_DALI_trace();
+#endif /* DALI_TRACE */
+#ifdef DALI_GATEWAY
+  /* Host requests on UART, frames sent as a bus master */
+  init_DALI_gateway();
+#endif /* DALI_GATEWAY */
+#ifdef DALI_CAN_BRIDGE
+  /* Bus events pushed to the CAN backbone */
+  init_DALI_can();
+#endif /* DALI_CAN_BRIDGE */
+#ifdef DALI_I2C_SLAVE
+  /* Register interface for a host MCU */
+  init_DALI_i2c();
+#endif /* DALI_I2C_SLAVE */
   /* End of initialisation */
 
   /* sleep/halt coudown counter */
   HALTtimer = LOW_POWER_TIMEOUT;
-  LEDlight = 0;
 
 
   /* main program loop */
@@ -124,6 +166,15 @@ void main(void)
     {
       if (HALTtimer) // countdown timeout if no activity in timer
         HALTtimer--;
+#ifdef DALI_GATEWAY
+      gateway_timer();    // incomplete request dropped after GW_IDLE_MS
+#endif /* DALI_GATEWAY */
+#ifdef DALI_CAN_BRIDGE
+      can_bridge_timer(); // partly filled event frame sent after CANB_FLUSH_MS
+#endif /* DALI_CAN_BRIDGE */
+#ifdef DALI_I2C_SLAVE
+      i2c_slave_timer();  // register snapshot refreshed each I2CS_REFRESH_MS
+#endif /* DALI_I2C_SLAVE */
       if (DALI_CheckAndExecuteTimer())  // need to call this function under 1ms interval periodically (fading function)
         HALTtimer = LOW_POWER_TIMEOUT;  // restart 10seconds timeout if some activity in timer
     }
@@ -133,10 +184,26 @@ void main(void)
       HALTtimer = LOW_POWER_TIMEOUT;    // restart 10seconds timeout if received and executed command
       Physically_Selected = !(DALI_BUTTON_PORT->IDR & (1<<DALI_BUTTON_PIN));   // physical selection = pushbutton in GND
     }
+    update_PWM(); // new light levels of all units in one pass
+#ifdef DALI_GATEWAY
+    if (gateway_process()) // next queued frame handed to the transmitter at once
+      HALTtimer = LOW_POWER_TIMEOUT;
+#endif /* DALI_GATEWAY */
+#ifdef DALI_CAN_BRIDGE
+    if (can_bridge_process()) // events packed into CAN frames, commands of the controller
+      HALTtimer = LOW_POWER_TIMEOUT;
+#endif /* DALI_CAN_BRIDGE */
+#ifdef DALI_I2C_SLAVE
+    if (i2c_slave_process()) // event pin, register snapshot for the host
+      HALTtimer = LOW_POWER_TIMEOUT;
+#endif /* DALI_I2C_SLAVE */
     /* -------------------------------------------------------------------------------- */
     if (!HALTtimer) // go to power save state (WFI or HALT)
     {
-      if (LEDlight) // go to sleep or halt according light level (level "0" = power off = halt)
+#if defined (DALI_GATEWAY) || defined (DALI_CAN_BRIDGE) || defined (DALI_I2C_SLAVE)
+      wfi();         // sleep only: UART receiver of the gateway, CAN or I2C cell need the clock
+#else
+      if (PWM_lit()) // go to sleep or halt according light level (level "0" = power off = halt)
       {
         wfi();       // enable sleep only: PWM function requires continuous run and/or interrupts
       }
@@ -145,12 +212,23 @@ void main(void)
         DALI_halt();     // enable halt: PWM function is off - not requires continuous run and/or not uses interrupts
         HALTtimer = 600; // wake-up = DALI bus changed - command is receiving, 600ms to receive command and check bus errors
       }
+#endif /* DALI_GATEWAY || DALI_CAN_BRIDGE || DALI_I2C_SLAVE */
     }
     /* -------------------------------------------------------------------------------- */
-    if (!(TIM3->CR1 & TIM3_CR1_CEN))   // if PWM counter is not running (hardware error)
+#if (DALI_INSTANCES > 1)
+    for (unit = 0; unit < DALI_INSTANCES; unit++)
+    {
+      if (!PWM_unit_running(unit))     // if PWM counter is not running (hardware error)
+        DALI_Set_Lamp_Failure(unit, 1);  // set Lamp failure
+      else
+        DALI_Set_Lamp_Failure(unit, 0);  // reset Lamp failure
+    }
+#else
+    if (!PWM_unit_running(0))          // if PWM counter is not running (hardware error)
       DALI_Set_Lamp_Failure(1);        // set Lamp failure
     else
       DALI_Set_Lamp_Failure(0);        // reset Lamp failure
+#endif
     /* -------------------------------------------------------------------------------- */
   } /* while(1) loop */
   
@@ -21,8 +21,12 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stm8s_it.h"
 #include "DALIslave.h"
+#include "DALItrace.h"
+#include "DALIgateway.h"
+#include "DALIcan.h"
+#include "DALIi2c.h"
+#include "DALIpwm.h"
 
-extern GPIO_TypeDef* DALIIN_port;
 extern TRTC_1ms_Callback * RTC_1ms_Callback;
 __IO uint16_t oneMScounter;
 
@@ -112,10 +116,7 @@ INTERRUPT_HANDLER(EXTI_PORTA_IRQHandler, 3)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
-	if(DALIIN_port == GPIOA)
-	{
-		receive_data();
-	}
+  receive_edge(GPIOA); //start bit on the DALI line(s) of the port
 }
 
 
@@ -129,10 +130,7 @@ INTERRUPT_HANDLER(EXTI_PORTB_IRQHandler, 4)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
-  if(DALIIN_port == GPIOB)
-	{
-		receive_data();
-	}
+  receive_edge(GPIOB); //start bit on the DALI line(s) of the port
 }
 
 /**
@@ -145,10 +143,7 @@ INTERRUPT_HANDLER(EXTI_PORTC_IRQHandler, 5)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
-  if(DALIIN_port == GPIOC)
-	{
-		receive_data();
-	}
+  receive_edge(GPIOC); //start bit on the DALI line(s) of the port
 }
 
 /**
@@ -161,10 +156,7 @@ INTERRUPT_HANDLER(EXTI_PORTD_IRQHandler, 6)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
-  if(DALIIN_port == GPIOD)
-	{
-		receive_data();
-	}
+  receive_edge(GPIOD); //start bit on the DALI line(s) of the port
 }
 
 /**
@@ -177,10 +169,7 @@ INTERRUPT_HANDLER(EXTI_PORTE_IRQHandler, 7)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
-  if(DALIIN_port == GPIOE)
-	{
-		receive_data();
-	}
+  receive_edge(GPIOE); //start bit on the DALI line(s) of the port
 }
 #ifdef STM8S903
 /**
@@ -207,6 +196,9 @@ INTERRUPT_HANDLER(EXTI_PORTE_IRQHandler, 7)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+#ifdef DALI_CAN_BRIDGE
+  can_rx_interrupt();
+#endif /* DALI_CAN_BRIDGE */
  }
 
 /**
@@ -244,6 +236,9 @@ INTERRUPT_HANDLER(TIM1_UPD_OVF_TRG_BRK_IRQHandler, 11)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+#ifdef PWM_DITHER
+  dither_PWM(1); //next PWM period of the TIM1 light outputs
+#endif /* PWM_DITHER */
 }
 
 /**
@@ -293,6 +288,9 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+#ifdef PWM_DITHER
+  dither_PWM(2); //next PWM period of the TIM2 light outputs
+#endif /* PWM_DITHER */
  }
 
 /**
@@ -320,6 +318,9 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+#ifdef PWM_DITHER
+  dither_PWM(3); //next PWM period of the TIM3 light outputs
+#endif /* PWM_DITHER */
  }
 
 /**
@@ -347,6 +348,12 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+#ifdef DALI_TRACE
+    trace_tx_interrupt();
+#endif /* DALI_TRACE */
+#ifdef DALI_GATEWAY
+    gateway_tx_interrupt();
+#endif /* DALI_GATEWAY */
  }
 
 /**
@@ -359,6 +366,12 @@ INTERRUPT_HANDLER(TIM1_CAP_COM_IRQHandler, 12)
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+#ifdef DALI_TRACE_REPLAY
+    trace_rx_interrupt();
+#endif /* DALI_TRACE_REPLAY */
+#ifdef DALI_GATEWAY
+    gateway_rx_interrupt();
+#endif /* DALI_GATEWAY */
  }
 #endif /*STM8S208 or STM8S207 or STM8S103 or STM8S903 or STM8AF62Ax or STM8AF52Ax */
 
@@ -372,6 +385,9 @@ INTERRUPT_HANDLER(I2C_IRQHandler, 19)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+#ifdef DALI_I2C_SLAVE
+  i2c_slave_interrupt();
+#endif /* DALI_I2C_SLAVE */
 }
 
 #if defined (STM8S105) || defined (STM8AF626x)
@@ -385,6 +401,12 @@ INTERRUPT_HANDLER(I2C_IRQHandler, 19)
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+#ifdef DALI_TRACE
+    trace_tx_interrupt();
+#endif /* DALI_TRACE */
+#ifdef DALI_GATEWAY
+    gateway_tx_interrupt();
+#endif /* DALI_GATEWAY */
  }
 
 /**
@@ -397,6 +419,12 @@ INTERRUPT_HANDLER(I2C_IRQHandler, 19)
     /* In order to detect unexpected events during development,
        it is recommended to set a breakpoint on the following instruction.
     */
+#ifdef DALI_TRACE_REPLAY
+    trace_rx_interrupt();
+#endif /* DALI_TRACE_REPLAY */
+#ifdef DALI_GATEWAY
+    gateway_rx_interrupt();
+#endif /* DALI_GATEWAY */
  }
 #endif /* STM8S105 or STM8AF626x */
 
@@ -477,28 +505,24 @@ INTERRUPT_HANDLER(TIM6_UPD_OVF_TRG_IRQHandler, 23)
   /* In order to detect unexpected events during development,
      it is recommended to set a breakpoint on the following instruction.
   */
+  tick_latency_sample(); //first: measures interrupt entry latency
   TIM4->SR1 &= ~0x01; //clear TIM4_IT_UPDATE;
+  timebase_tick();    //fractional part of the tick period
+#ifdef DALI_TRACE
+  trace_tick();       //timestamp of trace records
+#endif /* DALI_TRACE */
 
-  oneMScounter += US_PER_TICK;
-  if (oneMScounter >= US_PER_MS)
+  oneMScounter += MS_PER_SECOND; // exact: 1ms = TICKS_PER_SECOND/MS_PER_SECOND ticks
+  if (oneMScounter >= TICKS_PER_SECOND)
   {
-    oneMScounter -= US_PER_MS;
+    oneMScounter -= TICKS_PER_SECOND;
     RTC_1ms_Callback();
   }
 
-	if(get_flag()==RECEIVING_DATA)
-	{
-		receive_tick();
-	}else if(get_flag()==SENDING_DATA)
-	{
-		send_tick();
-	}
-
-  if(get_flag()==NO_ACTION)
-  {
-    check_interface_failure(); //check idle voltage on bus
-  } 
+  lines_tick();        //receive, send or check idle voltage on each DALI line
+  tick_duration_sample(); //last: measures interrupt duration
  }
+
 #endif /*STM8S903*/
 
 /**
@@ -0,0 +1,277 @@
+/**
+  ******************************************************************************
+  * @file    arccurves.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: generates the dimming curve knots of the DALI stack
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler (cc arccurves.c -o arccurves -lm) and
+   writes Libraries/DALIStack/inc/dali_curves.h, run it again whenever the
+   curve set changes:
+
+     arccurves [-o file] curve [curve ...]
+
+   Curves, in the order of their number (DT6 SELECT DIMMING CURVE, DTR):
+     log            IEC 62386-102 logarithmic curve (0.1% .. 100%)
+     linear         output proportional to the arc power level
+     gamma:<g>      (level/254)^g, e.g. gamma:2.2
+     bin:<file>     logarithmic curve corrected by the measurement of one LED
+                    bin: text file of "duty flux" lines, duty 0..65535 as
+                    written to the PWM, flux in any unit, both increasing
+   The first curve is the default one (reset value of the curve register).
+
+   Each curve is stored as DALIP_CURVE_KNOTS values at arc levels 4k-2
+   (k = 0..65): level 254 is a knot, so full output is exact, and
+   DALIP_ConvertARC interpolates the 3 levels between two knots with shifts
+   only. Level 0 is always off. Knot 0 makes level 1 right: it may be
+   below 0, written modulo 65536. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define KNOTS       66
+#define CURVES_MAX  16
+#define POINTS_MAX  256
+
+typedef struct
+{
+  char   name[64];
+  int    type;                  /* 0 log, 1 linear, 2 gamma, 3 bin */
+  double gamma;
+  int    points;
+  double duty[POINTS_MAX];
+  double flux[POINTS_MAX];      /* normalised to the last point */
+} TCurve;
+
+static TCurve Curves[CURVES_MAX];
+static int CurvesCnt;
+
+/* relative output (0..1) of the IEC logarithmic curve, any level */
+static double log_curve(double level)
+{
+  return pow(10.0, 3.0 * (level - 1.0) / 253.0 - 3.0);
+}
+
+/* duty (0..1) giving the relative flux, measured points interpolated */
+static double bin_duty(const TCurve *c, double flux)
+{
+  int i;
+
+  if (flux <= c->flux[0])
+    return c->duty[0] * flux / c->flux[0];
+  for (i = 1; i < c->points; i++)
+  {
+    if (flux <= c->flux[i])
+      return c->duty[i - 1] + (c->duty[i] - c->duty[i - 1])
+             * (flux - c->flux[i - 1]) / (c->flux[i] - c->flux[i - 1]);
+  }
+  return c->duty[c->points - 1];
+}
+
+static double curve_value(const TCurve *c, double level)
+{
+  double v;
+
+  if (level > 254.0)
+    return 1.0;
+  switch (c->type)
+  {
+    case 0:
+      return log_curve(level);
+    case 1:
+      v = level / 254.0;
+      break;
+    case 2:
+      v = (level > 0.0) ? pow(level / 254.0, c->gamma) : 0.0;
+      break;
+    default:
+      return bin_duty(c, log_curve(level));
+  }
+  return (v < 0.0) ? 0.0 : v;
+}
+
+/* value of knot k of a curve, 0..65535 */
+static long knot_value(const TCurve *c, int k)
+{
+  long v;
+
+  v = (long)floor(curve_value(c, 4.0 * k - 2.0) * 65535.0 + 0.5);
+  return (v > 65535) ? 65535 : v;
+}
+
+/* Knot 0 (level -2) is only used for level 1, interpolated from knot 0 and
+   knot 1 like DALIP_ConvertARC does it: chosen so that level 1 comes out
+   right, below 0 where the curve extrapolated to level -2 is (a linear curve
+   would not be linear at its bottom with knot 0 clamped to 0). Returned
+   modulo 65536: the u16 arithmetic of DALIP_ConvertARC wraps back. */
+static long knot0_value(const TCurve *c)
+{
+  long k1, target, t, d, v, best, err, best_err;
+
+  k1 = knot_value(c, 1);
+  target = (long)floor(curve_value(c, 1.0) * 65535.0 + 0.5);
+  best = k1;
+  best_err = 65536;
+  for (t = k1; t > k1 - 65536; t--)
+  {
+    d = k1 - t;
+    v = t + (d >> 1) + (d >> 2);
+    if (v < 0)
+      continue;
+    err = labs(v - target);
+    if (err < best_err)
+    {
+      best = t;
+      best_err = err;
+    }
+    if (v < target - 1)
+      break;
+  }
+  return best & 0xFFFF;
+}
+
+static int load_bin(TCurve *c, const char *file)
+{
+  FILE *f;
+  double d;
+  double l;
+  int i;
+
+  f = fopen(file, "r");
+  if (!f)
+  {
+    fprintf(stderr, "arccurves: cannot open %s\n", file);
+    return 0;
+  }
+  c->points = 0;
+  while ((c->points < POINTS_MAX) && (fscanf(f, "%lf %lf", &d, &l) == 2))
+  {
+    if ((c->points > 0) && ((d <= c->duty[c->points - 1]) || (l <= c->flux[c->points - 1])))
+    {
+      fprintf(stderr, "arccurves: %s: duty and flux must increase\n", file);
+      fclose(f);
+      return 0;
+    }
+    c->duty[c->points] = d / 65535.0;
+    c->flux[c->points] = l;
+    c->points++;
+  }
+  fclose(f);
+  if ((c->points < 2) || (c->flux[0] <= 0.0))
+  {
+    fprintf(stderr, "arccurves: %s: need 2 points at least, flux > 0\n", file);
+    return 0;
+  }
+  l = c->flux[c->points - 1];
+  for (i = 0; i < c->points; i++)
+    c->flux[i] /= l;
+  return 1;
+}
+
+static int parse_curve(const char *arg)
+{
+  TCurve *c;
+
+  if (CurvesCnt >= CURVES_MAX)
+  {
+    fprintf(stderr, "arccurves: too many curves\n");
+    return 0;
+  }
+  c = &Curves[CurvesCnt];
+  strncpy(c->name, arg, sizeof(c->name) - 1);
+  if (!strcmp(arg, "log"))
+    c->type = 0;
+  else if (!strcmp(arg, "linear"))
+    c->type = 1;
+  else if (!strncmp(arg, "gamma:", 6))
+  {
+    c->type = 2;
+    c->gamma = atof(arg + 6);
+    if (c->gamma <= 0.0)
+    {
+      fprintf(stderr, "arccurves: bad gamma %s\n", arg + 6);
+      return 0;
+    }
+  }
+  else if (!strncmp(arg, "bin:", 4))
+  {
+    c->type = 3;
+    if (!load_bin(c, arg + 4))
+      return 0;
+  }
+  else
+  {
+    fprintf(stderr, "arccurves: unknown curve %s\n", arg);
+    return 0;
+  }
+  CurvesCnt++;
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  const char *out = "dali_curves.h";
+  FILE *f;
+  int i;
+  int k;
+  long v;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-o") && (i + 1 < argc))
+      out = argv[++i];
+    else if (!parse_curve(argv[i]))
+      return 1;
+  }
+  if (!CurvesCnt)
+  {
+    fprintf(stderr, "usage: arccurves [-o file] log|linear|gamma:<g>|bin:<file> ...\n");
+    return 1;
+  }
+
+  f = fopen(out, "w");
+  if (!f)
+  {
+    fprintf(stderr, "arccurves: cannot write %s\n", out);
+    return 1;
+  }
+  fprintf(f, "/* Dimming curves of DALIP_ConvertARC - generated by Utilities/ArcCurves\n");
+  fprintf(f, "   (arccurves");
+  for (i = 1; i < argc; i++)
+    fprintf(f, " %s", argv[i]);
+  fprintf(f, "), do not edit */\n\n");
+  fprintf(f, "#ifndef DALI_CURVES_H\n#define DALI_CURVES_H\n\n");
+  fprintf(f, "#define DALIP_CURVES_CNT   %d\n", CurvesCnt);
+  fprintf(f, "#define DALIP_CURVE_KNOTS  %d  /* value at arc level 4k-2, k = 0..%d */\n\n", KNOTS, KNOTS - 1);
+  fprintf(f, "#define DALIP_CURVES_TABLE \\\n");
+  for (i = 0; i < CurvesCnt; i++)
+  {
+    fprintf(f, "  /* %d: %s */ \\\n  {", i, Curves[i].name);
+    for (k = 0; k < KNOTS; k++)
+    {
+      v = k ? knot_value(&Curves[i], k) : knot0_value(&Curves[i]);
+      if ((k % 11) == 0)
+        fprintf(f, " \\\n   ");
+      fprintf(f, "%6ld%s", v, (k < KNOTS - 1) ? "," : "");
+    }
+    fprintf(f, " \\\n  }%s \\\n", (i < CurvesCnt - 1) ? "," : "");
+  }
+  fprintf(f, "\n#endif\n");
+  fclose(f);
+  return 0;
+}
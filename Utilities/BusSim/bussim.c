@@ -0,0 +1,328 @@
+/**
+  ******************************************************************************
+  * @file    bussim.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: simulates several multi-master transmitters on one bus
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory:
+
+     cc -DDALI_LINES=64 -I../HostShim/inc -I../HostShim -I../../Project/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc bussim.c
+        ../HostShim/hostshim.c ../../Project/src/DALIslave.c -o bussim
+
+     bussim [-n devices] [-r events/s] [-p priority] [-b burst period s]
+            [-d delay] [-t seconds] [-s seed]
+
+   Each device is one line of the driver Project/src/DALIslave.c, compiled
+   for the host with DALI_LINES lines (HostShim: the registers are memory):
+   its multi-master transmitter (send_forward, settling time, read back,
+   collision break, DALI_TX_ATTEMPTS attempts) and its decoder run as on the
+   target, this tool is only the bus and the application. Devices queue 24
+   bit event frames (first byte = device number, so two frames always
+   differ) at random (-r, Poisson) and, with -b, all at the same time every
+   period. -p 0 gives each event a random priority 1..5.
+
+   Each device has its own port: DALIOUT pin 0, DALIIN pin 1. The bus is the
+   wired AND of the DALIOUT pins, sampled 8 times per tick: each device runs
+   its tick (line_tick) at its own phase, as the timers of real devices are
+   not synchronous, and sees the bus -d subticks late (interface delay,
+   default 2 = 26us) at its DALIIN pin. A falling edge there calls
+   receive_edge as the port interrupt would while it is enabled (CR2).
+   TIM4->CNTR, which stirs the settling time draw, is the phase of the
+   device and a random count.
+
+   Reported: collisions per attempt, frames given up, event latency (queued
+   to end of the frame sent) per priority, and the frames the other devices
+   decoded: each sent frame must be received by all of them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "DALIslave.h"
+
+#define SUBTICKS    8
+#define DEVICES_MAX DALI_LINES
+#define QUEUE_SIZE  32
+#define LAT_SLOTS   2000          /* latency histogram, 1ms slots */
+#define DELAY_MAX   15            /* bus history, subticks */
+
+#define PIN_OUT     0
+#define PIN_IN      1
+
+typedef struct
+{
+  int  phase;                     /* subtick of the device tick */
+  int  view;                      /* bus level at DALIIN */
+  int  pending;                   /* frame given to send_forward */
+  int  priority;
+  long queued;                    /* subtick the frame was queued at */
+  long q_time[QUEUE_SIZE];        /* waiting events: queue time, priority */
+  int  q_prio[QUEUE_SIZE];
+  int  q_head;
+  int  q_cnt;
+} TDevice;
+
+/* tick counter of stm8s_it.c (1ms callback), not used here */
+__IO uint16_t oneMScounter;
+
+static TDevice Dev[DEVICES_MAX];
+static GPIO_TypeDef Port[DEVICES_MAX];
+static int Devices = 8;
+static double Rate = 2.0;
+static int Priority = 0;
+static double Burst = 0.0;
+static double Seconds = 600.0;
+static int Delay = 2;
+static int BusHistory[DELAY_MAX + 1];
+
+static long Generated, Dropped, Sent, Failed, Received, Corrupted;
+static long LatCnt[DALI_TX_PRIORITIES];
+static double LatSum[DALI_TX_PRIORITIES];
+static double LatMax[DALI_TX_PRIORITIES];
+static long LatHist[DALI_TX_PRIORITIES][LAT_SLOTS];
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+static double rnd01(void)
+{
+  return (double)rnd() / 16777216.0;
+}
+
+/* frame decoded by a device: the first byte names the sender */
+static void frame_received(u8 line, u8 bits, u8 *frame)
+{
+  if ((bits == DALI_FRAME_24) && (frame[0] < Devices) && (frame[0] != line))
+    Received++;
+  else
+    Corrupted++;
+}
+
+static void bus_error(u8 line, u8 code)
+{
+  (void)line;
+  (void)code;
+}
+
+static void tick_1ms(void)
+{
+}
+
+static void queue_event(int n, long now)
+{
+  TDevice *d = &Dev[n];
+  int i;
+
+  Generated++;
+  if (d->q_cnt >= QUEUE_SIZE)
+  {
+    Dropped++;
+    return;
+  }
+  i = (d->q_head + d->q_cnt) % QUEUE_SIZE;
+  d->q_time[i] = now;
+  d->q_prio[i] = Priority ? Priority : 1 + (int)(rnd() % DALI_TX_PRIORITIES);
+  d->q_cnt++;
+}
+
+static void record_latency(TDevice *d, long now)
+{
+  double ms = (double)(now - d->queued) * 1000.0 / (TICKS_PER_SECOND * SUBTICKS);
+  int p = d->priority - 1;
+  int slot = (int)ms;
+
+  LatCnt[p]++;
+  LatSum[p] += ms;
+  if (ms > LatMax[p])
+    LatMax[p] = ms;
+  if (slot >= LAT_SLOTS)
+    slot = LAT_SLOTS - 1;
+  LatHist[p][slot]++;
+}
+
+/* application of the device: result of the frame sent, next event of the
+   queue to the transmitter */
+static void device_main(int n, long now)
+{
+  TDevice *d = &Dev[n];
+  u8 frame[DALI_FRAME_BYTES];
+  u8 status;
+
+  if (d->pending)
+  {
+    status = get_send_status(n);
+    if (status == DALI_TX_PENDING)
+      return;
+    d->pending = 0;
+    if (status == DALI_TX_DONE)
+    {
+      Sent++;
+      record_latency(d, now);
+    }
+    else
+      Failed++;
+  }
+  if (!d->q_cnt)
+    return;
+  frame[0] = (u8)n;
+  frame[1] = (u8)rnd();
+  frame[2] = (u8)rnd();
+  frame[3] = 0;
+  d->priority = d->q_prio[d->q_head];
+  d->queued = d->q_time[d->q_head];
+  TIM4->CNTR = (u8)rnd();
+  if (!send_forward(n, DALI_FRAME_24, frame, (u8)d->priority, 0))
+    return;
+  d->q_head = (d->q_head + 1) % QUEUE_SIZE;
+  d->q_cnt--;
+  d->pending = 1;
+}
+
+/* level at DALIIN of the device, start edge to the decoder as the port
+   interrupt would */
+static void device_input(int n, int bus)
+{
+  TDevice *d = &Dev[n];
+
+  if (bus)
+    Port[n].IDR |= (1 << PIN_IN);
+  else
+    Port[n].IDR &= ~(1 << PIN_IN);
+  if (d->view && !bus && (Port[n].CR2 & (1 << PIN_IN)))
+    receive_edge(&Port[n]);
+  d->view = bus;
+}
+
+/* one tick of the device: the timer counts from its phase */
+static void device_tick(int n)
+{
+  TIM4->CNTR = (u8)(Dev[n].phase + (rnd() & 0xF0));
+  line_tick(n);
+  /* DALIOUT is read back from its input data register */
+  Port[n].IDR = (u8)((Port[n].IDR & ~(1 << PIN_OUT)) | (Port[n].ODR & (1 << PIN_OUT)));
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: bussim [-n devices] [-r events/s] [-p priority 0..5] [-b burst period s] [-d delay 0..%d] [-t seconds] [-s seed]\n", DELAY_MAX);
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  long now;
+  long end;
+  long burst_period;
+  double p_event;
+  int bus;
+  int i;
+  int n;
+  int p;
+  long k;
+  long total;
+  unsigned long attempts;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 'n': Devices = atoi(argv[++i]); break;
+      case 'r': Rate = atof(argv[++i]); break;
+      case 'p': Priority = atoi(argv[++i]); break;
+      case 'b': Burst = atof(argv[++i]); break;
+      case 'd': Delay = atoi(argv[++i]); break;
+      case 't': Seconds = atof(argv[++i]); break;
+      case 's': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((Devices < 1) || (Devices > DEVICES_MAX) || (Priority < 0) || (Priority > DALI_TX_PRIORITIES)
+      || (Delay < 0) || (Delay > DELAY_MAX))
+    usage();
+
+  CLK->CMSR = CLK_SOURCE_HSI;
+  CLK->CKDIVR = 0;
+  for (n = 0; n < Devices; n++)
+  {
+    memset(&Dev[n], 0, sizeof(TDevice));
+    Dev[n].phase = (int)(rnd() % SUBTICKS);
+    Dev[n].view = 1;
+    init_DALI(n, &Port[n], PIN_OUT, 0, &Port[n], PIN_IN, 0, frame_received, bus_error, tick_1ms);
+    Port[n].IDR = (1 << PIN_OUT) | (1 << PIN_IN);
+  }
+
+  end = (long)(Seconds * TICKS_PER_SECOND * SUBTICKS);
+  burst_period = (long)(Burst * TICKS_PER_SECOND * SUBTICKS);
+  p_event = Rate / TICKS_PER_SECOND;
+  for (i = 0; i <= DELAY_MAX; i++)
+    BusHistory[i] = 1;
+  for (now = 0; now < end; now++)
+  {
+    bus = 1;
+    for (n = 0; n < Devices; n++)
+      bus &= Port[n].ODR >> PIN_OUT;
+    BusHistory[now % (DELAY_MAX + 1)] = bus & 1;
+    bus = BusHistory[(now + DELAY_MAX + 1 - Delay) % (DELAY_MAX + 1)];
+    if (burst_period && (now % burst_period == burst_period / 2))
+      for (n = 0; n < Devices; n++)
+        queue_event(n, now);
+    for (n = 0; n < Devices; n++)
+    {
+      device_input(n, bus);
+      if ((now % SUBTICKS) != Dev[n].phase)
+        continue;
+      if ((p_event > 0.0) && (rnd01() < p_event))
+        queue_event(n, now);
+      device_main(n, now);
+      device_tick(n);
+    }
+  }
+
+  attempts = DALIStats.tx_frames + DALIStats.collisions;
+  printf("devices %d, %.2f events/s each, bursts every %.2f s, delay %d, %.0f s simulated\n",
+         Devices, Rate, Burst, Delay, Seconds);
+  printf("events %ld, sent %ld, given up %ld, dropped (queue full) %ld\n", Generated, Sent, Failed, Dropped);
+  printf("attempts %lu, collisions %lu (%.2f%% of attempts)\n", attempts, (unsigned long)DALIStats.collisions,
+         attempts ? 100.0 * DALIStats.collisions / attempts : 0.0);
+  printf("decoded by the others %ld of %ld, corrupted %ld, decoder errors start %lu stop %lu edge %lu\n",
+         Received, (long)DALIStats.tx_frames * (Devices - 1), Corrupted, (unsigned long)DALIStats.err_start,
+         (unsigned long)DALIStats.err_stop, (unsigned long)DALIStats.err_edge);
+  printf("latency (ms)  events     mean      p95      max\n");
+  for (p = 0; p < DALI_TX_PRIORITIES; p++)
+  {
+    if (!LatCnt[p])
+      continue;
+    total = 0;
+    for (k = 0; k < LAT_SLOTS; k++)
+    {
+      total += LatHist[p][k];
+      if (total * 100 >= LatCnt[p] * 95)
+        break;
+    }
+    printf("priority %d  %8ld %8.1f %8ld %8.1f\n", p + 1, LatCnt[p], LatSum[p] / LatCnt[p], k + 1, LatMax[p]);
+  }
+  return 0;
+}
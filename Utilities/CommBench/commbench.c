@@ -0,0 +1,404 @@
+/**
+  ******************************************************************************
+  * @file    commbench.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: commissioning of many devices powered up together
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory (the random
+   generator of the stack, see Utilities/HostShim):
+
+     cc -I../HostShim/inc -I../HostShim -I../../Project/inc
+        -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc commbench.c
+        ../HostShim/hostshim.c ../../Libraries/DALIStack/src/dali_rand.c
+        -o commbench
+
+     commbench [-n devices] [-t trials] [-f HSI tolerance %] [-s seed]
+
+   -n devices (default 64) power up at the same time and are commissioned by
+   a controller, -t times (default 1000). Each device runs the random
+   generator of the stack, Libraries/DALIStack/src/dali_rand.c, on its own
+   pool (RandomPool saved and restored around each call) as the stack
+   calls it:
+   - DALIRnd_Init at power on: its serial number in DALIM_E2 (bank 0,
+     consecutive numbers, same GTIN), ADC conversions (HostAdcValue) with
+     one noise LSB of its own
+   - DALIRnd_Mix of the start edge phase of each frame received: TIM4
+     counter of the device at the edge, its HSI off by up to -f percent
+     (default 1, the factory trimming) and its timer started within 2us
+   - DALIRnd_Next (3 x) at RANDOMIZE, TIM4 counter 50us after the frame
+   The controller sends INITIALISE and RANDOMIZE (twice each), then finds
+   the lowest random address by binary search (SEARCHADDRH/M/L only when
+   they change, COMPARE), programs a short address there and checks it with
+   QUERY SHORT ADDRESS: one answer: WITHDRAW, answers colliding (devices
+   with the same random address): the short address is taken back and
+   RANDOMIZE sent again. Frames take 24ms, queries 40ms with the answer.
+
+   Rows: the generator of the stack with all sources, without serial number
+   (bank 0 not burnt in), without ADC noise, with neither (edge phases
+   only), and the generator before the entropy pool (TIM4 counter and a 2
+   bit counter). Reported per trial: RANDOMIZE rounds, devices which drew a
+   random address of another one (collisions, per device randomized),
+   COMPARE frames, frames and bus time; trials with more than 30 rounds
+   are given up. Exit status 1 if a trial with all sources is given up;
+   -f 0 (HSI of all devices the same) shows what the serial number and the
+   ADC noise are for. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "dali_config.h"
+#include "dali_mem.h"
+#include "dali_rand.h"
+
+#define DEVICES_MAX     256
+#define TIM4_COUNTS     208           /* TIM4 counts per tick, 16MHz / 8 / 9600 */
+#define TICK_S          (1.0 / 9600)
+#define FRAME_S         0.024
+#define QUERY_S         0.040
+#define EDGE_TO_END_S   0.0158        /* forward frame, start edge to stop bits */
+#define RANDOMIZE_S     0.00005       /* frame end to DALIC_Randomize */
+#define BOOT_S          2.0           /* power on to the first frame */
+#define ROUNDS_MAX      30
+#define SERIAL_FIRST    0x0B          /* bank 0: serial number, MSB first */
+#define NO_SHORT        0xFF
+
+#define SRC_SERIAL      0x01
+#define SRC_ADC         0x02
+#define SRC_LEGACY      0x04
+
+typedef struct
+{
+  u32 pool;                           /* RandomPool of the device */
+  double clock;                       /* HSI frequency / nominal */
+  double start;                       /* timer start after power on, s */
+  u32 random;                         /* random address */
+  u8 short_addr;
+  u8 withdrawn;
+  u8 legacy;                          /* RandomCounter of the generator before */
+} TDevice;
+
+typedef struct
+{
+  const char *name;
+  int sources;
+} TRow;
+
+static const TRow Rows[] =
+{
+  { "pool, all sources",        SRC_SERIAL | SRC_ADC },
+  { "pool, no serial number",   SRC_ADC },
+  { "pool, no ADC noise",       SRC_SERIAL },
+  { "pool, edge phases only",   0 },
+  { "TIM4 counter (before)",    SRC_LEGACY },
+};
+
+/* memory bank 0 and 1 storage of the stack (dali_mem.c is not linked) */
+u8 DALIM_E2[DALIM_E2_SIZE];
+extern u32 RandomPool;
+
+static TDevice Dev[DEVICES_MAX];
+static int Devices = 64;
+static long Trials = 1000;
+static double Tolerance = 1.0;
+static int Sources;
+static TDevice *Current;              /* device whose generator runs */
+static double Now;                    /* s from power on */
+static long Frames;
+static double BusTime;
+static long Compares;
+static long Randomized;
+static long Collided;
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+static double rnd01(void)
+{
+  return (double)rnd() / 16777216.0;
+}
+
+/* ADC input of the device: mid scale, one noise LSB (SRC_ADC) */
+static u16 adc_value(void)
+{
+  return (u16)(0x200 + ((Sources & SRC_ADC) ? (rnd() & 1) : 0));
+}
+
+/* TIM4 counter of the device at time t */
+static u8 timer_count(TDevice *d, double t)
+{
+  double ticks = (t - d->start) * d->clock / TICK_S;
+
+  return (u8)((ticks - (double)(long)ticks) * TIM4_COUNTS);
+}
+
+/* runs the generator of device d: its pool in RandomPool */
+static void select_device(TDevice *d)
+{
+  if (Current)
+    Current->pool = RandomPool;
+  Current = d;
+  RandomPool = d->pool;
+}
+
+static u8 legacy_random(TDevice *d, double t)
+{
+  u8 count = timer_count(d, t);
+
+  d->legacy++;
+  switch (d->legacy & 0x03)
+  {
+    case 0:  return count;
+    case 1:  return (u8)~count;
+    case 2:  return (u8)((count >> 1) ^ count);
+    default: return (u8)(count ^ d->legacy);
+  }
+}
+
+static void power_on(void)
+{
+  TDevice *d;
+  u32 serial = rnd();
+  int i;
+
+  Current = NULL;
+  memset(DALIM_E2, 0, sizeof(DALIM_E2));
+  for (i = DALIRND_ID_FIRST; i < SERIAL_FIRST; i++)
+    DALIM_E2[i] = (u8)(0x40 + i);           /* GTIN, firmware version */
+  for (i = 0; i < Devices; i++)
+  {
+    d = &Dev[i];
+    memset(d, 0, sizeof(*d));
+    d->clock = 1.0 + (2.0 * rnd01() - 1.0) * Tolerance / 100.0;
+    d->start = rnd01() * 2e-6;
+    d->short_addr = NO_SHORT;
+    if (Sources & SRC_SERIAL)
+    {
+      DALIM_E2[SERIAL_FIRST] = (u8)(serial >> 24);
+      DALIM_E2[SERIAL_FIRST + 1] = (u8)(serial >> 16);
+      DALIM_E2[SERIAL_FIRST + 2] = (u8)(serial >> 8);
+      DALIM_E2[SERIAL_FIRST + 3] = (u8)serial;
+      serial++;
+    }
+    select_device(d);
+    TIM4->CNTR = 0;
+    DALIRnd_Init();
+  }
+  select_device(&Dev[0]);
+  Now = BOOT_S;
+}
+
+/* forward frame on the bus: each device mixes its start edge phase */
+static void frame(double duration)
+{
+  int i;
+
+  for (i = 0; i < Devices; i++)
+  {
+    select_device(&Dev[i]);
+    DALIRnd_Mix(timer_count(&Dev[i], Now));
+  }
+  Now += duration;
+  Frames++;
+}
+
+/* RANDOMIZE, sent twice: new random address of the devices */
+static void randomize(void)
+{
+  TDevice *d;
+  double t;
+  int i;
+  int j;
+
+  frame(FRAME_S);
+  frame(FRAME_S);
+  t = Now - FRAME_S + EDGE_TO_END_S + RANDOMIZE_S;
+  for (i = 0; i < Devices; i++)
+  {
+    d = &Dev[i];
+    if (Sources & SRC_LEGACY)
+    {
+      d->random = (u32)legacy_random(d, t) << 16;
+      d->random |= (u32)legacy_random(d, t) << 8;
+      d->random |= legacy_random(d, t);
+    }
+    else
+    {
+      select_device(d);
+      TIM4->CNTR = timer_count(d, t);
+      d->random = (u32)DALIRnd_Next() << 16;
+      d->random |= (u32)DALIRnd_Next() << 8;
+      d->random |= DALIRnd_Next();
+    }
+  }
+  for (i = 0; i < Devices; i++)
+  { // devices still to find which share their random address
+    if (Dev[i].withdrawn)
+      continue;
+    Randomized++;
+    for (j = 0; j < Devices; j++)
+      if ((j != i) && !Dev[j].withdrawn && (Dev[j].random == Dev[i].random))
+      {
+        Collided++;
+        break;
+      }
+  }
+}
+
+/* COMPARE: any device not withdrawn with random <= search answers */
+static int compare(u32 search, u32 *sent)
+{
+  int i;
+  int shift;
+
+  for (shift = 16; shift >= 0; shift -= 8)
+    if (((search >> shift) & 0xFF) != ((*sent >> shift) & 0xFF))
+      frame(FRAME_S);                       /* SEARCHADDRH/M/L */
+  *sent = search;
+  frame(QUERY_S);
+  Compares++;
+  for (i = 0; i < Devices; i++)
+    if (!Dev[i].withdrawn && (Dev[i].random <= search))
+      return 1;
+  return 0;
+}
+
+/* one commissioning, returns the RANDOMIZE rounds, 0 if given up */
+static int commission(void)
+{
+  u32 sent = 0x1000000UL;                   /* no search address sent yet */
+  u32 addr;
+  int rounds = 1;
+  int next = 0;
+  int found;
+  int bit;
+  int i;
+
+  power_on();
+  frame(FRAME_S);                           /* INITIALISE, twice */
+  frame(FRAME_S);
+  randomize();
+  while (compare(0xFFFFFFUL, &sent))
+  {
+    addr = 0;
+    for (bit = 23; bit >= 0; bit--)
+      if (!compare(addr | ((1UL << bit) - 1), &sent))
+        addr |= 1UL << bit;
+    frame(FRAME_S);                         /* PROGRAM SHORT ADDRESS */
+    found = 0;
+    for (i = 0; i < Devices; i++)
+      if (!Dev[i].withdrawn && (Dev[i].random == addr))
+      {
+        Dev[i].short_addr = (u8)next;
+        found++;
+      }
+    frame(QUERY_S);                         /* QUERY SHORT ADDRESS */
+    if (found == 1)
+    {
+      frame(FRAME_S);                       /* WITHDRAW */
+      for (i = 0; i < Devices; i++)
+        if (Dev[i].short_addr == next)
+          Dev[i].withdrawn = 1;
+      next++;
+      continue;
+    }
+    frame(FRAME_S);                         /* DTR = MASK, STORE DTR AS SHORT ADDRESS twice */
+    frame(FRAME_S);
+    frame(FRAME_S);
+    for (i = 0; i < Devices; i++)
+      if (Dev[i].short_addr == next)
+        Dev[i].short_addr = NO_SHORT;
+    if (++rounds > ROUNDS_MAX)
+      return 0;
+    randomize();
+  }
+  return rounds;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: commbench [-n devices 2..%d] [-t trials] [-f HSI tolerance %%] [-s seed]\n", DEVICES_MAX);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long seed;
+  long rounds;
+  long failed;
+  long trial;
+  int status = 0;
+  int r;
+  int row;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 'n': Devices = atoi(argv[++i]); break;
+      case 't': Trials = atol(argv[++i]); break;
+      case 'f': Tolerance = atof(argv[++i]); break;
+      case 's': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((Devices < 2) || (Devices > DEVICES_MAX) || (Trials < 1) || (Tolerance < 0))
+    usage();
+
+  HostAdcValue = adc_value;
+  seed = Seed;
+  printf("%d devices powered up together, HSI within %.1f%%, %ld trials\n", Devices, Tolerance, Trials);
+  printf("generator                  rounds  collisions %%  COMPARE  frames  bus s   given up\n");
+  for (row = 0; row < (int)(sizeof(Rows) / sizeof(Rows[0])); row++)
+  {
+    Seed = seed;
+    Sources = Rows[row].sources;
+    rounds = 0;
+    failed = 0;
+    Frames = 0;
+    BusTime = 0;
+    Compares = 0;
+    Randomized = 0;
+    Collided = 0;
+    for (trial = 0; trial < Trials; trial++)
+    {
+      r = commission();
+      if (r)
+        rounds += r;
+      else
+        failed++;
+      BusTime += Now - BOOT_S;
+    }
+    printf("%-25s %7.2f %13.4f %8.0f %7.0f %6.1f %10ld\n", Rows[row].name,
+           (Trials > failed) ? (double)rounds / (Trials - failed) : 0.0,
+           Randomized ? 100.0 * Collided / Randomized : 0.0, (double)Compares / Trials, (double)Frames / Trials,
+           BusTime / Trials, failed);
+    if (Sources == (SRC_SERIAL | SRC_ADC))
+      status = failed ? 1 : 0;
+  }
+  return status;
+}
@@ -0,0 +1,401 @@
+/**
+  ******************************************************************************
+  * @file    e2stress.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: bus traffic while the data EEPROM is programmed
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory (firmware sources,
+   see Utilities/HostShim):
+
+     cc -I../HostShim/inc -I../HostShim -I../../Project/inc
+        -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc e2stress.c
+        ../HostShim/hostshim.c ../HostShim/hostctl.c ../../Project/src/DALIslave.c
+        ../../Project/src/stm8s_it.c ../../Libraries/DALIStack/src/dali*.c
+        ../../Libraries/DALIStack/src/eeprom.c
+        ../../Libraries/DALIStack/src/lite_timer_8bit.c -o e2stress
+
+     e2stress [-t seconds] [-a application write interval ms] [-p priority]
+              [-r seed]
+
+   A controller (HostShim/hostctl.c) and one control gear, the firmware of
+   this project: TIM4 interrupt and one pass of the main loop each tick,
+   port interrupt at the start edge of a frame. The controller sends without
+   a break: DTR, STORE DTR AS SCENE (twice) and QUERY SCENE LEVEL, scene and
+   value changing each time, so each store programs a byte of the data
+   EEPROM. The application of the gear writes its own EEPROM byte
+   (DALIP_Write_E2) each -a ms, 0 (default): again as soon as the previous
+   write is done, the EEPROM is programming all the time; -1: none.
+
+   A byte takes 6ms to program, the store waits for it: the main loop stops
+   for that time. Run with two models of the part:
+     read-while-write   STM8S105/207/208: the CPU goes on fetching from
+                        flash, the interrupts (bit sampling, reply timing)
+                        run as usual while the main loop waits
+     CPU stalled        STM8S103/903: no fetch from flash until the byte
+                        is programmed, interrupts included: the vector
+                        table is in flash, handlers in RAM would not help
+   Reported per model: forward frames sent and decoded by the gear, decoding
+   errors, queries answered with the value stored, the start of the answers
+   after the stop bits of the query (7..22 Te, 2.9..9.2ms: the controller
+   waits DALI_TX_ANSWER_TICKS) and the EEPROM bytes programmed. Last the gear is power cycled and the scenes
+   read back from EEPROM.
+
+   Exit code 1 if with read-while-write a frame is lost or not decoded, a
+   query not answered right or in time, or a scene is not in EEPROM. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "hostctl.h"
+#include "stm8s_it.h"
+#include "dali_config.h"
+#include "dali.h"
+#include "dali_diag.h"
+#include "dali_pub.h"
+#include "DALIslave.h"
+
+#define SUBTICKS        8
+#define DELAY           2             /* bus to the inputs, subticks */
+#define CTL_OUT         0             /* pins of the controller port */
+#define CTL_IN          1
+#define E2_TICKS        58            /* EEPROM byte, erase and write (6ms) */
+#define ANSWER_MIN      28            /* answer after the stop bits: 7 Te, */
+#define ANSWER_MAX      DALI_TX_ANSWER_TICKS /* the window of the controller (22 Te) */
+#define SCENES          16
+
+/* frames: special commands, broadcast commands */
+#define DALI_DTR        0xA3
+#define DALI_BROADCAST  0xFF
+#define DALI_STORE_SCENE 0x40         /* STORE DTR AS SCENE, send twice */
+#define DALI_QUERY_SCENE 0xB0         /* QUERY SCENE LEVEL */
+
+#define MODEL_RWW       0
+#define MODEL_STALL     1
+
+static const char *ModelNames[] =
+{
+  "read-while-write",
+  "CPU stalled",
+};
+
+static double Seconds = 60.0;
+static int AppInterval = 0;
+static int Priority = 1;
+
+static int Model;
+static long Now;                      /* subticks */
+static int BusHistory[DELAY + 1];
+static int GearView = 1;              /* bus at the DALIIN pins */
+static int CtlView = 1;
+static GPIO_TypeDef CtlPort;
+static int Busy;                      /* ticks the main loop still waits for the EEPROM */
+static int Stall;                     /* ticks the CPU still stalls */
+static long AppNext;                  /* tick of the next application write */
+static u8 AppCount;
+static u32 E2Seen;
+static long AnswerOpen = -2;               /* subtick the answer window opened, -1: not yet, -2: none */
+static double AnswerMin;              /* ticks */
+static double AnswerMax;
+static long AnswerLate;
+static u8 Scene[SCENES];              /* value stored last */
+static int Errors;
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+/* light output, not used */
+static void light(u16 level)
+{
+  (void)level;
+}
+
+static void ctl_received(u8 bits, u8 *frame)
+{
+  (void)bits;
+  (void)frame;
+}
+
+static void ctl_error(u8 code)
+{
+  (void)code;
+}
+
+static void ctl_1ms(void)
+{
+}
+
+/* one pass of the main loop of Project/src/main.c, then the application */
+static void main_pass(void)
+{
+  if (DALI_TimerStatus())
+    DALI_CheckAndExecuteTimer();
+  DALI_CheckAndExecuteReceivedCommand();
+  if ((AppInterval >= 0) && (Now / SUBTICKS >= AppNext))
+  {
+    DALIP_Write_E2(0, ++AppCount);
+    AppNext = Now / SUBTICKS + (long)AppInterval * TICKS_PER_SECOND / 1000;
+  }
+}
+
+/* power on of the gear, EEPROM kept */
+static void power_on(void)
+{
+  Busy = 0;
+  Stall = 0;
+  CLK->CKDIVR = 0x00;
+  DALI_Init(light);
+  DALI_Light_On_Done();
+  E2Seen = DALID_Counters.e2_writes;
+}
+
+/* TIM4 period of the gear: interrupt, main loop pass unless it waits for
+   the EEPROM; bytes programmed stop the main loop or the CPU */
+static void gear_tick(void)
+{
+  u32 bytes;
+
+  if (Stall)
+  {
+    Stall--;
+    return;
+  }
+  TIM4_UPD_OVF_IRQHandler();
+  if (Busy)
+  {
+    Busy--;
+    return;
+  }
+  main_pass();
+  bytes = DALID_Counters.e2_writes - E2Seen;
+  E2Seen = DALID_Counters.e2_writes;
+  if (Model == MODEL_RWW)
+    Busy = (int)bytes * E2_TICKS;
+  else
+    Stall = (int)bytes * E2_TICKS;
+}
+
+/* one subtick: bus (wired AND) seen DELAY subticks later at both inputs,
+   controller and gear ticks half a tick apart */
+static void step(void)
+{
+  GPIO_TypeDef *out = OUT_DALI_PORT;
+  GPIO_TypeDef *in = IN_DALI_PORT;
+  double ticks;
+  int gear_out;
+  int bus;
+
+  gear_out = ((out->ODR >> OUT_DALI_PIN) & 1) ^ INVERT_OUT_DALI;
+  if (!gear_out && (AnswerOpen >= 0))
+  { // start bit of the answer
+    ticks = (double)(Now - AnswerOpen) / SUBTICKS;
+    if (ticks < AnswerMin)
+      AnswerMin = ticks;
+    if (ticks > AnswerMax)
+      AnswerMax = ticks;
+    if ((ticks < ANSWER_MIN) || (ticks > ANSWER_MAX))
+      AnswerLate++;
+    AnswerOpen = -2;
+  }
+  bus = gear_out & ((CtlPort.ODR >> CTL_OUT) & 1);
+  BusHistory[Now % (DELAY + 1)] = bus;
+  bus = BusHistory[(Now + 1) % (DELAY + 1)];
+
+  CtlPort.IDR = (u8)((CtlPort.ODR & (1 << CTL_OUT)) | (bus << CTL_IN));
+  if (CtlView && !bus && (CtlPort.CR2 & (1 << CTL_IN)))
+    ctl_receive_edge(&CtlPort);
+  CtlView = bus;
+
+  out->IDR = (u8)((out->IDR & ~(1 << OUT_DALI_PIN)) | (out->ODR & (1 << OUT_DALI_PIN)));
+  if (bus ^ INVERT_IN_DALI)
+    in->IDR |= (u8)(1 << IN_DALI_PIN);
+  else
+    in->IDR &= (u8)~(1 << IN_DALI_PIN);
+  if (GearView && !bus && (in->CR2 & (1 << IN_DALI_PIN)) && !Stall)
+    EXTI_PORTB_IRQHandler();
+  GearView = bus;
+
+  if (!(Now % SUBTICKS))
+  {
+    TIM4->CNTR = (u8)rnd();
+    gear_tick();
+  }
+  else if (Now % SUBTICKS == SUBTICKS / 2)
+  {
+    TIM4->CNTR = (u8)rnd();
+    ctl_line_tick();
+  }
+  Now++;
+}
+
+static void run_ms(long ms)
+{
+  long end = Now + ms * SUBTICKS * TICKS_PER_SECOND / 1000;
+
+  while (Now < end)
+    step();
+}
+
+/* forward frame, sent once the bus is free; returns the backward frame
+   of a query or -1 */
+static int frame(u8 address, u8 data, int query)
+{
+  u8 f[2];
+  u8 status;
+
+  f[0] = address;
+  f[1] = data;
+  AnswerOpen = query ? -1 : -2;
+  ctl_send_forward(DALI_FRAME_16, f, (u8)Priority, (u8)query);
+  do
+  {
+    step();
+    status = ctl_get_send_status();
+    if ((status == DALI_TX_WAIT_ANSWER) && (AnswerOpen == -1))
+      AnswerOpen = Now;
+  } while ((status == DALI_TX_PENDING) || (status == DALI_TX_WAIT_ANSWER));
+  AnswerOpen = -2;
+  return (status == DALI_TX_ANSWER) ? ctl_get_send_answer() : -1;
+}
+
+static void check(int ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    Errors++;
+  }
+}
+
+/* traffic for Seconds with the model given, returns 0 if a frame was lost,
+   not decoded or a query not answered right */
+static int run(int model)
+{
+  TDALIStats gear = DALIStats;
+  u32 sent = ctl_DALIStats.tx_frames;
+  u32 e2 = DALID_Counters.e2_writes;
+  long end = Now + (long)(Seconds * SUBTICKS * TICKS_PER_SECOND);
+  long queries = 0;
+  long right = 0;
+  u32 received;
+  u32 errors;
+  u8 scene;
+  u8 value;
+
+  Model = model;
+  AnswerMin = 1e9;
+  AnswerMax = 0;
+  AnswerLate = 0;
+  while (Now < end)
+  {
+    scene = (u8)(rnd() % SCENES);
+    do
+      value = (u8)rnd();
+    while (value == Scene[scene]);
+    frame(DALI_DTR, value, 0);
+    frame(DALI_BROADCAST, (u8)(DALI_STORE_SCENE + scene), 0);
+    frame(DALI_BROADCAST, (u8)(DALI_STORE_SCENE + scene), 0);
+    Scene[scene] = value;
+    queries++;
+    if (frame(DALI_BROADCAST, (u8)(DALI_QUERY_SCENE + scene), 1) == value)
+      right++;
+  }
+  sent = ctl_DALIStats.tx_frames - sent;
+  received = DALIStats.frames - gear.frames;
+  errors = (DALIStats.err_start - gear.err_start) + (DALIStats.err_stop - gear.err_stop)
+           + (DALIStats.err_edge - gear.err_edge);
+  printf("%-17s %8lu %8lu %7lu %8ld %8ld %6.1f..%4.1f %8ld %9lu\n", ModelNames[model], (unsigned long)sent,
+         (unsigned long)received, (unsigned long)errors, queries, right, (AnswerMax > 0) ? AnswerMin * 1000.0 / TICKS_PER_SECOND : 0.0, AnswerMax * 1000.0 / TICKS_PER_SECOND,
+         AnswerLate, (unsigned long)(DALID_Counters.e2_writes - e2));
+  return (received == sent) && !errors && (right == queries) && !AnswerLate;
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: e2stress [-t seconds] [-a application write interval ms, -1: none] [-p priority 1..%d] [-r seed]\n",
+          DALI_TX_PRIORITIES);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  int stored;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 't': Seconds = atof(argv[++i]); break;
+      case 'a': AppInterval = atoi(argv[++i]); break;
+      case 'p': Priority = atoi(argv[++i]); break;
+      case 'r': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((Seconds <= 0) || (AppInterval < -1) || (Priority < 1) || (Priority > DALI_TX_PRIORITIES))
+    usage();
+
+  for (i = 0; i <= DELAY; i++)
+    BusHistory[i] = 1;
+  CtlPort.ODR = 1 << CTL_OUT;
+  ctl_init_DALI(&CtlPort, CTL_OUT, 0, &CtlPort, CTL_IN, 0, ctl_received, ctl_error, ctl_1ms);
+  power_on();
+  run_ms(1000);
+  for (i = 0; i < SCENES; i++)
+    Scene[i] = 0xFF;
+
+  printf("%.0f s per model, application writes %s", Seconds, (AppInterval < 0) ? "none" : "");
+  if (AppInterval == 0)
+    printf("back to back");
+  else if (AppInterval > 0)
+    printf("each %d ms", AppInterval);
+  printf(", EEPROM byte %.1f ms\n", E2_TICKS * 1000.0 / TICKS_PER_SECOND);
+  printf("model                 sent  decoded  errors  queries    right   answer ms     late  E2 bytes\n");
+  check(run(MODEL_RWW), "frames and answers with read-while-write");
+  run(MODEL_STALL);
+
+  /* scenes stored last are in EEPROM: power cycle, read back */
+  Model = MODEL_RWW;
+  AppInterval = -1;
+  run_ms(100);
+  for (i = 0; i < SCENES; i++)
+  {
+    Scene[i] = (u8)rnd();
+    frame(DALI_DTR, Scene[i], 0);
+    frame(DALI_BROADCAST, (u8)(DALI_STORE_SCENE + i), 0);
+    frame(DALI_BROADCAST, (u8)(DALI_STORE_SCENE + i), 0);
+  }
+  run_ms(100);
+  power_on();
+  run_ms(1000);
+  stored = 0;
+  for (i = 0; i < SCENES; i++)
+    stored += (frame(DALI_BROADCAST, (u8)(DALI_QUERY_SCENE + i), 1) == Scene[i]);
+  printf("power cycled: %d of %d scenes read back\n", stored, SCENES);
+  check(stored == SCENES, "scenes in EEPROM");
+  return Errors ? 1 : 0;
+}
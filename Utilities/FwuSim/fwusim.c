@@ -0,0 +1,670 @@
+/**
+  ******************************************************************************
+  * @file    fwusim.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: firmware update time over the Dali bus
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory (firmware sources
+   built with the update, see Utilities/HostShim):
+
+     cc -DDALI_FW_UPDATE -DRAM_EXECUTION -I../HostShim/inc -I../HostShim
+        -I../../Project/inc -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc fwusim.c
+        ../HostShim/hostshim.c ../HostShim/hostctl.c ../../Project/src/DALIslave.c
+        ../../Project/src/stm8s_it.c ../../Libraries/DALIStack/src/dali*.c
+        ../../Libraries/DALIStack/src/eeprom.c
+        ../../Libraries/DALIStack/src/lite_timer_8bit.c -o fwusim
+
+     fwusim [-s image bytes] [-p priority] [-c check interval]
+            [-e frame loss per mille] [-i interrupted at percent]
+            [-f power failures] [-r seed]
+
+   A controller and one control gear on a simulated bus. The gear is the
+   firmware of this project with DALI_FW_UPDATE: driver, stack, update
+   (dali_fwu.c) and boot (dali_boot.c) run as on the target, TIM4 interrupt
+   and one pass of the main loop each tick, port interrupt at the start
+   edge of a frame. Program memory and the data EEPROM are HostMem. The
+   controller is a second copy of the driver (HostShim/hostctl.c) which sends the
+   frames of the update with priority -p and waits for each to be done:
+   - START: DTR1 = DALIU_BANK, lock byte, image size and CRC-32, START
+   - per block: DTR = DALIU_LOC_BLOCK, ENABLE WRITE MEMORY twice, block
+     number, CRC-16, FLASH_BLOCK_SIZE data writes; DALIU_LOC_NEXT is read
+     back (DTR, 2 x READ MEMORY LOCATION) each -c blocks and after a write
+     without answer, the controller goes on from the block given there
+   Transfer modes:
+     reply, stop and wait   WRITE MEMORY LOCATION, NEXT read after each block
+     reply, overlapped      WRITE MEMORY LOCATION, block programmed in the
+                            settling time before the next frame
+     no reply, overlapped   WRITE MEMORY LOCATION - NO REPLY
+   While the gear programs a block its CPU stalls for 6ms (interrupts
+   masked, ticks lost): a frame in that time is lost. -e drops forward
+   frames at the input of the gear.
+
+   Then the transfer is interrupted at -i percent, the gear power cycled and
+   START sent again: it resumes at the block kept in EEPROM.
+
+   INSTALL: the gear resets, the boot swaps the slots and starts the new
+   image on trial. It is done once cleanly (word and EEPROM writes give the
+   swap time, 6ms each) and -f more times with power failures at random
+   stores (EEPROM or flash, the cell written is left with a wrong value),
+   again and again at random while the gear powers up: each time slot A
+   must hold the new image, slot B the old one and the record DALIU_TRIAL.
+   Last the trial: a new image which hangs (the main loop stops) is reset by
+   the independent watchdog until it is rolled back after DALIU_TRIALS
+   resets, one which runs confirms itself after DALIU_CONFIRM_S.
+
+   A reset runs the boot and DALI_Init again. RAM of the firmware is not
+   cleared, except for the diagnostics counters (uptime). Exit code 1 if
+   any check failed. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "hostctl.h"
+#include "stm8s_it.h"
+#include "stm8s_iwdg.h"
+#include "dali_config.h"
+#include "dali.h"
+#include "dali_diag.h"
+#include "dali_fwu.h"
+#include "DALIslave.h"
+
+#define SUBTICKS        8
+#define DELAY           2             /* bus to the inputs, subticks */
+#define CTL_OUT         0             /* pins of the controller port */
+#define CTL_IN          1
+#define PROGRAM_TICKS   58            /* flash block, standard mode (6ms) */
+#define WRITE_MS        6.0           /* flash word or EEPROM byte */
+#define IWDG_TICKS      (TICKS_PER_SECOND * 102L / 100)  /* prescaler 256, reload 0xFF */
+
+/* frames: special commands, broadcast commands */
+#define DALI_TERMINATE  0xA1
+#define DALI_DTR        0xA3
+#define DALI_DTR1       0xC3
+#define DALI_WRITE      0xC7          /* WRITE MEMORY LOCATION */
+#define DALI_WRITE_NR   0xC9          /* WRITE MEMORY LOCATION - NO REPLY */
+#define DALI_BROADCAST  0xFF
+#define DALI_ENABLE_WM  0x81          /* ENABLE WRITE MEMORY, send twice */
+#define DALI_READ_MEM   0xC5          /* READ MEMORY LOCATION */
+
+#define MODE_STOP_WAIT  0
+#define MODE_REPLY      1
+#define MODE_NO_REPLY   2
+
+static const char *ModeNames[] =
+{
+  "reply, stop and wait",
+  "reply, overlapped",
+  "no reply, overlapped",
+};
+
+static long ImageSize = 8192;
+static int Priority = 1;
+static int CheckEvery = 8;
+static int LossPerMille = 0;
+static int Interrupted = 50;
+static int PowerFails = 100;
+
+static u8 OldImage[DALIU_SLOT_SIZE];  /* slot A at the start */
+static u8 NewImage[DALIU_SLOT_SIZE];  /* image transferred, 0 after its end */
+static u8 Snapshot[0x10000];          /* HostMem with the new image READY */
+static long Blocks;
+static u32 ImageCrc;
+
+static long Now;                      /* subticks */
+static int BusHistory[DELAY + 1];
+static int GearView = 1;              /* bus at the DALIIN pins */
+static int CtlView = 1;
+static GPIO_TypeDef CtlPort;
+static int Lose;                      /* forward frame queued is lost at the gear */
+static int Stall;                     /* ticks the gear CPU still stalls */
+static u32 BlocksSeen;
+static int HangNew;                   /* new image hangs once it runs */
+static int Hang;
+static long IwdgTicks;
+static long Resets;
+static long Watchdogs;
+static long Failures;                 /* power failures */
+static u32 FailSpan;                  /* stores of a clean install */
+static int Errors;
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+static u32 crc32(u32 crc, const u8 *p, long n)
+{
+  int i;
+
+  while (n--)
+  {
+    crc ^= *p++;
+    for (i = 0; i < 8; i++)
+      crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320UL) : (crc >> 1);
+  }
+  return crc;
+}
+
+static u16 crc16(const u8 *p, int n)
+{
+  u16 crc = 0xFFFF;
+  int i;
+
+  while (n--)
+  {
+    crc ^= (u16)(*p++ << 8);
+    for (i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (u16)((crc << 1) ^ 0x1021) : (u16)(crc << 1);
+  }
+  return crc;
+}
+
+/* image linked for slot A: vector table, then random code of size bytes */
+static void make_image(u8 *image, long size)
+{
+  long i;
+
+  memset(image, 0, DALIU_SLOT_SIZE);
+  for (i = 0; i < size; i++)
+    image[i] = (u8)rnd();
+  for (i = 0; i < DALIU_VECTORS; i++)
+  {
+    image[4 * i] = 0x82;
+    image[4 * i + 1] = 0;
+    image[4 * i + 2] = (u8)((DALIU_SLOT_A + 0x100 + 4 * i) >> 8);
+    image[4 * i + 3] = (u8)(DALIU_SLOT_A + 0x100 + 4 * i);
+  }
+}
+
+static u8 record(u8 offset)
+{
+  return HostMem[DALIU_E2_ADDRESS + offset];
+}
+
+/* light output, not used */
+static void light(u16 level)
+{
+  (void)level;
+}
+
+static void ctl_received(u8 bits, u8 *frame)
+{
+  (void)bits;
+  (void)frame;
+}
+
+static void ctl_error(u8 code)
+{
+  (void)code;
+}
+
+static void ctl_1ms(void)
+{
+}
+
+/* one pass of the main loop of Project/src/main.c */
+static void main_pass(void)
+{
+  if (DALI_TimerStatus())
+    DALI_CheckAndExecuteTimer();
+  DALI_CheckAndExecuteReceivedCommand();
+}
+
+/* power on or reset of the gear: boot (slot swap), DALI_Init. A reset or a
+   power failure on the way starts it over. */
+static void power_on(void)
+{
+  for (;;)
+  {
+    switch (setjmp(HostResetPoint))
+    {
+      case 0:
+        break;
+      case 2:
+        Failures++;
+        HostPowerFail = (rnd() & 1) ? HostWrites + 1 + rnd() % FailSpan : 0;
+        continue;
+      default:
+        Resets++;
+        continue;
+    }
+    break;
+  }
+  Stall = 0;
+  IwdgTicks = 0;
+  IWDG->KR = 0;
+  memset(&DALID_Counters, 0, sizeof(DALID_Counters));
+  DALID_UptimeMs = 0;
+  DALIU_BootSwap();
+  Hang = HangNew && !memcmp(&HostMem[DALIU_SLOT_A], NewImage, DALIU_SLOT_SIZE);
+  CLK->CKDIVR = 0x00;
+  DALI_Init(light);
+  DALI_Light_On_Done();
+  BlocksSeen = HostBlocks;
+}
+
+/* TIM4 period of the gear: interrupt, main loop pass, watchdog */
+static void gear_tick(void)
+{
+  switch (setjmp(HostResetPoint))
+  {
+    case 0:
+      break;
+    case 2:
+      Failures++;
+      HostPowerFail = (rnd() & 1) ? HostWrites + 1 + rnd() % FailSpan : 0;
+      power_on();
+      return;
+    default:
+      Resets++;
+      power_on();
+      return;
+  }
+  if (Stall)
+  {
+    Stall--;
+    return;
+  }
+  TIM4_UPD_OVF_IRQHandler();
+  if (!Hang)
+    main_pass();
+  if (HostBlocks != BlocksSeen)
+  { // flash block programmed: the CPU stalls
+    BlocksSeen = HostBlocks;
+    Stall = PROGRAM_TICKS;
+  }
+  if (IWDG->KR == IWDG_KEY_REFRESH)
+  {
+    IWDG->KR = 0;
+    IwdgTicks = 0;
+  }
+  else if (DALIU_Watchdog() && (++IwdgTicks > IWDG_TICKS))
+  {
+    Watchdogs++;
+    DALIU_RESET();
+  }
+}
+
+/* one subtick: bus (wired AND) seen DELAY subticks later at both inputs,
+   controller and gear ticks half a tick apart */
+static void step(void)
+{
+  GPIO_TypeDef *out = OUT_DALI_PORT;
+  GPIO_TypeDef *in = IN_DALI_PORT;
+  int bus;
+  int gear;
+
+  bus = (((out->ODR >> OUT_DALI_PIN) & 1) ^ INVERT_OUT_DALI) & ((CtlPort.ODR >> CTL_OUT) & 1);
+  BusHistory[Now % (DELAY + 1)] = bus;
+  bus = BusHistory[(Now + 1) % (DELAY + 1)];
+
+  CtlPort.IDR = (u8)((CtlPort.ODR & (1 << CTL_OUT)) | (bus << CTL_IN));
+  if (CtlView && !bus && (CtlPort.CR2 & (1 << CTL_IN)))
+    ctl_receive_edge(&CtlPort);
+  CtlView = bus;
+
+  gear = (Lose && (ctl_get_send_status() == DALI_TX_PENDING)) ? 1 : bus;
+  out->IDR = (u8)((out->IDR & ~(1 << OUT_DALI_PIN)) | (out->ODR & (1 << OUT_DALI_PIN)));
+  if (gear ^ INVERT_IN_DALI)
+    in->IDR |= (u8)(1 << IN_DALI_PIN);
+  else
+    in->IDR &= (u8)~(1 << IN_DALI_PIN);
+  if (GearView && !gear && (in->CR2 & (1 << IN_DALI_PIN)) && !Stall)
+    EXTI_PORTB_IRQHandler();
+  GearView = gear;
+
+  if (!(Now % SUBTICKS))
+  {
+    TIM4->CNTR = (u8)rnd();
+    gear_tick();
+  }
+  else if (Now % SUBTICKS == SUBTICKS / 2)
+  {
+    TIM4->CNTR = (u8)rnd();
+    ctl_line_tick();
+  }
+  Now++;
+}
+
+static void run_ms(long ms)
+{
+  long end = Now + ms * SUBTICKS * TICKS_PER_SECOND / 1000;
+
+  while (Now < end)
+    step();
+}
+
+static double seconds(long subticks)
+{
+  return (double)subticks / SUBTICKS / TICKS_PER_SECOND;
+}
+
+/* forward frame, sent once the bus is free; returns the backward frame
+   of a query or -1 */
+static int frame(u8 address, u8 data, int query)
+{
+  u8 f[2];
+  u8 status;
+
+  f[0] = address;
+  f[1] = data;
+  Lose = (int)(rnd() % 1000) < LossPerMille;
+  ctl_send_forward(DALI_FRAME_16, f, (u8)Priority, (u8)query);
+  do
+    step();
+  while (((status = ctl_get_send_status()) == DALI_TX_PENDING) || (status == DALI_TX_WAIT_ANSWER));
+  Lose = 0;
+  return (status == DALI_TX_ANSWER) ? ctl_get_send_answer() : -1;
+}
+
+/* DTR and ENABLE WRITE MEMORY: the writes go to loc and on */
+static void enable_write(u8 loc)
+{
+  frame(DALI_DTR, loc, 0);
+  frame(DALI_BROADCAST, DALI_ENABLE_WM, 0);
+  frame(DALI_BROADCAST, DALI_ENABLE_WM, 0);
+}
+
+/* returns 0 if a write with reply was not answered */
+static int write_loc(int mode, u8 data)
+{
+  if (mode == MODE_NO_REPLY)
+  {
+    frame(DALI_WRITE_NR, data, 0);
+    return 1;
+  }
+  return frame(DALI_WRITE, data, 1) == data;
+}
+
+/* location of bank DALIU_BANK, -1 if not answered */
+static int read_loc(u8 loc)
+{
+  frame(DALI_DTR1, DALIU_BANK, 0);
+  frame(DALI_DTR, loc, 0);
+  return frame(DALI_BROADCAST, DALI_READ_MEM, 1);
+}
+
+static long read_next(void)
+{
+  int hi;
+  int lo;
+
+  do
+  {
+    frame(DALI_DTR, DALIU_LOC_NEXT, 0);
+    hi = frame(DALI_BROADCAST, DALI_READ_MEM, 1);
+    lo = frame(DALI_BROADCAST, DALI_READ_MEM, 1);
+  } while ((hi < 0) || (lo < 0));
+  return (hi << 8) | lo;
+}
+
+/* command, written until the state read back is the one expected */
+static void command(u8 cmd, u8 state)
+{
+  int i;
+
+  do
+  {
+    frame(DALI_DTR1, DALIU_BANK, 0);
+    enable_write(2);
+    write_loc(MODE_REPLY, 0x55);          /* lock byte */
+    if (cmd == DALIU_CMD_START)
+    {
+      enable_write(DALIU_LOC_BLOCKS);
+      write_loc(MODE_REPLY, (u8)(Blocks >> 8));
+      write_loc(MODE_REPLY, (u8)Blocks);
+      for (i = 24; i >= 0; i -= 8)
+        write_loc(MODE_REPLY, (u8)(ImageCrc >> i));
+    }
+    enable_write(DALIU_LOC_COMMAND);
+    write_loc(MODE_REPLY, cmd);
+  } while (read_loc(DALIU_LOC_COMMAND) != state);
+}
+
+/* one block from its header */
+static int send_block(int mode, long block)
+{
+  const u8 *data = &NewImage[block * FLASH_BLOCK_SIZE];
+  u16 crc = crc16(data, FLASH_BLOCK_SIZE);
+  int ok;
+  int i;
+
+  enable_write(DALIU_LOC_BLOCK);
+  ok = write_loc(mode, (u8)(block >> 8));
+  ok = ok && write_loc(mode, (u8)block);
+  ok = ok && write_loc(mode, (u8)(crc >> 8));
+  ok = ok && write_loc(mode, (u8)crc);
+  for (i = 0; ok && (i < FLASH_BLOCK_SIZE); i++)
+    ok = write_loc(mode, data[i]);
+  return ok;
+}
+
+/* START (or resume), blocks until the gear expects stop (or all are in),
+   returns the block it expects next */
+static long transfer(int mode, long stop)
+{
+  long next;
+  long sent;
+  int since_check;
+  int ok;
+
+  command(DALIU_CMD_START, DALIU_RECEIVING);
+  next = read_next();
+  sent = next;
+  since_check = 0;
+  while ((next < Blocks) && (next < stop))
+  {
+    ok = send_block(mode, sent);
+    sent++;
+    if (!ok || (mode == MODE_STOP_WAIT) || (++since_check >= CheckEvery) || (sent >= Blocks) || (sent >= stop))
+    {
+      next = read_next();
+      sent = next;
+      since_check = 0;
+    }
+  }
+  return next;
+}
+
+/* gear waits for the image check: DALIU_READY */
+static void wait_ready(void)
+{
+  while (read_loc(DALIU_LOC_COMMAND) != DALIU_READY)
+    run_ms(100);
+}
+
+static void check(int ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    Errors++;
+  }
+}
+
+/* slots swapped and the new image on trial */
+static int installed(void)
+{
+  return !memcmp(&HostMem[DALIU_SLOT_A], NewImage, DALIU_SLOT_SIZE)
+         && !memcmp(&HostMem[DALIU_SLOT_B], OldImage, DALIU_SLOT_SIZE)
+         && (record(DALIU_E2_STATE) == DALIU_TRIAL) && (record(DALIU_E2_TRIALS) >= 1)
+         && (record(DALIU_E2_TRIALS) <= DALIU_TRIALS);
+}
+
+/* from the snapshot: INSTALL, returns once the gear runs the new image */
+static void install(void)
+{
+  long end;
+
+  memcpy(HostMem, Snapshot, sizeof(HostMem));
+  power_on();
+  run_ms(100);
+  frame(DALI_DTR1, DALIU_BANK, 0);
+  enable_write(2);
+  write_loc(MODE_REPLY, 0x55);
+  enable_write(DALIU_LOC_COMMAND);
+  frame(DALI_WRITE_NR, DALIU_CMD_INSTALL, 0);
+  end = Now + 10L * SUBTICKS * TICKS_PER_SECOND;
+  while ((record(DALIU_E2_STATE) != DALIU_TRIAL) && (Now < end))
+    run_ms(10);
+  HostPowerFail = 0;
+  run_ms(100);
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: fwusim [-s image bytes] [-p priority 1..%d] [-c check interval] [-e frame loss per mille]\n"
+                  "              [-i interrupted at percent] [-f power failures] [-r seed]\n", DALI_TX_PRIORITIES);
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned long seed;
+  long start;
+  long full = 0;
+  long kept;
+  long next;
+  long resets;
+  u32 writes;
+  u32 flash;
+  int mode;
+  int ok;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 's': ImageSize = atol(argv[++i]); break;
+      case 'p': Priority = atoi(argv[++i]); break;
+      case 'c': CheckEvery = atoi(argv[++i]); break;
+      case 'e': LossPerMille = atoi(argv[++i]); break;
+      case 'i': Interrupted = atoi(argv[++i]); break;
+      case 'f': PowerFails = atoi(argv[++i]); break;
+      case 'r': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((ImageSize < DALIU_VECTORS * 4) || (ImageSize > DALIU_SLOT_SIZE) || (Priority < 1) || (Priority > DALI_TX_PRIORITIES)
+      || (CheckEvery < 1) || (LossPerMille < 0) || (LossPerMille >= 1000) || (Interrupted < 1) || (Interrupted > 99)
+      || (PowerFails < 0))
+    usage();
+
+  Blocks = (ImageSize + FLASH_BLOCK_SIZE - 1) / FLASH_BLOCK_SIZE;
+  make_image(OldImage, DALIU_SLOT_SIZE * 3 / 4);
+  make_image(NewImage, ImageSize);
+  ImageCrc = crc32(0xFFFFFFFFUL, NewImage, Blocks * FLASH_BLOCK_SIZE) ^ 0xFFFFFFFFUL;
+  memcpy(&HostMem[DALIU_SLOT_A], OldImage, DALIU_SLOT_SIZE);
+  for (i = 0; i <= DELAY; i++)
+    BusHistory[i] = 1;
+  CtlPort.ODR = 1 << CTL_OUT;
+  ctl_init_DALI(&CtlPort, CTL_OUT, 0, &CtlPort, CTL_IN, 0, ctl_received, ctl_error, ctl_1ms);
+  FailSpan = 1;
+  power_on();
+  run_ms(1000);
+
+  printf("image %ld bytes, %ld blocks of %d, priority %d, NEXT read each %d blocks, frame loss %d/1000\n",
+         ImageSize, Blocks, FLASH_BLOCK_SIZE, Priority, CheckEvery, LossPerMille);
+  printf("mode                    transfer s   payload B/s   frames   blocks programmed\n");
+  seed = Seed;
+  for (mode = MODE_STOP_WAIT; mode <= MODE_NO_REPLY; mode++)
+  {
+    Seed = seed;
+    command(DALIU_CMD_ABORT, DALIU_IDLE);
+    writes = ctl_DALIStats.tx_frames + DALIStats.replies;
+    flash = HostBlocks;
+    start = Now;
+    transfer(mode, Blocks);
+    full = Now - start;
+    printf("%-22s %11.1f %13.1f %8lu %10lu\n", ModeNames[mode], seconds(full),
+           Blocks * FLASH_BLOCK_SIZE / seconds(full),
+           (unsigned long)(ctl_DALIStats.tx_frames + DALIStats.replies - writes), (unsigned long)(HostBlocks - flash));
+    start = Now;
+    wait_ready();
+  }
+  printf("image check %.1f s\n", seconds(Now - start));
+  check(!memcmp(&HostMem[DALIU_SLOT_B], NewImage, DALIU_SLOT_SIZE), "image in slot B");
+
+  /* interruption: the gear keeps NEXT in EEPROM, START of the same image resumes */
+  command(DALIU_CMD_ABORT, DALIU_IDLE);
+  kept = transfer(MODE_NO_REPLY, Blocks * Interrupted / 100);
+  power_on();
+  run_ms(1000);
+  start = Now;
+  next = read_next();
+  transfer(MODE_NO_REPLY, Blocks);
+  printf("interrupted at %d%%, power cycled (no reply): resumed at block %ld, %.1f s, whole transfer %.1f s\n",
+         Interrupted, next, seconds(Now - start), seconds(full));
+  check(next == kept, "resume at the block kept in EEPROM");
+  wait_ready();
+  memcpy(Snapshot, HostMem, sizeof(Snapshot));
+
+  /* install, clean */
+  writes = HostWrites;
+  flash = HostFlashWrites;
+  resets = Resets;
+  install();
+  check(installed(), "clean install");
+  FailSpan = HostWrites - writes;
+  flash = HostFlashWrites - flash;
+  printf("install: %lu resets, swap %lu flash words and %lu EEPROM bytes written, %.1f s\n",
+         Resets - resets, (unsigned long)flash / 4, (unsigned long)(FailSpan - flash),
+         (flash / 4 + (FailSpan - flash)) * WRITE_MS / 1000.0);
+
+  /* install with power failures */
+  ok = 0;
+  Failures = 0;
+  for (i = 0; i < PowerFails; i++)
+  {
+    HostPowerFail = HostWrites + 1 + rnd() % FailSpan;
+    install();
+    if (installed())
+      ok++;
+  }
+  printf("install with power failures: %d installs, %ld power failures, %d right\n", PowerFails, Failures, ok);
+  check(ok == PowerFails, "install with power failures");
+
+  /* trial: the new image hangs, the watchdog resets it until it is rolled back */
+  HangNew = 1;
+  install();
+  start = Now;
+  resets = Watchdogs;
+  while ((record(DALIU_E2_STATE) != DALIU_ROLLED_BACK) && (Now - start < 60L * SUBTICKS * TICKS_PER_SECOND))
+    run_ms(100);
+  printf("trial, image hangs: rolled back after %ld watchdog resets, %.1f s\n", Watchdogs - resets, seconds(Now - start));
+  check((record(DALIU_E2_STATE) == DALIU_ROLLED_BACK) && !memcmp(&HostMem[DALIU_SLOT_A], OldImage, DALIU_SLOT_SIZE)
+        && !memcmp(&HostMem[DALIU_SLOT_B], NewImage, DALIU_SLOT_SIZE), "rollback of a hanging image");
+
+  /* trial: the new image runs and confirms itself */
+  HangNew = 0;
+  install();
+  run_ms((DALIU_CONFIRM_S + 2) * 1000L);
+  printf("trial, image runs: %s after %d s\n", (record(DALIU_E2_STATE) == DALIU_CONFIRMED) ? "confirmed" : "not confirmed",
+         DALIU_CONFIRM_S + 2);
+  check(record(DALIU_E2_STATE) == DALIU_CONFIRMED, "confirmation");
+  return Errors ? 1 : 0;
+}
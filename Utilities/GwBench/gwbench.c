@@ -0,0 +1,370 @@
+/**
+  ******************************************************************************
+  * @file    gwbench.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: sustained command rate of the UART to Dali gateway
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory (firmware sources of
+   the gateway build, see Utilities/HostShim):
+
+     cc -DDALI_LINES=2 -DDALI_INSTANCES=2 -DDALI_GATEWAY -I../HostShim/inc
+        -I../HostShim -I../../Project/inc -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc gwbench.c
+        ../HostShim/hostshim.c ../../Project/src/DALIslave.c
+        ../../Project/src/DALIgateway.c ../../Project/src/stm8s_it.c
+        ../../Libraries/DALIStack/src/dali*.c ../../Libraries/DALIStack/src/eeprom.c
+        ../../Libraries/DALIStack/src/lite_timer_8bit.c -o gwbench
+
+     gwbench [-n requests] [-q depth] [-l host latency ms] [-b baudrate]
+             [-d delay] [-s seed]
+
+   Loopback of a host and the firmware of this project built as a gateway
+   with two lines: line 0 is the gateway (GW_LINE), the control gear answering
+   it is unit 1 on line 1, both lines are wired to the same simulated bus.
+   The firmware runs as on the target: TIM4 interrupt each tick, port
+   interrupt at the start edge of a frame, UART interrupts at the byte times
+   of -b, and one pass of the main loop of Project/src/main.c after each tick
+   (1ms tasks, received commands, gateway_process). The gateway does not see
+   its own frames, unit 0 on line 0 does not get them either; the two lines
+   share the timer, so the gear decodes in phase with the gateway, the bus
+   reaches the inputs -d subticks (1/8 tick) late.
+
+   The host keeps up to -q requests in flight and sends the next one -l ms
+   after a response came in (USB serial adapters: 1..16ms latency timer),
+   each request is GW_REQUEST_SIZE bytes with its checksum. Requests:
+     command              broadcast OFF
+     query                broadcast QUERY STATUS, answered by unit 1
+     query, no answer     QUERY STATUS to short address 63 (nobody)
+     send twice           broadcast STORE ACTUAL LEVEL IN DTR, GW_FLAG_TWICE
+   and workloads of one kind of them or a mix (shares in percent).
+   Each workload is run with depth 1 (host waits for each response) and with
+   the depth given, reported: requests per second, bus load (frames on the
+   wire, stop bits included) and responses other than the one expected. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "stm8s_it.h"
+#include "dali_config.h"
+#include "dali.h"
+#include "DALIslave.h"
+#include "DALIgateway.h"
+
+#define SUBTICKS       8
+#define DELAY_MAX      7              /* bus history, subticks */
+
+#define FORWARD_TICKS  ((2 + 2 * 16 + 4) * 4)  /* 16 bit frame, start and stop bits */
+#define BACKWARD_TICKS ((2 + 2 * 8 + 4) * 4)
+
+#define CMD_OFF        (0x00)
+#define CMD_DTR_STORE  (0x21)         /* STORE ACTUAL LEVEL IN DTR, send twice */
+#define CMD_STATUS     (0x90)         /* QUERY STATUS */
+
+#define KINDS          4
+
+typedef struct
+{
+  u8 address;
+  u8 command;
+  u8 flags;
+  u8 expected;      /* response */
+} TRequest;
+
+static const TRequest Kinds[KINDS] =
+{
+  { 0xFF, CMD_OFF,       0,             GW_RSP_DONE },      /* command */
+  { 0xFF, CMD_STATUS,    GW_FLAG_QUERY, GW_RSP_ANSWER },    /* query */
+  { 0x7F, CMD_STATUS,    GW_FLAG_QUERY, GW_RSP_NO_ANSWER }, /* query, no answer */
+  { 0xFF, CMD_DTR_STORE, GW_FLAG_TWICE, GW_RSP_DONE },      /* send twice */
+};
+
+typedef struct
+{
+  const char *name;
+  int shares[KINDS];  /* percent */
+} TWorkload;
+
+static const TWorkload Workloads[] =
+{
+  { "commands",           { 100,   0,   0,   0 } },
+  { "queries",            {   0, 100,   0,   0 } },
+  { "queries, no answer", {   0,   0, 100,   0 } },
+  { "send twice",         {   0,   0,   0, 100 } },
+  { "mix 60/25/5/10",     {  60,  25,   5,  10 } },
+};
+
+static long Requests = 2000;
+static int Depth = GW_QUEUE_DEPTH;
+static double Latency = 16.0;
+static long Baudrate = 115200;
+static int Delay = 2;
+
+static long Now;                      /* subticks */
+static int BusHistory[DELAY_MAX + 1];
+static int ViewB = 1;                 /* bus at the DALIIN pins of line 0 and 1 */
+static int ViewE = 1;
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+/* light output of the units, not used */
+static void light(u8 unit, u16 level)
+{
+  (void)unit;
+  (void)level;
+}
+
+/* level of the DALIOUT pin of a line on the bus (1: released) */
+static int line_out(GPIO_TypeDef *port, u8 pin, u8 invert)
+{
+  return ((port->ODR >> pin) & 1) ^ invert;
+}
+
+/* DALIIN pin of a line, DALIOUT read back; returns 1 on a falling edge the
+   port interrupt takes */
+static int line_in(GPIO_TypeDef *out, u8 out_pin, GPIO_TypeDef *in, u8 in_pin, u8 invert, int bus, int *view)
+{
+  int edge;
+
+  out->IDR = (u8)((out->IDR & ~(1 << out_pin)) | (out->ODR & (1 << out_pin)));
+  if (bus ^ invert)
+    in->IDR |= (u8)(1 << in_pin);
+  else
+    in->IDR &= (u8)~(1 << in_pin);
+  edge = *view && !bus && (in->CR2 & (1 << in_pin));
+  *view = bus;
+  return edge;
+}
+
+/* one subtick of the bus: wired AND of both lines, seen -d subticks later */
+static void bus_step(void)
+{
+  int bus;
+
+  bus = line_out(OUT_DALI_PORT, OUT_DALI_PIN, INVERT_OUT_DALI)
+        & line_out(OUT_DALI2_PORT, OUT_DALI2_PIN, INVERT_OUT_DALI2);
+  BusHistory[Now % (DELAY_MAX + 1)] = bus;
+  bus = BusHistory[(Now + DELAY_MAX + 1 - Delay) % (DELAY_MAX + 1)];
+  if (line_in(OUT_DALI_PORT, OUT_DALI_PIN, IN_DALI_PORT, IN_DALI_PIN, INVERT_IN_DALI, bus, &ViewB))
+    EXTI_PORTB_IRQHandler();
+  if (line_in(OUT_DALI2_PORT, OUT_DALI2_PIN, IN_DALI2_PORT, IN_DALI2_PIN, INVERT_IN_DALI2, bus, &ViewE))
+    EXTI_PORTE_IRQHandler();
+}
+
+/* one pass of the main loop of Project/src/main.c (gateway build) */
+static void main_pass(void)
+{
+  if (DALI_TimerStatus())
+  {
+    gateway_timer();
+    DALI_CheckAndExecuteTimer();
+  }
+  DALI_CheckAndExecuteReceivedCommand();
+  gateway_process();
+}
+
+/* runs one workload, returns requests per second */
+static double run(const TWorkload *w, int depth, double *load, long *unexpected)
+{
+  double byte = (double)SUBTICKS * TICKS_PER_SECOND * 10 / Baudrate; /* subticks */
+  double lat = Latency * SUBTICKS * TICKS_PER_SECOND / 1000.0;
+  u8 req[GW_REQUEST_SIZE];
+  u8 rsp[GW_RESPONSE_SIZE];
+  u8 expected[256];                   /* by request id */
+  const TRequest *r;
+  double *ready;
+  double rx_next = 0.0;               /* next request byte at the gateway */
+  double tx_free = 0.0;               /* UART transmitter of the gateway */
+  double tx_at = -1.0;                /* response byte in flight: arrival */
+  u8 tx_byte = 0;
+  long sent = 0;                      /* requests sent by the host */
+  long done = 0;                      /* responses received */
+  long start;
+  u32 frames;
+  u32 replies;
+  int rx_pos = GW_REQUEST_SIZE;
+  int rsp_pos = 0;
+  int kind;
+  int i;
+  u8 sum;
+
+  ready = (double *)malloc((Requests + 1) * sizeof(double));
+  if (!ready)
+    exit(1);
+  for (i = 0; (i < depth) && (i < Requests); i++)
+    ready[i] = (double)Now;
+  frames = DALIStats.tx_frames;
+  replies = DALIStats.replies;
+  *unexpected = 0;
+  start = Now;
+  while (done < Requests)
+  {
+    /* host: next request byte on the UART */
+    if ((rx_pos == GW_REQUEST_SIZE) && (sent < Requests) && (sent < done + depth) && (ready[sent] <= Now))
+    {
+      i = (int)(rnd() % 100);
+      for (kind = 0; (kind < KINDS - 1) && (i >= w->shares[kind]); kind++)
+        i -= w->shares[kind];
+      r = &Kinds[kind];
+      expected[sent & 0xFF] = r->expected;
+      req[0] = GW_REQUEST;
+      req[1] = (u8)sent;
+      req[2] = r->flags;
+      req[3] = DALI_FRAME_16;
+      req[4] = r->address;
+      req[5] = r->command;
+      req[6] = 0;
+      req[7] = 0;
+      sum = 0;
+      for (i = 0; i < GW_REQUEST_SIZE - 1; i++)
+        sum += req[i];
+      req[GW_REQUEST_SIZE - 1] = (u8)(0 - sum);
+      rx_pos = 0;
+      if (rx_next < Now)
+        rx_next = (double)Now;
+      sent++;
+    }
+    if ((rx_pos < GW_REQUEST_SIZE) && (rx_next + byte <= Now))
+    {
+      GW_UART->DR = req[rx_pos++];
+      gateway_rx_interrupt();
+      rx_next += byte;
+    }
+
+    /* gateway: response bytes, one at a time */
+    if ((tx_at >= 0.0) && (tx_at <= Now))
+    {
+      rsp[rsp_pos++] = tx_byte;
+      tx_at = -1.0;
+      if (rsp_pos == GW_RESPONSE_SIZE)
+      {
+        if ((rsp[0] != expected[rsp[1]]) || (rsp[1] != (u8)done))
+          (*unexpected)++;
+        ready[done + depth < Requests ? done + depth : Requests] = Now + lat;
+        done++;
+        rsp_pos = 0;
+      }
+    }
+    if ((tx_at < 0.0) && (tx_free <= Now) && (GW_UART->CR2 & GW_CR2_TIEN))
+    {
+      gateway_tx_interrupt();
+      if (GW_UART->CR2 & GW_CR2_TIEN)
+      {
+        tx_byte = GW_UART->DR;
+        tx_free = Now + byte;
+        tx_at = tx_free;
+      }
+    }
+
+    bus_step();
+    if (!(Now % SUBTICKS))
+    {
+      TIM4->CNTR = (u8)rnd();
+      TIM4_UPD_OVF_IRQHandler();
+      main_pass();
+    }
+    Now++;
+  }
+  free(ready);
+
+  *load = 100.0 * (FORWARD_TICKS * (double)(DALIStats.tx_frames - frames)
+                   + BACKWARD_TICKS * (double)(DALIStats.replies - replies)) * SUBTICKS / (Now - start);
+  return Requests * (double)SUBTICKS * TICKS_PER_SECOND / (Now - start);
+}
+
+/* bus idle, nothing queued: the next run starts from the settled state */
+static void settle(void)
+{
+  long end = Now + SUBTICKS * TICKS_PER_SECOND / 10;
+
+  while (Now < end)
+  {
+    bus_step();
+    if (!(Now % SUBTICKS))
+    {
+      TIM4_UPD_OVF_IRQHandler();
+      main_pass();
+    }
+    Now++;
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: gwbench [-n requests] [-q depth 1..%d] [-l host latency ms] [-b baudrate] [-d delay 0..%d] [-s seed]\n",
+          GW_QUEUE_DEPTH, DELAY_MAX);
+  exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+  double rate1;
+  double rate;
+  double load1;
+  double load;
+  long bad1;
+  long bad;
+  unsigned int k;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 'n': Requests = atol(argv[++i]); break;
+      case 'q': Depth = atoi(argv[++i]); break;
+      case 'l': Latency = atof(argv[++i]); break;
+      case 'b': Baudrate = atol(argv[++i]); break;
+      case 'd': Delay = atoi(argv[++i]); break;
+      case 's': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((Requests < 1) || (Depth < 1) || (Depth > GW_QUEUE_DEPTH) || (Latency < 0.0) || (Baudrate < 1200)
+      || (Delay < 0) || (Delay > DELAY_MAX))
+    usage();
+
+  /* initialisation of Project/src/main.c, gateway build */
+  for (i = 0; i <= DELAY_MAX; i++)
+    BusHistory[i] = 1;
+  CLK->CKDIVR = 0x00;
+  DALI_Init(light);
+  DALI_Light_On_Done();
+  init_DALI_gateway();
+  settle();
+
+  printf("%ld requests, host latency %.1f ms, %ld baud, %d byte requests\n", Requests, Latency, Baudrate, GW_REQUEST_SIZE);
+  printf("workload              depth 1 req/s (bus %%)   depth %d req/s (bus %%)   unexpected\n", Depth);
+  for (k = 0; k < sizeof(Workloads) / sizeof(Workloads[0]); k++)
+  {
+    rate1 = run(&Workloads[k], 1, &load1, &bad1);
+    settle();
+    rate = run(&Workloads[k], Depth, &load, &bad);
+    settle();
+    printf("%-20s %10.1f (%4.1f)    %14.1f (%4.1f)   %10ld\n", Workloads[k].name, rate1, load1, rate, load, bad1 + bad);
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    hostctl.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tools: bus controller, second copy of the driver
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Bus controller of the host tools which run the firmware of this project
+   as control gear (FwuSim, E2Stress...): the driver Project/src/DALIslave.c
+   compiled a second time in the same program, all its external names
+   prefixed with ctl_ (hostshim.h declares the ones the tools call). It
+   shares HostMem with the control gear: TIM4, CLK and ITC are written the
+   same way by both, its port is a GPIO_TypeDef of the tool. */
+
+#define BootTicks               ctl_BootTicks
+#define DALILines               ctl_DALILines
+#define DALIStats               ctl_DALIStats
+#define PhaseAccumulator        ctl_PhaseAccumulator
+#define RTC1msFnc               ctl_RTC1msFnc
+#define RTC_1ms_Callback        ctl_RTC_1ms_Callback
+#define TickDurationMaxIdle     ctl_TickDurationMaxIdle
+#define TickDurationMaxRun      ctl_TickDurationMaxRun
+#define TickLatencyMax          ctl_TickLatencyMax
+#define TickLatencyMin          ctl_TickLatencyMin
+#define Timebase                ctl_Timebase
+#define TimebaseIdle            ctl_TimebaseIdle
+#define TimebaseRun             ctl_TimebaseRun
+#define check_interface_failure ctl_check_interface_failure
+#define get_boot_ticks          ctl_get_boot_ticks
+#define get_flag                ctl_get_flag
+#define get_fmaster             ctl_get_fmaster
+#define get_idle_ticks          ctl_get_idle_ticks
+#define get_send_answer         ctl_get_send_answer
+#define get_send_status         ctl_get_send_status
+#define get_start_edge_phase    ctl_get_start_edge_phase
+#define get_tick_duration_us    ctl_get_tick_duration_us
+#define get_tick_jitter_us      ctl_get_tick_jitter_us
+#define get_timer_count         ctl_get_timer_count
+#define init_DALI               ctl_init_DALI
+#define inject_frame            ctl_inject_frame
+#define line_tick               ctl_line_tick
+#define lines_tick              ctl_lines_tick
+#define oneMScounter            ctl_oneMScounter
+#define receive_data            ctl_receive_data
+#define receive_edge            ctl_receive_edge
+#define receive_tick            ctl_receive_tick
+#define reset_tick_jitter       ctl_reset_tick_jitter
+#define send_data               ctl_send_data
+#define send_forward            ctl_send_forward
+#define send_tick               ctl_send_tick
+#define set_DALI_clock          ctl_set_DALI_clock
+#define tick_duration_sample    ctl_tick_duration_sample
+#define tick_latency_sample     ctl_tick_latency_sample
+#define timebase_tick           ctl_timebase_tick
+
+#include "../../Project/src/DALIslave.c"
+
+/* 1ms counter of the TIM4 interrupt (stm8s_it.c), not linked for the controller */
+__IO uint16_t oneMScounter;
@@ -0,0 +1,38 @@
+/**
+  ******************************************************************************
+  * @file    hostctl.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tools: bus controller of hostctl.c
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __HOSTCTL_H
+#define __HOSTCTL_H
+
+#include "DALIslave.h"
+
+/* the driver functions of hostctl.c the tools call, DALIslave.h names with
+   the ctl_ prefix (same DALI_LINES as the control gear) */
+void ctl_init_DALI(DALI_LINE_PARAMS GPIO_TypeDef* port_out, u8 pin_out, u8 invert_out, GPIO_TypeDef* port_in, u8 pin_in,
+                   u8 invert_in, TDataReceivedCallback DataReceivedFunction, TErrorCallback ErrorFunction,
+                   TRTC_1ms_Callback RTC_1ms_Function);
+void ctl_line_tick(DALI_LINE_PARAM);
+void ctl_receive_edge(GPIO_TypeDef *port);
+u8 ctl_send_forward(DALI_LINE_PARAMS u8 bits, u8 *frame, u8 priority, u8 query);
+u8 ctl_get_send_status(DALI_LINE_PARAM);
+u8 ctl_get_send_answer(DALI_LINE_PARAM);
+extern TDALIStats ctl_DALIStats;
+
+#endif /* __HOSTCTL_H */
@@ -0,0 +1,153 @@
+/**
+  ******************************************************************************
+  * @file    hostshim.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host shim: memory image and library functions for host builds
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Linked into the host tools which compile firmware sources (see
+   inc/stm8s.h): the STM8 address space and the few library functions the
+   stack and the driver call. Peripherals do nothing by themselves, the tool
+   drives the registers it needs. The ADC returns HostAdcValue(), so a tool
+   can give each conversion its own noise. Flash and EEPROM programming end
+   at once (EOP and HVOFF stay set), the tool counts the time it takes. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include "stm8s.h"
+#include "stm8s_flash.h"
+#include "hostshim.h"
+
+/* reset values the firmware waits on: HSI selected, EEPROM/flash idle */
+u8 HostMem[0x10000] =
+{
+  [HOST_CLK + offsetof(CLK_TypeDef, CMSR)]     = CLK_SOURCE_HSI,
+  [HOST_CLK + offsetof(CLK_TypeDef, CKDIVR)]   = 0x18,
+  [HOST_FLASH + offsetof(FLASH_TypeDef, IAPSR)] = FLASH_IAPSR_HVOFF | FLASH_IAPSR_EOP,
+};
+
+jmp_buf HostResetPoint;
+u32 HostWrites;
+u32 HostFlashWrites;
+u32 HostPowerFail;
+u32 HostBlocks;
+u8 HostItcPriority[ITC_IRQ_EEPROM_EEC + 1];
+
+static u16 host_adc_default(void)
+{
+  return 0x200;
+}
+
+u16 (*HostAdcValue)(void) = host_adc_default;
+
+void assert_failed(uint8_t* file, uint32_t line)
+{
+  fprintf(stderr, "assert_param failed: %s line %u\n", (char *)file, (unsigned)line);
+  exit(2);
+}
+
+void ITC_SetSoftwarePriority(ITC_Irq_TypeDef IrqNum, ITC_PriorityLevel_TypeDef PriorityValue)
+{
+  if (IrqNum <= ITC_IRQ_EEPROM_EEC)
+    HostItcPriority[IrqNum] = (u8)PriorityValue;
+}
+
+void ADC1_DeInit(void)
+{
+}
+
+void ADC1_Init(ADC1_ConvMode_TypeDef ADC1_ConversionMode, ADC1_Channel_TypeDef ADC1_Channel,
+               ADC1_PresSel_TypeDef ADC1_PrescalerSelection, ADC1_ExtTrig_TypeDef ADC1_ExtTrigger,
+               FunctionalState ADC1_ExtTriggerState, ADC1_Align_TypeDef ADC1_Align,
+               ADC1_SchmittTrigg_TypeDef ADC1_SchmittTriggerChannel, FunctionalState ADC1_SchmittTriggerState)
+{
+  (void)ADC1_ConversionMode;
+  (void)ADC1_Channel;
+  (void)ADC1_PrescalerSelection;
+  (void)ADC1_ExtTrigger;
+  (void)ADC1_ExtTriggerState;
+  (void)ADC1_Align;
+  (void)ADC1_SchmittTriggerChannel;
+  (void)ADC1_SchmittTriggerState;
+}
+
+void ADC1_StartConversion(void)
+{
+}
+
+uint16_t ADC1_GetConversionValue(void)
+{
+  return HostAdcValue();
+}
+
+FlagStatus ADC1_GetFlagStatus(ADC1_Flag_TypeDef Flag)
+{
+  (void)Flag;
+  return SET; /* conversion done at once */
+}
+
+void ADC1_ClearFlag(ADC1_Flag_TypeDef Flag)
+{
+  (void)Flag;
+}
+
+void HostWrite(u16 addr, u8 val)
+{
+  if (++HostWrites == HostPowerFail)
+  {
+    HostMem[addr] ^= (u8)(val | 0x5A); /* cell neither old nor new */
+    longjmp(HostResetPoint, 2);
+  }
+  if (addr >= 0x8000)
+    HostFlashWrites++;
+  HostMem[addr] = val;
+}
+
+void HostReset(void)
+{
+  longjmp(HostResetPoint, 1);
+}
+
+void FLASH_Unlock(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  HostMem[HOST_FLASH + offsetof(FLASH_TypeDef, IAPSR)] |= (u8)~FLASH_MemType & (FLASH_IAPSR_PUL | FLASH_IAPSR_DUL);
+}
+
+void FLASH_Lock(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  HostMem[HOST_FLASH + offsetof(FLASH_TypeDef, IAPSR)] &= (u8)FLASH_MemType;
+}
+
+void FLASH_ProgramBlock(uint16_t BlockNum, FLASH_MemType_TypeDef FLASH_MemType,
+                        FLASH_ProgramMode_TypeDef FLASH_ProgMode, uint8_t *Buffer)
+{
+  u16 addr;
+  u8 i;
+
+  (void)FLASH_ProgMode;
+  addr = (u16)(((FLASH_MemType == FLASH_MEMTYPE_PROG) ? 0x8000 : 0x4000) + BlockNum * FLASH_BLOCK_SIZE);
+  for (i = 0; i < FLASH_BLOCK_SIZE; i++)
+    HostMem[(u16)(addr + i)] = Buffer[i];
+  HostBlocks++;
+}
+
+FLASH_Status_TypeDef FLASH_WaitForLastOperation(FLASH_MemType_TypeDef FLASH_MemType)
+{
+  (void)FLASH_MemType;
+  return FLASH_STATUS_SUCCESSFUL_OPERATION;
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file    hostshim.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host shim: interface of hostshim.c to the host tools
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+#ifndef __HOSTSHIM_H
+#define __HOSTSHIM_H
+
+#include <setjmp.h>
+#include "stm8s.h"
+
+/* ADC conversion result (default: constant 0x200) */
+extern u16 (*HostAdcValue)(void);
+
+/* firmware update: DALIU_RESET() and a power failure at store HostPowerFail
+   (counted in HostWrites, 0 = never; the byte stored is left torn) jump to
+   HostResetPoint, which the tool sets with setjmp: 1 = reset, 2 = power
+   failure. HostFlashWrites counts the stores into program memory,
+   HostBlocks the flash blocks programmed. */
+extern jmp_buf HostResetPoint;
+extern u32 HostWrites;
+extern u32 HostFlashWrites;
+extern u32 HostPowerFail;
+extern u32 HostBlocks;
+
+/* ITC software priorities set by the firmware (ITC_PRIORITYLEVEL_x), by
+   interrupt vector: the simulators serve interrupts pending together in
+   the order they give */
+extern u8 HostItcPriority[ITC_IRQ_EEPROM_EEC + 1];
+
+#endif /* __HOSTSHIM_H */
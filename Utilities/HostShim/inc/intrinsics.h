@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+  * @file    intrinsics.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host shim: IAR intrinsic functions
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* The host runs interrupt routines itself between main loop passes, the
+   firmware is never preempted: interrupt masking, wait and halt do nothing. */
+
+#ifndef __HOSTSHIM_INTRINSICS_H
+#define __HOSTSHIM_INTRINSICS_H
+
+#define __enable_interrupt()      ((void)0)
+#define __disable_interrupt()     ((void)0)
+#define __no_operation()          ((void)0)
+#define __trap()                  ((void)0)
+#define __wait_for_interrupt()    ((void)0)
+#define __halt()                  ((void)0)
+#define __get_interrupt_state()   (0)
+#define __set_interrupt_state(s)  ((void)(s))
+typedef unsigned char __istate_t;
+
+#endif /* __HOSTSHIM_INTRINSICS_H */
@@ -0,0 +1,186 @@
+/**
+  ******************************************************************************
+  * @file    stm8s.h
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host shim: library header for host builds of the firmware
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Host builds of the firmware sources (simulators and tests in Utilities):
+   this directory comes first in the include path, so the sources find this
+   header instead of the library one. It includes the library header with
+   - the IAR flavour selected and its keywords (__eeprom, __near, __ramfunc,
+     __interrupt...) empty, _IAR_ removed again afterwards: the sources then
+     take their plain C branches (no @ placement)
+   - long read as int while the library types are declared: u32 stays 32 bit
+     on 64 bit hosts and uint32_t matches the one of the C library
+   - STM8S105 (the target of Project) if no device is given
+   and moves every peripheral into HostMem, a 64KB image of the STM8 address
+   space (hostshim.c): registers are plain memory the host reads and drives,
+   TIM4->CNTR, GPIO IDR, UART DR... sim(), rim(), wfi() and halt() are
+   no-ops (intrinsics.h of this directory), interrupt routines are called by
+   the host between main loop passes, so nothing preempts the firmware.
+   Flash programming writes HostMem (hostshim.c) and ends at once. */
+
+#ifndef __HOSTSHIM_STM8S_H
+#define __HOSTSHIM_STM8S_H
+
+#if !defined (STM8S208) && !defined (STM8S207) && !defined (STM8S105) && !defined (STM8S103) && !defined (STM8S903) && !defined (STM8AF52Ax) && !defined (STM8AF62Ax) && !defined (STM8AF626x)
+ #define STM8S105
+#endif
+
+#ifndef __ICCSTM8__
+ #define __ICCSTM8__
+#endif
+#define __eeprom
+#define __near
+#define __far
+#define __tiny
+#define __no_init
+#define __ramfunc
+#define __interrupt
+
+#define long int
+#include "../../../Libraries/STM8S_StdPeriph_Driver/inc/stm8s.h"
+#undef long
+#undef _IAR_
+
+/* STM8 address space: peripherals, option bytes, flash (0x8000..0xFFFF) */
+extern u8 HostMem[0x10000];
+
+#define HOST_OPT      0x4800
+#define HOST_GPIOA    0x5000
+#define HOST_GPIOB    0x5005
+#define HOST_GPIOC    0x500A
+#define HOST_GPIOD    0x500F
+#define HOST_GPIOE    0x5014
+#define HOST_GPIOF    0x5019
+#define HOST_GPIOG    0x501E
+#define HOST_GPIOH    0x5023
+#define HOST_GPIOI    0x5028
+#define HOST_FLASH    0x505A
+#define HOST_EXTI     0x50A0
+#define HOST_RST      0x50B3
+#define HOST_CLK      0x50C0
+#define HOST_WWDG     0x50D1
+#define HOST_IWDG     0x50E0
+#define HOST_AWU      0x50F0
+#define HOST_BEEP     0x50F3
+#define HOST_SPI      0x5200
+#define HOST_I2C      0x5210
+#define HOST_UART1    0x5230
+#define HOST_UART2    0x5240
+#define HOST_UART3    0x5240
+#define HOST_TIM1     0x5250
+#define HOST_TIM2     0x5300
+#define HOST_TIM3     0x5320
+#define HOST_TIM4     0x5340
+#define HOST_TIM5     0x5300
+#define HOST_TIM6     0x5340
+#define HOST_ADC1     0x53E0
+#define HOST_ADC2     0x5400
+#define HOST_CAN      0x5420
+#define HOST_CFG      0x7F60
+#define HOST_ITC      0x7F70
+#define HOST_DM       0x7F90
+
+#undef  OPT_BaseAddress
+#define OPT_BaseAddress     (HostMem + HOST_OPT)
+#undef  GPIOA_BaseAddress
+#define GPIOA_BaseAddress   (HostMem + HOST_GPIOA)
+#undef  GPIOB_BaseAddress
+#define GPIOB_BaseAddress   (HostMem + HOST_GPIOB)
+#undef  GPIOC_BaseAddress
+#define GPIOC_BaseAddress   (HostMem + HOST_GPIOC)
+#undef  GPIOD_BaseAddress
+#define GPIOD_BaseAddress   (HostMem + HOST_GPIOD)
+#undef  GPIOE_BaseAddress
+#define GPIOE_BaseAddress   (HostMem + HOST_GPIOE)
+#undef  GPIOF_BaseAddress
+#define GPIOF_BaseAddress   (HostMem + HOST_GPIOF)
+#undef  GPIOG_BaseAddress
+#define GPIOG_BaseAddress   (HostMem + HOST_GPIOG)
+#undef  GPIOH_BaseAddress
+#define GPIOH_BaseAddress   (HostMem + HOST_GPIOH)
+#undef  GPIOI_BaseAddress
+#define GPIOI_BaseAddress   (HostMem + HOST_GPIOI)
+#undef  FLASH_BaseAddress
+#define FLASH_BaseAddress   (HostMem + HOST_FLASH)
+#undef  EXTI_BaseAddress
+#define EXTI_BaseAddress    (HostMem + HOST_EXTI)
+#undef  RST_BaseAddress
+#define RST_BaseAddress     (HostMem + HOST_RST)
+#undef  CLK_BaseAddress
+#define CLK_BaseAddress     (HostMem + HOST_CLK)
+#undef  WWDG_BaseAddress
+#define WWDG_BaseAddress    (HostMem + HOST_WWDG)
+#undef  IWDG_BaseAddress
+#define IWDG_BaseAddress    (HostMem + HOST_IWDG)
+#undef  AWU_BaseAddress
+#define AWU_BaseAddress     (HostMem + HOST_AWU)
+#undef  BEEP_BaseAddress
+#define BEEP_BaseAddress    (HostMem + HOST_BEEP)
+#undef  SPI_BaseAddress
+#define SPI_BaseAddress     (HostMem + HOST_SPI)
+#undef  I2C_BaseAddress
+#define I2C_BaseAddress     (HostMem + HOST_I2C)
+#undef  UART1_BaseAddress
+#define UART1_BaseAddress   (HostMem + HOST_UART1)
+#undef  UART2_BaseAddress
+#define UART2_BaseAddress   (HostMem + HOST_UART2)
+#undef  UART3_BaseAddress
+#define UART3_BaseAddress   (HostMem + HOST_UART3)
+#undef  TIM1_BaseAddress
+#define TIM1_BaseAddress    (HostMem + HOST_TIM1)
+#undef  TIM2_BaseAddress
+#define TIM2_BaseAddress    (HostMem + HOST_TIM2)
+#undef  TIM3_BaseAddress
+#define TIM3_BaseAddress    (HostMem + HOST_TIM3)
+#undef  TIM4_BaseAddress
+#define TIM4_BaseAddress    (HostMem + HOST_TIM4)
+#undef  TIM5_BaseAddress
+#define TIM5_BaseAddress    (HostMem + HOST_TIM5)
+#undef  TIM6_BaseAddress
+#define TIM6_BaseAddress    (HostMem + HOST_TIM6)
+#undef  ADC1_BaseAddress
+#define ADC1_BaseAddress    (HostMem + HOST_ADC1)
+#undef  ADC2_BaseAddress
+#define ADC2_BaseAddress    (HostMem + HOST_ADC2)
+#undef  CAN_BaseAddress
+#define CAN_BaseAddress     (HostMem + HOST_CAN)
+#undef  CFG_BaseAddress
+#define CFG_BaseAddress     (HostMem + HOST_CFG)
+#undef  ITC_BaseAddress
+#define ITC_BaseAddress     (HostMem + HOST_ITC)
+#undef  DM_BaseAddress
+#define DM_BaseAddress      (HostMem + HOST_DM)
+
+/* firmware update (dali_fwu.h, dali_boot.c): program memory and data EEPROM
+   are HostMem, stores and the software reset go through hostshim.c */
+#define DALIU_MEM(addr)          (HostMem[(u16)(addr)])
+#define DALIU_WRITE(addr, val)   HostWrite((u16)(addr), (val))
+#define DALIU_RESET()            HostReset()
+void HostWrite(u16 addr, u8 val);
+void HostReset(void);
+
+/* data EEPROM of the stack (dali_ctx.h): the user area of the target and
+   the register images of DALI_INSTANCES units, up to 255 in one process */
+#define DALI_E2_SIZE             (125 + (DALI_INSTANCES - 1) * DALI_E2_REGS_SIZE)
+
+/* light outputs (Project/inc/DALIpwm.h): the simulators give the units a
+   light callback, the 4 channels of the board do not bound DALI_INSTANCES */
+#define PWM_CHANNELS_MAX         (DALI_INSTANCES * PWM_UNIT_CHANNELS)
+
+#endif /* __HOSTSHIM_STM8S_H */
@@ -0,0 +1,488 @@
+/**
+  ******************************************************************************
+  * @file    linesim.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: control gear on two DALI lines with traffic on both
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds with any host C compiler, from this directory (firmware sources
+   with two lines, see Utilities/HostShim):
+
+     cc -DDALI_LINES=2 -DDALI_INSTANCES=2 -I../HostShim/inc -I../HostShim
+        -I../../Project/inc -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc linesim.c
+        ../HostShim/hostshim.c ../HostShim/hostctl.c ../../Project/src/DALIslave.c
+        ../../Project/src/stm8s_it.c ../../Libraries/DALIStack/src/dali*.c
+        ../../Libraries/DALIStack/src/eeprom.c
+        ../../Libraries/DALIStack/src/lite_timer_8bit.c -o linesim
+
+     linesim [-t seconds] [-g max gap ms] [-r seed]
+
+   The firmware of this project with DALI_LINES 2 as one control gear
+   serving two separate buses: unit 0 on line 0 (IN_DALI_PORT, port B
+   interrupt), unit 1 on line 1 (IN_DALI2_PORT, port E interrupt), both
+   lines ticked by the one TIM4 interrupt, one pass of the main loop each
+   tick. With -DDALI_INSTANCES=n (2..254) the stack runs n units in this
+   process, the even ones on line 0, the odd ones on line 1: a broadcast
+   reaches all units of its line, the first of them answers. Each bus has its own controller (HostShim/hostctl.c, line 0 and
+   line 1 of its driver, ticked at other phases of the tick: the
+   controllers are not synchronous to the gear nor to each other). Each
+   controller sends, independently, 0..-g ms (default 20) apart: DTR,
+   STORE DTR AS SCENE (twice) and QUERY SCENE LEVEL as broadcasts, with
+   scenes and values of its own random sequence. So frames on the two lines
+   overlap in all phases, start edges in the same tick included, and a
+   frame decoded on the wrong line or executed for the unit of the other
+   line gives a wrong answer. Last the gear is power cycled, the scenes
+   are queried on both lines and read from the registers of each unit
+   (DALI_Read_Register): all units keep their register image in EEPROM.
+
+   Reported per line: frames sent by its controller and decoded by the
+   gear, decoding errors, queries answered with the value stored; the share
+   of the busy time with both lines busy and the frames started in the same
+   tick as a frame of the other line; the tick jitter (get_tick_jitter_us)
+   from the order the interrupt priorities give a start edge and the tick
+   update pending together (the port interrupt modelled as EXTI_COUNTS, no
+   other latency). Exit code 1 if a frame is lost, an answer wrong or the
+   jitter above DALI_LATENCY_BUDGET_US. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "hostctl.h"
+#include "stm8s_it.h"
+#include "dali_config.h"
+#include "dali.h"
+#include "dali_regs.h"
+#include "DALIslave.h"
+
+#if (DALI_LINES != 2) || (DALI_INSTANCES < 2)
+ #error "build with -DDALI_LINES=2 -DDALI_INSTANCES=2 (or more units)"
+#endif
+
+#define SUBTICKS        8
+#define DELAY           2             /* bus to the inputs, subticks */
+#define CTL_OUT         0             /* pins of the controller ports */
+#define CTL_IN          1
+#define SCENES          16
+#define EXTI_COUNTS     19            /* port interrupt routine in TIM4 counts (150 cycles at 16 MHz) */
+
+/* frames: special commands, broadcast commands */
+#define DALI_DTR        0xA3
+#define DALI_BROADCAST  0xFF
+#define DALI_STORE_SCENE 0x40         /* STORE DTR AS SCENE, send twice */
+#define DALI_QUERY_SCENE 0xB0         /* QUERY SCENE LEVEL */
+
+/* sequence step of a controller */
+#define STEP_GAP        0
+#define STEP_DTR        1
+#define STEP_STORE      2
+#define STEP_STORE2     3
+#define STEP_QUERY      4
+
+typedef struct
+{
+  /* gear side: pins of the line in dali_config.h, its port interrupt */
+  GPIO_TypeDef *out_port;
+  u8 out_pin;
+  u8 out_invert;
+  GPIO_TypeDef *in_port;
+  u8 in_pin;
+  u8 in_invert;
+  void (*edge)(void);
+  int gear_view;                      /* bus at the gear input */
+  long start_tick;                    /* tick of the last start edge at the gear */
+
+  /* controller side */
+  GPIO_TypeDef ctl_port;
+  int ctl_view;
+  int ctl_phase;                      /* subtick of its tick */
+  int history[DELAY + 1];
+  int step;
+  int pending;                        /* frame given to ctl_send_forward */
+  long gap;                           /* ticks until the next sequence */
+  u8 scene;
+  u8 value;
+  u8 stored[SCENES];
+
+  long sent;
+  long queries;
+  long right;
+} TLine;
+
+static TLine Line[DALI_LINES];
+static double Seconds = 60.0;
+static int MaxGap = 20;
+static long Now;                      /* subticks */
+static long Busy[DALI_LINES + 1];     /* ticks with 1 or 2 lines busy */
+static int Sequences;                 /* controllers start new sequences */
+static long SameTick;                 /* start edges on both lines in one tick */
+static long EdgeAtUpdate;             /* start edge with the tick update, other line busy */
+static int Errors;
+
+static unsigned long Seed = 1;
+
+static unsigned long rnd(void)
+{
+  Seed = Seed * 1103515245UL + 12345UL;
+  return (Seed >> 8) & 0xFFFFFFUL;
+}
+
+/* light outputs, not used */
+static void light(DALI_UNIT_PARAMS u16 level)
+{
+  (void)unit;
+  (void)level;
+}
+
+static void ctl_received(DALI_LINE_PARAMS u8 bits, u8 *frame)
+{
+  (void)line;
+  (void)bits;
+  (void)frame;
+}
+
+static void ctl_error(DALI_LINE_PARAMS u8 code)
+{
+  (void)line;
+  (void)code;
+}
+
+static void ctl_1ms(void)
+{
+}
+
+static void power_on(void)
+{
+  CLK->CKDIVR = 0x00;
+  TIM4->CR1 &= (u8)~TIM4_CR1_CEN;     /* started by the controllers: timebases of the gear computed too */
+  DALI_Init(light);
+  DALI_Light_On_Done();
+}
+
+/* TIM4 period of the gear: interrupt (both lines), main loop pass */
+static void gear_tick(void)
+{
+  int active = 0;
+  int l;
+
+  TIM4_UPD_OVF_IRQHandler();
+  if (DALI_TimerStatus())
+    DALI_CheckAndExecuteTimer();
+  DALI_CheckAndExecuteReceivedCommand();
+  for (l = 0; l < DALI_LINES; l++)
+    active += (DALILines[l].flag != NO_ACTION);
+  Busy[active]++;
+}
+
+/* next frame of the sequence of the controller, once the previous one is
+   through */
+static void ctl_main(u8 l)
+{
+  TLine *c = &Line[l];
+  u8 status;
+  u8 f[2];
+
+  if (c->pending)
+  {
+    status = ctl_get_send_status(l);
+    if ((status == DALI_TX_PENDING) || (status == DALI_TX_WAIT_ANSWER))
+      return;
+    c->pending = 0;
+    if (status != DALI_TX_FAILED)
+      c->sent++;
+    if (c->step == STEP_QUERY)
+    {
+      c->queries++;
+      if ((status == DALI_TX_ANSWER) && (ctl_get_send_answer(l) == c->value))
+        c->right++;
+      c->step = STEP_GAP;
+      c->gap = (long)(rnd() % (MaxGap + 1)) * TICKS_PER_SECOND / 1000;
+    }
+  }
+  switch (c->step)
+  {
+    case STEP_GAP:
+      if ((c->gap-- > 0) || !Sequences)
+        return;
+      c->scene = (u8)(rnd() % SCENES);
+      do
+        c->value = (u8)rnd();
+      while (c->value == c->stored[c->scene]);
+      f[0] = DALI_DTR;
+      f[1] = c->value;
+      c->step = STEP_DTR;
+      break;
+    case STEP_DTR:
+    case STEP_STORE:
+      f[0] = DALI_BROADCAST;
+      f[1] = (u8)(DALI_STORE_SCENE + c->scene);
+      c->step++;
+      break;
+    default: // STEP_STORE2
+      c->stored[c->scene] = c->value;
+      f[0] = DALI_BROADCAST;
+      f[1] = (u8)(DALI_QUERY_SCENE + c->scene);
+      c->step = STEP_QUERY;
+      break;
+  }
+  c->pending = ctl_send_forward(l, DALI_FRAME_16, f, 1, (u8)(c->step == STEP_QUERY));
+  if (!c->pending)
+    Errors++;
+}
+
+/* software priority level 0..3 of an ITC_PRIORITYLEVEL_x value */
+static int itc_level(u8 priority)
+{
+  switch (priority)
+  {
+    case ITC_PRIORITYLEVEL_1: return 1;
+    case ITC_PRIORITYLEVEL_2: return 2;
+    case ITC_PRIORITYLEVEL_3: return 3;
+    default:                  return 0;
+  }
+}
+
+/* one subtick: each bus (wired AND of its controller and the gear line)
+   seen DELAY subticks later at both inputs. A start edge in the subtick of
+   the tick update is pending together with TIM4: at the same priority the
+   port interrupt (lower vector) runs first and TIM4 enters EXTI_COUNTS
+   late, at a lower one TIM4 runs first */
+static void step(void)
+{
+  TLine *c;
+  long tick = Now / SUBTICKS;
+  int update = !(Now % SUBTICKS);
+  int exti_first;
+  int edge[DALI_LINES];
+  int late = 0;
+  int gear_out;
+  int bus;
+  u8 l;
+
+  for (l = 0; l < DALI_LINES; l++)
+  {
+    c = &Line[l];
+    gear_out = ((c->out_port->ODR >> c->out_pin) & 1) ^ c->out_invert;
+    bus = gear_out & ((c->ctl_port.ODR >> CTL_OUT) & 1);
+    c->history[Now % (DELAY + 1)] = bus;
+    bus = c->history[(Now + 1) % (DELAY + 1)];
+
+    c->ctl_port.IDR = (u8)((c->ctl_port.ODR & (1 << CTL_OUT)) | (bus << CTL_IN));
+    if (c->ctl_view && !bus && (c->ctl_port.CR2 & (1 << CTL_IN)))
+      ctl_receive_edge(&c->ctl_port);
+    c->ctl_view = bus;
+
+    c->out_port->IDR = (u8)((c->out_port->IDR & ~(1 << c->out_pin)) | (c->out_port->ODR & (1 << c->out_pin)));
+    if (bus ^ c->in_invert)
+      c->in_port->IDR |= (u8)(1 << c->in_pin);
+    else
+      c->in_port->IDR &= (u8)~(1 << c->in_pin);
+    edge[l] = c->gear_view && !bus && (c->in_port->CR2 & (1 << c->in_pin));
+    c->gear_view = bus;
+  }
+
+  exti_first = (itc_level(HostItcPriority[ITC_IRQ_PORTB]) >= itc_level(HostItcPriority[ITC_IRQ_TIM4_OVF]));
+  if (update && !exti_first)
+  {
+    TIM4->CNTR = 0;
+    gear_tick();
+  }
+  for (l = 0; l < DALI_LINES; l++)
+    if (edge[l])
+    {
+      c = &Line[l];
+      c->start_tick = tick;
+      if (Line[l ^ 1].start_tick == tick)
+        SameTick++;
+      if (update && (DALILines[l ^ 1].flag != NO_ACTION))
+      {
+        EdgeAtUpdate++;
+        late = exti_first;
+      }
+      c->edge();
+    }
+  if (update && exti_first)
+  {
+    TIM4->CNTR = (u8)(late ? EXTI_COUNTS : 0);
+    gear_tick();
+  }
+  for (l = 0; l < DALI_LINES; l++)
+    if (Now % SUBTICKS == Line[l].ctl_phase)
+    {
+      ctl_main(l);
+      TIM4->CNTR = (u8)rnd();
+      ctl_line_tick(l);
+    }
+  Now++;
+}
+
+static void run_ms(long ms)
+{
+  long end = Now + ms * SUBTICKS * TICKS_PER_SECOND / 1000;
+
+  while (Now < end)
+    step();
+}
+
+/* forward frame of controller l alone, returns the backward frame of a
+   query or -1 */
+static int frame(u8 l, u8 address, u8 data, int query)
+{
+  u8 f[2];
+  u8 status;
+
+  f[0] = address;
+  f[1] = data;
+  ctl_send_forward(l, DALI_FRAME_16, f, 1, (u8)query);
+  do
+  {
+    step();
+    status = ctl_get_send_status(l);
+  } while ((status == DALI_TX_PENDING) || (status == DALI_TX_WAIT_ANSWER));
+  return (status == DALI_TX_ANSWER) ? ctl_get_send_answer(l) : -1;
+}
+
+static void check(int ok, const char *what)
+{
+  if (!ok)
+  {
+    printf("FAILED: %s\n", what);
+    Errors++;
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: linesim [-t seconds] [-g max gap ms] [-r seed]\n");
+  exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+  TDALIStats gear;
+  long end;
+  long busy;
+  int stored;
+  int units;
+  u8 l;
+  int i;
+  int u;
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+      usage();
+    switch (argv[i][1])
+    {
+      case 't': Seconds = atof(argv[++i]); break;
+      case 'g': MaxGap = atoi(argv[++i]); break;
+      case 'r': Seed = (unsigned long)atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if ((Seconds <= 0) || (MaxGap < 0))
+    usage();
+
+  Line[0].out_port = OUT_DALI_PORT;
+  Line[0].out_pin = OUT_DALI_PIN;
+  Line[0].out_invert = INVERT_OUT_DALI;
+  Line[0].in_port = IN_DALI_PORT;
+  Line[0].in_pin = IN_DALI_PIN;
+  Line[0].in_invert = INVERT_IN_DALI;
+  Line[0].edge = EXTI_PORTB_IRQHandler;
+  Line[1].out_port = OUT_DALI2_PORT;
+  Line[1].out_pin = OUT_DALI2_PIN;
+  Line[1].out_invert = INVERT_OUT_DALI2;
+  Line[1].in_port = IN_DALI2_PORT;
+  Line[1].in_pin = IN_DALI2_PIN;
+  Line[1].in_invert = INVERT_IN_DALI2;
+  Line[1].edge = EXTI_PORTE_IRQHandler;
+  for (l = 0; l < DALI_LINES; l++)
+  {
+    Line[l].gear_view = 1;
+    Line[l].ctl_view = 1;
+    Line[l].start_tick = -1;
+    Line[l].ctl_phase = 3 + 2 * l;
+    for (i = 0; i <= DELAY; i++)
+      Line[l].history[i] = 1;
+    memset(Line[l].stored, 0xFF, sizeof(Line[l].stored));
+    Line[l].ctl_port.ODR = 1 << CTL_OUT;
+    ctl_init_DALI(l, &Line[l].ctl_port, CTL_OUT, 0, &Line[l].ctl_port, CTL_IN, 0, ctl_received, ctl_error, ctl_1ms);
+  }
+  power_on();
+  run_ms(1000);
+
+  gear = DALIStats;
+  reset_tick_jitter();
+  end = Now + (long)(Seconds * SUBTICKS * TICKS_PER_SECOND);
+  Sequences = 1;
+  while (Now < end)
+    step();
+  Sequences = 0;
+  while (Line[0].pending || Line[1].pending || (Line[0].step != STEP_GAP) || (Line[1].step != STEP_GAP))
+    step();
+  run_ms(10);                         /* stop bits of the last answer */
+  gear.frames = DALIStats.frames - gear.frames;
+  gear.err_start = DALIStats.err_start - gear.err_start;
+  gear.err_stop = DALIStats.err_stop - gear.err_stop;
+  gear.err_edge = DALIStats.err_edge - gear.err_edge;
+  gear.replies = DALIStats.replies - gear.replies;
+
+  printf("%.0f s, sequences 0..%d ms apart on each line\n", Seconds, MaxGap);
+  printf("line     sent  queries    right\n");
+  for (l = 0; l < DALI_LINES; l++)
+  {
+    printf("%4u %8ld %8ld %8ld\n", l, Line[l].sent, Line[l].queries, Line[l].right);
+    check(Line[l].right == Line[l].queries, "answers on a line");
+  }
+  busy = Busy[1] + Busy[2];
+  printf("gear: decoded %lu of %ld, errors start %lu stop %lu edge %lu, answers %lu\n",
+         (unsigned long)gear.frames, Line[0].sent + Line[1].sent, (unsigned long)gear.err_start,
+         (unsigned long)gear.err_stop, (unsigned long)gear.err_edge, (unsigned long)gear.replies);
+  printf("both lines busy %.1f%% of the busy time, frames started in the same tick %ld\n",
+         busy ? 100.0 * Busy[2] / busy : 0.0, SameTick);
+  printf("tick jitter %u us (budget %u us), start edges at the update with the other line busy %ld,\n"
+         "port interrupt level %d, TIM4 level %d\n", get_tick_jitter_us(), DALI_LATENCY_BUDGET_US,
+         EdgeAtUpdate, itc_level(HostItcPriority[ITC_IRQ_PORTB]), itc_level(HostItcPriority[ITC_IRQ_TIM4_OVF]));
+  check(get_tick_jitter_us() <= DALI_LATENCY_BUDGET_US, "tick jitter");
+  check(gear.frames == (u32)(Line[0].sent + Line[1].sent), "frames decoded");
+  check(!gear.err_start && !gear.err_stop && !gear.err_edge, "decoding errors");
+  check(gear.replies == (u32)(Line[0].queries + Line[1].queries), "answers sent");
+
+  /* scenes stored last are in EEPROM, each unit its own: power cycle, read back */
+  run_ms(100);
+  power_on();
+  run_ms(1000);
+  stored = 0;
+  for (l = 0; l < DALI_LINES; l++)
+    for (i = 0; i < SCENES; i++)
+      stored += (frame(l, DALI_BROADCAST, (u8)(DALI_QUERY_SCENE + i), 1) == Line[l].stored[i]);
+  printf("power cycled: %d of %d scenes read back\n", stored, DALI_LINES * SCENES);
+  check(stored == DALI_LINES * SCENES, "scenes in EEPROM");
+  units = 0;
+  for (u = 0; u < DALI_INSTANCES; u++)
+  {
+    stored = 0;
+    for (i = 0; i < SCENES; i++)
+      stored += (DALI_Read_Register((u8)u, (u8)(DALIREG_SCENE + i)) == Line[u % DALI_LINES].stored[i]);
+    units += (stored == SCENES);
+  }
+  printf("units: %d of %d with all scenes of their line\n", units, DALI_INSTANCES);
+  check(units == DALI_INSTANCES, "register images of the units");
+  return Errors ? 1 : 0;
+}
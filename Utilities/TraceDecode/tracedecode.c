@@ -0,0 +1,438 @@
+/**
+  ******************************************************************************
+  * @file    tracedecode.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: bus trace stream to a readable log and a replay file
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds on Linux with any C compiler, from this directory (headers of the
+   firmware only, see Utilities/HostShim):
+
+     cc -I../HostShim/inc -I../HostShim -I../../Project/inc
+        -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc tracedecode.c
+        -o tracedecode
+
+     tracedecode [-o log] [-w replay] [-v] [input]
+
+   input is the trace stream of DALI_TRACE (format of Project/inc/DALItrace.h):
+   a serial port (set to TRACE_BAUDRATE 8N1, raw, read until Ctrl-C), a file
+   or stdin (default). Records are decoded as they come, one log line each
+   (stdout or -o):
+     <s from the first record> <ms since the previous one> <line> <event> <details>
+   line is 0 or 1 (TRACE_LINE1), - for the records common to the lines.
+   TRACE_WRAP records are listed with -v only. Bytes which are no valid
+   record (type unknown, payload out of range, a wrap record with a
+   timestamp, a timestamp going backwards) are skipped until the stream is
+   in step again, so the tool can be started while the device is sending;
+   a record is decoded when the next one has come (Ctrl-C decodes the
+   last one).
+   The device drops a TRACE_WRAP record only with its buffer full, so a
+   timestamp may go backwards in a TRACE_LOST record only: the wrap is
+   counted there. If that record was corrupted as well, the wrap is counted
+   at the BACKWARDS_WRAP th record in step going backwards.
+
+   -w writes the valid records, unchanged and in order, to a replay file:
+   the input of Utilities/TraceReplay (offline replay into the host build of
+   the stack) and of DALI_TRACE_REPLAY (streamed back into the UART of the
+   device). A lost wrap gets its TRACE_WRAP record inserted, so long gaps
+   keep their length. The record counts go
+   to stderr. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#undef CR1                            /* termios delay masks, register names of stm8s.h */
+#undef CR2
+#undef CR3
+#include "stm8s.h"
+#include "DALIslave.h"
+#include "DALItrace.h"
+
+#define RECORD_MAX      (3 + 1 + DALI_FRAME_BYTES)
+#define READ_SIZE       4096
+#define TYPES           0x100
+#define BACKWARDS_WRAP  4             /* records going backwards taken as a lost wrap */
+
+static FILE *Log;
+static FILE *Replay;
+static int Verbose;
+static volatile sig_atomic_t Stop;
+
+static unsigned long Wraps;           /* timestamp wraps so far */
+static unsigned long Last;            /* tick of the previous record */
+static unsigned long First;
+static int Started;
+static unsigned long Count[TYPES];
+static int Backwards;                 /* records in step rejected for their timestamp */
+static unsigned long Garbage, Repaired, Lost;
+
+static const char *StateName[] =
+{
+  "NO_ACTION", "SENDING_DATA", "RECEIVING_DATA", "ERR", "SENDING_FORWARD", "SENDING_BREAK"
+};
+
+static const char *ErrorName[] =
+{
+  "", "start bit too long", "edge or wrong level in stop bits", "missing edge in data bits"
+};
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: tracedecode [-o log] [-w replay] [-v] [input]\n");
+  exit(2);
+}
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  Stop = 1;
+}
+
+/* payload bytes of a record type, -1 if it is none (as trace_len) */
+static int payload(u8 type)
+{
+  if (type == TRACE_STATE)
+    return 2;
+  switch (type & (u8)~TRACE_LINE1)
+  {
+    case TRACE_START:
+    case TRACE_IF_FAIL:
+      return 0;
+    case TRACE_FRAME_TX:
+    case TRACE_ERROR:
+      return 1;
+    case TRACE_FRAME_RX:
+      return 2;
+    case TRACE_FRAME_RXL:
+      return 1 + DALI_FRAME_BYTES;
+    default:
+      break;
+  }
+  if (type == TRACE_WRAP)
+    return 0;
+  if (type == TRACE_LOST)
+    return 1;
+  return -1;
+}
+
+/* payload values the firmware can send */
+static int plausible(const u8 *r)
+{
+  switch (r[0] & (u8)~TRACE_LINE1)
+  {
+    case TRACE_ERROR:
+      return (r[3] >= TRACE_ERR_START) && (r[3] <= TRACE_ERR_EDGE);
+    case TRACE_FRAME_RXL:
+      return (r[3] > 0) && (r[3] <= 8 * DALI_FRAME_BYTES);
+    default:
+      break;
+  }
+  if (r[0] == TRACE_WRAP)
+    return (r[1] == 0) && (r[2] == 0);
+  if (r[0] == TRACE_STATE)
+    return (r[3] < 2) && (r[4] < sizeof(StateName) / sizeof(StateName[0]));
+  if (r[0] == TRACE_LOST)
+    return r[3] != 0;
+  return 1;
+}
+
+static void put_replay(const u8 *r, int len)
+{
+  if (Replay && (fwrite(r, 1, (size_t)len, Replay) != (size_t)len))
+  {
+    perror("replay");
+    exit(2);
+  }
+}
+
+/* one record of len bytes, 0 if its timestamp shows the stream is out of step */
+static int record(const u8 *r, int len)
+{
+  static const u8 wrap[3] = { TRACE_WRAP, 0, 0 };
+  unsigned long at;
+  char line;
+  char details[64];
+  const char *event;
+  int i;
+
+  at = (Wraps << 16) | ((unsigned long)r[1] << 8) | r[2];
+  if (r[0] == TRACE_WRAP)
+    at = ++Wraps << 16;
+  else if (Started && (at < Last))
+  { // a wrap record is dropped only with the buffer full: TRACE_LOST comes first
+    if ((r[0] != TRACE_LOST) && (++Backwards < BACKWARDS_WRAP))
+      return 0;
+    Backwards = 0;
+    Wraps++;
+    at += 0x10000UL;
+    Repaired++;
+    put_replay(wrap, sizeof(wrap));
+  }
+  Backwards = 0;
+  Count[r[0]]++;
+  put_replay(r, len);
+  if (!Started)
+  {
+    Started = 1;
+    First = at;
+    Last = at;
+  }
+
+  line = (r[0] & TRACE_LINE1) ? '1' : '0';
+  details[0] = 0;
+  if (r[0] == TRACE_WRAP)
+  {
+    line = '-';
+    event = "wrap";
+  }
+  else if (r[0] == TRACE_LOST)
+  {
+    line = '-';
+    event = "lost";
+    Lost += r[3];
+    sprintf(details, "%u%s records dropped", r[3], (r[3] == 0xFF) ? " or more" : "");
+  }
+  else if (r[0] == TRACE_STATE)
+  {
+    line = (char)('0' + r[3]);
+    event = "state";
+    strcpy(details, StateName[r[4]]);
+  }
+  else
+  {
+    switch (r[0] & (u8)~TRACE_LINE1)
+    {
+      case TRACE_FRAME_RX:
+        event = "rx";
+        sprintf(details, "%02X %02X", r[3], r[4]);
+        break;
+      case TRACE_FRAME_TX:
+        event = "tx";
+        sprintf(details, "%02X", r[3]);
+        break;
+      case TRACE_START:
+        event = "start";
+        break;
+      case TRACE_ERROR:
+        event = "error";
+        strcpy(details, ErrorName[r[3]]);
+        break;
+      case TRACE_IF_FAIL:
+        event = "if_fail";
+        strcpy(details, "bus low 500ms");
+        break;
+      default: // TRACE_FRAME_RXL
+        event = (r[3] == 8) ? "backward" : "rxl";
+        sprintf(details, "%u bits", r[3]);
+        for (i = 0; i < (r[3] + 7) / 8; i++)
+          sprintf(details + strlen(details), " %02X", r[4 + i]);
+        break;
+    }
+  }
+  if ((r[0] != TRACE_WRAP) || Verbose)
+    fprintf(Log, "%12.6f %+10.3f %c %-8s %s\n", (double)(at - First) / TICKS_PER_SECOND,
+            (double)(at - Last) * 1000.0 / TICKS_PER_SECOND, line, event, details);
+  Last = at;
+  return 1;
+}
+
+/* raw 8N1 at TRACE_BAUDRATE if the input is a serial port */
+static void setup_port(int fd)
+{
+  struct termios tio;
+
+  if (!isatty(fd))
+    return;
+  if (tcgetattr(fd, &tio) < 0)
+  {
+    perror("tcgetattr");
+    exit(2);
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag &= (tcflag_t)~(CSTOPB | PARENB | CRTSCTS);
+  tio.c_cflag |= CLOCAL | CREAD | CS8;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+#if (TRACE_BAUDRATE == 115200)
+  cfsetispeed(&tio, B115200);
+#else
+ #error "set the termios speed of TRACE_BAUDRATE"
+#endif
+  if (tcsetattr(fd, TCSANOW, &tio) < 0)
+  {
+    perror("tcsetattr");
+    exit(2);
+  }
+  tcflush(fd, TCIFLUSH);
+}
+
+/* length of the record at r, 0 if it is not complete in avail bytes, -1 if
+   it is no record */
+static int length(const u8 *r, size_t avail)
+{
+  int len;
+
+  if (!avail)
+    return 0;
+  len = payload(r[0]);
+  if (len < 0)
+    return -1;
+  len += 3;
+  if ((size_t)len > avail)
+    return 0;
+  return plausible(r) ? len : -1;
+}
+
+/* record b can follow record a */
+static int in_order(const u8 *a, const u8 *b)
+{
+  if ((b[0] == TRACE_WRAP) || (b[0] == TRACE_LOST))
+    return 1;
+  return ((b[1] << 8) | b[2]) >= ((a[1] << 8) | a[2]);
+}
+
+/* decodes the records in buf, returns the bytes used: a record is taken
+   when a record with the same or a later timestamp follows it (or it is the
+   last one of the stream, end), anything else is read out of step, from
+   the middle of another record or a corrupted one */
+static size_t decode(const u8 *buf, size_t have, int end)
+{
+  size_t pos = 0;
+  int len;
+  int next;
+
+  while (pos < have)
+  {
+    len = length(buf + pos, have - pos);
+    if (len > 0)
+    {
+      next = length(buf + pos + len, have - pos - (size_t)len);
+      if ((next == 0) && !end)
+        break;                              /* wait for the next record */
+      if ((next > 0) ? in_order(buf + pos, buf + pos + len) && record(buf + pos, len)
+                     : (end && (next == 0) && record(buf + pos, len)))
+      {
+        pos += (size_t)len;
+        continue;
+      }
+    }
+    else if ((len == 0) && !end)
+      break;                                /* record not complete yet */
+    Garbage++;                              /* resynchronize on the next byte */
+    pos++;
+  }
+  return pos;
+}
+
+int main(int argc, char *argv[])
+{
+  static u8 buf[READ_SIZE + 2 * RECORD_MAX];  /* a record and the next one are kept */
+  struct sigaction sa;
+  const char *input = NULL;
+  size_t have = 0;
+  size_t pos;
+  ssize_t got;
+  int fd = 0;
+  int i;
+
+  Log = stdout;
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-v"))
+      Verbose = 1;
+    else if (!strcmp(argv[i], "-o") && (i + 1 < argc))
+    {
+      Log = fopen(argv[++i], "w");
+      if (!Log)
+      {
+        perror(argv[i]);
+        return 2;
+      }
+    }
+    else if (!strcmp(argv[i], "-w") && (i + 1 < argc))
+    {
+      Replay = fopen(argv[++i], "wb");
+      if (!Replay)
+      {
+        perror(argv[i]);
+        return 2;
+      }
+    }
+    else if ((argv[i][0] != '-') && !input)
+      input = argv[i];
+    else
+      usage();
+  }
+  if (input)
+  {
+    fd = open(input, O_RDONLY | O_NOCTTY);
+    if (fd < 0)
+    {
+      perror(input);
+      return 2;
+    }
+  }
+  setup_port(fd);
+
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = on_signal;                /* no SA_RESTART: read returns */
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  while (!Stop)
+  {
+    got = read(fd, buf + have, sizeof(buf) - have);
+    if (got < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      perror("read");
+      return 2;
+    }
+    if (got == 0)
+      break;
+    have += (size_t)got;
+    pos = decode(buf, have, 0);
+    have -= pos;
+    memmove(buf, buf + pos, have);
+    fflush(Log);
+  }
+  decode(buf, have, 1);
+
+  fflush(Log);
+  if (Replay && fclose(Replay))
+  {
+    perror("replay");
+    return 2;
+  }
+  fprintf(stderr, "records: rx %lu rxl %lu tx %lu start %lu error %lu if_fail %lu state %lu wrap %lu lost %lu\n",
+          Count[TRACE_FRAME_RX] + Count[TRACE_FRAME_RX | TRACE_LINE1],
+          Count[TRACE_FRAME_RXL] + Count[TRACE_FRAME_RXL | TRACE_LINE1],
+          Count[TRACE_FRAME_TX] + Count[TRACE_FRAME_TX | TRACE_LINE1],
+          Count[TRACE_START] + Count[TRACE_START | TRACE_LINE1],
+          Count[TRACE_ERROR] + Count[TRACE_ERROR | TRACE_LINE1],
+          Count[TRACE_IF_FAIL] + Count[TRACE_IF_FAIL | TRACE_LINE1],
+          Count[TRACE_STATE], Count[TRACE_WRAP], Count[TRACE_LOST]);
+  fprintf(stderr, "records dropped by the device %lu, bytes skipped %lu, wrap records inserted %lu\n",
+          Lost, Garbage, Repaired);
+  return 0;
+}
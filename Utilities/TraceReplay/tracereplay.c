@@ -0,0 +1,428 @@
+/**
+  ******************************************************************************
+  * @file    tracereplay.c
+  * @author  STMicroelectronics - MCD Application Team
+  * @version V2.0.0
+  * @date    07/04/2011
+  * @brief   Host tool: replays a bus trace into the stack in virtual time
+  ******************************************************************************
+  *
+  * THE PRESENT FIRMWARE WHICH IS FOR GUIDANCE ONLY AIMS AT PROVIDING CUSTOMERS
+  * WITH CODING INFORMATION REGARDING THEIR PRODUCTS IN ORDER FOR THEM TO SAVE
+  * TIME. AS A RESULT, STMICROELECTRONICS SHALL NOT BE HELD LIABLE FOR ANY
+  * DIRECT, INDIRECT OR CONSEQUENTIAL DAMAGES WITH RESPECT TO ANY CLAIMS ARISING
+  * FROM THE CONTENT OF SUCH FIRMWARE AND/OR THE USE MADE BY CUSTOMERS OF THE
+  * CODING INFORMATION CONTAINED HEREIN IN CONNECTION WITH THEIR PRODUCTS.
+  *
+  * <h2><center>&copy; COPYRIGHT 2011 STMicroelectronics</center></h2>
+  ******************************************************************************
+  */
+
+/* Builds on Linux (mmap) with any C compiler, from this directory (firmware
+   sources, see Utilities/HostShim):
+
+     cc -I../HostShim/inc -I../HostShim -I../../Project/inc
+        -I../../Libraries/DALIStack/inc
+        -I../../Libraries/STM8S_StdPeriph_Driver/inc tracereplay.c
+        ../HostShim/hostshim.c ../../Project/src/DALIslave.c
+        ../../Project/src/stm8s_it.c ../../Libraries/DALIStack/src/dali*.c
+        ../../Libraries/DALIStack/src/eeprom.c
+        ../../Libraries/DALIStack/src/lite_timer_8bit.c -o tracereplay
+
+     tracereplay [-o output] [-d reference] [-b boot ms] capture
+
+   Add -DDALI_LINES=2 / -DDALI_INSTANCES=n as the firmware the capture was
+   taken with was built.
+
+   capture is a bus trace in the format of Project/inc/DALItrace.h, as the
+   UART of DALI_TRACE sent it or as Utilities/TraceDecode wrote it, mapped
+   into memory: captures of several GB are read as they are paged in. The
+   firmware of this project runs in virtual time, a TIM4 interrupt and a
+   pass of the main loop per tick, from power on: each TRACE_FRAME_RX and
+   TRACE_FRAME_RXL record is handed to the stack by inject_frame (as
+   DALI_TRACE_REPLAY does on the target) at its recorded tick, the first
+   one -b ms (default 1000) after power on, the others at the recorded
+   delays (TRACE_WRAP records give the upper bits of the time). A frame
+   which comes while the line is busy (answer being sent) waits for the
+   next tick. Other records are skipped, bytes which are no record too.
+
+   Output, one line per event, time in ticks from power on:
+     <tick> rx <line> <bits> <frame hex>    frame injected
+     <tick> tx <line> <answer hex>          backward frame started
+     <tick> light <unit> <level>            light output changed
+     <tick> reg <unit> <index> <value hex>  register changed (DALIR_ReadReg)
+   Registers are listed all after power on, then compared after the main
+   loop handled each frame. Runs are deterministic: -d compares the output
+   with a reference output line by line, lists the first differences and
+   exits with 1 if there is one. The replay speed goes to stderr. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stm8s.h"
+#include "hostshim.h"
+#include "stm8s_it.h"
+#include "dali_config.h"
+#include "dali.h"
+#include "dali_regs.h"
+#include "DALIslave.h"
+#include "DALItrace.h"
+
+#define LINE_MAX_LEN    80
+#define DIFFS_SHOWN     10
+#define REGS            DALIREG_ROM_END
+
+typedef struct
+{
+  const u8 *data;
+  size_t size;
+} TMapped;
+
+static FILE *Out;
+static TMapped Ref;
+static size_t RefPos;
+static unsigned long OutLines;
+static unsigned long Diffs;
+
+static unsigned long Now;             /* ticks from power on */
+static u16 Light[DALI_INSTANCES];
+static u16 LightShown[DALI_INSTANCES];
+static u8 Regs[DALI_INSTANCES][REGS];
+static u8 LineFlag[DALI_LINES];
+
+static unsigned long Records, Injected, Delayed, Skipped, Garbage, Answers;
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: tracereplay [-o output] [-d reference] [-b boot ms] capture\n");
+  exit(2);
+}
+
+static void map_file(const char *name, TMapped *m)
+{
+  struct stat st;
+  int fd;
+
+  fd = open(name, O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &st) < 0))
+  {
+    perror(name);
+    exit(2);
+  }
+  m->size = (size_t)st.st_size;
+  m->data = NULL;
+  if (m->size)
+  {
+    m->data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m->data == MAP_FAILED)
+    {
+      perror(name);
+      exit(2);
+    }
+    madvise((void *)m->data, m->size, MADV_SEQUENTIAL);
+  }
+  close(fd);
+}
+
+/* one output line: written to -o, compared with the next line of -d */
+static void emit(const char *fmt, ...)
+{
+  char line[LINE_MAX_LEN];
+  size_t len;
+  size_t end;
+  va_list ap;
+
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  OutLines++;
+  if (Out)
+    fprintf(Out, "%s\n", line);
+  if (!Ref.data && !Ref.size)
+    return;
+  for (end = RefPos; (end < Ref.size) && (Ref.data[end] != '\n'); end++)
+    ;
+  len = strlen(line);
+  if ((RefPos >= Ref.size) || (end - RefPos != len) || memcmp(&Ref.data[RefPos], line, len))
+  {
+    if (++Diffs <= DIFFS_SHOWN)
+      printf("line %lu: %s\n     reference: %.*s\n", OutLines, line,
+             (RefPos < Ref.size) ? (int)(end - RefPos) : 5, (RefPos < Ref.size) ? (const char *)&Ref.data[RefPos] : "(end)");
+  }
+  RefPos = (end < Ref.size) ? end + 1 : end;
+}
+
+/* light output callback of DALI_Init */
+static void light(DALI_UNIT_PARAMS u16 level)
+{
+#if (DALI_INSTANCES > 1)
+  Light[unit] = level;
+#else
+  Light[0] = level;
+#endif
+}
+
+static u8 read_reg(u8 unit, u8 idx)
+{
+#if (DALI_INSTANCES > 1)
+  return DALI_Read_Register(unit, idx);
+#else
+  (void)unit;
+  return DALI_Read_Register(idx);
+#endif
+}
+
+/* registers which changed (all of them if all) */
+static void compare_regs(int all)
+{
+  u8 unit;
+  u8 idx;
+  u8 val;
+
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+    for (idx = 0; idx < REGS; idx++)
+    {
+      val = read_reg(unit, idx);
+      if (all || (val != Regs[unit][idx]))
+        emit("%lu reg %u %u %02X", Now, unit, idx, val);
+      Regs[unit][idx] = val;
+    }
+}
+
+/* one tick: TIM4 interrupt, main loop pass of Project/src/main.c, answers
+   started and light output changes */
+static void tick(void)
+{
+  u8 line;
+  u8 unit;
+
+  Now++;
+  TIM4_UPD_OVF_IRQHandler();
+  if (DALI_TimerStatus())
+    DALI_CheckAndExecuteTimer();
+  DALI_CheckAndExecuteReceivedCommand();
+  for (line = 0; line < DALI_LINES; line++)
+  {
+    if ((DALILines[line].flag == SENDING_DATA) && (LineFlag[line] != SENDING_DATA))
+    {
+      Answers++;
+      emit("%lu tx %u %02X", Now, line, DALILines[line].answer);
+    }
+    LineFlag[line] = DALILines[line].flag;
+  }
+  for (unit = 0; unit < DALI_INSTANCES; unit++)
+    if (Light[unit] != LightShown[unit])
+    {
+      LightShown[unit] = Light[unit];
+      emit("%lu light %u %u", Now, unit, Light[unit]);
+    }
+}
+
+/* payload bytes of a record type, -1 if it is none */
+static int payload(u8 type)
+{
+  switch (type)
+  {
+    case TRACE_WRAP:
+    case TRACE_START:
+    case TRACE_IF_FAIL:
+    case TRACE_START | TRACE_LINE1:
+    case TRACE_IF_FAIL | TRACE_LINE1:
+      return 0;
+    case TRACE_FRAME_TX:
+    case TRACE_ERROR:
+    case TRACE_LOST:
+    case TRACE_FRAME_TX | TRACE_LINE1:
+    case TRACE_ERROR | TRACE_LINE1:
+      return 1;
+    case TRACE_FRAME_RX:
+    case TRACE_FRAME_RX | TRACE_LINE1:
+    case TRACE_STATE:
+      return 2;
+    case TRACE_FRAME_RXL:
+    case TRACE_FRAME_RXL | TRACE_LINE1:
+      return 1 + DALI_FRAME_BYTES;
+    default:
+      return -1;
+  }
+}
+
+static void inject(u8 line, u8 bits, u8 *frame)
+{
+  char hex[2 * DALI_FRAME_BYTES + 1];
+  int bytes = (bits + 7) / 8;
+  int i;
+
+  if (bytes > DALI_FRAME_BYTES)
+    bytes = DALI_FRAME_BYTES;
+  for (i = 0; i < bytes; i++)
+    sprintf(&hex[2 * i], "%02X", frame[i]);
+  hex[2 * bytes] = 0;
+#if (DALI_LINES > 1)
+  while (!inject_frame(line, bits, frame))
+#else
+  while (!inject_frame(bits, frame))
+#endif
+  {
+    Delayed++;
+    tick();
+  }
+  Injected++;
+  emit("%lu rx %u %u %s", Now, line, bits, hex);
+  DALI_CheckAndExecuteReceivedCommand();
+  compare_regs(0);
+}
+
+int main(int argc, char *argv[])
+{
+  TMapped cap;
+  const char *capture = NULL;
+  const char *output = NULL;
+  const char *reference = NULL;
+  long boot_ms = 1000;
+  unsigned long wraps = 0;
+  unsigned long start = 0;
+  unsigned long last = 0;
+  unsigned long at;
+  int first = 1;
+  clock_t clk;
+  double real;
+  size_t pos;
+  u8 frame[DALI_FRAME_BYTES];
+  u8 type;
+  u8 line;
+  int len;
+  int i;
+
+  for (i = 1; i < argc; i++)
+  {
+    if (argv[i][0] != '-')
+    {
+      if (capture)
+        usage();
+      capture = argv[i];
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage();
+    switch (argv[i][1])
+    {
+      case 'o': output = argv[++i]; break;
+      case 'd': reference = argv[++i]; break;
+      case 'b': boot_ms = atol(argv[++i]); break;
+      default: usage();
+    }
+  }
+  if (!capture || (boot_ms < 0))
+    usage();
+  map_file(capture, &cap);
+  if (reference)
+  {
+    map_file(reference, &Ref);
+    if (!Ref.size)
+      Ref.data = (const u8 *)"";
+  }
+  if (output)
+  {
+    Out = fopen(output, "w");
+    if (!Out)
+    {
+      perror(output);
+      return 2;
+    }
+  }
+
+  clk = clock();
+  CLK->CKDIVR = 0x00;
+  DALI_Init(light);
+  DALI_Light_On_Done();
+  for (line = 0; line < DALI_LINES; line++)
+  { // idle bus at the inputs
+    if (DALILines[line].in_invert)
+      DALILines[line].in_port->IDR &= (u8)~DALILines[line].in_pin;
+    else
+      DALILines[line].in_port->IDR |= DALILines[line].in_pin;
+  }
+  compare_regs(1);
+
+  pos = 0;
+  while (pos + 3 <= cap.size)
+  {
+    type = cap.data[pos];
+    len = payload(type);
+    if ((len < 0) || (pos + 3 + len > cap.size))
+    { // no record: resynchronize on the next byte
+      Garbage++;
+      pos++;
+      continue;
+    }
+    Records++;
+    at = (wraps << 16) | ((unsigned long)cap.data[pos + 1] << 8) | cap.data[pos + 2];
+    if (type == TRACE_WRAP)
+      at = ++wraps << 16;
+    else if (!first && (at < last))
+    { // wrap record lost
+      wraps++;
+      at += 0x10000UL;
+    }
+    last = at;
+    line = (u8)((type & TRACE_LINE1) ? 1 : 0);
+    if ((type & ~TRACE_LINE1) == TRACE_FRAME_RX)
+    {
+      frame[0] = cap.data[pos + 3];
+      frame[1] = cap.data[pos + 4];
+      frame[2] = 0;
+      frame[3] = 0;
+      len = DALI_FRAME_16;
+    }
+    else if ((type & ~TRACE_LINE1) == TRACE_FRAME_RXL)
+    {
+      len = cap.data[pos + 3];
+      memcpy(frame, &cap.data[pos + 4], DALI_FRAME_BYTES);
+    }
+    else
+    {
+      pos += 3 + payload(type);
+      continue;
+    }
+    pos += 3 + payload(type);
+    if (line >= DALI_LINES)
+    {
+      Skipped++;
+      continue;
+    }
+    if (first)
+    {
+      first = 0;
+      start = at - (unsigned long)(boot_ms * TICKS_PER_SECOND / 1000);
+    }
+    while (Now < at - start)
+      tick();
+    inject(line, (u8)len, frame);
+  }
+  for (i = 0; i < TICKS_PER_SECOND; i++)
+    tick();
+  compare_regs(0);
+
+  real = (double)(clock() - clk) / CLOCKS_PER_SEC;
+  fprintf(stderr, "%lu records, %lu frames replayed (%lu waited for the line, %lu of other lines), %lu answers, %lu bytes skipped\n",
+          Records, Injected, Delayed, Skipped, Answers, Garbage);
+  fprintf(stderr, "%.1f s bus time in %.2f s: %.0f x real time, %.0f frames/s\n", (double)Now / TICKS_PER_SECOND, real,
+          real > 0 ? (double)Now / TICKS_PER_SECOND / real : 0.0, real > 0 ? Injected / real : 0.0);
+  if (Out)
+    fclose(Out);
+  if (reference)
+  {
+    if (RefPos < Ref.size)
+      Diffs++;
+    printf("%lu lines, %lu differences with %s\n", OutLines, Diffs, reference);
+    return Diffs ? 1 : 0;
+  }
+  return 0;
+}